@@ -1,26 +1,23 @@
 #include "AABBTree.h"
+#include "ComponentCamera.h"
+#include "JobSystem.h"
 #include <assert.h>
 #include <stack>
+#include <algorithm>
+#include <limits>
+#include <functional>
 #include "debugdraw.h"
 
 
 AABBTree::AABBTree(unsigned initialSize)
 {
-	nodeCapacity = initialSize;
-	//Resize
-	nodes.resize(initialSize);
-	for (unsigned nodeIndex = 0; nodeIndex < initialSize; nodeIndex++)
-	{
-		NodeAABB &node = nodes[nodeIndex];
-		node.nextNodeIndex = nodeIndex + 1;
-	}
-	nodes[initialSize - 1].nextNodeIndex = AABB_NULL_NODE;
+	GrowPool(initialSize);
+	nextFreeNodeIndex = 0;
 }
 
 AABBTree::~AABBTree()
 {
 	nodes.clear();
-	objectNodeIndexMap.clear();
 }
 
 unsigned AABBTree::AllocateNode()
@@ -30,16 +27,8 @@ unsigned AABBTree::AllocateNode()
 	{
 		assert(allocatedNodeCount == nodeCapacity);
 
-		nodeCapacity += growthSize;
-		nodes.resize(nodeCapacity);
-		nodes[allocatedNodeCount - 1].nextNodeIndex = allocatedNodeCount;
-		for (unsigned nodeIndex = allocatedNodeCount; nodeIndex < nodeCapacity; nodeIndex++)
-		{
-			NodeAABB& node = nodes[nodeIndex];
-			node.nextNodeIndex = nodeIndex + 1;
-		}
-		nodes[nodeCapacity - 1].nextNodeIndex = AABB_NULL_NODE;
-		nextFreeNodeIndex = allocatedNodeCount;
+		nextFreeNodeIndex = nodeCapacity;
+		GrowPool(nodeCapacity + growthSize);
 	}
 
 	unsigned nodeIndex = nextFreeNodeIndex;
@@ -47,14 +36,37 @@ unsigned AABBTree::AllocateNode()
 	nextFreeNodeIndex = allocatedNode.nextNodeIndex;
 	allocatedNodeCount++;
 
+	// freed parents keep their child links, start clean
+	allocatedNode = NodeAABB();
+
 	return nodeIndex;
 
 }
 
+void AABBTree::GrowPool(unsigned newCapacity)
+{
+	// new nodes are linked as free nodes, the last one ends the list. A pool of 0 nodes still grows so the
+	// list has a last node
+	unsigned oldCapacity = nodes.size();
+	nodeCapacity = std::max(newCapacity, oldCapacity + growthSize);
+	nodes.resize(nodeCapacity);
+	leafCenters.resize(nodeCapacity);
+	for (unsigned nodeIndex = oldCapacity; nodeIndex < nodeCapacity; nodeIndex++)
+	{
+		NodeAABB& node = nodes[nodeIndex];
+		node.nextNodeIndex = nodeIndex + 1;
+		node.height = -1;
+	}
+	nodes[nodeCapacity - 1].nextNodeIndex = AABB_NULL_NODE;
+
+	return;
+}
+
 void AABBTree::DeallocateNode(unsigned nodeIndex)
 {
 	NodeAABB& deallocateNode = nodes[nodeIndex];
 	deallocateNode.nextNodeIndex = nextFreeNodeIndex;
+	deallocateNode.height = -1;
 	nextFreeNodeIndex = nodeIndex;
 	allocatedNodeCount--;
 
@@ -64,33 +76,31 @@ void AABBTree::DeallocateNode(unsigned nodeIndex)
 void AABBTree::Insert(GameObject * go)
 {
 	assert(go != nullptr);
+	assert(go->aabbTreeNodeIndex == AABB_NULL_NODE);
 
 	unsigned nodeIndex = AllocateNode();
-	NodeAABB& node = nodes[nodeIndex];
+	nodes[nodeIndex].go = go;
+	go->aabbTreeNodeIndex = nodeIndex;
+	leafCenters[nodeIndex] = go->globalBoundingBox->CenterPoint();
+	++objectCount;
 
-	//AABB a bit bigger for avoiding little movements
-	AABB auxAABB = AABB(go->globalBoundingBox->minPoint - float3(2,2,2), go->globalBoundingBox->maxPoint + float3(2,2,2));
-	node.aabb = auxAABB;
-	node.go = go;
-
-	InsertLeaf(nodeIndex);
-	objectNodeIndexMap[go] = nodeIndex;
+	InsertLeaf(nodeIndex, FatAABB(*go->globalBoundingBox, float3::zero));
 
 	return;
 }
 
-void AABBTree::InsertLeaf(unsigned leafNodeIndex)
+void AABBTree::InsertLeaf(unsigned leafNodeIndex, const AABB &leafAABB)
 {
 	// make sure we're inserting a new leaf
 	assert(nodes[leafNodeIndex].parentNodeIndex == AABB_NULL_NODE);
-	assert(nodes[leafNodeIndex].leftNodeIndex == AABB_NULL_NODE);
-	assert(nodes[leafNodeIndex].rightNodeIndex == AABB_NULL_NODE);
+	assert(nodes[leafNodeIndex].isLeaf());
 
 	
 	//if the tree is empty then we make the root the leaf
 	if (rootNodeIndex == AABB_NULL_NODE)
 	{
 		rootNodeIndex = leafNodeIndex;
+		rootAABB = leafAABB;
 		return;
 	}
 
@@ -98,41 +108,41 @@ void AABBTree::InsertLeaf(unsigned leafNodeIndex)
 	// search for the best place to put the new leaf in the tree
 	// we use surface area and depth as search heuristics
 	unsigned treeNodeIndex = rootNodeIndex;
-	NodeAABB& leafNode = nodes[leafNodeIndex];
+	AABB treeAABB = rootAABB;
 	while (!nodes[treeNodeIndex].isLeaf())
 	{
 		// because of the test in the while loop above we know we are never a leaf inside it
 		const NodeAABB& treeNode = nodes[treeNodeIndex];
-		unsigned leftNodeIndex = treeNode.leftNodeIndex;
-		unsigned rightNodeIndex = treeNode.rightNodeIndex;
-		const NodeAABB& leftNode = nodes[leftNodeIndex];
-		const NodeAABB& rightNode = nodes[rightNodeIndex];
+		unsigned leftNodeIndex = treeNode.childNodeIndex[0];
+		unsigned rightNodeIndex = treeNode.childNodeIndex[1];
+		AABB leftAabb = treeNode.ChildAABB(0);
+		AABB rightAabb = treeNode.ChildAABB(1);
 		
-		AABB combinedAabb = MergeAABB(treeNode.aabb,leafNode.aabb);
+		AABB combinedAabb = MergeAABB(treeAABB, leafAABB);
 
 		float newParentNodeCost = 2.0f * combinedAabb.SurfaceArea();
-		float minimumPushDownCost = 2.0f * (combinedAabb.SurfaceArea() - treeNode.aabb.SurfaceArea());
+		float minimumPushDownCost = 2.0f * (combinedAabb.SurfaceArea() - treeAABB.SurfaceArea());
 
 		// use the costs to figure out whether to create a new parent here or descend
 		float costLeft;
 		float costRight;
-		if (leftNode.isLeaf())
+		if (nodes[leftNodeIndex].isLeaf())
 		{
-			costLeft = MergeAABB(leftNode.aabb, leafNode.aabb).SurfaceArea() + minimumPushDownCost;
+			costLeft = MergeAABB(leftAabb, leafAABB).SurfaceArea() + minimumPushDownCost;
 		}
 		else
 		{
-			AABB newLeftAabb = MergeAABB(leftNode.aabb, leafNode.aabb);
-			costLeft = (newLeftAabb.SurfaceArea() - leftNode.aabb.SurfaceArea()) + minimumPushDownCost;
+			AABB newLeftAabb = MergeAABB(leftAabb, leafAABB);
+			costLeft = (newLeftAabb.SurfaceArea() - leftAabb.SurfaceArea()) + minimumPushDownCost;
 		}
-		if (rightNode.isLeaf())
+		if (nodes[rightNodeIndex].isLeaf())
 		{
-			costRight = MergeAABB(rightNode.aabb, leafNode.aabb).SurfaceArea() + minimumPushDownCost;
+			costRight = MergeAABB(rightAabb, leafAABB).SurfaceArea() + minimumPushDownCost;
 		}
 		else
 		{
-			AABB newRightAabb = MergeAABB(rightNode.aabb, leafNode.aabb);
-			costRight = (newRightAabb.SurfaceArea() - rightNode.aabb.SurfaceArea()) + minimumPushDownCost;
+			AABB newRightAabb = MergeAABB(rightAabb, leafAABB);
+			costRight = (newRightAabb.SurfaceArea() - rightAabb.SurfaceArea()) + minimumPushDownCost;
 		}
 
 		// if the cost of creating a new parent node here is less than descending in either direction then
@@ -146,54 +156,43 @@ void AABBTree::InsertLeaf(unsigned leafNodeIndex)
 		if (costLeft < costRight)
 		{
 			treeNodeIndex = leftNodeIndex;
+			treeAABB = leftAabb;
 		}
 		else
 		{
 			treeNodeIndex = rightNodeIndex;
+			treeAABB = rightAabb;
 		}
 	}
 
 	// the leafs sibling is going to be the node we found above and we are going to create a new
 	// parent node and attach the leaf and this item
+	unsigned leafSiblingIndex = treeNodeIndex;
+	unsigned oldParentIndex = nodes[leafSiblingIndex].parentNodeIndex;
 
+	// AllocateNode can grow the pool, only indices are kept across it
 	unsigned newParentIndex = AllocateNode();
-	NodeAABB& newParent = nodes[newParentIndex];
-	unsigned leafSiblingIndex = treeNodeIndex;
-	NodeAABB& leafSibling = nodes[leafSiblingIndex];
-	unsigned oldParentIndex = leafSibling.parentNodeIndex;
-	newParent.parentNodeIndex = oldParentIndex;
-	newParent.aabb = MergeAABB(leafNode.aabb, leafSibling.aabb); // the new parents aabb is the leaf aabb combined with it's siblings aabb
-	newParent.leftNodeIndex = leafSiblingIndex;
-	newParent.rightNodeIndex = leafNodeIndex;
-	nodes[leafNodeIndex].parentNodeIndex = newParentIndex;
-	//TODO: this was the source of the error, leafNode didnt change nodes[X] if x is 9, wonder why
-	//leafNode.parentNodeIndex = newParentIndex;
-	leafSibling.parentNodeIndex = newParentIndex;
+	nodes[newParentIndex].height = 1;
+	nodes[newParentIndex].parentNodeIndex = oldParentIndex;
+	SetChild(newParentIndex, 0, leafSiblingIndex, treeAABB);
+	SetChild(newParentIndex, 1, leafNodeIndex, leafAABB);
 
+	// the new parents aabb is the leaf aabb combined with it's siblings aabb
+	AABB newParentAabb = MergeAABB(leafAABB, treeAABB);
 	if (oldParentIndex == AABB_NULL_NODE)
 	{
 		// the old parent was the root and so this is now the root
 		rootNodeIndex = newParentIndex;
+		rootAABB = newParentAabb;
 	}
 	else
 	{
-		// the old parent was not the root and so we need to patch the left or right index to
-		// point to the new node
-		NodeAABB& oldParent = nodes[oldParentIndex];
-		if (oldParent.leftNodeIndex == leafSiblingIndex)
-		{
-			oldParent.leftNodeIndex = newParentIndex;
-		}
-		else
-		{
-			oldParent.rightNodeIndex = newParentIndex;
-		}
+		// the old parent was not the root and so we need to patch the slot that pointed to the sibling
+		SetChild(oldParentIndex, GetChildSlot(oldParentIndex, leafSiblingIndex), newParentIndex, newParentAabb);
 	}
 
 	// finally we need to walk back up the tree fixing heights and areas
-	//treeNodeIndex = leafNode.parentNodeIndex;
-	treeNodeIndex = nodes[leafNodeIndex].parentNodeIndex;
-	FixUpwardsTree(treeNodeIndex);
+	FixUpwardsTree(newParentIndex);
 
 	return;
 }
@@ -202,35 +201,87 @@ void AABBTree::FixUpwardsTree(unsigned treeNodeIndex)
 {
 	while (treeNodeIndex != AABB_NULL_NODE)
 	{
+		// rotate first so the refit is done on the final layout
+		treeNodeIndex = Balance(treeNodeIndex);
+
 		NodeAABB& treeNode = nodes[treeNodeIndex];
 
 		// every node should be a parent
-		assert(treeNode.leftNodeIndex != AABB_NULL_NODE && treeNode.rightNodeIndex != AABB_NULL_NODE);
+		assert(!treeNode.isLeaf());
 
-		// fix height and area
-		const NodeAABB& leftNode = nodes[treeNode.leftNodeIndex];
-		const NodeAABB& rightNode = nodes[treeNode.rightNodeIndex];
-		treeNode.aabb = MergeAABB(rightNode.aabb, leftNode.aabb);
+		// fix height and area, the area lives in the parent
+		treeNode.height = 1 + std::max(nodes[treeNode.childNodeIndex[0]].height, nodes[treeNode.childNodeIndex[1]].height);
+		SetNodeAABB(treeNodeIndex, MergeAABB(treeNode.ChildAABB(0), treeNode.ChildAABB(1)));
 
 		treeNodeIndex = treeNode.parentNodeIndex;
+	}
 
+	return;
 
-		if (treeNode.parentNodeIndex == treeNode.leftNodeIndex || treeNode.parentNodeIndex == treeNode.rightNodeIndex || treeNode.leftNodeIndex == treeNode.rightNodeIndex)
-		{
-			return;
-		}
+}
+
+unsigned AABBTree::Balance(unsigned treeNodeIndex)
+{
+	// same local rotations as Box2D's dynamic tree: if one child is more than one level taller
+	// than the other, the taller child is promoted and its shorter child goes down to this node
+	unsigned indexA = treeNodeIndex;
+	NodeAABB& nodeA = nodes[indexA];
+	if (nodeA.isLeaf() || nodeA.height < 2)
+		return indexA;
+
+	int balance = nodes[nodeA.childNodeIndex[1]].height - nodes[nodeA.childNodeIndex[0]].height;
+	if (balance >= -1 && balance <= 1)
+		return indexA;
+
+	// X is the taller child and Y the other one
+	int slotX = (balance > 1) ? 1 : 0;
+	int slotY = 1 - slotX;
+	unsigned indexX = nodeA.childNodeIndex[slotX];
+	unsigned indexY = nodeA.childNodeIndex[slotY];
+	NodeAABB& nodeX = nodes[indexX];
+	AABB aabbY = nodeA.ChildAABB(slotY);
+
+	int slotTall = (nodes[nodeX.childNodeIndex[0]].height > nodes[nodeX.childNodeIndex[1]].height) ? 0 : 1;
+	int slotShort = 1 - slotTall;
+	unsigned indexTall = nodeX.childNodeIndex[slotTall];
+	unsigned indexShort = nodeX.childNodeIndex[slotShort];
+	AABB aabbTall = nodeX.ChildAABB(slotTall);
+	AABB aabbShort = nodeX.ChildAABB(slotShort);
+
+	// X takes the place of A, the bounds of the subtree don't change
+	unsigned parentIndex = nodeA.parentNodeIndex;
+	nodeX.parentNodeIndex = parentIndex;
+	if (parentIndex == AABB_NULL_NODE)
+	{
+		rootNodeIndex = indexX;
+	}
+	else
+	{
+		nodes[parentIndex].childNodeIndex[GetChildSlot(parentIndex, indexA)] = indexX;
 	}
 
-	return;
+	// A keeps Y and takes the short grandchild where X was
+	SetChild(indexA, slotX, indexShort, aabbShort);
+	nodeA.height = 1 + std::max(nodes[indexY].height, nodes[indexShort].height);
+
+	// X gets A and the tall grandchild
+	SetChild(indexX, 0, indexA, MergeAABB(aabbY, aabbShort));
+	SetChild(indexX, 1, indexTall, aabbTall);
+	nodeX.height = 1 + std::max(nodeA.height, nodes[indexTall].height);
 
+	return indexX;
 }
 
 void AABBTree::Remove(GameObject* go)
 {
-	unsigned nodeIndex = objectNodeIndexMap[go];
+	unsigned nodeIndex = go->aabbTreeNodeIndex;
+	if (nodeIndex == AABB_NULL_NODE)
+		return;
+
 	RemoveLeaf(nodeIndex);
 	DeallocateNode(nodeIndex);
-	objectNodeIndexMap.erase(go);
+	go->aabbTreeNodeIndex = AABB_NULL_NODE;
+	--objectCount;
 
 	return;
 }
@@ -244,28 +295,19 @@ void AABBTree::RemoveLeaf(unsigned leafNodeIndex)
 		return;
 	}
 
-	NodeAABB& leafNode = nodes[leafNodeIndex];
-	unsigned parentNodeIndex = leafNode.parentNodeIndex;
+	unsigned parentNodeIndex = nodes[leafNodeIndex].parentNodeIndex;
 	const NodeAABB& parentNode = nodes[parentNodeIndex];
 	unsigned grandParentNodeIndex = parentNode.parentNodeIndex;
-	unsigned siblingNodeIndex = parentNode.leftNodeIndex == leafNodeIndex ? parentNode.rightNodeIndex : parentNode.leftNodeIndex;
+	int siblingSlot = 1 - GetChildSlot(parentNodeIndex, leafNodeIndex);
+	unsigned siblingNodeIndex = parentNode.childNodeIndex[siblingSlot];
+	AABB siblingAabb = parentNode.ChildAABB(siblingSlot);
 	assert(siblingNodeIndex != AABB_NULL_NODE); // we must have a sibling
-	NodeAABB& siblingNode = nodes[siblingNodeIndex];
 
 	if (grandParentNodeIndex != AABB_NULL_NODE)
 	{
 		// if we have a grand parent (i.e. the parent is not the root) then destroy the parent and connect the sibling to the grandparent in its
 		// place
-		NodeAABB& grandParentNode = nodes[grandParentNodeIndex];
-		if (grandParentNode.leftNodeIndex == parentNodeIndex)
-		{
-			grandParentNode.leftNodeIndex = siblingNodeIndex;
-		}
-		else
-		{
-			grandParentNode.rightNodeIndex = siblingNodeIndex;
-		}
-		siblingNode.parentNodeIndex = grandParentNodeIndex;
+		SetChild(grandParentNodeIndex, GetChildSlot(grandParentNodeIndex, parentNodeIndex), siblingNodeIndex, siblingAabb);
 		DeallocateNode(parentNodeIndex);
 
 		FixUpwardsTree(grandParentNodeIndex);
@@ -274,80 +316,438 @@ void AABBTree::RemoveLeaf(unsigned leafNodeIndex)
 	{
 		// if we have no grandparent then the parent is the root and so our sibling becomes the root and has it's parent removed
 		rootNodeIndex = siblingNodeIndex;
-		siblingNode.parentNodeIndex = AABB_NULL_NODE;
+		rootAABB = siblingAabb;
+		nodes[siblingNodeIndex].parentNodeIndex = AABB_NULL_NODE;
 		DeallocateNode(parentNodeIndex);
 	}
 
-	leafNode.parentNodeIndex = AABB_NULL_NODE;
+	nodes[leafNodeIndex].parentNodeIndex = AABB_NULL_NODE;
 
 	return;
 }
 
 void AABBTree::UpdateObject(GameObject * go)
 {
-	unsigned nodeIndex = objectNodeIndexMap[go];
-	UpdateLeaf(nodeIndex, *go->globalBoundingBox);
+	//Index kept in the object, no lookup
+	unsigned nodeIndex = go->aabbTreeNodeIndex;
+	if (nodeIndex == AABB_NULL_NODE)
+		return;
+
+	AABB leafAABB;
+	if (UpdateLeaf(nodeIndex, *go->globalBoundingBox, leafAABB) == 2)
+		InsertLeaf(nodeIndex, leafAABB);
 
 	return;
 }
 
-void AABBTree::GetIntersection(std::set<GameObject*>& intersectionGO, AABB * bbox)
+void AABBTree::UpdateObjects(const std::vector<GameObject*>& movedObjects)
 {
-	//DFS simulating recursivity using stack
+	//Each object must appear once, its leaf is detached from the tree until the second pass
+	refitCount = 0;
+	pendingLeaves.clear();
 
-	std::stack<unsigned> stack;
-	stack.push(rootNodeIndex);
-	while(!stack.empty())
+	for (auto go : movedObjects)
 	{
-		unsigned nodeIndex = stack.top();
-		stack.pop();
-		
-		if(nodeIndex == AABB_NULL_NODE)
+		unsigned nodeIndex = go->aabbTreeNodeIndex;
+		if (nodeIndex == AABB_NULL_NODE)
 			continue;
 
-		const NodeAABB& node = nodes[nodeIndex];
-		if(bbox->Intersects(node.aabb))
+		AABB leafAABB;
+		int result = UpdateLeaf(nodeIndex, *go->globalBoundingBox, leafAABB);
+		if (result == 1)
+		{
+			++refitCount;
+		}
+		else if (result == 2)
+		{
+			pendingLeaves.push_back(std::make_pair(nodeIndex, leafAABB));
+		}
+	}
+
+	//Inserted once all moved leaves are out so they are placed against the updated tree
+	for (const auto& pending : pendingLeaves)
+	{
+		InsertLeaf(pending.first, pending.second);
+	}
+	reinsertCount = pendingLeaves.size();
+
+	return;
+}
+
+void AABBTree::Build(const std::vector<GameObject*>& objects, JobSystem* jobs)
+{
+	//Objects of the old tree are not in it anymore, free nodes have height -1
+	for (unsigned nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++)
+	{
+		if (nodes[nodeIndex].isLeaf())
+			nodes[nodeIndex].go->aabbTreeNodeIndex = AABB_NULL_NODE;
+	}
+
+	rootNodeIndex = AABB_NULL_NODE;
+	objectCount = objects.size();
+
+	unsigned usedNodes = objects.empty() ? 0 : 2 * objects.size() - 1;
+	if (nodeCapacity < usedNodes)
+		nodeCapacity = usedNodes;
+
+	//Reset the pool, nodes after the built ones are the free list
+	nodes.assign(nodeCapacity, NodeAABB());
+	leafCenters.resize(nodeCapacity);
+	for (unsigned nodeIndex = usedNodes; nodeIndex < nodeCapacity; nodeIndex++)
+	{
+		nodes[nodeIndex].nextNodeIndex = nodeIndex + 1;
+		nodes[nodeIndex].height = -1;
+	}
+	if (nodeCapacity > usedNodes)
+		nodes[nodeCapacity - 1].nextNodeIndex = AABB_NULL_NODE;
+
+	nextFreeNodeIndex = (usedNodes < nodeCapacity) ? usedNodes : AABB_NULL_NODE;
+	allocatedNodeCount = usedNodes;
+
+	if (objects.empty())
+		return;
+
+	std::vector<BuildItem> items(objects.size());
+	for(unsigned i = 0; i < objects.size(); ++i)
+	{
+		items[i].aabb = FatAABB(*objects[i]->globalBoundingBox, float3::zero);
+		items[i].centroid = items[i].aabb.CenterPoint();
+		items[i].go = objects[i];
+	}
+
+	rootAABB = BuildRange(items, 0, items.size(), 0, AABB_NULL_NODE, jobs);
+	rootNodeIndex = 0;
+
+	return;
+}
+
+AABB AABBTree::BuildRange(std::vector<BuildItem>& items, unsigned begin, unsigned end, unsigned firstNodeIndex, unsigned parentNodeIndex, JobSystem* jobs)
+{
+	NodeAABB& node = nodes[firstNodeIndex];
+	node.parentNodeIndex = parentNodeIndex;
+
+	if (end - begin == 1)
+	{
+		//Each object is only in one range so threads write different objects
+		node.go = items[begin].go;
+		node.go->aabbTreeNodeIndex = firstNodeIndex;
+		leafCenters[firstNodeIndex] = items[begin].centroid;
+		return items[begin].aabb;
+	}
+
+	unsigned middle = SplitRange(items, begin, end);
+
+	//Left subtree goes right after this node and the right one after the left subtree
+	unsigned leftNodeIndex = firstNodeIndex + 1;
+	unsigned rightNodeIndex = leftNodeIndex + 2 * (middle - begin) - 1;
+
+	AABB leftAabb;
+	AABB rightAabb;
+	if (jobs != nullptr && end - begin > AABB_PARALLEL_THRESHOLD)
+	{
+		//Ranges don't overlap so each job writes its own items and nodes. Waiting runs other jobs, the left half
+		//can be stolen while this thread builds the right one
+		JobCounter left;
+		jobs->Run([&]() { leftAabb = BuildRange(items, begin, middle, leftNodeIndex, firstNodeIndex, jobs); }, &left);
+		rightAabb = BuildRange(items, middle, end, rightNodeIndex, firstNodeIndex, jobs);
+		jobs->Wait(left);
+	}
+	else
+	{
+		leftAabb = BuildRange(items, begin, middle, leftNodeIndex, firstNodeIndex, nullptr);
+		rightAabb = BuildRange(items, middle, end, rightNodeIndex, firstNodeIndex, nullptr);
+	}
+
+	SetChild(firstNodeIndex, 0, leftNodeIndex, leftAabb);
+	SetChild(firstNodeIndex, 1, rightNodeIndex, rightAabb);
+	node.height = 1 + std::max(nodes[leftNodeIndex].height, nodes[rightNodeIndex].height);
+
+	return MergeAABB(leftAabb, rightAabb);
+}
+
+unsigned AABBTree::SplitRange(std::vector<BuildItem>& items, unsigned begin, unsigned end) const
+{
+	//Split on the axis where centroids are more spread
+	AABB centroidBounds;
+	centroidBounds.SetNegativeInfinity();
+	for (unsigned i = begin; i < end; ++i)
+	{
+		centroidBounds.Enclose(items[i].centroid);
+	}
+
+	float3 extent = centroidBounds.Size();
+	int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z) ? 1 : 2;
+	float axisMin = centroidBounds.minPoint[axis];
+	float axisExtent = extent[axis];
+
+	unsigned middle = begin;
+	if (axisExtent > 0.0f)
+	{
+		//Bin the centroids and evaluate the cost of splitting at each bin boundary
+		unsigned binCount[AABB_SAH_BINS] = { 0 };
+		AABB binBounds[AABB_SAH_BINS];
+		for (int b = 0; b < AABB_SAH_BINS; ++b)
+		{
+			binBounds[b].SetNegativeInfinity();
+		}
+
+		float binScale = AABB_SAH_BINS / axisExtent;
+		for (unsigned i = begin; i < end; ++i)
+		{
+			int bin = std::min(AABB_SAH_BINS - 1, (int)((items[i].centroid[axis] - axisMin) * binScale));
+			++binCount[bin];
+			binBounds[bin].Enclose(items[i].aabb);
+		}
+
+		//Sweep from the right accumulating the cost of the right side of each split
+		float rightCost[AABB_SAH_BINS];
+		AABB accumulated;
+		accumulated.SetNegativeInfinity();
+		unsigned accumulatedCount = 0;
+		for (int b = AABB_SAH_BINS - 1; b > 0; --b)
+		{
+			accumulated.Enclose(binBounds[b]);
+			accumulatedCount += binCount[b];
+			rightCost[b] = (accumulatedCount > 0) ? accumulated.SurfaceArea() * accumulatedCount : 0.0f;
+		}
+
+		//Sweep from the left and keep the cheapest split
+		float bestCost = std::numeric_limits<float>::infinity();
+		int bestSplit = -1;
+		accumulated.SetNegativeInfinity();
+		accumulatedCount = 0;
+		for (int b = 0; b < AABB_SAH_BINS - 1; ++b)
 		{
-			if(node.isLeaf())
+			accumulated.Enclose(binBounds[b]);
+			accumulatedCount += binCount[b];
+			if (accumulatedCount == 0 || accumulatedCount == end - begin)
+				continue;
+
+			float cost = accumulated.SurfaceArea() * accumulatedCount + rightCost[b + 1];
+			if (cost < bestCost)
 			{
-				intersectionGO.insert(node.go);
+				bestCost = cost;
+				bestSplit = b;
 			}
-			else
+		}
+
+		if (bestSplit >= 0)
+		{
+			auto it = std::partition(items.begin() + begin, items.begin() + end, [&](const BuildItem &item)
 			{
-				stack.push(node.leftNodeIndex);
-				stack.push(node.rightNodeIndex);
-			}
+				return std::min(AABB_SAH_BINS - 1, (int)((item.centroid[axis] - axisMin) * binScale)) <= bestSplit;
+			});
+			middle = it - items.begin();
 		}
 	}
 
-	return;
+	//All centroids in the same place or no valid split, halve the range
+	if (middle == begin || middle == end)
+	{
+		middle = begin + (end - begin) / 2;
+		std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, [axis](const BuildItem &a, const BuildItem &b)
+		{
+			return a.centroid[axis] < b.centroid[axis];
+		});
+	}
+
+	return middle;
 }
 
-void AABBTree::GetIntersection(std::set<GameObject*>& intersectionGO, const LineSegment * ray)
+float AABBTree::ComputeSAHCost() const
 {
-	//DFS simulating recursivity using stack
+	if (rootNodeIndex == AABB_NULL_NODE)
+		return 0.0f;
+
+	//Sum of the areas of all nodes relative to the root, the expected number of nodes visited by a random ray
+	float rootArea = rootAABB.SurfaceArea();
+	if (rootArea <= 0.0f)
+		return 0.0f;
 
+	float cost = 1.0f;
 	std::stack<unsigned> stack;
 	stack.push(rootNodeIndex);
 	while (!stack.empty())
 	{
-		unsigned nodeIndex = stack.top();
+		const NodeAABB& node = nodes[stack.top()];
 		stack.pop();
 
-		if (nodeIndex == AABB_NULL_NODE)
+		if (node.isLeaf())
 			continue;
 
+		for (int slot = 0; slot < 2; ++slot)
+		{
+			cost += node.ChildAABB(slot).SurfaceArea() / rootArea;
+			stack.push(node.childNodeIndex[slot]);
+		}
+	}
+
+	return cost;
+}
+
+int AABBTree::ComputeDepth() const
+{
+	if (rootNodeIndex == AABB_NULL_NODE)
+		return 0;
+
+	int depth = 0;
+	std::stack<std::pair<unsigned, int>> stack;
+	stack.push(std::make_pair(rootNodeIndex, 1));
+	while (!stack.empty())
+	{
+		const NodeAABB& node = nodes[stack.top().first];
+		int nodeDepth = stack.top().second;
+		stack.pop();
+
+		depth = std::max(depth, nodeDepth);
+
+		if (!node.isLeaf())
+		{
+			stack.push(std::make_pair(node.childNodeIndex[0], nodeDepth + 1));
+			stack.push(std::make_pair(node.childNodeIndex[1], nodeDepth + 1));
+		}
+	}
+
+	return depth;
+}
+
+bool AABBTree::ValidateTree() const
+{
+	if (rootNodeIndex == AABB_NULL_NODE)
+		return objectCount == 0;
+
+	if (nodes[rootNodeIndex].parentNodeIndex != AABB_NULL_NODE)
+		return false;
+
+	unsigned leafCount = 0;
+	std::stack<std::pair<unsigned, AABB>> stack;
+	stack.push(std::make_pair(rootNodeIndex, rootAABB));
+	while (!stack.empty())
+	{
+		unsigned nodeIndex = stack.top().first;
+		AABB nodeAabb = stack.top().second;
 		const NodeAABB& node = nodes[nodeIndex];
-		if (ray->Intersects(node.aabb))
+		stack.pop();
+
+		if (node.isLeaf())
 		{
-			if (node.isLeaf())
+			if (node.go == nullptr || node.go->aabbTreeNodeIndex != nodeIndex || !nodeAabb.Contains(*node.go->globalBoundingBox))
+				return false;
+
+			++leafCount;
+			continue;
+		}
+
+		for (int slot = 0; slot < 2; ++slot)
+		{
+			const NodeAABB& childNode = nodes[node.childNodeIndex[slot]];
+			if (childNode.parentNodeIndex != nodeIndex || childNode.height < 0 || !nodeAabb.Contains(node.ChildAABB(slot)))
+				return false;
+
+			stack.push(std::make_pair(node.childNodeIndex[slot], node.ChildAABB(slot)));
+		}
+
+		if (node.height != 1 + std::max(nodes[node.childNodeIndex[0]].height, nodes[node.childNodeIndex[1]].height))
+			return false;
+	}
+
+	return leafCount == objectCount;
+}
+
+AABB AABBTree::FatAABB(const AABB & aabb, const float3 & displacement) const
+{
+	//AABB a bit bigger for avoiding little movements, relative to the object so small props are not inflated
+	float3 margin = Max(aabb.Size() * AABB_MARGIN_RATIO, float3(AABB_MIN_MARGIN, AABB_MIN_MARGIN, AABB_MIN_MARGIN));
+	AABB fatAABB = AABB(aabb.minPoint - margin, aabb.maxPoint + margin);
+
+	//Stretched towards where the object is going, assuming it keeps its last displacement
+	float3 prediction = displacement * AABB_DISPLACEMENT_MULTIPLIER;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (prediction[axis] < 0.0f)
+			fatAABB.minPoint[axis] += prediction[axis];
+		else
+			fatAABB.maxPoint[axis] += prediction[axis];
+	}
+
+	return fatAABB;
+}
+
+AABB AABBTree::GetNodeAABB(unsigned nodeIndex) const
+{
+	if (nodeIndex == rootNodeIndex)
+		return rootAABB;
+
+	unsigned parentNodeIndex = nodes[nodeIndex].parentNodeIndex;
+	return nodes[parentNodeIndex].ChildAABB(GetChildSlot(parentNodeIndex, nodeIndex));
+}
+
+void AABBTree::SetNodeAABB(unsigned nodeIndex, const AABB & aabb)
+{
+	if (nodeIndex == rootNodeIndex)
+	{
+		rootAABB = aabb;
+		return;
+	}
+
+	unsigned parentNodeIndex = nodes[nodeIndex].parentNodeIndex;
+	NodeAABB& parentNode = nodes[parentNodeIndex];
+	int slot = GetChildSlot(parentNodeIndex, nodeIndex);
+	parentNode.childMin[slot] = aabb.minPoint;
+	parentNode.childMax[slot] = aabb.maxPoint;
+
+	return;
+}
+
+int AABBTree::GetChildSlot(unsigned parentNodeIndex, unsigned childNodeIndex) const
+{
+	return (nodes[parentNodeIndex].childNodeIndex[0] == childNodeIndex) ? 0 : 1;
+}
+
+void AABBTree::SetChild(unsigned parentNodeIndex, int slot, unsigned childNodeIndex, const AABB & childAABB)
+{
+	NodeAABB& parentNode = nodes[parentNodeIndex];
+	parentNode.childNodeIndex[slot] = childNodeIndex;
+	parentNode.childMin[slot] = childAABB.minPoint;
+	parentNode.childMax[slot] = childAABB.maxPoint;
+	nodes[childNodeIndex].parentNodeIndex = parentNodeIndex;
+
+	return;
+}
+
+void AABBTree::GetIntersection(VisibleList & intersectionGO, const AABB * bbox)
+{
+	//DFS simulating recursivity using stack, the stack keeps its memory between queries
+	//Children bounds are in the parent so each step tests both children from one node
+	if (rootNodeIndex == AABB_NULL_NODE || !bbox->Intersects(rootAABB))
+		return;
+
+	if (nodes[rootNodeIndex].isLeaf())
+	{
+		intersectionGO.Add(nodes[rootNodeIndex].go);
+		return;
+	}
+
+	traversalStack.clear();
+	traversalStack.push_back(rootNodeIndex);
+	while(!traversalStack.empty())
+	{
+		const NodeAABB& node = nodes[traversalStack.back()];
+		traversalStack.pop_back();
+
+		for(int slot = 0; slot < 2; ++slot)
+		{
+			if (!bbox->Intersects(node.ChildAABB(slot)))
+				continue;
+
+			const NodeAABB& childNode = nodes[node.childNodeIndex[slot]];
+			if(childNode.isLeaf())
 			{
-				intersectionGO.insert(node.go);
+				intersectionGO.Add(childNode.go);
 			}
 			else
 			{
-				stack.push(node.leftNodeIndex);
-				stack.push(node.rightNodeIndex);
+				traversalStack.push_back(node.childNodeIndex[slot]);
 			}
 		}
 	}
@@ -355,110 +755,401 @@ void AABBTree::GetIntersection(std::set<GameObject*>& intersectionGO, const Line
 	return;
 }
 
+void AABBTree::GetIntersection(VisibleList & intersectionGO, const LineSegment * ray)
+{
+	//DFS simulating recursivity using stack, the stack keeps its memory between queries
+	if (rootNodeIndex == AABB_NULL_NODE || !ray->Intersects(rootAABB))
+		return;
 
+	if (nodes[rootNodeIndex].isLeaf())
+	{
+		intersectionGO.Add(nodes[rootNodeIndex].go);
+		return;
+	}
 
-void AABBTree::Draw() const
+	traversalStack.clear();
+	traversalStack.push_back(rootNodeIndex);
+	while (!traversalStack.empty())
+	{
+		const NodeAABB& node = nodes[traversalStack.back()];
+		traversalStack.pop_back();
+
+		for (int slot = 0; slot < 2; ++slot)
+		{
+			if (!ray->Intersects(node.ChildAABB(slot)))
+				continue;
+
+			const NodeAABB& childNode = nodes[node.childNodeIndex[slot]];
+			if (childNode.isLeaf())
+			{
+				intersectionGO.Add(childNode.go);
+			}
+			else
+			{
+				traversalStack.push_back(node.childNodeIndex[slot]);
+			}
+		}
+	}
+
+	return;
+}
+
+GameObject* AABBTree::RayCast(const LineSegment & ray, float & hitDistance)
 {
+	float entry, exit;
+	if (rootNodeIndex == AABB_NULL_NODE || !rootAABB.Intersects(ray, entry, exit) || entry >= hitDistance)
+		return nullptr;
+
+	GameObject* hitGO = nullptr;
+
+	rayHeap.clear();
+	rayHeap.push_back(std::make_pair(entry, rootNodeIndex));
+	while (!rayHeap.empty())
+	{
+		std::pop_heap(rayHeap.begin(), rayHeap.end(), std::greater<std::pair<float, unsigned>>());
+		std::pair<float, unsigned> next = rayHeap.back();
+		rayHeap.pop_back();
+
+		//Every node left starts farther than the closest hit
+		if (next.first >= hitDistance)
+			break;
+
+		const NodeAABB& node = nodes[next.second];
+		if (node.isLeaf())
+		{
+			//Leaf bounds are fat, the object box is tested before its triangles
+			if (!node.go->globalBoundingBox->Intersects(ray, entry, exit) || entry >= hitDistance)
+				continue;
+
+			GameObject* hitObject = node.go;
+			float distance = node.go->IsIntersectedByRay(ray, nullptr, &hitObject);
+			if (distance >= 0.0f && distance < hitDistance)
+			{
+				hitDistance = distance;
+				hitGO = hitObject;
+			}
+			continue;
+		}
+
+		for (int slot = 0; slot < 2; ++slot)
+		{
+			if (!node.ChildAABB(slot).Intersects(ray, entry, exit) || entry >= hitDistance)
+				continue;
+
+			rayHeap.push_back(std::make_pair(entry, node.childNodeIndex[slot]));
+			std::push_heap(rayHeap.begin(), rayHeap.end(), std::greater<std::pair<float, unsigned>>());
+		}
+	}
 
+	return hitGO;
+}
+void AABBTree::RayCast(const LineSegment * rays, RayHit * hits, unsigned count) const
+{
+	assert(count <= RAY_PACKET_SIZE);
 	if (rootNodeIndex == AABB_NULL_NODE)
 		return;
 
-	std::stack<NodeAABB> nodeStack;
-	nodeStack.push(nodes[rootNodeIndex]);
-	while (!nodeStack.empty())
+	//Bit i is set while ray i can still hit something nearer in the node
+	typedef unsigned long long RayMask;
+
+	float entry, exit;
+	RayMask rootMask = 0;
+	for (unsigned i = 0; i < count; ++i)
 	{
-		NodeAABB node = nodeStack.top();
-		nodeStack.pop();
+		if (rootAABB.Intersects(rays[i], entry, exit) && entry < hits[i].distance)
+			rootMask |= (RayMask)1 << i;
+	}
+
+	if (rootMask == 0)
+		return;
+
+	//Local stack so packets can run on different threads
+	std::vector<std::pair<unsigned, RayMask>> stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(rootNodeIndex, rootMask));
+	while (!stack.empty())
+	{
+		std::pair<unsigned, RayMask> next = stack.back();
+		stack.pop_back();
 
-		if (node.parentNodeIndex != AABB_NULL_NODE)
+		const NodeAABB& node = nodes[next.first];
+		if (node.isLeaf())
 		{
-			NodeAABB parent = nodes[node.parentNodeIndex];
-			dd::line(node.aabb.CenterPoint(), parent.aabb.CenterPoint(), float3(1.0f, 0.0f, 0.0f));
+			//All the rays of the packet that reach the object are tested against its mesh one after the other
+			for (unsigned i = 0; i < count; ++i)
+			{
+				if (!(next.second & ((RayMask)1 << i)))
+					continue;
+
+				if (!node.go->globalBoundingBox->Intersects(rays[i], entry, exit) || entry >= hits[i].distance)
+					continue;
+
+				unsigned triangle;
+				GameObject* hitObject = node.go;
+				float distance = node.go->IsIntersectedByRay(rays[i], &triangle, &hitObject);
+				if (distance >= 0.0f && distance < hits[i].distance)
+				{
+					hits[i].go = hitObject;
+					hits[i].distance = distance;
+					hits[i].triangle = triangle;
+				}
+			}
+			continue;
 		}
-		if (node.leftNodeIndex != AABB_NULL_NODE)
-			nodeStack.push(nodes[node.leftNodeIndex]);
-		if (node.rightNodeIndex != AABB_NULL_NODE)
-			nodeStack.push(nodes[node.rightNodeIndex]);
 
-		dd::aabb(node.aabb.minPoint, node.aabb.maxPoint, float3(1.0f, 0.0f, 0.0f));
+		RayMask childMask[2] = { 0, 0 };
+		float childEntry[2] = { std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+		for (int slot = 0; slot < 2; ++slot)
+		{
+			AABB childAABB = node.ChildAABB(slot);
+			for (unsigned i = 0; i < count; ++i)
+			{
+				if (!(next.second & ((RayMask)1 << i)))
+					continue;
+
+				if (childAABB.Intersects(rays[i], entry, exit) && entry < hits[i].distance)
+				{
+					childMask[slot] |= (RayMask)1 << i;
+					childEntry[slot] = std::min(childEntry[slot], entry);
+				}
+			}
+		}
 
+		//Nearer child is popped first
+		int nearSlot = (childEntry[0] <= childEntry[1]) ? 0 : 1;
+		if (childMask[1 - nearSlot] != 0)
+			stack.push_back(std::make_pair(node.childNodeIndex[1 - nearSlot], childMask[1 - nearSlot]));
+		if (childMask[nearSlot] != 0)
+			stack.push_back(std::make_pair(node.childNodeIndex[nearSlot], childMask[nearSlot]));
 	}
-	
+
 	return;
 }
 
-void AABBTree::UpdateLeaf(unsigned leafNodeIndex, const AABB & newAaab)
+void AABBTree::GetIntersection(VisibleList & intersectionGO, const MultiViewCuller & views)
 {
-	NodeAABB& node = nodes[leafNodeIndex];
+	//DFS where each node carries the views that see it and, for each of them, the planes it is not fully inside yet
+	if (rootNodeIndex == AABB_NULL_NODE || views.ViewCount() == 0)
+		return;
 
-	// if the node contains the new aabb then we just leave things
-	if (node.aabb.Contains(newAaab)) return;
+	ViewCullState rootState = views.RootState();
+	if (views.TestAABB(rootAABB, rootState, viewCullPlanes).visible == 0)
+		return;
+
+	if (nodes[rootNodeIndex].isLeaf())
+	{
+		ViewMasks leafMasks = views.TestAABB(*nodes[rootNodeIndex].go->globalBoundingBox, rootState, viewCullPlanes);
+		if (leafMasks.visible != 0)
+			intersectionGO.Add(nodes[rootNodeIndex].go, leafMasks.visible, leafMasks.inside);
+
+		return;
+	}
+
+	viewCullStack.clear();
+	viewCullStack.push_back(std::make_pair(rootNodeIndex, rootState));
+	while (!viewCullStack.empty())
+	{
+		unsigned nodeIndex = viewCullStack.back().first;
+		ViewCullState state = viewCullStack.back().second;
+		viewCullStack.pop_back();
+
+		const NodeAABB& node = nodes[nodeIndex];
+		for (int slot = 0; slot < 2; ++slot)
+		{
+			ViewCullState childState = state;
+			ViewMasks masks = views.TestAABB(node.ChildAABB(slot), childState, viewCullPlanes);
+			if (masks.visible == 0)
+				continue;
+
+			unsigned childNodeIndex = node.childNodeIndex[slot];
+			const NodeAABB& childNode = nodes[childNodeIndex];
+			if (childNode.isLeaf())
+			{
+				ViewMasks leafMasks = views.TestAABB(*childNode.go->globalBoundingBox, childState, viewCullPlanes);
+				if (leafMasks.visible != 0)
+					intersectionGO.Add(childNode.go, leafMasks.visible, leafMasks.inside);
+			}
+			else if (masks.inside == masks.visible)
+			{
+				//Every view that sees it has it inside
+				AddSubtree(intersectionGO, childNodeIndex, masks.inside);
+			}
+			else
+			{
+				viewCullStack.push_back(std::make_pair(childNodeIndex, childState));
+			}
+		}
+	}
+
+	return;
+}
+
+void AABBTree::AddSubtree(VisibleList & intersectionGO, unsigned treeNodeIndex, unsigned int insideViews)
+{
+	traversalStack.clear();
+	traversalStack.push_back(treeNodeIndex);
+	while (!traversalStack.empty())
+	{
+		const NodeAABB& node = nodes[traversalStack.back()];
+		traversalStack.pop_back();
+
+		if (node.isLeaf())
+		{
+			intersectionGO.Add(node.go, insideViews, insideViews);
+		}
+		else
+		{
+			traversalStack.push_back(node.childNodeIndex[0]);
+			traversalStack.push_back(node.childNodeIndex[1]);
+		}
+	}
 
-	RemoveLeaf(leafNodeIndex);
-	//AABB a bit bigger for avoiding little movements
-	node.aabb = AABB(newAaab.minPoint - float3(2, 2, 2), newAaab.maxPoint + float3(2, 2, 2));
-	InsertLeaf(leafNodeIndex);
-	
 	return;
 }
 
-bool AABBTree::ValidNodeLeaf(unsigned leafNodeIndex)
+unsigned AABBTree::GetNearest(const float3 & point, unsigned k, float maxDistance, NearestObject * nearest, unsigned count)
 {
-	NodeAABB& leafNode = nodes[leafNodeIndex];
-	//assert(leafNode.isLeaf());
+	if (rootNodeIndex == AABB_NULL_NODE || k == 0)
+		return count;
 
-	std::stack<NodeAABB> nodeStack;
-	nodeStack.push(nodes[rootNodeIndex]);
-	int counter = 0;
-	std::stack<unsigned>nodeIndexes; 
-	nodeIndexes.push(rootNodeIndex);
-	while (!nodeStack.empty())
+	//Only nearer than the k-th object once there are k of them
+	auto isFarther = [&](float distance)
 	{
-		NodeAABB node = nodeStack.top();
-		nodeStack.pop();
+		return (count == k) ? distance >= nearest[k - 1].distance : distance > maxDistance;
+	};
 
+	float distance = rootAABB.Distance(point);
+	if (isFarther(distance))
+		return count;
 
+	rayHeap.clear();
+	rayHeap.push_back(std::make_pair(distance, rootNodeIndex));
+	while (!rayHeap.empty())
+	{
+		std::pop_heap(rayHeap.begin(), rayHeap.end(), std::greater<std::pair<float, unsigned>>());
+		std::pair<float, unsigned> next = rayHeap.back();
+		rayHeap.pop_back();
 
-		if (node.leftNodeIndex == leafNodeIndex)
-		{
-			++counter;
-			if (leafNode.parentNodeIndex != nodeIndexes.top())
-				return false;
+		//Every node left is farther
+		if (isFarther(next.first))
+			break;
 
+		const NodeAABB& node = nodes[next.second];
+		if (node.isLeaf())
+		{
+			//Leaf bounds are fat, the object box gives the distance
+			distance = node.go->globalBoundingBox->Distance(point);
+			if (!isFarther(distance))
+				count = InsertNearest(nearest, count, k, node.go, distance);
+			continue;
 		}
 
-		if (node.rightNodeIndex == leafNodeIndex)
+		for (int slot = 0; slot < 2; ++slot)
 		{
-			++counter;
-			if (leafNode.parentNodeIndex != nodeIndexes.top())
-				return false;
+			distance = node.ChildAABB(slot).Distance(point);
+			if (isFarther(distance))
+				continue;
+
+			rayHeap.push_back(std::make_pair(distance, node.childNodeIndex[slot]));
+			std::push_heap(rayHeap.begin(), rayHeap.end(), std::greater<std::pair<float, unsigned>>());
 		}
+	}
 
-		nodeIndexes.pop();
+	return count;
+}
 
-		if (node.leftNodeIndex != AABB_NULL_NODE)
+void AABBTree::GetWithinRadius(const float3 & point, float radius, std::vector<NearestObject>& objects)
+{
+	if (rootNodeIndex != AABB_NULL_NODE && rootAABB.Distance(point) <= radius)
+	{
+		traversalStack.clear();
+		traversalStack.push_back(rootNodeIndex);
+		while (!traversalStack.empty())
 		{
-			nodeStack.push(nodes[node.leftNodeIndex]);
-			nodeIndexes.push(node.leftNodeIndex);
+			const NodeAABB& node = nodes[traversalStack.back()];
+			traversalStack.pop_back();
+
+			if (node.isLeaf())
+			{
+				NearestObject object;
+				object.go = node.go;
+				object.distance = node.go->globalBoundingBox->Distance(point);
+				if (object.distance <= radius)
+					objects.push_back(object);
+				continue;
+			}
+
+			for (int slot = 0; slot < 2; ++slot)
+			{
+				if (node.ChildAABB(slot).Distance(point) <= radius)
+					traversalStack.push_back(node.childNodeIndex[slot]);
+			}
 		}
-		if (node.rightNodeIndex != AABB_NULL_NODE)
+	}
+
+	std::sort(objects.begin(), objects.end());
+
+	return;
+}
+
+void AABBTree::Draw() const
+{
+
+	if (rootNodeIndex == AABB_NULL_NODE)
+		return;
+
+	dd::aabb(rootAABB.minPoint, rootAABB.maxPoint, float3(1.0f, 0.0f, 0.0f));
+
+	std::stack<std::pair<unsigned, AABB>> nodeStack;
+	nodeStack.push(std::make_pair(rootNodeIndex, rootAABB));
+	while (!nodeStack.empty())
+	{
+		const NodeAABB& node = nodes[nodeStack.top().first];
+		AABB nodeAabb = nodeStack.top().second;
+		nodeStack.pop();
+
+		if (node.isLeaf())
+			continue;
+
+		for (int slot = 0; slot < 2; ++slot)
 		{
-			nodeStack.push(nodes[node.rightNodeIndex]);
-			nodeIndexes.push(node.rightNodeIndex);
+			AABB childAabb = node.ChildAABB(slot);
+			dd::line(childAabb.CenterPoint(), nodeAabb.CenterPoint(), float3(1.0f, 0.0f, 0.0f));
+			dd::aabb(childAabb.minPoint, childAabb.maxPoint, float3(1.0f, 0.0f, 0.0f));
+			nodeStack.push(std::make_pair(node.childNodeIndex[slot], childAabb));
 		}
 
-
 	}
+	
+	return;
+}
 
-	if (counter > 1)
-		return false;
+int AABBTree::UpdateLeaf(unsigned leafNodeIndex, const AABB & newAaab, AABB & leafAABB)
+{
+	float3 center = newAaab.CenterPoint();
+	float3 displacement = center - leafCenters[leafNodeIndex];
+	leafCenters[leafNodeIndex] = center;
+
+	// if the node contains the new aabb then we just leave things
+	if (GetNodeAABB(leafNodeIndex).Contains(newAaab))
+		return 0;
 
-	return true;
+	leafAABB = FatAABB(newAaab, displacement);
+
+	// if the new fat box is still inside the parent the ancestors stay valid, only the leaf bounds change
+	unsigned parentNodeIndex = nodes[leafNodeIndex].parentNodeIndex;
+	if (leafNodeIndex == rootNodeIndex || GetNodeAABB(parentNodeIndex).Contains(leafAABB))
+	{
+		SetNodeAABB(leafNodeIndex, leafAABB);
+		return 1;
+	}
+
+	RemoveLeaf(leafNodeIndex);
+	
+	return 2;
 }
 
 AABB AABBTree::MergeAABB(const AABB &first, const AABB &second) const
 {
 	return AABB(float3(Min(first.minPoint, second.minPoint)), float3(Max(first.maxPoint, second.maxPoint)));
 }
-
-
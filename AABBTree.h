@@ -5,27 +5,72 @@
 #include "MathGeoLib/Geometry/AABB.h"
 #include "MathGeoLib/Geometry/LineSegment.h"
 #include "GameObject.h"
+#include "SpatialQuery.h"
+#include "MultiViewCuller.h"
+#include "VisibleList.h"
 #include <vector>
-#include <set>
-#include <map>
+#include <malloc.h>
 
 
 #define AABB_NULL_NODE 0xffffffff
 
+//Bulk build
+#define AABB_SAH_BINS 16
+//Ranges bigger than this build their two halves as separate jobs
+#define AABB_PARALLEL_THRESHOLD 1024
 
-struct NodeAABB
+//Fat margins, grown from the object size and stretched along its displacement since last update
+#define AABB_MARGIN_RATIO 0.1f
+#define AABB_MIN_MARGIN 0.05f
+#define AABB_DISPLACEMENT_MULTIPLIER 4.0f
+
+class JobSystem;
+
+//One node per cache line. Parents store the bounds of both children so a traversal step
+//tests the two children reading only the parent, the root bounds are kept in the tree.
+struct alignas(64) NodeAABB
+{
+	NodeAABB() : childNodeIndex{ AABB_NULL_NODE, AABB_NULL_NODE }, parentNodeIndex(AABB_NULL_NODE), height(0) {}
+
+	// bounds of the children, slot 0 is left and slot 1 right
+	float3 childMin[2];
+	float3 childMax[2];
+	union
+	{
+		unsigned childNodeIndex[2];
+		// leaves only
+		GameObject* go;
+	};
+	union
+	{
+		unsigned parentNodeIndex;
+		// node linked list link, only while the node is free
+		unsigned nextNodeIndex;
+	};
+	// leaves have height 0
+	short height;
+
+	bool isLeaf() const { return height == 0; }
+	AABB ChildAABB(int slot) const { return AABB(childMin[slot], childMax[slot]); }
+
+};
+
+static_assert(sizeof(NodeAABB) == 64, "NodeAABB must fill one cache line");
+
+//std::allocator ignores alignas bigger than the default alignment before C++17
+template<class T>
+struct CacheAlignedAllocator
 {
-	AABB aabb;
-	GameObject* go = nullptr;
-	// tree links
-	unsigned parentNodeIndex = AABB_NULL_NODE;
-	unsigned leftNodeIndex = AABB_NULL_NODE;
-	unsigned rightNodeIndex = AABB_NULL_NODE;
-	// node linked list link
-	unsigned nextNodeIndex = AABB_NULL_NODE;
+	typedef T value_type;
+
+	CacheAlignedAllocator() = default;
+	template<class U> CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
 
-	bool isLeaf() const { return leftNodeIndex == AABB_NULL_NODE; }
+	T* allocate(size_t count) { return (T*)_aligned_malloc(count * sizeof(T), alignof(T)); }
+	void deallocate(T* pointer, size_t) { _aligned_free(pointer); }
 
+	template<class U> bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+	template<class U> bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
 };
 
 class AABBTree
@@ -35,37 +80,102 @@ public:
 	~AABBTree();
 
 
+	//The leaf index is kept in GameObject::aabbTreeNodeIndex so an object can only be in one tree
 	void Insert(GameObject* go);
 	void Remove(GameObject* go);
 	void UpdateObject(GameObject* go);
+	//Leaves whose fat box still holds the object are left alone, the ones that still fit in their parent are
+	//refit in place and the rest are removed first and reinserted together
+	void UpdateObjects(const std::vector<GameObject*> &movedObjects);
+
+	//Replaces the whole tree with a top-down binned SAH build of the objects, big ranges are split between the
+	//threads of jobs if any
+	void Build(const std::vector<GameObject*> &objects, JobSystem* jobs = nullptr);
+	//Quality of the tree, comparable between bulk build and incremental insertion
+	float ComputeSAHCost() const;
+	int ComputeDepth() const;
+	//Checks links, heights and bounds of every node
+	bool ValidateTree() const;
+
+	void GetIntersection(VisibleList &intersectionGO, const AABB* bbox);
+	void GetIntersection(VisibleList &intersectionGO, const LineSegment* ray);
+	//Single walk for all the views, objects are added with the views that see them
+	void GetIntersection(VisibleList &intersectionGO, const MultiViewCuller &views);
+	//Closest object whose mesh is hit by the ray. Nodes are visited nearest first by entry distance and the search
+	//stops when the next node starts after the closest hit. hitDistance is measured along the segment in [0, 1],
+	//only hits nearer than its value on entry are taken
+	GameObject* RayCast(const LineSegment &ray, float &hitDistance);
+	//Up to RAY_PACKET_SIZE rays traverse the tree together, a node is visited while some ray of the packet can still
+	//find a nearer hit in it. Only hits nearer than the ones already in hits are taken. Safe to call from several threads
+	void RayCast(const LineSegment* rays, RayHit* hits, unsigned count) const;
+	//k nearest objects to the point no farther than maxDistance, nearest first. Nodes are visited nearest first and the
+	//search stops when the next node is farther than the k-th object. The buffer already holds count sorted objects
+	//from another structure, they are merged with the ones found. Returns the new count
+	unsigned GetNearest(const float3 &point, unsigned k, float maxDistance, NearestObject* nearest, unsigned count = 0);
+	//Objects whose box is within radius of the point are appended and the whole list is sorted nearest first
+	void GetWithinRadius(const float3 &point, float radius, std::vector<NearestObject> &objects);
 
-	void GetIntersection(std::set<GameObject*> &intersectionGO, AABB* bbox);
-	void GetIntersection(std::set<GameObject*> &intersectionGO, const LineSegment* ray);
-	
 	void Draw() const;
 
 
 	//Tree
-	std::map<GameObject*, unsigned> objectNodeIndexMap;
-	std::vector<NodeAABB> nodes;
+	std::vector<NodeAABB, CacheAlignedAllocator<NodeAABB>> nodes;
 	unsigned rootNodeIndex = AABB_NULL_NODE;
+	AABB rootAABB;
+	//Kept between frames, the views usually move little
+	ViewCullPlanes viewCullPlanes;
+	unsigned objectCount = 0;
 	unsigned allocatedNodeCount = 0;
 	unsigned nextFreeNodeIndex = 0;
 	unsigned nodeCapacity = 0;
 	unsigned growthSize = 10;
 
+	//Last UpdateObjects
+	unsigned refitCount = 0;
+	unsigned reinsertCount = 0;
+
 
 private:
 	AABB MergeAABB(const AABB &first, const AABB &second) const;
 	unsigned AllocateNode();
 	void DeallocateNode(unsigned nodeIndex);
-	void InsertLeaf(unsigned leafNodeIndex);
+	void InsertLeaf(unsigned leafNodeIndex, const AABB &leafAABB);
 	void FixUpwardsTree(unsigned treeNodeIndex);
+	unsigned Balance(unsigned treeNodeIndex);
 	void RemoveLeaf(unsigned leafNodeIndex);
-	void UpdateLeaf(unsigned leafNodeIndex, const AABB& newAaab);
+	//Returns 0 if the leaf was kept, 1 if refit and 2 if it has been removed to be reinserted with leafAABB
+	int UpdateLeaf(unsigned leafNodeIndex, const AABB& newAaab, AABB &leafAABB);
+	//Multi view queries pass the views that have the subtree inside
+	void AddSubtree(VisibleList &intersectionGO, unsigned treeNodeIndex, unsigned int insideViews = 0);
+	AABB FatAABB(const AABB &aabb, const float3 &displacement) const;
+	void GrowPool(unsigned newCapacity);
+
+	//Bounds of a node are stored in its parent
+	AABB GetNodeAABB(unsigned nodeIndex) const;
+	void SetNodeAABB(unsigned nodeIndex, const AABB &aabb);
+	int GetChildSlot(unsigned parentNodeIndex, unsigned childNodeIndex) const;
+	void SetChild(unsigned parentNodeIndex, int slot, unsigned childNodeIndex, const AABB &childAABB);
+
+	//Bulk build, a range of n objects uses the 2n - 1 nodes after firstNodeIndex so threads never share nodes
+	struct BuildItem
+	{
+		AABB aabb;
+		float3 centroid;
+		GameObject* go;
+	};
+	AABB BuildRange(std::vector<BuildItem> &items, unsigned begin, unsigned end, unsigned firstNodeIndex, unsigned parentNodeIndex, JobSystem* jobs);
+	unsigned SplitRange(std::vector<BuildItem> &items, unsigned begin, unsigned end) const;
+
+	//Traversal stacks kept between queries
+	std::vector<unsigned> traversalStack;
+	std::vector<std::pair<unsigned, ViewCullState>> viewCullStack;
+	//Min-heap of (entry distance, node), (distance to the point, node) for the nearest queries
+	std::vector<std::pair<float, unsigned>> rayHeap;
+
+	//Center of each leaf object at its last update, indexed like nodes. Kept outside the nodes so they fit one line
+	std::vector<float3> leafCenters;
+	std::vector<std::pair<unsigned, AABB>> pendingLeaves;
 
-	bool ValidNodeLeaf(unsigned leafNodeIndex);
 };
 
 #endif __AABBTree_H__
-
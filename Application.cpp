@@ -12,6 +12,7 @@
 #include "ModuleScene.h"
 #include "ModuleFilesystem.h"
 #include "ModuleDebugDraw.h"
+#include "JobSystem.h"
 #include "Timer.h"
 #include "uSTimer.h"
 //#include "Brofiler/Brofiler.h"
@@ -20,6 +21,8 @@ using namespace std;
 
 Application::Application()
 {
+	jobs = new JobSystem();
+
 	// Order matters: they will Init/start/update in this order
 	modules.push_back(filesystem = new ModuleFilesystem());
 	modules.push_back(window = new ModuleWindow());
@@ -43,6 +46,8 @@ Application::~Application()
     {
         delete *it;
     }
+
+	delete jobs;
 }
 
 bool Application::Init()
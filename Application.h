@@ -18,6 +18,7 @@ class ModuleTimeManager;
 class ModuleScene;
 class ModuleDebugDraw;
 class ModuleFilesystem;
+class JobSystem;
 
 class Application
 {
@@ -44,6 +45,8 @@ public:
 	ModuleDebugDraw* debugDraw = nullptr;
 	ModuleFilesystem* filesystem = nullptr;
 
+	//Shared by every module, it lives longer than all of them
+	JobSystem* jobs = nullptr;
 
 private:
 
@@ -6,6 +6,7 @@
 #include "ModuleCamera.h"
 #include "ModuleRender.h"
 #include "GameObject.h"
+#include "FrustumCuller.h"
 #include "SceneLoader.h"
 #include <math.h>
 #include "MathGeoLib/Geometry/Plane.h"
@@ -43,6 +44,13 @@ ComponentCamera::ComponentCamera(GameObject * go, ComponentCamera * comp)
 
 	frustum = new Frustum(*comp->frustum);
 
+	screenSizeCulling = comp->screenSizeCulling;
+	minScreenSize = comp->minScreenSize;
+	for(unsigned int i = 0; i < MESH_LOD_LEVELS - 1; ++i)
+	{
+		lodScreenSizes[i] = comp->lodScreenSizes[i];
+	}
+
 	proj = frustum->ProjectionMatrix();
 	view = frustum->ViewMatrix();
 
@@ -58,7 +66,7 @@ void ComponentCamera::Update()
 {
 	float3x3 quatAux = float3x3::zero;
 	float3 scaleAux = float3::zero;
-	myGameObject->myTransform->globalModelMatrix.Decompose(frustum->pos,quatAux, scaleAux);
+	myGameObject->myTransform->GetGlobalMatrix().Decompose(frustum->pos,quatAux, scaleAux);
 	frustum->up = float3::unitY * quatAux;
 	frustum->front = -float3::unitZ * quatAux;
 	
@@ -184,59 +192,37 @@ void ComponentCamera::DrawInspector()
 		ImGui::SliderFloat(":FOV", &frustum->verticalFov, 0.0001f, 9.0f);
 
 		SetFOV();
+
+		DrawDetailInspector();
 	}
 
 	return;
 }
 
-int ComponentCamera::AABBWithinFrustum(const AABB &aabb) const
+void ComponentCamera::DrawDetailInspector()
 {
-	//Tests if an AABB is within the frusum
-	//returns 0 if out, 1 if in and 2 if intersects
-	float3 corners[8];
-	aabb.GetCornerPoints(corners);
-
-	int iTotalIn = 0;
-
-	//test all 8 corners against the 6 planes of the frustum
-	// if all points are behind 1 specific plane, we are out
-	// if we are in with all points, then we are fully in
-	for(int p = 0; p < 6; ++p)
+	ImGui::PushID(this);
+	ImGui::Checkbox("Screen Size Culling", &screenSizeCulling);
+	ImGui::SliderFloat(":Min screen size (px)", &minScreenSize, 0.0f, 50.0f);
+	for(unsigned int i = 0; i < MESH_LOD_LEVELS - 1; ++i)
 	{
-		int iInCount = 8;
-		int iPtIn = 1;
-
-		for(int i = 0; i< 8; ++i)
-		{
-			//test this point against the planes
-			if(SideOfPlane(corners[i], frustum->GetPlane(p)) == FRONT)
-			{
-				iPtIn = 0;
-				--iInCount;
-			}
-		}
-		
-		// were all the points outside of plane p?
-		if (iInCount == 0)
-			return AABB_OUT;
-
-		// check if they were all on the right side of the plane
-		iTotalIn += iPtIn;
-
+		char label[32];
+		sprintf_s(label, 32, ":LOD %u below (px)", i + 1);
+		//Thresholds stay sorted so each level covers a range of sizes
+		float maxSize = (i == 0) ? 1000.0f : lodScreenSizes[i - 1];
+		float minSize = (i == MESH_LOD_LEVELS - 2) ? minScreenSize : lodScreenSizes[i + 1];
+		ImGui::SliderFloat(label, &lodScreenSizes[i], minSize, maxSize);
 	}
-	// so if iTotalIn is 6, then all are inside the view
-	if (iTotalIn == 6)
-		return(AABB_IN);
+	ImGui::PopID();
 
-	return AABB_INTERSECT;
+	return;
 }
 
-bool ComponentCamera::SideOfPlane(const float3 &point, const Plane &plane) const
+int ComponentCamera::AABBWithinFrustum(const AABB &aabb) const
 {
-	float value = plane.normal.Dot(point);
-	value -= plane.d;
-
-	return (value >= 0.0f) ? true : false;
+	//Tests if an AABB is within the frusum
+	//returns 0 if out, 1 if in and 2 if intersects
+	return FrustumCuller::TestAABBCorners(*frustum, aabb);
 }
 
 void ComponentCamera::OnSave(SceneLoader & loader)
@@ -253,6 +239,15 @@ void ComponentCamera::OnSave(SceneLoader & loader)
 	loader.AddFloat("Far Plane", frustum->farPlaneDistance);
 	loader.AddFloat("Vertical FOV", frustum->verticalFov);
 	loader.AddFloat("Horizontal FOV", frustum->horizontalFov);
+
+	loader.AddUnsignedInt("Screen Size Culling", screenSizeCulling);
+	loader.AddFloat("Min Screen Size", minScreenSize);
+	for(unsigned int i = 0; i < MESH_LOD_LEVELS - 1; ++i)
+	{
+		char key[32];
+		sprintf_s(key, 32, "LOD %u Screen Size", i + 1);
+		loader.AddFloat(key, lodScreenSizes[i]);
+	}
 }
 
 void ComponentCamera::OnLoad(SceneLoader & loader)
@@ -269,6 +264,15 @@ void ComponentCamera::OnLoad(SceneLoader & loader)
 	frustum->verticalFov = loader.GetFloat("Vertical FOV", (float)M_PI / 4.0f);
 	frustum->horizontalFov = loader.GetFloat("Horizontal FOV", 2.0f * atanf(tanf(frustum->verticalFov * 0.5f)));
 
+	screenSizeCulling = loader.GetUnsignedInt("Screen Size Culling", screenSizeCulling) != 0;
+	minScreenSize = loader.GetFloat("Min Screen Size", minScreenSize);
+	for(unsigned int i = 0; i < MESH_LOD_LEVELS - 1; ++i)
+	{
+		char key[32];
+		sprintf_s(key, 32, "LOD %u Screen Size", i + 1);
+		lodScreenSizes[i] = loader.GetFloat(key, lodScreenSizes[i]);
+	}
+
 	proj = frustum->ProjectionMatrix();
 	view = frustum->ViewMatrix();
 
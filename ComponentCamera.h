@@ -3,8 +3,12 @@
 
 #include "Globals.h"
 #include "Component.h"
+#include "Mesh.h"
 #include "MathGeoLib/Geometry/Frustum.h"
 #include "MathGeoLib/Math/float4x4.h"
+#include <vector>
+
+class VisibleList;
 
 
 const int AABB_OUT = 0;
@@ -36,10 +40,19 @@ public:
 	void ComputeViewMatrix();
 	void ComputeProjMatrix();
 	void DrawInspector();
+	void DrawDetailInspector();
+
+	//Screen size of a sphere in pixels: its projected diameter for a viewport of the given height
+	float ScreenSize(const float3 &center, float radius, int viewportHeight) const;
+	//Detail level for a screen size, the thresholds go from the biggest to the smallest
+	unsigned int DetailLevel(float screenSize) const;
+	//Detail level of each mesh of visible seen by the view, meshes smaller than minScreenSize lose the view bit.
+	//Counts the dropped meshes and the meshes of each level
+	void SelectDetailLevels(const VisibleList &visible, unsigned int view, int viewportHeight, std::vector<unsigned char> &detailLevels,
+		unsigned int &culledCount, unsigned int levelCounts[MESH_LOD_LEVELS]) const;
 
 	//Frutum intersection
 	int AABBWithinFrustum(const AABB &aabb) const;
-	bool SideOfPlane(const float3 &point, const Plane &plane) const;
 
 	//Saving and loading
 	void OnSave(SceneLoader & loader);
@@ -61,6 +74,12 @@ public:
 	float zoomSpeed = 0.5f;
 	float motionOffset = 2.5f;
 
+	//Screen size culling: meshes smaller than minScreenSize pixels are not drawn by this camera
+	bool screenSizeCulling = true;
+	float minScreenSize = 2.0f;
+	//Meshes smaller than lodScreenSizes[i] pixels are drawn with the detail level i + 1
+	float lodScreenSizes[MESH_LOD_LEVELS - 1] = { 150.0f, 40.0f };
+
 	unsigned int frustumVAO = 0; 
 	
 	float3 oldPosition;
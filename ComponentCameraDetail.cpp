@@ -0,0 +1,59 @@
+//Screen size culling and detail levels of ComponentCamera, they don't use the Application or OpenGL so the tests build them
+#include "ComponentCamera.h"
+#include "GameObject.h"
+#include "VisibleList.h"
+#include <math.h>
+
+float ComponentCamera::ScreenSize(const float3 &center, float radius, int viewportHeight) const
+{
+	if (frustum->type == FrustumType::OrthographicFrustum)
+		return 2.0f * radius / frustum->orthographicHeight * viewportHeight;
+
+	//Inside the sphere it covers the whole screen
+	float distance = frustum->pos.Distance(center);
+	if (distance <= radius)
+		return (float)viewportHeight;
+
+	return radius / (distance * tanf(frustum->verticalFov * 0.5f)) * viewportHeight;
+}
+
+unsigned int ComponentCamera::DetailLevel(float screenSize) const
+{
+	unsigned int level = 0;
+	while (level < MESH_LOD_LEVELS - 1 && screenSize < lodScreenSizes[level])
+	{
+		++level;
+	}
+
+	return level;
+}
+
+void ComponentCamera::SelectDetailLevels(const VisibleList &visible, unsigned int view, int viewportHeight, std::vector<unsigned char> &detailLevels,
+	unsigned int &culledCount, unsigned int levelCounts[MESH_LOD_LEVELS]) const
+{
+	detailLevels.assign(visible.Size(), 0);
+	if (!screenSizeCulling || viewportHeight <= 0)
+		return;
+
+	//Only meshes, lights and empty objects still have to be drawn to set their uniforms
+	for(unsigned int i = 0; i < visible.Size(); ++i)
+	{
+		GameObject* gameObject = visible[i];
+		if (!(gameObject->visibleViews & view) || gameObject->myMesh == nullptr || gameObject->globalBoundingBox == nullptr)
+			continue;
+
+		const AABB &box = *gameObject->globalBoundingBox;
+		float screenSize = ScreenSize(box.CenterPoint(), box.HalfDiagonal().Length(), viewportHeight);
+		if (screenSize < minScreenSize)
+		{
+			gameObject->visibleViews &= ~view;
+			++culledCount;
+			continue;
+		}
+
+		detailLevels[i] = DetailLevel(screenSize);
+		++levelCounts[detailLevels[i]];
+	}
+
+	return;
+}
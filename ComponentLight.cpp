@@ -66,7 +66,7 @@ void ComponentLight::Draw()
 {
 	if (lightType == LDIRECTIONAL)
 	{
-		float3 arrowFrom = myGameObject->myTransform->position;
+		float3 arrowFrom = myGameObject->myTransform->GetPosition();
 		float3 arrowTo = arrowFrom + direction;
 		dd::arrow(arrowFrom, arrowTo, float3(1.0f, 1.0f, 1.0f), 0.1f);
 		
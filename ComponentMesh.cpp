@@ -7,7 +7,7 @@
 #include "SceneImporter.h"
 #include "MeshImporter.h"
 #include "MathGeoLib/Geometry/LineSegment.h"
-#include "MathGeoLib/Geometry/Triangle.h"
+#include <limits>
 
 using namespace std;
 
@@ -35,30 +35,19 @@ void ComponentMesh::LoadMesh(Mesh* loadedMesh)
 	mesh = loadedMesh;
 }
 
-void ComponentMesh::Draw(const unsigned int program) const
+void ComponentMesh::Draw(const unsigned int program, unsigned int lod) const
 {
-	mesh->Draw(program);
+	mesh->Draw(program, lod);
 }
 
-float ComponentMesh::IsIntersectedByRay(const float3 &origin ,const LineSegment & ray)
+float ComponentMesh::IsIntersectedByRay(const LineSegment & ray, unsigned int* triangle)
 {
-	float minDist = -1.0f;
-
-	for(unsigned int i = 0; i < mesh->indices.size();i += 3)
-	{
-
-		Triangle tri = Triangle(mesh->vertices[mesh->indices[i]].Position, mesh->vertices[mesh->indices[i+1]].Position, mesh->vertices[mesh->indices[i+2]].Position);
-		if(tri.Intersects(ray))
-		{
-			//If first time assign otherwise only assign if lesser
-			float dist = tri.Distance(origin);
-			if (minDist == -1.0f)
-				minDist = dist;
-			else if (dist < minDist)
-				minDist = dist;
-		}
-	}
+	if (!mesh->bvh.IsBuilt())
+		mesh->bvh.Build(mesh->vertices, mesh->indices);
 
+	float minDist = std::numeric_limits<float>::infinity();
+	if (!mesh->bvh.RayCast(ray, minDist, triangle))
+		return -1.0f;
 
 	return minDist;
 }
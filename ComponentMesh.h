@@ -4,6 +4,8 @@
 #include "Component.h"
 #include "Mesh.h"
 
+struct MeshData;
+
 class ComponentMesh : public Component
 {
 public:
@@ -12,9 +14,10 @@ public:
 	~ComponentMesh();
 
 	void LoadMesh(Mesh* myMesh);
-	void Draw(const unsigned int program) const;
+	void Draw(const unsigned int program, unsigned int lod = 0) const;
 
-	float IsIntersectedByRay(const float3 &origin, const LineSegment &ray);
+	//Closest hit along the segment in [0, 1], -1.0f if no triangle is hit
+	float IsIntersectedByRay(const LineSegment &ray, unsigned int* triangle = nullptr);
 
 	//Saving and loading
 	void OnSave(SceneLoader & loader);
@@ -10,6 +10,7 @@ ComponentTransform::ComponentTransform(GameObject* gameObject)
 {
 	myGameObject = gameObject;
 	myType = TRANSFORM;
+	slot = Transforms->Add(this);
 	UpdateMatrices();
 }
 
@@ -17,25 +18,28 @@ ComponentTransform::ComponentTransform(GameObject * gameObject, ComponentTransfo
 {
 	myGameObject = gameObject;
 	myType = TRANSFORM;
-	position = comp->position;
-	rotation = comp->rotation;
-	scale = comp->scale;
+	slot = Transforms->Add(this);
+	SetPosition(comp->GetPosition());
+	SetRotation(comp->GetRotation());
+	SetScale(comp->GetScale());
+	QuatToEuler();
 	UpdateMatrices();
 }
 
 
 ComponentTransform::~ComponentTransform()
 {
+	Transforms->Remove(slot);
 }
 
 void ComponentTransform::EulerToQuat()
 {
-	rotation = math::Quat::FromEulerXYZ(DegToRad(eulerRotation).x, DegToRad(eulerRotation).y, DegToRad(eulerRotation).z);
+	SetRotation(math::Quat::FromEulerXYZ(DegToRad(eulerRotation).x, DegToRad(eulerRotation).y, DegToRad(eulerRotation).z));
 }
 
 void ComponentTransform::QuatToEuler()
 {
-	eulerRotation = rotation.ToEulerXYZ();
+	eulerRotation = GetRotation().ToEulerXYZ();
 	eulerRotation.x = math::RadToDeg(eulerRotation.x);
 	eulerRotation.y = math::RadToDeg(eulerRotation.y);
 	eulerRotation.z = math::RadToDeg(eulerRotation.z);
@@ -43,26 +47,22 @@ void ComponentTransform::QuatToEuler()
 
 void ComponentTransform::UpdateMatrices()
 {
-	globalModelMatrix = globalModelMatrix * localModelMatrix.Inverted();
-	localModelMatrix = float4x4::FromTRS(position, rotation, scale);
-	globalModelMatrix = globalModelMatrix * localModelMatrix;
-}
-
-void ComponentTransform::SetGlobalMatrix(const float4x4 &parentGlobal)
-{
-	globalModelMatrix = parentGlobal * localModelMatrix;
+	Transforms->UpdateSlot(slot);
 }
 
 void ComponentTransform::SetGlobalMatrix(const float4x4 & newGlobal, const float4x4 & parentGlobal)
 {
-	globalModelMatrix = newGlobal;
+	Transforms->worldMatrices[slot] = newGlobal;
 	SetLocalMatrix(parentGlobal);
 }
 
 void ComponentTransform::SetLocalMatrix(const float4x4 &newParentGlobalMatrix)
 {
-	localModelMatrix = newParentGlobalMatrix.Inverted() *  globalModelMatrix;
+	float4x4 &localModelMatrix = Transforms->localMatrices[slot];
+	localModelMatrix = newParentGlobalMatrix.Inverted() * GetGlobalMatrix();
 
+	float3 position, scale;
+	Quat rotation;
 	localModelMatrix.Decompose(position, rotation, scale);
 
 	if (scale.x < 0.01f)
@@ -74,32 +74,43 @@ void ComponentTransform::SetLocalMatrix(const float4x4 &newParentGlobalMatrix)
 	if (scale.z < 0.01f)
 		scale.z = 0.01f;
 
+	SetPosition(position);
+	SetRotation(rotation);
+	SetScale(scale);
 	QuatToEuler();
 	
 }
 
+void ComponentTransform::SetParent(const ComponentTransform * parentTransform)
+{
+	Transforms->SetParent(slot, (parentTransform != nullptr) ? parentTransform->slot : TRANSFORM_NULL_SLOT);
+}
+
 void ComponentTransform::TranslateTo(const float3 & newPos)
 {
-	position = newPos;
+	SetPosition(newPos);
 }
 
 void ComponentTransform::DrawInspector()
 {
 	if (ImGui::CollapsingHeader("Transform", ImGuiTreeNodeFlags_DefaultOpen))
 	{
-		//Aux variables if static
-		float3 auxPos = position;
+		//Aux variables, static objects don't take the edits
+		float3 auxPos = GetPosition();
 		float3 auxRot = eulerRotation;
-		float3 auxScale = scale;
+		float3 auxScale = GetScale();
 
 		bool isStatic = myGameObject->isStatic;
 
 		ImGui::Text("Position");
-		ImGui::DragFloat3("Position", (float *)((isStatic) ? &auxPos : &position), 0.1f);
+		if (ImGui::DragFloat3("Position", (float *)&auxPos, 0.1f) && !isStatic)
+			SetPosition(auxPos);
 		ImGui::Text("Rotation");
-		ImGui::DragFloat3("Rotation", (float *)((isStatic) ? &auxRot : &eulerRotation), 1.0f, -360.0f, 360.0f);
+		if (ImGui::DragFloat3("Rotation", (float *)((isStatic) ? &auxRot : &eulerRotation), 1.0f, -360.0f, 360.0f) && !isStatic)
+			EulerToQuat();
 		ImGui::Text("Scale");
-		ImGui::DragFloat3("Scale", (float *)((isStatic) ? &auxScale : &scale), 0.01f, 0.01f, 1000.0f);
+		if (ImGui::DragFloat3("Scale", (float *)&auxScale, 0.01f, 0.01f, 1000.0f) && !isStatic)
+			SetScale(auxScale);
 
 		ImGui::Separator();
 
@@ -121,17 +132,18 @@ void ComponentTransform::DrawInspector()
 
 void ComponentTransform::OnSave(SceneLoader & loader)
 {
-	loader.AddVec3f("Translation", position);
-	loader.AddVec3f("Scale", scale);
+	const Quat &rotation = GetRotation();
+	loader.AddVec3f("Translation", GetPosition());
+	loader.AddVec3f("Scale", GetScale());
 	loader.AddVec4f("Rotation", float4(rotation.x, rotation.y, rotation.z, rotation.w));
 }
 
 void ComponentTransform::OnLoad(SceneLoader & loader)
 {
-	position = loader.GetVec3f("Translation", float3(0, 0, 0));
-	scale = loader.GetVec3f("Scale", float3(1, 1, 1));
+	SetPosition(loader.GetVec3f("Translation", float3(0, 0, 0)));
+	SetScale(loader.GetVec3f("Scale", float3(1, 1, 1)));
 	float4 rotationVec = loader.GetVec4f("Rotation", float4(0, 0, 0, 1));
-	rotation = Quat(rotationVec.x, rotationVec.y, rotationVec.z, rotationVec.w);
+	SetRotation(Quat(rotationVec.x, rotationVec.y, rotationVec.z, rotationVec.w));
 
 	QuatToEuler();
 	UpdateMatrices();
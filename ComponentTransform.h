@@ -6,6 +6,7 @@
 #include "MathGeoLib/Math/float3.h"
 #include "MathGeoLib/Math/Quat.h"
 #include "MathGeoLib/Math/float4x4.h"
+#include "TransformHierarchy.h"
 
 class ComponentTransform : public Component
 {
@@ -16,26 +17,37 @@ public:
 
 	void EulerToQuat();
 	void QuatToEuler();
+	//Matrices of this transform alone, the scene updates all of them at once in TransformHierarchy::Update
 	void UpdateMatrices();
-	void SetGlobalMatrix(const float4x4 &parentGlobal);
 	void SetGlobalMatrix(const float4x4 &newGlobal, const float4x4 &parentGlobal);
 	void SetLocalMatrix(const float4x4 &newParentGlobalMatrix);
+	void SetParent(const ComponentTransform* parentTransform);
 	void TranslateTo(const float3 &newPos);
 	void DrawInspector();
 
+	//Local transform and matrices, they are kept in the TransformHierarchy
+	const float3& GetPosition() const { return Transforms->positions[slot]; }
+	const Quat& GetRotation() const { return Transforms->rotations[slot]; }
+	const float3& GetScale() const { return Transforms->scales[slot]; }
+	const float4x4& GetLocalMatrix() const { return Transforms->localMatrices[slot]; }
+	const float4x4& GetGlobalMatrix() const { return Transforms->worldMatrices[slot]; }
+
+	//Setters mark the transform dirty, it is recomputed with its descendants in the next scene update
+	void SetPosition(const float3 &newPosition) { Transforms->positions[slot] = newPosition; MarkDirty(); }
+	void SetRotation(const Quat &newRotation) { Transforms->rotations[slot] = newRotation; MarkDirty(); }
+	void SetScale(const float3 &newScale) { Transforms->scales[slot] = newScale; MarkDirty(); }
+	void MarkDirty() { Transforms->MarkDirty(slot); }
+
 	//Saving and loading
 	void OnSave(SceneLoader & loader);
 	void OnLoad(SceneLoader & loader);
 
 	//Variables
-	//Local Transform
-	float3 position = float3(0.0f, 0.0f, 0.0f);
-	Quat rotation = Quat::identity;
+	//Rotation edited in the inspector, in degrees
 	float3 eulerRotation = float3(0.0f, 0.0f, 0.0f);
-	float3 scale = float3(1.0f, 1.0f, 1.0f);
 
-	float4x4 localModelMatrix = float4x4::identity;
-	float4x4 globalModelMatrix = float4x4::identity;
+	//Slot in the TransformHierarchy, it changes when the hierarchy is sorted
+	unsigned int slot = TRANSFORM_NULL_SLOT;
 
 };
 
@@ -0,0 +1,233 @@
+#include "FrustumCuller.h"
+#include "ComponentCamera.h"
+#include "MathGeoLib/Geometry/Plane.h"
+
+#ifdef FRUSTUM_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+const unsigned FrustumCuller::ALL_PLANES;
+
+void FrustumCuller::SetPlanes(const Frustum & frustum)
+{
+	Plane planes[6];
+	frustum.GetPlanes(planes);
+
+	for(int p = 0; p < 6; ++p)
+	{
+		planeX[p] = planes[p].normal.x;
+		planeY[p] = planes[p].normal.y;
+		planeZ[p] = planes[p].normal.z;
+		planeD[p] = planes[p].d;
+	}
+
+	return;
+}
+
+int FrustumCuller::TestAABB(const AABB & aabb) const
+{
+	//Same result as testing the 8 corners: the n-vertex is the corner with the smallest distance to the plane
+	//and the p-vertex the one with the biggest
+	bool intersects = false;
+
+	for(int p = 0; p < 6; ++p)
+	{
+		float nX = (planeX[p] > 0.0f) ? aabb.minPoint.x : aabb.maxPoint.x;
+		float nY = (planeY[p] > 0.0f) ? aabb.minPoint.y : aabb.maxPoint.y;
+		float nZ = (planeZ[p] > 0.0f) ? aabb.minPoint.z : aabb.maxPoint.z;
+
+		//All corners in front of the plane
+		if (planeX[p] * nX + planeY[p] * nY + planeZ[p] * nZ - planeD[p] >= 0.0f)
+			return AABB_OUT;
+
+		float pX = (planeX[p] > 0.0f) ? aabb.maxPoint.x : aabb.minPoint.x;
+		float pY = (planeY[p] > 0.0f) ? aabb.maxPoint.y : aabb.minPoint.y;
+		float pZ = (planeZ[p] > 0.0f) ? aabb.maxPoint.z : aabb.minPoint.z;
+
+		//Some corner in front of the plane
+		if (planeX[p] * pX + planeY[p] * pY + planeZ[p] * pZ - planeD[p] >= 0.0f)
+			intersects = true;
+	}
+
+	return (intersects) ? AABB_INTERSECT : AABB_IN;
+}
+
+int FrustumCuller::TestAABBCorners(const Frustum & frustum, const AABB & aabb)
+{
+	float3 corners[8];
+	aabb.GetCornerPoints(corners);
+
+	int iTotalIn = 0;
+
+	//Get the planes once instead of rebuilding them for every corner
+	Plane planes[6];
+	frustum.GetPlanes(planes);
+
+	//test all 8 corners against the 6 planes of the frustum
+	// if all points are behind 1 specific plane, we are out
+	// if we are in with all points, then we are fully in
+	for(int p = 0; p < 6; ++p)
+	{
+		int iInCount = 8;
+		int iPtIn = 1;
+
+		for(int i = 0; i< 8; ++i)
+		{
+			//test this point against the planes, in front of it is outside
+			if(planes[p].normal.Dot(corners[i]) - planes[p].d >= 0.0f)
+			{
+				iPtIn = 0;
+				--iInCount;
+			}
+		}
+		
+		// were all the points outside of plane p?
+		if (iInCount == 0)
+			return AABB_OUT;
+
+		// check if they were all on the right side of the plane
+		iTotalIn += iPtIn;
+
+	}
+	// so if iTotalIn is 6, then all are inside the view
+	if (iTotalIn == 6)
+		return(AABB_IN);
+
+	return AABB_INTERSECT;
+}
+
+int FrustumCuller::TestAABB(const AABB & aabb, unsigned & planeMask, int & lastPlane) const
+{
+	//The plane that rejected the box last time is the most likely to reject it again
+	for(int i = 0; i < 6; ++i)
+	{
+		int p = (lastPlane + i) % 6;
+		if (!(planeMask & (1 << p)))
+			continue;
+
+		float nX = (planeX[p] > 0.0f) ? aabb.minPoint.x : aabb.maxPoint.x;
+		float nY = (planeY[p] > 0.0f) ? aabb.minPoint.y : aabb.maxPoint.y;
+		float nZ = (planeZ[p] > 0.0f) ? aabb.minPoint.z : aabb.maxPoint.z;
+
+		if (planeX[p] * nX + planeY[p] * nY + planeZ[p] * nZ - planeD[p] >= 0.0f)
+		{
+			lastPlane = p;
+			return AABB_OUT;
+		}
+
+		float pX = (planeX[p] > 0.0f) ? aabb.maxPoint.x : aabb.minPoint.x;
+		float pY = (planeY[p] > 0.0f) ? aabb.maxPoint.y : aabb.minPoint.y;
+		float pZ = (planeZ[p] > 0.0f) ? aabb.maxPoint.z : aabb.minPoint.z;
+
+		//Fully inside this plane, children don't need to test it again
+		if (planeX[p] * pX + planeY[p] * pY + planeZ[p] * pZ - planeD[p] < 0.0f)
+			planeMask &= ~(1 << p);
+	}
+
+	return (planeMask == 0) ? AABB_IN : AABB_INTERSECT;
+}
+
+void FrustumCuller::Clear()
+{
+	//Keep the memory for the next frame
+	count = 0;
+
+	return;
+}
+
+void FrustumCuller::AddBox(const AABB & aabb)
+{
+	if(count == minX.size())
+	{
+		unsigned newSize = count + 4;
+		minX.resize(newSize);
+		minY.resize(newSize);
+		minZ.resize(newSize);
+		maxX.resize(newSize);
+		maxY.resize(newSize);
+		maxZ.resize(newSize);
+	}
+
+	minX[count] = aabb.minPoint.x;
+	minY[count] = aabb.minPoint.y;
+	minZ[count] = aabb.minPoint.z;
+	maxX[count] = aabb.maxPoint.x;
+	maxY[count] = aabb.maxPoint.y;
+	maxZ[count] = aabb.maxPoint.z;
+	++count;
+
+	return;
+}
+
+void FrustumCuller::Cull(std::vector<int>& results) const
+{
+#ifdef FRUSTUM_CULLER_SSE
+	results.resize(count);
+
+	const __m128 zero = _mm_setzero_ps();
+
+	for(unsigned i = 0; i < count; i += 4)
+	{
+		__m128 boxMinX = _mm_loadu_ps(&minX[i]);
+		__m128 boxMinY = _mm_loadu_ps(&minY[i]);
+		__m128 boxMinZ = _mm_loadu_ps(&minZ[i]);
+		__m128 boxMaxX = _mm_loadu_ps(&maxX[i]);
+		__m128 boxMaxY = _mm_loadu_ps(&maxY[i]);
+		__m128 boxMaxZ = _mm_loadu_ps(&maxZ[i]);
+
+		__m128 outMask = zero;
+		__m128 intersectMask = zero;
+
+		for(int p = 0; p < 6; ++p)
+		{
+			//The sign of the normal is the same for the 4 boxes so n/p-vertex selection is done once per plane
+			__m128 nX = (planeX[p] > 0.0f) ? boxMinX : boxMaxX;
+			__m128 nY = (planeY[p] > 0.0f) ? boxMinY : boxMaxY;
+			__m128 nZ = (planeZ[p] > 0.0f) ? boxMinZ : boxMaxZ;
+			__m128 pX = (planeX[p] > 0.0f) ? boxMaxX : boxMinX;
+			__m128 pY = (planeY[p] > 0.0f) ? boxMaxY : boxMinY;
+			__m128 pZ = (planeZ[p] > 0.0f) ? boxMaxZ : boxMinZ;
+
+			__m128 normalX = _mm_set1_ps(planeX[p]);
+			__m128 normalY = _mm_set1_ps(planeY[p]);
+			__m128 normalZ = _mm_set1_ps(planeZ[p]);
+			__m128 d = _mm_set1_ps(planeD[p]);
+
+			__m128 nDist = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, nX), _mm_mul_ps(normalY, nY)), _mm_mul_ps(normalZ, nZ)), d);
+			__m128 pDist = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, pX), _mm_mul_ps(normalY, pY)), _mm_mul_ps(normalZ, pZ)), d);
+
+			outMask = _mm_or_ps(outMask, _mm_cmpge_ps(nDist, zero));
+			intersectMask = _mm_or_ps(intersectMask, _mm_cmpge_ps(pDist, zero));
+		}
+
+		int out = _mm_movemask_ps(outMask);
+		int intersect = _mm_movemask_ps(intersectMask);
+
+		for(unsigned j = 0; j < 4 && i + j < count; ++j)
+		{
+			if (out & (1 << j))
+				results[i + j] = AABB_OUT;
+			else if (intersect & (1 << j))
+				results[i + j] = AABB_INTERSECT;
+			else
+				results[i + j] = AABB_IN;
+		}
+	}
+#else
+	CullScalar(results);
+#endif
+
+	return;
+}
+
+void FrustumCuller::CullScalar(std::vector<int>& results) const
+{
+	results.resize(count);
+
+	for(unsigned i = 0; i < count; ++i)
+	{
+		results[i] = TestAABB(AABB(float3(minX[i], minY[i], minZ[i]), float3(maxX[i], maxY[i], maxZ[i])));
+	}
+
+	return;
+}
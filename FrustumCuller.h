@@ -0,0 +1,61 @@
+#ifndef __FrustumCuller_H__
+#define __FrustumCuller_H__
+
+#include "Globals.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include "MathGeoLib/Geometry/Frustum.h"
+#include <vector>
+
+//Comment this line to force the scalar path
+#define FRUSTUM_CULLER_SSE
+
+//Batch frustum culler
+//Planes are taken once per frame and boxes are stored as SoA arrays so they can be tested 4 at a time.
+//Results use the same codes as ComponentCamera::AABBWithinFrustum (AABB_OUT, AABB_IN, AABB_INTERSECT)
+class FrustumCuller
+{
+public:
+	FrustumCuller() = default;
+	~FrustumCuller() = default;
+
+	//Planes
+	void SetPlanes(const Frustum &frustum);
+	int TestAABB(const AABB &aabb) const;
+	//Only tests the planes set in planeMask (bit p for plane p) starting by lastPlane.
+	//Planes the box is fully inside are removed from the mask and lastPlane is set to the rejecting plane
+	int TestAABB(const AABB &aabb, unsigned &planeMask, int &lastPlane) const;
+
+	//Every corner against every plane, the reference for the other tests. Used by ComponentCamera::AABBWithinFrustum
+	static int TestAABBCorners(const Frustum &frustum, const AABB &aabb);
+
+	//Boxes
+	void Clear();
+	void AddBox(const AABB &aabb);
+	unsigned Size() const { return count; }
+
+	//Writes one code per box added since last Clear
+	void Cull(std::vector<int> &results) const;
+	void CullScalar(std::vector<int> &results) const;
+
+	//Plane normals point outwards of the frustum: { near, far, left, right, top, bottom }
+	float planeX[6];
+	float planeY[6];
+	float planeZ[6];
+	float planeD[6];
+
+	static const unsigned ALL_PLANES = 0x3f;
+
+private:
+	//SoA bounds, padded to a multiple of 4 boxes
+	std::vector<float> minX;
+	std::vector<float> minY;
+	std::vector<float> minZ;
+	std::vector<float> maxX;
+	std::vector<float> maxY;
+	std::vector<float> maxZ;
+
+	unsigned count = 0;
+
+};
+
+#endif __FrustumCuller_H__
@@ -3,6 +3,11 @@
 #include "ModuleCamera.h"
 #include "ModuleRender.h"
 #include "ModuleScene.h"
+#include "AABBTree.h"
+#include "SpatialHashGrid.h"
+#include "OverlapPairs.h"
+#include "LooseOctree.h"
+#include "TransformHierarchy.h"
 #include "Skybox.h"
 
 
@@ -20,7 +25,49 @@ void GUICamera::Draw(const char * title)
 		ImGui::Text("Camera Position: (%.3f,%.3f,%.3f)", App->camera->editorCamera->frustum->pos.x, App->camera->editorCamera->frustum->pos.y, App->camera->editorCamera->frustum->pos.z);
 		ImGui::Text("Camera near distance: %.3f", App->camera->editorCamera->frustum->nearPlaneDistance);
 		ImGui::Text("Camera far distance: %.3f", App->camera->editorCamera->frustum->farPlaneDistance);
-		ImGui::Text("Time for building iterative quadtree: %f", App->scene->timeIterative);
+		ImGui::Text("Time for building octree: %f", App->scene->timeOctree);
+		if (App->scene->octreeIsComputed)
+			ImGui::Text("Octree: %u objects in %u cells", App->scene->octree->Size(), App->scene->octree->UsedCells());
+		ImGui::Text("Octree version: %u (%u stale rebuilds dropped)", App->scene->octreeVersion, App->scene->octreeRebuilder.discardedCount);
+		if (ImGui::Button("Rebuild Octree"))
+		{
+			App->scene->BuildOctree();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Rebuild Octree (Background)"))
+		{
+			App->scene->RebuildOctreeAsync();
+		}
+		ImGui::Text("Time for building AABBTree: %f", App->scene->timeAABBTree);
+		ImGui::Text("AABBTree SAH cost: %.3f Depth: %d", App->scene->aabbTreeSAHCost, App->scene->aabbTreeDepth);
+		ImGui::Text("AABBTree updates: %u refit, %u reinserted", App->scene->aabbTree->refitCount, App->scene->aabbTree->reinsertCount);
+		if (ImGui::Button("Rebuild AABBTree (SAH)"))
+		{
+			App->scene->BuildAABBTree();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Rebuild AABBTree (Incremental)"))
+		{
+			App->scene->BuildAABBTree(true);
+		}
+		ImGui::Text("GameObjects: %u static, %u dynamic", (unsigned)App->scene->gameObjects.GetStatic().size(), (unsigned)App->scene->gameObjects.GetDynamic().size());
+		if (ImGui::RadioButton("Auto", App->scene->broadphaseMode == BROADPHASE_AUTO))
+			App->scene->broadphaseMode = BROADPHASE_AUTO;
+		ImGui::SameLine();
+		if (ImGui::RadioButton("AABBTree", App->scene->broadphaseMode == BROADPHASE_AABBTREE))
+			App->scene->broadphaseMode = BROADPHASE_AABBTREE;
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Grid", App->scene->broadphaseMode == BROADPHASE_GRID))
+			App->scene->broadphaseMode = BROADPHASE_GRID;
+		ImGui::Text("Dynamic objects in the %s, %.0f%% moving", App->scene->dynamicGridIsActive ? "grid" : "AABBTree", App->scene->movingFraction * 100.0f);
+		if (App->scene->dynamicGridIsActive)
+			ImGui::Text("Grid: %u objects in %u cells, %u cell changes", App->scene->dynamicGrid->Size(), App->scene->dynamicGrid->UsedCells(), App->scene->dynamicGrid->cellChangeCount);
+		ImGui::Text("Transforms: %u of %u recomputed in %.3f ms, %u sorts", App->scene->recomputedTransforms, Transforms->Size(), App->scene->timeTransforms, Transforms->sortCount);
+		ImGui::Text("Scene update: %.3f ms, %u dynamic objects moved", App->scene->timeSceneUpdate, (unsigned)App->scene->movedGO.size());
+		ImGui::Checkbox("Parallel Transforms", &App->scene->parallelTransforms);
+		ImGui::Checkbox("Track Overlaps", &App->scene->trackOverlaps);
+		ImGui::Text("Overlaps: %u pairs, %u began, %u ended, %u objects checked (%.3f ms)", App->scene->overlapPairs->PairCount(), (unsigned)App->scene->overlapPairs->beginPairs.size(),
+			(unsigned)App->scene->overlapPairs->endPairs.size(), App->scene->overlapPairs->movedCount, App->scene->timeOverlapPairs);
 
 		ImGui::Checkbox("Show Grid", &App->renderer->showGrid);
 		ImGui::Checkbox("Show Bounding Box", &App->renderer->showBoundingBox);
@@ -41,9 +88,17 @@ void GUICamera::Draw(const char * title)
 			}
 
 		}
-		ImGui::Checkbox("Show QuadTree", &App->renderer->showQuadTree); 
+		ImGui::Checkbox("Show Octree", &App->renderer->showOctree);
 		ImGui::Checkbox("Show AABBTree", &App->renderer->showAABBTree);
 		ImGui::Checkbox("Show Frustum", &App->renderer->showFrustum);
+		ImGui::Checkbox("Static Visibility Cache", &App->renderer->staticVisibilityCache);
+		ImGui::Text("Static frames: %u reused, %u patched, %u rebuilt (%u boxes retested)", App->renderer->staticFramesReused, App->renderer->staticFramesPatched, App->renderer->staticFramesRebuilt, App->renderer->staticRetestedCount);
+		ImGui::Text("Model meshes: %u accepted by parent, %u tested", App->renderer->meshesAcceptedByParent, App->renderer->meshesTestedByParent);
+		ImGui::Checkbox("Occlusion Culling", &App->renderer->occlusionCulling);
+		ImGui::Text("Occlusion: %u objects hidden by %u occluders (all views)", App->renderer->occlusionCulledCount, App->renderer->occluderCount);
+		App->camera->editorCamera->DrawDetailInspector();
+		ImGui::Text("Screen size: %u objects too small (all views)", App->renderer->screenSizeCulledCount);
+		ImGui::Text("Detail levels: %u full, %u LOD 1, %u LOD 2", App->renderer->detailLevelCount[0], App->renderer->detailLevelCount[1], App->renderer->detailLevelCount[2]);
 		//ImGui::Checkbox("Move Objects", &App->scene->moveObjectsArround);
 
 		/*
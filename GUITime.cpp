@@ -4,6 +4,7 @@
 #include "ModuleIMGUI.h"
 #include "ModuleTimeManager.h"
 #include "ModuleRender.h"
+#include "JobSystem.h"
 #include "FontAwesome/IconsFontAwesome5.h"
 #include "SDL/SDL.h"
 
@@ -41,6 +42,8 @@ void GUITime::Draw(const char * title)
 
 		ImGui::Text("Time per frame (before waiting): %.5f (ms)", App->timemanager->GetTimeBeforeVsync());
 
+		ImGui::Text("Jobs: %u threads, %u jobs run, %u stolen", App->jobs->ThreadCount(), App->jobs->GetJobCount(), App->jobs->GetStolenCount());
+
 
 
 
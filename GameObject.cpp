@@ -38,13 +38,9 @@ GameObject::GameObject(const char * name)
 	while(!validUID && name != "World")
 	{
 		this->UID = UUIDGen->getUUID();
-		if(App->scene->UIDs.find(UID) == App->scene->UIDs.end())
-		{
-			App->scene->UIDs.insert(UID);
-			validUID = true;
-		}
+		validUID = App->scene->gameObjects.ReserveUID(UID);
 	}
-	boundingBox = new AABB(myTransform->position - float3(1, 1, 1), myTransform->position + float3(1, 1, 1));
+	boundingBox = new AABB(myTransform->GetPosition() - float3(1, 1, 1), myTransform->GetPosition() + float3(1, 1, 1));
 	globalBoundingBox = new AABB(*boundingBox);
 
 }
@@ -102,12 +98,21 @@ GameObject::GameObject(const GameObject &go, GameObject* parent)
 	}
 
 	this->parent = parent;
+	if (myTransform != nullptr && parent != nullptr)
+		myTransform->SetParent(parent->myTransform);
 	//UID substitute
 	
-	isStatic = go.isStatic;
+	//Copies are listed as dynamic objects by the scene
+	isStatic = false;
 	isParentOfMeshes = go.isParentOfMeshes;
 
-	this->UID = UUIDGen->getUUID();
+	bool validUID = false;
+	//Ensure that UID is unique
+	while(!validUID)
+	{
+		this->UID = UUIDGen->getUUID();
+		validUID = App->scene->gameObjects.ReserveUID(UID);
+	}
 
 }
 
@@ -136,46 +141,6 @@ void GameObject::Update()
 	return;
 }
 
-void GameObject::SetParent(GameObject * newParent)
-
-{
-	//Erase me from previous father
-	if (parent != nullptr)
-	{
-		parent->RemoveChildren(this);
-	}
-		
-	
-	if(newParent != nullptr)
-	{
-		LOG("Setting new GamesObject parent and children.")
-		parent = newParent;
-		parent->children.push_back(this);
-
-		if(myMesh != nullptr)
-			parent->isParentOfMeshes = true;
-
-		return;
-	}
-
-
-
-	LOG("ERROR: Cannot set parent because new Parent is nullptr.");
-	return;
-
-}
-
-void GameObject::RemoveChildren(GameObject * child)
-{
-	//TODO: crash when deleting player
-	if(!children.empty())
-	{
-		children.erase(std::find(children.begin(), children.end(), child));
-	}
-	
-	return;
-}
-
 void GameObject::DeleteGameObject()
 {
 	if (UID == 1)
@@ -185,15 +150,13 @@ void GameObject::DeleteGameObject()
 	}
 
 	parent->RemoveChildren(this);
+	//Selection and clipboard handles to this object are stale from here
 	App->scene->RemoveGameObject(this);
 	for(auto ch : children)
 	{
 		ch->DeleteGameObject();
 	}
 
-	if (App->scene->selectedByHierarchy == this)
-		App->scene->selectedByHierarchy = nullptr;
-
 	CleanUp();
 
 	
@@ -272,7 +235,7 @@ void GameObject::DrawHierarchy(GameObject * selected)
 		if (ImGui::Selectable("Copy"))
 		{
 			if (this->UID != 1)
-				App->scene->clipboard = this;
+				App->scene->clipboard = App->scene->gameObjects.GetHandle(this);
 			else
 				LOG("Root cannot be copied. STOP!");
 		}
@@ -420,33 +383,6 @@ void GameObject::DrawCamera()
 	}
 }
 
-void GameObject::UpdateTransform()
-{
-	if(myTransform != nullptr)
-	{
-		if(parent != nullptr && parent->myTransform != nullptr)
-		{
-			myTransform->SetGlobalMatrix(parent->myTransform->globalModelMatrix);
-		}
-		myTransform->UpdateMatrices();
-
-		if(globalBoundingBox != nullptr && boundingBox != nullptr)
-		{
-			//AABB Global Update
-			//Compute globalBoundingBox
-
-			AABB auxBox;
-			auxBox.SetNegativeInfinity();
-			auxBox.Enclose(*boundingBox);
-			auxBox.TransformAsAABB(myTransform->globalModelMatrix);
-
-			*globalBoundingBox = auxBox;
-			
-			
-		}
-	}
-}
-
 void GameObject::SetName(const std::string &newName)
 {
 	name = newName;
@@ -497,7 +433,7 @@ void GameObject::ComputeAABB()
 		//Compute globalBoundingBox
 		float3 globalPos, globalScale;
 		float3x3 globalRot;
-		myTransform->globalModelMatrix.Decompose(globalPos, globalRot, globalScale);
+		myTransform->GetGlobalMatrix().Decompose(globalPos, globalRot, globalScale);
 
 		globalBoundingBox = new AABB(min.Mul(globalScale) + globalPos, max.Mul(globalScale) + globalPos);
 
@@ -528,7 +464,7 @@ void GameObject::ComputeAABB()
 	//Compute globalBoundingBox
 	float3 globalPos, globalScale;
 	float3x3 globalRot;
-	myTransform->globalModelMatrix.Decompose(globalPos, globalRot, globalScale);
+	myTransform->GetGlobalMatrix().Decompose(globalPos, globalRot, globalScale);
 
 	globalBoundingBox = new AABB(min.Mul(globalScale) + globalPos, max.Mul(globalScale) + globalPos);
 
@@ -540,7 +476,7 @@ void GameObject::DrawAABB() const
 	dd::aabb(globalBoundingBox->minPoint, globalBoundingBox->maxPoint, float3(0, 1, 0));
 }
 
-void GameObject::Draw(const unsigned int program, bool isGamePlaying, bool drawAABB)
+void GameObject::Draw(const unsigned int program, bool isGamePlaying, bool drawAABB, unsigned int lod)
 {
 	if (myLight != nullptr)
 	{
@@ -557,7 +493,7 @@ void GameObject::Draw(const unsigned int program, bool isGamePlaying, bool drawA
 	if(myMesh != nullptr)
 	{
 		myMaterial->SetDrawTextures(program);
-		myMesh->Draw(program);
+		myMesh->Draw(program, lod);
 	}
 }
 
@@ -572,7 +508,10 @@ void GameObject::DrawInspector(bool &showInspector)
 
 	ImGui::Begin(ICON_FA_INFO_CIRCLE " Inspector", &showInspector);
 
-	ImGui::Checkbox("", &isEnabled); ImGui::SameLine();
+	//Disabled objects are not updated, their bounds are taken again when they are enabled
+	if (ImGui::Checkbox("", &isEnabled) && isEnabled)
+		myTransform->MarkDirty();
+	ImGui::SameLine();
 	
 	ImGui::InputText("##Name", &name);
 
@@ -594,8 +533,6 @@ void GameObject::DrawInspector(bool &showInspector)
 	}
 
 	ImGui::End();
-	//Change EulerRotation to Quat
-	myTransform->EulerToQuat();
 }
 
 void GameObject::OnSave(SceneLoader & loader)
@@ -680,29 +617,16 @@ void GameObject::OnLoad(SceneLoader & loader)
 		component->OnLoad(loader);
 	}
 
-	App->scene->UIDs.insert(UID);
+	App->scene->gameObjects.ReserveUID(UID);
 	return;
 }
 
-float GameObject::IsIntersectedByRay(const float3 &origin, const LineSegment & ray)
-{
-	if (myMesh == nullptr)
-		return -1.0f;
-
-	//Transform ray coordinates into local space
-	LineSegment localRay = LineSegment(ray);
-	localRay.Transform(myTransform->globalModelMatrix.Inverted());
-	
-
-	return myMesh->IsIntersectedByRay(origin, localRay);
-}
-
 void GameObject::SetGlobalMatrix(const float4x4 & newGlobal)
 {
 	assert(myTransform != nullptr);
 	if(parent != nullptr && parent->myTransform != nullptr)
 	{
-		myTransform->SetGlobalMatrix(newGlobal, parent->myTransform->globalModelMatrix);
+		myTransform->SetGlobalMatrix(newGlobal, parent->myTransform->GetGlobalMatrix());
 	}
 
 	return;
@@ -729,33 +653,44 @@ void GameObject::SetStatic()
 
 	//Get all children and set static boolean
 	grandParent->GetAllChilds(myRelatedGO);
+	bool makeStatic = isStatic;
 	for(auto go : myRelatedGO)
 	{
-		go->isStatic = isStatic;
+		go->isStatic = makeStatic;
 
-		if (isStatic)
+		//Only objects that change set are moved between octree and aabbtree
+		bool wasStatic = App->scene->gameObjects.IsStatic(go);
+		if (wasStatic == makeStatic)
+			continue;
+
+		//Empties and cameras are in the dynamic structures too, objects culled with their parent are in none
+		bool isInStructures = go->globalBoundingBox != nullptr && !go->IsCulledWithParent();
+		if (makeStatic)
 		{
-			App->scene->dynamicGO.erase(go);
-			App->scene->staticGO.insert(go);
+			App->scene->gameObjects.Insert(go, true);
 
-			//Only added/removed to aabbtree if GO have mesh or is parent of mesh
-			if((go->myMesh != nullptr || go->isParentOfMeshes) && go->globalBoundingBox != nullptr)
-				App->scene->aabbTree->Remove(go);
+			if (isInStructures)
+			{
+				App->scene->RemoveDynamic(go);
+				App->scene->AddToOctree(go);
+			}
 		}
 
 		else
 		{
-			App->scene->staticGO.erase(go);
-			App->scene->dynamicGO.insert(go);
+			App->scene->gameObjects.Insert(go, false);
+			//Bounds and overlaps are taken in the next update
+			go->myTransform->MarkDirty();
 
-			if ((go->myMesh != nullptr || go->isParentOfMeshes) && go->globalBoundingBox != nullptr)
-				App->scene->aabbTree->Insert(go);
+			if (isInStructures)
+			{
+				App->scene->RemoveFromOctree(go);
+				App->scene->InsertDynamic(go);
+			}
 		}
 
 	}
 
-	App->scene->BuildQuadTree();
-
 	return;
 }
 
@@ -794,9 +729,14 @@ void GameObject::CheckDragAndDrop(GameObject * go)
 				myParent = myParent->parent;
 			}
 
+			GameObject* oldParent = newChild->parent;
 			newChild->SetParent(go);
 			if(newChild->parent->myTransform != nullptr)
-				newChild->myTransform->SetLocalMatrix(newChild->parent->myTransform->globalModelMatrix);
+				newChild->myTransform->SetLocalMatrix(newChild->parent->myTransform->GetGlobalMatrix());
+
+			//The moved object can join or leave the culling group of a model
+			App->scene->UpdateCullingGroup(oldParent);
+			App->scene->UpdateCullingGroup(go);
 		}
 		ImGui::EndDragDropTarget();
 	}
@@ -15,6 +15,9 @@ class ComponentMaterial;
 class ComponentCamera;
 class ComponentLight;
 class SceneLoader;
+class MultiViewCuller;
+class VisibleList;
+struct ViewCullPlanes;
 
 class GameObject
 {
@@ -40,8 +43,9 @@ public:
 	//Draw Main Camera
 	void DrawCamera();
 
-	//Update
-	void UpdateTransform();
+	//Update, global bounds from the world matrix computed by the TransformHierarchy. Only writes the bounds of this object
+	void UpdateBoundingBox();
+	void UpdateBoundingBox(const float4x4 &globalMatrix);
 
 	//Variables
 	//UID are unique
@@ -76,10 +80,37 @@ public:
 	void ComputeAABB();
 	void DrawAABB() const;
 
+	//Meshes of a loaded model are not in the spatial trees, they are culled and ray cast through their parent
+	bool IsCulledWithParent() const;
+	//Global bounds of a parent of meshes, they enclose the global bounds of the meshes culled with it
+	void EncloseChildren();
+	//In the AABBTree, the dynamic grid or the static octree
+	bool IsInSpatialStructures() const;
+	//Children that have to leave or join the spatial structures after a parent change, then encloses the grouped ones
+	void UpdateCullingGroup(std::vector<GameObject*> &leaving, std::vector<GameObject*> &joining);
+	//Adds the enabled meshes culled with this object to visible, tested only in the views this object crosses
+	void CullChildren(const MultiViewCuller &views, ViewCullPlanes &cullPlanes, VisibleList &visible, unsigned int &testedCount, unsigned int &acceptedCount) const;
+
 	AABB* boundingBox = nullptr;
 	AABB* globalBoundingBox = nullptr;
 
-	void Draw(const unsigned int program, bool isGamePlaying, bool drawAABB = false);
+	//Stamp of the last VisibleList query that added this object
+	unsigned int visibleStamp = 0;
+	//Views that see the object and views it is fully inside, bit v for view v. Set by the multi view queries
+	unsigned int visibleViews = 0;
+	unsigned int insideViews = 0;
+	//Leaf of the object in the AABBTree, AABB_NULL_NODE (0xffffffff) when it is not in the tree
+	unsigned int aabbTreeNodeIndex = 0xffffffff;
+	//Item of the object in the static octree, OCTREE_NULL_ITEM (0xffffffff) when it is not in the octree
+	unsigned int octreeItemIndex = 0xffffffff;
+	//Item of the object in the dynamic grid, GRID_NULL_ITEM (0xffffffff) when it is not in the grid
+	unsigned int gridItemIndex = 0xffffffff;
+	//Proxy of the object in the overlap pairs, OVERLAP_NULL_PROXY (0xffffffff) when its overlaps are not tracked
+	unsigned int overlapProxyIndex = 0xffffffff;
+	//Slot of the object in the scene registry, GAMEOBJECT_NULL_SLOT (0xffffffff) when it is not registered
+	unsigned int registrySlot = 0xffffffff;
+
+	void Draw(const unsigned int program, bool isGamePlaying, bool drawAABB = false, unsigned int lod = 0);
 	void DrawInspector(bool &showInspector);
 
 	//Shape type
@@ -90,7 +121,9 @@ public:
 
 	int numberOfCopies = 0;
 
-	float IsIntersectedByRay(const float3 &origin, const LineSegment & ray);
+	//Closest hit along the segment in [0, 1], -1.0f if the mesh is not hit
+	//Parents of meshes also test the meshes culled with them, hitObject is the object that was hit
+	float IsIntersectedByRay(const LineSegment & ray, unsigned int* triangle = nullptr, GameObject** hitObject = nullptr);
 	std::string name = "";
 
 	//ImGuizmo SetModelMatrix
@@ -0,0 +1,200 @@
+//Parent links, bounds, culling groups and ray hits of GameObject. They don't use the Application so the tests build them
+#include "GameObject.h"
+#include "ComponentTransform.h"
+#include "ComponentMesh.h"
+#include "AABBTree.h"
+#include "LooseOctree.h"
+#include "SpatialHashGrid.h"
+#include "MultiViewCuller.h"
+#include "VisibleList.h"
+#include "MathGeoLib/Geometry/LineSegment.h"
+#include <algorithm>
+
+void GameObject::SetParent(GameObject * newParent)
+
+{
+	//Erase me from previous father
+	if (parent != nullptr)
+	{
+		parent->RemoveChildren(this);
+	}
+		
+	
+	if(newParent != nullptr)
+	{
+		LOG("Setting new GamesObject parent and children.")
+		parent = newParent;
+		parent->children.push_back(this);
+
+		if (myTransform != nullptr)
+			myTransform->SetParent(parent->myTransform);
+
+		if(myMesh != nullptr)
+			parent->isParentOfMeshes = true;
+
+		return;
+	}
+
+
+
+	LOG("ERROR: Cannot set parent because new Parent is nullptr.");
+	return;
+
+}
+
+void GameObject::RemoveChildren(GameObject * child)
+{
+	//TODO: crash when deleting player
+	if(!children.empty())
+	{
+		children.erase(std::find(children.begin(), children.end(), child));
+	}
+	
+	return;
+}
+
+void GameObject::UpdateBoundingBox()
+{
+	if(myTransform != nullptr)
+		UpdateBoundingBox(myTransform->GetGlobalMatrix());
+}
+
+void GameObject::UpdateBoundingBox(const float4x4 &globalMatrix)
+{
+	//Parents of meshes enclose their children once these are updated
+	if(globalBoundingBox != nullptr && boundingBox != nullptr && !isParentOfMeshes)
+	{
+		//AABB Global Update
+		//Compute globalBoundingBox
+
+		AABB auxBox;
+		auxBox.SetNegativeInfinity();
+		auxBox.Enclose(*boundingBox);
+		auxBox.TransformAsAABB(globalMatrix);
+
+		*globalBoundingBox = auxBox;
+	}
+}
+
+bool GameObject::IsCulledWithParent() const
+{
+	//Only model roots without mesh group their children, the scene root never does
+	return myMesh != nullptr && parent != nullptr && parent->isParentOfMeshes && parent->myMesh == nullptr
+		&& !parent->isRoot && parent->globalBoundingBox != nullptr;
+}
+
+void GameObject::EncloseChildren()
+{
+	if (globalBoundingBox == nullptr)
+		return;
+
+	AABB bounds;
+	bounds.SetNegativeInfinity();
+	for(auto child : children)
+	{
+		if (child->IsCulledWithParent() && child->globalBoundingBox != nullptr)
+			bounds.Enclose(*child->globalBoundingBox);
+	}
+
+	if (bounds.IsFinite())
+		*globalBoundingBox = bounds;
+
+	return;
+}
+
+bool GameObject::IsInSpatialStructures() const
+{
+	return aabbTreeNodeIndex != AABB_NULL_NODE || gridItemIndex != GRID_NULL_ITEM || octreeItemIndex != OCTREE_NULL_ITEM;
+}
+
+void GameObject::UpdateCullingGroup(std::vector<GameObject*> &leaving, std::vector<GameObject*> &joining)
+{
+	for(auto child : children)
+	{
+		bool culledWithParent = child->IsCulledWithParent();
+		bool inStructures = child->IsInSpatialStructures();
+		if (culledWithParent && inStructures)
+			leaving.push_back(child);
+		else if (!culledWithParent && !inStructures && child->globalBoundingBox != nullptr)
+			joining.push_back(child);
+	}
+
+	if (isParentOfMeshes)
+		EncloseChildren();
+
+	return;
+}
+
+void GameObject::CullChildren(const MultiViewCuller &views, ViewCullPlanes &cullPlanes, VisibleList &visible, unsigned int &testedCount, unsigned int &acceptedCount) const
+{
+	if (!isParentOfMeshes)
+		return;
+
+	//Views that have this object inside see all of its meshes, only the crossing ones are tested
+	for(auto child : children)
+	{
+		if (!child->isEnabled || !child->IsCulledWithParent())
+			continue;
+
+		ViewMasks masks;
+		ViewCullState state = views.RootState();
+		state.viewMask = visibleViews & ~insideViews;
+		if (state.viewMask != 0)
+		{
+			++testedCount;
+			masks = views.TestAABB(*child->globalBoundingBox, state, cullPlanes);
+		}
+
+		if (insideViews != 0)
+			++acceptedCount;
+
+		masks.visible |= insideViews;
+		masks.inside |= insideViews;
+		if (masks.visible != 0)
+			visible.Add(child, masks.visible, masks.inside);
+	}
+
+	return;
+}
+
+float GameObject::IsIntersectedByRay(const LineSegment & ray, unsigned int* triangle, GameObject** hitObject)
+{
+	float hitDistance = -1.0f;
+	if (myMesh != nullptr)
+	{
+		//Transform ray coordinates into local space, the position along the segment is the same in both spaces
+		LineSegment localRay = LineSegment(ray);
+		localRay.Transform(myTransform->GetGlobalMatrix().Inverted());
+
+		hitDistance = myMesh->IsIntersectedByRay(localRay, triangle);
+		if (hitDistance >= 0.0f && hitObject != nullptr)
+			*hitObject = this;
+	}
+
+	if (!isParentOfMeshes)
+		return hitDistance;
+
+	//Meshes culled with this object are not in the trees, the nearest one is the hit
+	float entry, exit;
+	for(auto child : children)
+	{
+		if (!child->IsCulledWithParent() || child->globalBoundingBox == nullptr)
+			continue;
+
+		if (!child->globalBoundingBox->Intersects(ray, entry, exit) || (hitDistance >= 0.0f && entry >= hitDistance))
+			continue;
+
+		unsigned int childTriangle;
+		float distance = child->IsIntersectedByRay(ray, &childTriangle);
+		if (distance >= 0.0f && (hitDistance < 0.0f || distance < hitDistance))
+		{
+			hitDistance = distance;
+			if (triangle != nullptr)
+				*triangle = childTriangle;
+			if (hitObject != nullptr)
+				*hitObject = child;
+		}
+	}
+
+	return hitDistance;
+}
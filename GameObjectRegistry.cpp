@@ -0,0 +1,172 @@
+#include "GameObjectRegistry.h"
+#include "GameObject.h"
+#include <assert.h>
+
+GameObjectHandle GameObjectRegistry::Add(GameObject* go)
+{
+	assert(go != nullptr);
+	if (go->registrySlot != GAMEOBJECT_NULL_SLOT)
+		return GetHandle(go);
+
+	unsigned slot = firstFreeSlot;
+	if (slot != GAMEOBJECT_NULL_SLOT)
+	{
+		firstFreeSlot = slots[slot].nextFreeSlot;
+		slots[slot].nextFreeSlot = GAMEOBJECT_NULL_SLOT;
+		--freeSlotCount;
+	}
+	else
+	{
+		slot = slots.size();
+		slots.push_back(Slot());
+	}
+
+	slots[slot].go = go;
+	go->registrySlot = slot;
+	uidSlots[go->UID] = slot;
+
+	return GetHandle(go);
+}
+
+void GameObjectRegistry::Insert(GameObject* go, bool isStatic)
+{
+	unsigned slot = Add(go).slot;
+	if (slots[slot].allIndex != GAMEOBJECT_NULL_SLOT)
+	{
+		if (slots[slot].isStatic == isStatic)
+			return;
+
+		EraseDense(slots[slot].isStatic ? staticObjects : dynamicObjects, slots[slot].listIndex, false);
+	}
+	else
+	{
+		slots[slot].allIndex = allObjects.size();
+		allObjects.push_back(go);
+	}
+
+	std::vector<GameObject*>& list = isStatic ? staticObjects : dynamicObjects;
+	slots[slot].listIndex = list.size();
+	slots[slot].isStatic = isStatic;
+	list.push_back(go);
+
+	return;
+}
+
+void GameObjectRegistry::Remove(GameObject* go)
+{
+	unsigned slot = go->registrySlot;
+	if (slot == GAMEOBJECT_NULL_SLOT)
+		return;
+
+	//An object removed twice or from another registry
+	assert(slot < slots.size() && slots[slot].go == go);
+	Unlist(slot);
+
+	auto uid = uidSlots.find(go->UID);
+	if (uid != uidSlots.end() && uid->second == slot)
+		uidSlots.erase(uid);
+
+	++slots[slot].generation;
+	slots[slot].go = nullptr;
+	slots[slot].nextFreeSlot = firstFreeSlot;
+	firstFreeSlot = slot;
+	++freeSlotCount;
+	go->registrySlot = GAMEOBJECT_NULL_SLOT;
+
+	return;
+}
+
+void GameObjectRegistry::Clear()
+{
+	//The objects are not read, they can be deleted before
+	firstFreeSlot = GAMEOBJECT_NULL_SLOT;
+	for(unsigned slot = slots.size(); slot > 0; --slot)
+	{
+		Slot& freed = slots[slot - 1];
+		if (freed.go != nullptr)
+			++freed.generation;
+
+		freed.go = nullptr;
+		freed.allIndex = GAMEOBJECT_NULL_SLOT;
+		freed.listIndex = GAMEOBJECT_NULL_SLOT;
+		freed.nextFreeSlot = firstFreeSlot;
+		firstFreeSlot = slot - 1;
+	}
+	freeSlotCount = slots.size();
+
+	allObjects.clear();
+	staticObjects.clear();
+	dynamicObjects.clear();
+	uidSlots.clear();
+
+	return;
+}
+
+bool GameObjectRegistry::ReserveUID(unsigned uid)
+{
+	return uidSlots.emplace(uid, GAMEOBJECT_NULL_SLOT).second;
+}
+
+GameObject* GameObjectRegistry::Get(const GameObjectHandle& handle) const
+{
+	if (handle.slot >= slots.size() || slots[handle.slot].generation != handle.generation)
+		return nullptr;
+
+	return slots[handle.slot].go;
+}
+
+GameObjectHandle GameObjectRegistry::GetHandle(const GameObject* go) const
+{
+	GameObjectHandle handle;
+	if (go == nullptr || go->registrySlot == GAMEOBJECT_NULL_SLOT)
+		return handle;
+
+	handle.slot = go->registrySlot;
+	handle.generation = slots[go->registrySlot].generation;
+
+	return handle;
+}
+
+GameObject* GameObjectRegistry::Find(unsigned uid) const
+{
+	auto it = uidSlots.find(uid);
+	if (it == uidSlots.end() || it->second == GAMEOBJECT_NULL_SLOT)
+		return nullptr;
+
+	return slots[it->second].go;
+}
+
+bool GameObjectRegistry::IsStatic(const GameObject* go) const
+{
+	if (go->registrySlot == GAMEOBJECT_NULL_SLOT)
+		return false;
+
+	const Slot& slot = slots[go->registrySlot];
+	return slot.allIndex != GAMEOBJECT_NULL_SLOT && slot.isStatic;
+}
+
+void GameObjectRegistry::Unlist(unsigned slot)
+{
+	if (slots[slot].allIndex == GAMEOBJECT_NULL_SLOT)
+		return;
+
+	EraseDense(allObjects, slots[slot].allIndex, true);
+	EraseDense(slots[slot].isStatic ? staticObjects : dynamicObjects, slots[slot].listIndex, false);
+	slots[slot].allIndex = GAMEOBJECT_NULL_SLOT;
+	slots[slot].listIndex = GAMEOBJECT_NULL_SLOT;
+
+	return;
+}
+
+void GameObjectRegistry::EraseDense(std::vector<GameObject*>& objects, unsigned index, bool isAll)
+{
+	GameObject* last = objects.back();
+	objects[index] = last;
+	if (isAll)
+		slots[last->registrySlot].allIndex = index;
+	else
+		slots[last->registrySlot].listIndex = index;
+	objects.pop_back();
+
+	return;
+}
@@ -0,0 +1,87 @@
+#ifndef __GameObjectRegistry_H__
+#define __GameObjectRegistry_H__
+
+#include "Globals.h"
+#include <vector>
+#include <unordered_map>
+
+#define GAMEOBJECT_NULL_SLOT 0xffffffff
+
+class GameObject;
+
+//Reference to a registered GameObject that can outlive it, the generation tells a freed or reused slot apart
+struct GameObjectHandle
+{
+	unsigned slot = GAMEOBJECT_NULL_SLOT;
+	unsigned generation = 0;
+
+	bool operator==(const GameObjectHandle &other) const { return slot == other.slot && generation == other.generation; }
+	bool operator!=(const GameObjectHandle &other) const { return !(*this == other); }
+};
+
+//GameObjects of the scene in a slot map with generational handles
+//Every registered object has a slot, kept in GameObject::registrySlot, and its UID is mapped to it. Removing an object
+//frees its slot and increments the slot generation, so the handles to it return nullptr instead of a deleted object.
+//Listed objects are also in dense arrays, all of them and either the static or the dynamic ones, removed by moving
+//the last object into the hole, so walking them is a linear sweep. Their order changes when objects are removed.
+class GameObjectRegistry
+{
+public:
+	GameObjectRegistry() = default;
+	~GameObjectRegistry() = default;
+
+	//Gives the object a slot and maps its UID without listing it, as the root
+	GameObjectHandle Add(GameObject* go);
+	//Lists the object as static or dynamic, adding it if needed. A listed object is moved to the other list
+	void Insert(GameObject* go, bool isStatic);
+	//Frees the slot and the UID, nothing happens if the object is not registered
+	void Remove(GameObject* go);
+	//Every slot is freed, handles from before stay stale
+	void Clear();
+
+	//False if another object has the UID. Reserved UIDs are taken until the object that has them is removed
+	bool ReserveUID(unsigned uid);
+
+	//nullptr if the handle is stale
+	GameObject* Get(const GameObjectHandle &handle) const;
+	//Handle of a registered object, a null handle otherwise
+	GameObjectHandle GetHandle(const GameObject* go) const;
+	//Registered object with the UID, nullptr if there is none
+	GameObject* Find(unsigned uid) const;
+	bool IsStatic(const GameObject* go) const;
+
+	const std::vector<GameObject*>& GetAll() const { return allObjects; }
+	const std::vector<GameObject*>& GetStatic() const { return staticObjects; }
+	const std::vector<GameObject*>& GetDynamic() const { return dynamicObjects; }
+	unsigned Size() const { return slots.size() - freeSlotCount; }
+
+private:
+	struct Slot
+	{
+		GameObject* go = nullptr;
+		unsigned generation = 0;
+		//Positions in the dense arrays, GAMEOBJECT_NULL_SLOT while not listed
+		unsigned allIndex = GAMEOBJECT_NULL_SLOT;
+		unsigned listIndex = GAMEOBJECT_NULL_SLOT;
+		bool isStatic = false;
+		unsigned nextFreeSlot = GAMEOBJECT_NULL_SLOT;
+	};
+
+	void Unlist(unsigned slot);
+	//Moves the last object into the hole and drops the last position
+	void EraseDense(std::vector<GameObject*> &objects, unsigned index, bool isAll);
+
+	std::vector<Slot> slots;
+	unsigned firstFreeSlot = GAMEOBJECT_NULL_SLOT;
+	unsigned freeSlotCount = 0;
+
+	std::vector<GameObject*> allObjects;
+	std::vector<GameObject*> staticObjects;
+	std::vector<GameObject*> dynamicObjects;
+
+	//Slot of every UID, GAMEOBJECT_NULL_SLOT for UIDs reserved by objects that are not registered yet
+	std::unordered_map<unsigned, unsigned> uidSlots;
+
+};
+
+#endif __GameObjectRegistry_H__
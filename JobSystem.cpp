@@ -0,0 +1,258 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+//Queue of the current thread in the job system it works for
+static thread_local const JobSystem* threadJobSystem = nullptr;
+static thread_local unsigned threadQueue = 0;
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+	if (workerCount == 0)
+	{
+		unsigned hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+	}
+
+	//Every queue exists before the first worker can steal from it
+	for(unsigned i = 0; i < workerCount + 1; ++i)
+	{
+		queues.push_back(std::unique_ptr<JobQueue>(new JobQueue()));
+	}
+
+	for(unsigned i = 0; i < workerCount; ++i)
+	{
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i + 1));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		quit = true;
+	}
+	wakeUp.notify_all();
+
+	for(auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::Run(const std::function<void()>& job, JobCounter* counter)
+{
+	if (counter != nullptr)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	JobQueue& queue = *queues[QueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back({ job, counter });
+		++queue.pushedCount;
+	}
+	queuedJobs.fetch_add(1);
+	WakeWorker();
+
+	return;
+}
+
+void JobSystem::RunBackground(const std::function<void()>& job, JobCounter* counter)
+{
+	if (counter != nullptr)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+		backgroundQueue.jobs.push_back({ job, counter });
+		++backgroundQueue.pushedCount;
+	}
+	queuedBackgroundJobs.fetch_add(1);
+	WakeWorker();
+
+	return;
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+	unsigned index = QueueIndex();
+	while (!counter.IsDone())
+	{
+		//Jobs of the counter can be running on other threads
+		if (!RunNextJob(index))
+			std::this_thread::yield();
+	}
+
+	return;
+}
+
+void JobSystem::ParallelFor(unsigned count, const std::function<void(unsigned)>& job)
+{
+	ParallelForRange(count, 1, [&job](unsigned begin, unsigned end)
+	{
+		for(unsigned i = begin; i < end; ++i)
+		{
+			job(i);
+		}
+	});
+
+	return;
+}
+
+void JobSystem::ParallelForRange(unsigned count, unsigned minRange, const std::function<void(unsigned, unsigned)>& job)
+{
+	if (count == 0)
+		return;
+
+	unsigned rangeCount = std::min(ThreadCount() * 4, std::max(count / std::max(minRange, 1u), 1u));
+	if (rangeCount == 1)
+	{
+		job(0, count);
+		return;
+	}
+
+	//The first range runs here, the others can be stolen while it runs
+	JobCounter counter;
+	for(unsigned range = rangeCount - 1; range > 0; --range)
+	{
+		unsigned begin = (unsigned)((unsigned long long)count * range / rangeCount);
+		unsigned end = (unsigned)((unsigned long long)count * (range + 1) / rangeCount);
+		Run([&job, begin, end]() { job(begin, end); }, &counter);
+	}
+	job(0, (unsigned)((unsigned long long)count / rangeCount));
+	Wait(counter);
+
+	return;
+}
+
+unsigned JobSystem::GetJobCount() const
+{
+	unsigned count = 0;
+	for(auto& queue : queues)
+	{
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		count += queue->pushedCount;
+	}
+	std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+	count += backgroundQueue.pushedCount;
+
+	return count;
+}
+
+unsigned JobSystem::GetStolenCount() const
+{
+	unsigned count = 0;
+	for(auto& queue : queues)
+	{
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		count += queue->stolenCount;
+	}
+
+	return count;
+}
+
+void JobSystem::WorkerLoop(unsigned index)
+{
+	threadJobSystem = this;
+	threadQueue = index;
+
+	while (true)
+	{
+		//Background jobs only here, outside of any wait
+		if (RunNextJob(index) || RunBackgroundJob())
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		++sleepingWorkers;
+		wakeUp.wait(lock, [this]() { return quit || queuedJobs.load() > 0 || queuedBackgroundJobs.load() > 0; });
+		--sleepingWorkers;
+		if (quit && queuedJobs.load() == 0 && queuedBackgroundJobs.load() == 0)
+			return;
+	}
+}
+
+bool JobSystem::RunNextJob(unsigned index)
+{
+	if (queuedJobs.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	Job job;
+	bool isFound = false;
+	for(unsigned i = 0; i < queues.size() && !isFound; ++i)
+	{
+		JobQueue& queue = *queues[(index + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			continue;
+
+		//Newest own job, oldest job of other threads
+		if (i == 0)
+		{
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+		}
+		else
+		{
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			++queue.stolenCount;
+		}
+		isFound = true;
+	}
+
+	if (!isFound)
+		return false;
+
+	queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	RunJob(job);
+
+	return true;
+}
+
+bool JobSystem::RunBackgroundJob()
+{
+	if (queuedBackgroundJobs.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	Job job;
+	{
+		std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+		if (backgroundQueue.jobs.empty())
+			return false;
+
+		job = std::move(backgroundQueue.jobs.front());
+		backgroundQueue.jobs.pop_front();
+	}
+
+	queuedBackgroundJobs.fetch_sub(1, std::memory_order_relaxed);
+	RunJob(job);
+
+	return true;
+}
+
+void JobSystem::RunJob(Job& job)
+{
+	job.function();
+	if (job.counter != nullptr)
+		job.counter->pending.fetch_sub(1, std::memory_order_release);
+
+	return;
+}
+
+void JobSystem::WakeWorker()
+{
+	//A worker going to sleep either sees the new job or is already waiting when it is notified
+	if (sleepingWorkers.load() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wakeUp.notify_one();
+	}
+
+	return;
+}
+
+unsigned JobSystem::QueueIndex() const
+{
+	return (threadJobSystem == this) ? threadQueue : 0;
+}
@@ -0,0 +1,96 @@
+#ifndef __JobSystem_H__
+#define __JobSystem_H__
+
+#include "Globals.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//Jobs started with a counter that are not finished yet
+class JobCounter
+{
+public:
+	bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<unsigned> pending{ 0 };
+
+};
+
+//Work stealing job system, one per application
+//Every thread has its own queue: it pushes and pops its jobs at the back, so nested jobs run while their data is
+//still in cache, and threads without work steal the oldest jobs from the front of the other queues.
+//Threads that are not workers, like the main thread, use the first queue. Waiting on a counter runs other jobs
+//instead of blocking, so jobs can start jobs and wait for them and loops can be nested.
+//Long jobs that may span frames go to a background queue only idle workers take from, a wait never runs them.
+class JobSystem
+{
+public:
+	//0 uses one worker less than the hardware threads
+	JobSystem(unsigned workerCount = 0);
+	~JobSystem();
+
+	//The counter, if any, is done when the job and every other job started with it are finished
+	void Run(const std::function<void()> &job, JobCounter* counter = nullptr);
+	//Taken by a worker when no other job is queued, never by a thread waiting on a counter
+	void RunBackground(const std::function<void()> &job, JobCounter* counter = nullptr);
+	//Runs jobs until the counter is done
+	void Wait(const JobCounter &counter);
+
+	//Runs job(index) for every index in [0, count) and returns when all of them are done
+	void ParallelFor(unsigned count, const std::function<void(unsigned)> &job);
+	//Splits [0, count) in a few ranges per thread of at least minRange indices and runs job(begin, end) on each.
+	//A single range runs on the calling thread without waking the workers
+	void ParallelForRange(unsigned count, unsigned minRange, const std::function<void(unsigned, unsigned)> &job);
+
+	unsigned ThreadCount() const { return queues.size(); }
+	//Jobs pushed and jobs taken from the queue of another thread since the start
+	unsigned GetJobCount() const;
+	unsigned GetStolenCount() const;
+
+private:
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	struct JobQueue
+	{
+		mutable std::mutex mutex;
+		std::deque<Job> jobs;
+		unsigned pushedCount = 0;
+		unsigned stolenCount = 0;
+	};
+
+	void WorkerLoop(unsigned index);
+	//Own jobs first, then the other queues starting from the next one. False if every queue was empty
+	bool RunNextJob(unsigned index);
+	//Oldest background job. False if there was none
+	bool RunBackgroundJob();
+	void RunJob(Job &job);
+	void WakeWorker();
+	unsigned QueueIndex() const;
+
+	//Queue 0 belongs to the threads that are not workers
+	std::vector<std::unique_ptr<JobQueue>> queues;
+	JobQueue backgroundQueue;
+	std::vector<std::thread> workers;
+
+	//Workers sleep when no queue has jobs, background ones included
+	std::atomic<unsigned> queuedJobs{ 0 };
+	std::atomic<unsigned> queuedBackgroundJobs{ 0 };
+	std::atomic<unsigned> sleepingWorkers{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	bool quit = false;
+
+};
+
+#endif __JobSystem_H__
@@ -0,0 +1,615 @@
+#include "LooseOctree.h"
+#include "GameObject.h"
+#include "debugdraw.h"
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+#include <functional>
+
+LooseOctree::LooseOctree()
+{
+	//Level l has 8^l cells, all levels go one after the other
+	unsigned cellCount = 0;
+	for(int level = 0; level <= LOOSE_OCTREE_MAX_DEPTH; ++level)
+	{
+		levelOffset[level] = cellCount;
+		cellCount += 1 << (3 * level);
+	}
+
+	cells.resize(cellCount);
+}
+
+void LooseOctree::Clear(const AABB & limits)
+{
+	//Cubic root so cells have the same size in every axis
+	float3 center = limits.CenterPoint();
+	rootSize = limits.Size().MaxElement();
+	if (rootSize <= 0.0f)
+		rootSize = 1.0f;
+
+	this->limits = AABB(center - float3(rootSize * 0.5f), center + float3(rootSize * 0.5f));
+
+	std::fill(cells.begin(), cells.end(), OctreeCell());
+	items.clear();
+	itemCount = 0;
+	firstFreeItem = OCTREE_NULL_ITEM;
+	growCount = 0;
+	removeCount = 0;
+
+	return;
+}
+
+void LooseOctree::Insert(GameObject * go)
+{
+	assert(go != nullptr && go->globalBoundingBox != nullptr);
+	if (go->octreeItemIndex != OCTREE_NULL_ITEM)
+		return;
+
+	const AABB& aabb = *go->globalBoundingBox;
+
+	//First object of an octree that was never cleared
+	if (rootSize == 0.0f)
+		Clear(aabb);
+
+	if (!limits.Contains(aabb))
+		Grow(aabb);
+
+	go->octreeItemIndex = InsertItem(go, aabb);
+
+	return;
+}
+
+void LooseOctree::Remove(GameObject * go)
+{
+	unsigned itemIndex = go->octreeItemIndex;
+	if (itemIndex == OCTREE_NULL_ITEM)
+		return;
+
+	assert(items[itemIndex].go == go);
+
+	UnlinkItem(itemIndex);
+
+	items[itemIndex].go = nullptr;
+	items[itemIndex].nextItem = firstFreeItem;
+	firstFreeItem = itemIndex;
+
+	go->octreeItemIndex = OCTREE_NULL_ITEM;
+	--itemCount;
+	++removeCount;
+
+	return;
+}
+
+void LooseOctree::Build(const AABB & limits, const std::vector<std::pair<GameObject*, AABB>>& objects)
+{
+	Clear(limits);
+
+	items.reserve(objects.size());
+	for(const auto& object : objects)
+	{
+		InsertItem(object.first, object.second);
+	}
+
+	return;
+}
+
+void LooseOctree::BindObjects() const
+{
+	for(unsigned itemIndex = 0; itemIndex < items.size(); ++itemIndex)
+	{
+		if (items[itemIndex].go != nullptr)
+			items[itemIndex].go->octreeItemIndex = itemIndex;
+	}
+
+	return;
+}
+
+bool LooseOctree::NeedsRebuild() const
+{
+	//More objects removed than left
+	return growCount > 0 || removeCount > itemCount;
+}
+
+void LooseOctree::GetIntersection(VisibleList & intersectionGO, const AABB * bbox)
+{
+	//DFS over non empty cells, each object is stored once so no duplicates come from the octree
+	traversalStack.clear();
+	traversalStack.push_back({ 0, 0, 0, 0 });
+	while(!traversalStack.empty())
+	{
+		CellCoordinates cell = traversalStack.back();
+		traversalStack.pop_back();
+
+		const OctreeCell& octreeCell = cells[CellIndex(cell)];
+		if (octreeCell.subtreeCount == 0)
+			continue;
+
+		//Root is not tested, objects outside the limits are kept there
+		if (cell.level > 0 && !bbox->Intersects(LooseCellAABB(cell)))
+			continue;
+
+		for(unsigned itemIndex = octreeCell.firstItem; itemIndex != OCTREE_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			if (bbox->Intersects(items[itemIndex].aabb))
+				intersectionGO.Add(items[itemIndex].go);
+		}
+
+		if (cell.level == LOOSE_OCTREE_MAX_DEPTH)
+			continue;
+
+		for(unsigned child = 0; child < 8; ++child)
+		{
+			traversalStack.push_back({ cell.level + 1, 2 * cell.x + (child & 1), 2 * cell.y + ((child >> 1) & 1), 2 * cell.z + ((child >> 2) & 1) });
+		}
+	}
+
+	return;
+}
+
+void LooseOctree::GetIntersection(VisibleList & intersectionGO, const LineSegment * ray)
+{
+	traversalStack.clear();
+	traversalStack.push_back({ 0, 0, 0, 0 });
+	while (!traversalStack.empty())
+	{
+		CellCoordinates cell = traversalStack.back();
+		traversalStack.pop_back();
+
+		const OctreeCell& octreeCell = cells[CellIndex(cell)];
+		if (octreeCell.subtreeCount == 0)
+			continue;
+
+		if (cell.level > 0 && !ray->Intersects(LooseCellAABB(cell)))
+			continue;
+
+		for (unsigned itemIndex = octreeCell.firstItem; itemIndex != OCTREE_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			if (ray->Intersects(items[itemIndex].aabb))
+				intersectionGO.Add(items[itemIndex].go);
+		}
+
+		if (cell.level == LOOSE_OCTREE_MAX_DEPTH)
+			continue;
+
+		for (unsigned child = 0; child < 8; ++child)
+		{
+			traversalStack.push_back({ cell.level + 1, 2 * cell.x + (child & 1), 2 * cell.y + ((child >> 1) & 1), 2 * cell.z + ((child >> 2) & 1) });
+		}
+	}
+
+	return;
+}
+
+GameObject* LooseOctree::RayCast(const LineSegment & ray, float & hitDistance)
+{
+	GameObject* hitGO = nullptr;
+	if (itemCount == 0)
+		return hitGO;
+
+	//Root is not tested, objects outside the limits are kept there
+	rayHeap.clear();
+	rayHeap.push_back({ 0.0f, { 0, 0, 0, 0 } });
+	while (!rayHeap.empty())
+	{
+		std::pop_heap(rayHeap.begin(), rayHeap.end(), std::greater<RayCell>());
+		RayCell next = rayHeap.back();
+		rayHeap.pop_back();
+
+		if (next.entry >= hitDistance)
+			break;
+
+		const CellCoordinates& cell = next.cell;
+		const OctreeCell& octreeCell = cells[CellIndex(cell)];
+
+		float entry, exit;
+		for (unsigned itemIndex = octreeCell.firstItem; itemIndex != OCTREE_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			if (!items[itemIndex].aabb.Intersects(ray, entry, exit) || entry >= hitDistance)
+				continue;
+
+			GameObject* hitObject = items[itemIndex].go;
+			float distance = items[itemIndex].go->IsIntersectedByRay(ray, nullptr, &hitObject);
+			if (distance >= 0.0f && distance < hitDistance)
+			{
+				hitDistance = distance;
+				hitGO = hitObject;
+			}
+		}
+
+		if (cell.level == LOOSE_OCTREE_MAX_DEPTH)
+			continue;
+
+		for (unsigned child = 0; child < 8; ++child)
+		{
+			CellCoordinates childCell = { cell.level + 1, 2 * cell.x + (child & 1), 2 * cell.y + ((child >> 1) & 1), 2 * cell.z + ((child >> 2) & 1) };
+			if (cells[CellIndex(childCell)].subtreeCount == 0)
+				continue;
+
+			if (!LooseCellAABB(childCell).Intersects(ray, entry, exit) || entry >= hitDistance)
+				continue;
+
+			rayHeap.push_back({ entry, childCell });
+			std::push_heap(rayHeap.begin(), rayHeap.end(), std::greater<RayCell>());
+		}
+	}
+
+	return hitGO;
+}
+
+void LooseOctree::RayCast(const LineSegment * rays, RayHit * hits, unsigned count) const
+{
+	assert(count <= RAY_PACKET_SIZE);
+	if (itemCount == 0 || count == 0)
+		return;
+
+	typedef unsigned long long RayMask;
+
+	//Root is not tested, objects outside the limits are kept there
+	RayMask rootMask = (count == RAY_PACKET_SIZE) ? ~(RayMask)0 : (((RayMask)1 << count) - 1);
+
+	std::vector<std::pair<CellCoordinates, RayMask>> stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(CellCoordinates{ 0, 0, 0, 0 }, rootMask));
+	while (!stack.empty())
+	{
+		std::pair<CellCoordinates, RayMask> next = stack.back();
+		stack.pop_back();
+
+		const CellCoordinates& cell = next.first;
+		const OctreeCell& octreeCell = cells[CellIndex(cell)];
+
+		float entry, exit;
+		for (unsigned itemIndex = octreeCell.firstItem; itemIndex != OCTREE_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			const OctreeItem& item = items[itemIndex];
+			for (unsigned i = 0; i < count; ++i)
+			{
+				if (!(next.second & ((RayMask)1 << i)))
+					continue;
+
+				if (!item.aabb.Intersects(rays[i], entry, exit) || entry >= hits[i].distance)
+					continue;
+
+				unsigned triangle;
+				GameObject* hitObject = item.go;
+				float distance = item.go->IsIntersectedByRay(rays[i], &triangle, &hitObject);
+				if (distance >= 0.0f && distance < hits[i].distance)
+				{
+					hits[i].go = hitObject;
+					hits[i].distance = distance;
+					hits[i].triangle = triangle;
+				}
+			}
+		}
+
+		if (cell.level == LOOSE_OCTREE_MAX_DEPTH)
+			continue;
+
+		for (unsigned child = 0; child < 8; ++child)
+		{
+			CellCoordinates childCell = { cell.level + 1, 2 * cell.x + (child & 1), 2 * cell.y + ((child >> 1) & 1), 2 * cell.z + ((child >> 2) & 1) };
+			if (cells[CellIndex(childCell)].subtreeCount == 0)
+				continue;
+
+			AABB childAABB = LooseCellAABB(childCell);
+			RayMask childMask = 0;
+			for (unsigned i = 0; i < count; ++i)
+			{
+				if ((next.second & ((RayMask)1 << i)) && childAABB.Intersects(rays[i], entry, exit) && entry < hits[i].distance)
+					childMask |= (RayMask)1 << i;
+			}
+
+			if (childMask != 0)
+				stack.push_back(std::make_pair(childCell, childMask));
+		}
+	}
+
+	return;
+}
+
+unsigned LooseOctree::GetNearest(const float3 & point, unsigned k, float maxDistance, NearestObject * nearest, unsigned count)
+{
+	if (itemCount == 0 || k == 0)
+		return count;
+
+	auto isFarther = [&](float distance)
+	{
+		return (count == k) ? distance >= nearest[k - 1].distance : distance > maxDistance;
+	};
+
+	//Root is not tested, objects outside the limits are kept there
+	rayHeap.clear();
+	rayHeap.push_back({ 0.0f, { 0, 0, 0, 0 } });
+	while (!rayHeap.empty())
+	{
+		std::pop_heap(rayHeap.begin(), rayHeap.end(), std::greater<RayCell>());
+		RayCell next = rayHeap.back();
+		rayHeap.pop_back();
+
+		if (isFarther(next.entry))
+			break;
+
+		const CellCoordinates& cell = next.cell;
+		const OctreeCell& octreeCell = cells[CellIndex(cell)];
+
+		for (unsigned itemIndex = octreeCell.firstItem; itemIndex != OCTREE_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			float distance = items[itemIndex].aabb.Distance(point);
+			if (!isFarther(distance))
+				count = InsertNearest(nearest, count, k, items[itemIndex].go, distance);
+		}
+
+		if (cell.level == LOOSE_OCTREE_MAX_DEPTH)
+			continue;
+
+		for (unsigned child = 0; child < 8; ++child)
+		{
+			CellCoordinates childCell = { cell.level + 1, 2 * cell.x + (child & 1), 2 * cell.y + ((child >> 1) & 1), 2 * cell.z + ((child >> 2) & 1) };
+			if (cells[CellIndex(childCell)].subtreeCount == 0)
+				continue;
+
+			float distance = LooseCellAABB(childCell).Distance(point);
+			if (isFarther(distance))
+				continue;
+
+			rayHeap.push_back({ distance, childCell });
+			std::push_heap(rayHeap.begin(), rayHeap.end(), std::greater<RayCell>());
+		}
+	}
+
+	return count;
+}
+
+void LooseOctree::GetWithinRadius(const float3 & point, float radius, std::vector<NearestObject>& objects)
+{
+	traversalStack.clear();
+	traversalStack.push_back({ 0, 0, 0, 0 });
+	while (!traversalStack.empty())
+	{
+		CellCoordinates cell = traversalStack.back();
+		traversalStack.pop_back();
+
+		const OctreeCell& octreeCell = cells[CellIndex(cell)];
+		if (octreeCell.subtreeCount == 0)
+			continue;
+
+		//Root is not tested, objects outside the limits are kept there
+		if (cell.level > 0 && LooseCellAABB(cell).Distance(point) > radius)
+			continue;
+
+		for (unsigned itemIndex = octreeCell.firstItem; itemIndex != OCTREE_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			NearestObject object;
+			object.go = items[itemIndex].go;
+			object.distance = items[itemIndex].aabb.Distance(point);
+			if (object.distance <= radius)
+				objects.push_back(object);
+		}
+
+		if (cell.level == LOOSE_OCTREE_MAX_DEPTH)
+			continue;
+
+		for (unsigned child = 0; child < 8; ++child)
+		{
+			traversalStack.push_back({ cell.level + 1, 2 * cell.x + (child & 1), 2 * cell.y + ((child >> 1) & 1), 2 * cell.z + ((child >> 2) & 1) });
+		}
+	}
+
+	std::sort(objects.begin(), objects.end());
+
+	return;
+}
+
+void LooseOctree::Draw() const
+{
+	//Only cells with objects below them
+	std::vector<CellCoordinates> stack;
+	stack.push_back({ 0, 0, 0, 0 });
+	while (!stack.empty())
+	{
+		CellCoordinates cell = stack.back();
+		stack.pop_back();
+
+		if (cells[CellIndex(cell)].subtreeCount == 0)
+			continue;
+
+		AABB cellAABB = CellAABB(cell);
+		dd::aabb(cellAABB.minPoint, cellAABB.maxPoint, float3(1.0f, 0.5f, 0.5f));
+
+		if (cell.level == LOOSE_OCTREE_MAX_DEPTH)
+			continue;
+
+		for (unsigned child = 0; child < 8; ++child)
+		{
+			stack.push_back({ cell.level + 1, 2 * cell.x + (child & 1), 2 * cell.y + ((child >> 1) & 1), 2 * cell.z + ((child >> 2) & 1) });
+		}
+	}
+
+	return;
+}
+
+unsigned LooseOctree::UsedCells() const
+{
+	unsigned usedCells = 0;
+	for(const auto& cell : cells)
+	{
+		if (cell.firstItem != OCTREE_NULL_ITEM)
+			++usedCells;
+	}
+
+	return usedCells;
+}
+
+unsigned LooseOctree::CellIndex(const CellCoordinates & cell) const
+{
+	return levelOffset[cell.level] + MortonCode(cell.x, cell.y, cell.z);
+}
+
+AABB LooseOctree::CellAABB(const CellCoordinates & cell) const
+{
+	float cellSize = rootSize / (float)(1 << cell.level);
+	float3 minPoint = limits.minPoint + float3((float)cell.x, (float)cell.y, (float)cell.z) * cellSize;
+
+	return AABB(minPoint, minPoint + float3(cellSize));
+}
+
+AABB LooseOctree::LooseCellAABB(const CellCoordinates & cell) const
+{
+	//Half a cell bigger on every side
+	float cellSize = rootSize / (float)(1 << cell.level);
+	float3 minPoint = limits.minPoint + float3((float)cell.x - 0.5f, (float)cell.y - 0.5f, (float)cell.z - 0.5f) * cellSize;
+
+	return AABB(minPoint, minPoint + float3(2.0f * cellSize));
+}
+
+LooseOctree::CellCoordinates LooseOctree::FindCell(const AABB & aabb) const
+{
+	//Objects up to the cell size fit in the loose cell that holds their center
+	float extent = aabb.Size().MaxElement();
+	int level = LOOSE_OCTREE_MAX_DEPTH;
+	if (extent > 0.0f)
+		level = std::min(LOOSE_OCTREE_MAX_DEPTH, std::max(0, (int)floor(log2(rootSize / extent))));
+
+	float3 center = aabb.CenterPoint();
+	for (; level > 0; --level)
+	{
+		int cellsPerAxis = 1 << level;
+		float cellSize = rootSize / (float)cellsPerAxis;
+		float3 position = (center - limits.minPoint) / cellSize;
+
+		CellCoordinates cell;
+		cell.level = level;
+		cell.x = (unsigned)std::min(cellsPerAxis - 1, std::max(0, (int)floor(position.x)));
+		cell.y = (unsigned)std::min(cellsPerAxis - 1, std::max(0, (int)floor(position.y)));
+		cell.z = (unsigned)std::min(cellsPerAxis - 1, std::max(0, (int)floor(position.z)));
+
+		//Centers outside the limits are clamped, those objects may not fit and go up
+		if (LooseCellAABB(cell).Contains(aabb))
+			return cell;
+	}
+
+	return { 0, 0, 0, 0 };
+}
+
+unsigned LooseOctree::InsertItem(GameObject * go, const AABB & aabb)
+{
+	unsigned itemIndex = firstFreeItem;
+	if (itemIndex != OCTREE_NULL_ITEM)
+	{
+		firstFreeItem = items[itemIndex].nextItem;
+	}
+	else
+	{
+		itemIndex = items.size();
+		items.push_back(OctreeItem());
+	}
+
+	items[itemIndex].aabb = aabb;
+	items[itemIndex].go = go;
+	LinkItem(itemIndex);
+	++itemCount;
+
+	return itemIndex;
+}
+
+void LooseOctree::LinkItem(unsigned itemIndex)
+{
+	OctreeItem& item = items[itemIndex];
+	item.cell = FindCell(item.aabb);
+
+	OctreeCell& octreeCell = cells[CellIndex(item.cell)];
+	item.previousItem = OCTREE_NULL_ITEM;
+	item.nextItem = octreeCell.firstItem;
+	if (octreeCell.firstItem != OCTREE_NULL_ITEM)
+		items[octreeCell.firstItem].previousItem = itemIndex;
+	octreeCell.firstItem = itemIndex;
+
+	//Walk up to the root counting the object on every ancestor, O(depth)
+	CellCoordinates cell = item.cell;
+	while(cell.level >= 0)
+	{
+		++cells[CellIndex(cell)].subtreeCount;
+
+		--cell.level;
+		cell.x >>= 1;
+		cell.y >>= 1;
+		cell.z >>= 1;
+	}
+
+	return;
+}
+
+void LooseOctree::UnlinkItem(unsigned itemIndex)
+{
+	OctreeItem& item = items[itemIndex];
+
+	if (item.previousItem != OCTREE_NULL_ITEM)
+		items[item.previousItem].nextItem = item.nextItem;
+	else
+		cells[CellIndex(item.cell)].firstItem = item.nextItem;
+
+	if (item.nextItem != OCTREE_NULL_ITEM)
+		items[item.nextItem].previousItem = item.previousItem;
+
+	CellCoordinates cell = item.cell;
+	while (cell.level >= 0)
+	{
+		--cells[CellIndex(cell)].subtreeCount;
+
+		--cell.level;
+		cell.x >>= 1;
+		cell.y >>= 1;
+		cell.z >>= 1;
+	}
+
+	return;
+}
+
+void LooseOctree::Grow(const AABB & aabb)
+{
+	float3 target = aabb.CenterPoint();
+	bool grown = false;
+	for(int growth = 0; growth < LOOSE_OCTREE_MAX_GROWTH && !limits.Contains(aabb); ++growth)
+	{
+		//The old root becomes one of the 8 children of the new one, on the side away from the object
+		float3 center = limits.CenterPoint();
+		float3 minPoint = limits.minPoint;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			if (target[axis] < center[axis])
+				minPoint[axis] -= rootSize;
+		}
+
+		rootSize *= 2.0f;
+		limits = AABB(minPoint, minPoint + float3(rootSize));
+		++growCount;
+		grown = true;
+	}
+
+	if (!grown)
+		return;
+
+	//Cell sizes changed, items are placed again keeping their indices
+	std::fill(cells.begin(), cells.end(), OctreeCell());
+	for(unsigned itemIndex = 0; itemIndex < items.size(); ++itemIndex)
+	{
+		if (items[itemIndex].go != nullptr)
+			LinkItem(itemIndex);
+	}
+
+	return;
+}
+
+unsigned LooseOctree::MortonCode(unsigned x, unsigned y, unsigned z)
+{
+	//Interleave the bits as ...z1y1x1z0y0x0, children of a cell get consecutive codes
+	unsigned code = 0;
+	for (int bit = 0; bit < LOOSE_OCTREE_MAX_DEPTH; ++bit)
+	{
+		code |= ((x >> bit) & 1) << (3 * bit);
+		code |= ((y >> bit) & 1) << (3 * bit + 1);
+		code |= ((z >> bit) & 1) << (3 * bit + 2);
+	}
+
+	return code;
+}
@@ -0,0 +1,125 @@
+#ifndef __LooseOctree_H__
+#define __LooseOctree_H__
+
+#include "Globals.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include "MathGeoLib/Geometry/LineSegment.h"
+#include "VisibleList.h"
+#include "SpatialQuery.h"
+#include <vector>
+
+#define OCTREE_NULL_ITEM 0xffffffff
+//Deepest level, cells per axis are 2^level
+#define LOOSE_OCTREE_MAX_DEPTH 5
+//Limits are doubled towards objects that land outside, objects still outside after this are kept in the root
+#define LOOSE_OCTREE_MAX_GROWTH 8
+
+class GameObject;
+
+//Loose octree for static objects
+//Cells of every level are stored in one array, a cell is found by its level and the Morton code of its coordinates
+//so children of a cell are contiguous. Loose cells are twice the size of the cell so an object is stored once, in
+//the deepest cell whose loose bounds contain it.
+class LooseOctree
+{
+public:
+	LooseOctree();
+	~LooseOctree() = default;
+
+	//Removes all the objects, limits are made cubic
+	void Clear(const AABB &limits);
+	//The item index is kept in GameObject::octreeItemIndex so an object can only be in one octree
+	void Insert(GameObject* go);
+	void Remove(GameObject* go);
+
+	//Replaces the content with a copy of the given bounds without touching the GameObjects, so it can run on another
+	//thread while the scene keeps using a different octree. BindObjects has to be called before Insert/Remove.
+	void Build(const AABB &limits, const std::vector<std::pair<GameObject*, AABB>> &objects);
+	void BindObjects() const;
+
+	//Limits grew or most of the objects were removed since last Clear, a rebuild would fit the scene better
+	bool NeedsRebuild() const;
+
+	void GetIntersection(VisibleList &intersectionGO, const AABB* bbox);
+	void GetIntersection(VisibleList &intersectionGO, const LineSegment* ray);
+	//Same as AABBTree::RayCast, cells are visited nearest first and hitDistance is along the segment in [0, 1]
+	GameObject* RayCast(const LineSegment &ray, float &hitDistance);
+	//Same as the AABBTree packet query, safe to call from several threads
+	void RayCast(const LineSegment* rays, RayHit* hits, unsigned count) const;
+	//Same as the AABBTree nearest queries, cells are visited nearest first
+	unsigned GetNearest(const float3 &point, unsigned k, float maxDistance, NearestObject* nearest, unsigned count = 0);
+	void GetWithinRadius(const float3 &point, float radius, std::vector<NearestObject> &objects);
+
+	void Draw() const;
+
+	unsigned Size() const { return itemCount; }
+	unsigned UsedCells() const;
+
+	//Limits of the octree
+	AABB limits;
+
+	//Since last Clear
+	unsigned growCount = 0;
+	unsigned removeCount = 0;
+
+private:
+	struct OctreeCell
+	{
+		unsigned firstItem = OCTREE_NULL_ITEM;
+		//Objects in this cell and all its descendants, empty subtrees are skipped
+		unsigned subtreeCount = 0;
+	};
+
+	struct CellCoordinates
+	{
+		int level;
+		unsigned x;
+		unsigned y;
+		unsigned z;
+	};
+
+	struct OctreeItem
+	{
+		//Copy of the bounds so queries don't touch the GameObject
+		AABB aabb;
+		//nullptr while the item is free
+		GameObject* go = nullptr;
+		CellCoordinates cell;
+		unsigned previousItem = OCTREE_NULL_ITEM;
+		//Next item of the cell, or next free item
+		unsigned nextItem = OCTREE_NULL_ITEM;
+	};
+
+	unsigned CellIndex(const CellCoordinates &cell) const;
+	AABB CellAABB(const CellCoordinates &cell) const;
+	AABB LooseCellAABB(const CellCoordinates &cell) const;
+	CellCoordinates FindCell(const AABB &aabb) const;
+	unsigned InsertItem(GameObject* go, const AABB &aabb);
+	void LinkItem(unsigned itemIndex);
+	void UnlinkItem(unsigned itemIndex);
+	//Doubles the limits until they contain aabb and relinks all the items
+	void Grow(const AABB &aabb);
+	static unsigned MortonCode(unsigned x, unsigned y, unsigned z);
+
+	std::vector<OctreeCell> cells;
+	std::vector<OctreeItem> items;
+	unsigned itemCount = 0;
+	unsigned firstFreeItem = OCTREE_NULL_ITEM;
+	unsigned levelOffset[LOOSE_OCTREE_MAX_DEPTH + 1];
+	float rootSize = 0.0f;
+
+	//Traversal stack kept between queries
+	std::vector<CellCoordinates> traversalStack;
+	//Heap of cells ordered by entry distance, or by distance to the point in the nearest queries
+	struct RayCell
+	{
+		float entry;
+		CellCoordinates cell;
+
+		bool operator>(const RayCell &other) const { return entry > other.entry; }
+	};
+	std::vector<RayCell> rayHeap;
+
+};
+
+#endif __LooseOctree_H__
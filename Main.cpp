@@ -4,6 +4,7 @@
 #include "Globals.h"
 #include "UUIDGenerator.h"
 #include "SceneImporter.h"
+#include "TransformHierarchy.h"
 
 #include "SDL/SDL.h"
 #pragma comment( lib, "SDL2.lib" )
@@ -21,6 +22,7 @@ enum main_states
 Application* App = NULL;
 UUIDGenerator* UUIDGen = NULL;
 SceneImporter* Importer = NULL;
+TransformHierarchy* Transforms = NULL;
 
 int main(int argc, char ** argv)
 {
@@ -36,6 +38,7 @@ int main(int argc, char ** argv)
 			LOG("Application Creation --------------");
 			UUIDGen = new UUIDGenerator();
 			Importer = new SceneImporter();
+			Transforms = new TransformHierarchy();
 			App = new Application();
 			state = MAIN_START;
 			break;
@@ -89,6 +92,7 @@ int main(int argc, char ** argv)
 	}
 
 	delete App;
+	delete Transforms;
 	delete Importer;
 	delete UUIDGen;
 	return main_return;
@@ -34,9 +34,13 @@ void Mesh::setupMesh()
 
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 
+	//The simplified levels are only kept in the EBO
+	vector<unsigned int> allIndices;
+	BuildDetailLevels(vertices, indices, allIndices, lodOffset, lodCount);
+
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-		&indices[0], GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(unsigned int),
+		&allIndices[0], GL_STATIC_DRAW);
 
 	// vertex positions
 	glEnableVertexAttribArray(0);
@@ -51,10 +55,13 @@ void Mesh::setupMesh()
 	glBindVertexArray(0);
 }
 
-void Mesh::Draw(const unsigned int program) const
+void Mesh::Draw(const unsigned int program, unsigned int lod) const
 {
+	if (lod >= MESH_LOD_LEVELS)
+		lod = MESH_LOD_LEVELS - 1;
+
 	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	glDrawElements(GL_TRIANGLES, lodCount[lod], GL_UNSIGNED_INT, (void*)(lodOffset[lod] * sizeof(unsigned int)));
 	glBindVertexArray(0);
 	glActiveTexture(GL_TEXTURE0);
 }
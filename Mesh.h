@@ -3,9 +3,13 @@
 
 #include "MathGeoLib/Math/float3.h"
 #include "MathGeoLib/Math/float2.h"
+#include "MeshBVH.h"
 #include <vector>
 #include <string>
 
+//Detail levels of every mesh, level 0 is the full mesh and the others are built by vertex clustering
+#define MESH_LOD_LEVELS 3
+
 struct Vertex {
 	float3 Position;
 	float3 Normal;
@@ -19,17 +23,29 @@ public:
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::string name;
+	//Triangle BVH for ray casts, built the first time the mesh is picked and shared by all its components
+	MeshBVH bvh;
 
 	/*  Functions  */
 	Mesh();
 	Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
 	~Mesh();
-	void Draw(const unsigned int program) const;
+	void Draw(const unsigned int program, unsigned int lod = 0) const;
 	void setupMesh();
+	//Indices of every detail level one after the other, with the first index and the index count of each level.
+	//Levels that collapse or meshes too small to simplify keep the previous level
+	static void BuildDetailLevels(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, std::vector<unsigned int>& allIndices,
+		unsigned int lodOffset[MESH_LOD_LEVELS], unsigned int lodCount[MESH_LOD_LEVELS]);
+
+	//Triangles drawn at a detail level
+	unsigned int LodTriangleCount(unsigned int lod) const { return lodCount[lod] / 3; }
 
 private:
 	/*  Render data  */
 	unsigned int VAO, VBO, EBO;
+	//All the levels share the vertices, their indices follow each other in the EBO
+	unsigned int lodOffset[MESH_LOD_LEVELS] = { 0 };
+	unsigned int lodCount[MESH_LOD_LEVELS] = { 0 };
 
 	/*  Functions    */
 };
@@ -0,0 +1,411 @@
+#include "MeshBVH.h"
+#include "Mesh.h"
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+#ifdef MESH_BVH_SSE
+#include <xmmintrin.h>
+#endif
+
+//Triangles whose determinant is below this are parallel to the ray
+#define MESH_BVH_EPSILON 1e-12f
+
+void MeshBVH::Build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	Clear();
+
+	triangleCount = indices.size() / 3;
+	built = true;
+	if (triangleCount == 0)
+		return;
+
+	std::vector<BuildTriangle> triangles(triangleCount);
+	for(unsigned i = 0; i < triangleCount; ++i)
+	{
+		const float3& a = vertices[indices[3 * i]].Position;
+		const float3& b = vertices[indices[3 * i + 1]].Position;
+		const float3& c = vertices[indices[3 * i + 2]].Position;
+
+		triangles[i].aabb = AABB(Min(Min(a, b), c), Max(Max(a, b), c));
+		triangles[i].centroid = (a + b + c) / 3.0f;
+		triangles[i].vertexIndex[0] = indices[3 * i];
+		triangles[i].vertexIndex[1] = indices[3 * i + 1];
+		triangles[i].vertexIndex[2] = indices[3 * i + 2];
+		triangles[i].triangle = i;
+	}
+
+	//A binary tree with leaves of up to 4 triangles
+	nodes.reserve(2 * (triangleCount / MESH_BVH_LEAF_TRIANGLES + 1));
+	packets.reserve(triangleCount / MESH_BVH_LEAF_TRIANGLES + 1);
+
+	BuildNode(triangles, 0, triangleCount, 0, vertices);
+
+	return;
+}
+
+void MeshBVH::Clear()
+{
+	nodes.clear();
+	packets.clear();
+	triangleCount = 0;
+	built = false;
+
+	return;
+}
+
+bool MeshBVH::RayCast(const LineSegment & ray, float & hitDistance, unsigned* triangle) const
+{
+	return Traverse(ray, hitDistance, triangle, false);
+}
+
+bool MeshBVH::RayCastScalar(const LineSegment & ray, float & hitDistance, unsigned* triangle) const
+{
+	return Traverse(ray, hitDistance, triangle, true);
+}
+
+bool MeshBVH::Traverse(const LineSegment & ray, float & hitDistance, unsigned* triangle, bool isScalar) const
+{
+	if (nodes.empty())
+		return false;
+
+	//The direction is not normalized so distances along it are positions on the segment
+	float3 origin = ray.a;
+	float3 direction = ray.b - ray.a;
+	float3 invDirection = float3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	float maxDistance = std::min(hitDistance, 1.0f);
+	unsigned hitTriangle = MESH_BVH_NULL_TRIANGLE;
+
+	float entry;
+	if (!IntersectNode(nodes[0], origin, invDirection, maxDistance, entry))
+		return false;
+
+	//DFS visiting the nearest child first, the stack is never deeper than the tree
+	std::pair<unsigned, float> stack[MESH_BVH_MAX_DEPTH + 1];
+	int stackSize = 0;
+	stack[stackSize++] = std::make_pair(0u, entry);
+
+	while (stackSize > 0)
+	{
+		std::pair<unsigned, float> next = stack[--stackSize];
+		if (next.second > maxDistance)
+			continue;
+
+		const BVHNode& node = nodes[next.first];
+		if (node.triangleCount > 0)
+		{
+			const TrianglePacket& packet = packets[node.index];
+			int lane = isScalar ? IntersectPacketScalar(packet, origin, direction, maxDistance) : IntersectPacket(packet, origin, direction, maxDistance);
+			if (lane >= 0)
+				hitTriangle = packet.triangle[lane];
+			continue;
+		}
+
+		unsigned leftNodeIndex = next.first + 1;
+		unsigned rightNodeIndex = node.index;
+		float leftEntry, rightEntry;
+		bool leftHit = IntersectNode(nodes[leftNodeIndex], origin, invDirection, maxDistance, leftEntry);
+		bool rightHit = IntersectNode(nodes[rightNodeIndex], origin, invDirection, maxDistance, rightEntry);
+
+		if (leftHit && rightHit)
+		{
+			//Farther child first so the nearer one is popped next
+			if (leftEntry < rightEntry)
+			{
+				stack[stackSize++] = std::make_pair(rightNodeIndex, rightEntry);
+				stack[stackSize++] = std::make_pair(leftNodeIndex, leftEntry);
+			}
+			else
+			{
+				stack[stackSize++] = std::make_pair(leftNodeIndex, leftEntry);
+				stack[stackSize++] = std::make_pair(rightNodeIndex, rightEntry);
+			}
+		}
+		else if (leftHit)
+		{
+			stack[stackSize++] = std::make_pair(leftNodeIndex, leftEntry);
+		}
+		else if (rightHit)
+		{
+			stack[stackSize++] = std::make_pair(rightNodeIndex, rightEntry);
+		}
+	}
+
+	if (hitTriangle == MESH_BVH_NULL_TRIANGLE)
+		return false;
+
+	hitDistance = maxDistance;
+	if (triangle != nullptr)
+		*triangle = hitTriangle;
+
+	return true;
+}
+
+void MeshBVH::BuildNode(std::vector<BuildTriangle>& triangles, unsigned begin, unsigned end, int depth, const std::vector<Vertex>& vertices)
+{
+	unsigned nodeIndex = nodes.size();
+	nodes.push_back(BVHNode());
+
+	AABB bounds;
+	bounds.SetNegativeInfinity();
+	for (unsigned i = begin; i < end; ++i)
+	{
+		bounds.Enclose(triangles[i].aabb);
+	}
+
+	nodes[nodeIndex].minPoint = bounds.minPoint;
+	nodes[nodeIndex].maxPoint = bounds.maxPoint;
+
+	if (end - begin <= MESH_BVH_LEAF_TRIANGLES)
+	{
+		TrianglePacket packet;
+		for (int lane = 0; lane < MESH_BVH_LEAF_TRIANGLES; ++lane)
+		{
+			float3 v0 = float3::zero;
+			float3 edge1 = float3::zero;
+			float3 edge2 = float3::zero;
+			packet.triangle[lane] = MESH_BVH_NULL_TRIANGLE;
+			if (begin + lane < end)
+			{
+				const BuildTriangle& triangle = triangles[begin + lane];
+				packet.triangle[lane] = triangle.triangle;
+				v0 = vertices[triangle.vertexIndex[0]].Position;
+				edge1 = vertices[triangle.vertexIndex[1]].Position - v0;
+				edge2 = vertices[triangle.vertexIndex[2]].Position - v0;
+			}
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				packet.v0[axis][lane] = v0[axis];
+				packet.edge1[axis][lane] = edge1[axis];
+				packet.edge2[axis][lane] = edge2[axis];
+			}
+		}
+
+		nodes[nodeIndex].index = packets.size();
+		nodes[nodeIndex].triangleCount = end - begin;
+		packets.push_back(packet);
+		return;
+	}
+
+	unsigned middle = SplitRange(triangles, begin, end, depth);
+
+	//Left child goes right after this node
+	BuildNode(triangles, begin, middle, depth + 1, vertices);
+	nodes[nodeIndex].index = nodes.size();
+	nodes[nodeIndex].triangleCount = 0;
+	BuildNode(triangles, middle, end, depth + 1, vertices);
+
+	return;
+}
+
+unsigned MeshBVH::SplitRange(std::vector<BuildTriangle>& triangles, unsigned begin, unsigned end, int depth) const
+{
+	//Split on the axis where centroids are more spread
+	AABB centroidBounds;
+	centroidBounds.SetNegativeInfinity();
+	for (unsigned i = begin; i < end; ++i)
+	{
+		centroidBounds.Enclose(triangles[i].centroid);
+	}
+
+	float3 extent = centroidBounds.Size();
+	int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z) ? 1 : 2;
+	float axisMin = centroidBounds.minPoint[axis];
+	float axisExtent = extent[axis];
+
+	if (axisExtent > 0.0f && depth < MESH_BVH_SAH_MAX_DEPTH)
+	{
+		//Bin the centroids and evaluate the cost of splitting at each bin boundary
+		unsigned binCount[MESH_BVH_SAH_BINS] = { 0 };
+		AABB binBounds[MESH_BVH_SAH_BINS];
+		for (int b = 0; b < MESH_BVH_SAH_BINS; ++b)
+		{
+			binBounds[b].SetNegativeInfinity();
+		}
+
+		float binScale = MESH_BVH_SAH_BINS / axisExtent;
+		for (unsigned i = begin; i < end; ++i)
+		{
+			int bin = std::min(MESH_BVH_SAH_BINS - 1, (int)((triangles[i].centroid[axis] - axisMin) * binScale));
+			++binCount[bin];
+			binBounds[bin].Enclose(triangles[i].aabb);
+		}
+
+		//Sweep from the right accumulating the cost of the right side of each split
+		float rightCost[MESH_BVH_SAH_BINS];
+		AABB accumulated;
+		accumulated.SetNegativeInfinity();
+		unsigned accumulatedCount = 0;
+		for (int b = MESH_BVH_SAH_BINS - 1; b > 0; --b)
+		{
+			accumulated.Enclose(binBounds[b]);
+			accumulatedCount += binCount[b];
+			rightCost[b] = (accumulatedCount > 0) ? accumulated.SurfaceArea() * accumulatedCount : 0.0f;
+		}
+
+		//Sweep from the left and keep the cheapest split
+		float bestCost = std::numeric_limits<float>::infinity();
+		int bestSplit = -1;
+		accumulated.SetNegativeInfinity();
+		accumulatedCount = 0;
+		for (int b = 0; b < MESH_BVH_SAH_BINS - 1; ++b)
+		{
+			accumulated.Enclose(binBounds[b]);
+			accumulatedCount += binCount[b];
+			if (accumulatedCount == 0 || accumulatedCount == end - begin)
+				continue;
+
+			float cost = accumulated.SurfaceArea() * accumulatedCount + rightCost[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		if (bestSplit >= 0)
+		{
+			auto it = std::partition(triangles.begin() + begin, triangles.begin() + end, [&](const BuildTriangle &triangle)
+			{
+				return std::min(MESH_BVH_SAH_BINS - 1, (int)((triangle.centroid[axis] - axisMin) * binScale)) <= bestSplit;
+			});
+			return it - triangles.begin();
+		}
+	}
+
+	//Same centroids or too deep, halve the range
+	unsigned middle = begin + (end - begin) / 2;
+	std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end, [axis](const BuildTriangle &first, const BuildTriangle &second)
+	{
+		return first.centroid[axis] < second.centroid[axis];
+	});
+
+	return middle;
+}
+
+bool MeshBVH::IntersectNode(const BVHNode & node, const float3 & origin, const float3 & invDirection, float maxDistance, float & entry) const
+{
+	float tNear = 0.0f;
+	float tFar = maxDistance;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float t1 = (node.minPoint[axis] - origin[axis]) * invDirection[axis];
+		float t2 = (node.maxPoint[axis] - origin[axis]) * invDirection[axis];
+		tNear = std::max(tNear, std::min(t1, t2));
+		tFar = std::min(tFar, std::max(t1, t2));
+	}
+
+	entry = tNear;
+	return tNear <= tFar;
+}
+
+int MeshBVH::IntersectPacket(const TrianglePacket & packet, const float3 & origin, const float3 & direction, float & hitDistance) const
+{
+#ifdef MESH_BVH_SSE
+	//Moller-Trumbore on the 4 triangles at once
+	__m128 v0X = _mm_loadu_ps(packet.v0[0]);
+	__m128 v0Y = _mm_loadu_ps(packet.v0[1]);
+	__m128 v0Z = _mm_loadu_ps(packet.v0[2]);
+	__m128 edge1X = _mm_loadu_ps(packet.edge1[0]);
+	__m128 edge1Y = _mm_loadu_ps(packet.edge1[1]);
+	__m128 edge1Z = _mm_loadu_ps(packet.edge1[2]);
+	__m128 edge2X = _mm_loadu_ps(packet.edge2[0]);
+	__m128 edge2Y = _mm_loadu_ps(packet.edge2[1]);
+	__m128 edge2Z = _mm_loadu_ps(packet.edge2[2]);
+
+	__m128 dirX = _mm_set1_ps(direction.x);
+	__m128 dirY = _mm_set1_ps(direction.y);
+	__m128 dirZ = _mm_set1_ps(direction.z);
+
+	//p = dir x edge2
+	__m128 pX = _mm_sub_ps(_mm_mul_ps(dirY, edge2Z), _mm_mul_ps(dirZ, edge2Y));
+	__m128 pY = _mm_sub_ps(_mm_mul_ps(dirZ, edge2X), _mm_mul_ps(dirX, edge2Z));
+	__m128 pZ = _mm_sub_ps(_mm_mul_ps(dirX, edge2Y), _mm_mul_ps(dirY, edge2X));
+
+	__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ));
+	__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+	//s = origin - v0
+	__m128 sX = _mm_sub_ps(_mm_set1_ps(origin.x), v0X);
+	__m128 sY = _mm_sub_ps(_mm_set1_ps(origin.y), v0Y);
+	__m128 sZ = _mm_sub_ps(_mm_set1_ps(origin.z), v0Z);
+
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, pX), _mm_mul_ps(sY, pY)), _mm_mul_ps(sZ, pZ)), invDet);
+
+	//q = s x edge1
+	__m128 qX = _mm_sub_ps(_mm_mul_ps(sY, edge1Z), _mm_mul_ps(sZ, edge1Y));
+	__m128 qY = _mm_sub_ps(_mm_mul_ps(sZ, edge1X), _mm_mul_ps(sX, edge1Z));
+	__m128 qZ = _mm_sub_ps(_mm_mul_ps(sX, edge1Y), _mm_mul_ps(sY, edge1X));
+
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dirX, qX), _mm_mul_ps(dirY, qY)), _mm_mul_ps(dirZ, qZ)), invDet);
+	__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), invDet);
+
+	//Both faces are hit, padding lanes have a null determinant
+	__m128 zero = _mm_setzero_ps();
+	__m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+	__m128 mask = _mm_cmpgt_ps(absDet, _mm_set1_ps(MESH_BVH_EPSILON));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+	mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(hitDistance)));
+
+	int hits = _mm_movemask_ps(mask);
+	if (hits == 0)
+		return -1;
+
+	float distances[MESH_BVH_LEAF_TRIANGLES];
+	_mm_storeu_ps(distances, t);
+	int hitLane = -1;
+	for (int lane = 0; lane < MESH_BVH_LEAF_TRIANGLES; ++lane)
+	{
+		if ((hits & (1 << lane)) && distances[lane] < hitDistance)
+		{
+			hitDistance = distances[lane];
+			hitLane = lane;
+		}
+	}
+
+	return hitLane;
+#else
+	return IntersectPacketScalar(packet, origin, direction, hitDistance);
+#endif
+}
+
+int MeshBVH::IntersectPacketScalar(const TrianglePacket & packet, const float3 & origin, const float3 & direction, float & hitDistance) const
+{
+	int hitLane = -1;
+	for (int lane = 0; lane < MESH_BVH_LEAF_TRIANGLES; ++lane)
+	{
+		float3 v0 = float3(packet.v0[0][lane], packet.v0[1][lane], packet.v0[2][lane]);
+		float3 edge1 = float3(packet.edge1[0][lane], packet.edge1[1][lane], packet.edge1[2][lane]);
+		float3 edge2 = float3(packet.edge2[0][lane], packet.edge2[1][lane], packet.edge2[2][lane]);
+
+		float3 p = direction.Cross(edge2);
+		float det = edge1.Dot(p);
+		if (fabs(det) <= MESH_BVH_EPSILON)
+			continue;
+
+		float invDet = 1.0f / det;
+		float3 s = origin - v0;
+		float u = s.Dot(p) * invDet;
+		if (u < 0.0f || u > 1.0f)
+			continue;
+
+		float3 q = s.Cross(edge1);
+		float v = direction.Dot(q) * invDet;
+		if (v < 0.0f || u + v > 1.0f)
+			continue;
+
+		float t = edge2.Dot(q) * invDet;
+		if (t >= 0.0f && t < hitDistance)
+		{
+			hitDistance = t;
+			hitLane = lane;
+		}
+	}
+
+	return hitLane;
+}
@@ -0,0 +1,89 @@
+#ifndef __MeshBVH_H__
+#define __MeshBVH_H__
+
+#include "MathGeoLib/Math/float3.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include "MathGeoLib/Geometry/LineSegment.h"
+#include <vector>
+
+//Comment this line to force the scalar path
+#define MESH_BVH_SSE
+
+#define MESH_BVH_SAH_BINS 16
+//Triangles of a leaf are tested together, one per SIMD lane
+#define MESH_BVH_LEAF_TRIANGLES 4
+//Deeper ranges are split by the median so the traversal stack never overflows
+#define MESH_BVH_SAH_MAX_DEPTH 32
+#define MESH_BVH_MAX_DEPTH 64
+#define MESH_BVH_NULL_TRIANGLE 0xffffffff
+
+struct Vertex;
+
+//Triangle BVH of a mesh in local space, used for ray casts
+//Nodes are stored depth first so the left child of a node is the next one. Each leaf keeps its triangles as one SoA
+//packet of vertex and edges so the four of them are tested at once with Moller-Trumbore.
+class MeshBVH
+{
+public:
+	MeshBVH() = default;
+	~MeshBVH() = default;
+
+	void Build(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices);
+	void Clear();
+	bool IsBuilt() const { return built; }
+
+	//Nearest hit along the segment in [0, 1], only hits nearer than hitDistance on entry are taken.
+	//triangle is the index of the first vertex index of the triangle hit divided by 3
+	bool RayCast(const LineSegment &ray, float &hitDistance, unsigned* triangle = nullptr) const;
+	//Same traversal with the scalar triangle test, the reference for the SSE one
+	bool RayCastScalar(const LineSegment &ray, float &hitDistance, unsigned* triangle = nullptr) const;
+
+	unsigned NodeCount() const { return nodes.size(); }
+	unsigned TriangleCount() const { return triangleCount; }
+
+private:
+	struct BVHNode
+	{
+		float3 minPoint;
+		float3 maxPoint;
+		//Leaves: packet index. Inner nodes: index of the right child
+		unsigned index;
+		//0 for inner nodes
+		unsigned triangleCount;
+	};
+
+	//Four triangles as v0 and the two edges from it, padding lanes have null edges and never hit
+	struct TrianglePacket
+	{
+		float v0[3][MESH_BVH_LEAF_TRIANGLES];
+		float edge1[3][MESH_BVH_LEAF_TRIANGLES];
+		float edge2[3][MESH_BVH_LEAF_TRIANGLES];
+		unsigned triangle[MESH_BVH_LEAF_TRIANGLES];
+	};
+
+	struct BuildTriangle
+	{
+		AABB aabb;
+		float3 centroid;
+		unsigned vertexIndex[3];
+		unsigned triangle;
+	};
+
+	void BuildNode(std::vector<BuildTriangle> &triangles, unsigned begin, unsigned end, int depth, const std::vector<Vertex> &vertices);
+	unsigned SplitRange(std::vector<BuildTriangle> &triangles, unsigned begin, unsigned end, int depth) const;
+
+	bool Traverse(const LineSegment &ray, float &hitDistance, unsigned* triangle, bool isScalar) const;
+	//Slab test against the node, entry is the position along the segment
+	bool IntersectNode(const BVHNode &node, const float3 &origin, const float3 &invDirection, float maxDistance, float &entry) const;
+	//Lane of the nearest hit, -1 if no triangle is hit nearer than hitDistance
+	int IntersectPacket(const TrianglePacket &packet, const float3 &origin, const float3 &direction, float &hitDistance) const;
+	int IntersectPacketScalar(const TrianglePacket &packet, const float3 &origin, const float3 &direction, float &hitDistance) const;
+
+	std::vector<BVHNode> nodes;
+	std::vector<TrianglePacket> packets;
+	unsigned triangleCount = 0;
+	bool built = false;
+
+};
+
+#endif __MeshBVH_H__
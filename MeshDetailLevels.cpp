@@ -0,0 +1,78 @@
+//Detail levels of Mesh, they don't use OpenGL so the tests build them
+#include "Mesh.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+
+//Cells per axis of the clustering grid of each detail level after the first one
+static const unsigned int lodClusterCells[MESH_LOD_LEVELS - 1] = { 32, 10 };
+//Smaller meshes keep their full detail at every level
+static const unsigned int lodMinTriangles = 64;
+
+//Vertex clustering: the vertices of a cell collapse into the first one and the triangles left with two equal corners are dropped
+static void ClusterIndices(const vector<Vertex>& vertices, const vector<unsigned int>& indices, unsigned int cells, vector<unsigned int>& lodIndices)
+{
+	AABB bounds;
+	bounds.SetNegativeInfinity();
+	for(const auto& vertex : vertices)
+	{
+		bounds.Enclose(vertex.Position);
+	}
+
+	float cellSize = bounds.Size().MaxElement() / (float)cells;
+	if (cellSize <= 0.0f)
+		cellSize = 1.0f;
+
+	unordered_map<unsigned int, unsigned int> cellVertex;
+	vector<unsigned int> remap(vertices.size());
+	for(unsigned int i = 0; i < vertices.size(); ++i)
+	{
+		float3 cell = (vertices[i].Position - bounds.minPoint) / cellSize;
+		unsigned int x = std::min((unsigned int)cell.x, cells - 1);
+		unsigned int y = std::min((unsigned int)cell.y, cells - 1);
+		unsigned int z = std::min((unsigned int)cell.z, cells - 1);
+		remap[i] = cellVertex.insert(make_pair(x + (y + z * cells) * cells, i)).first->second;
+	}
+
+	for(unsigned int i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int a = remap[indices[i]];
+		unsigned int b = remap[indices[i + 1]];
+		unsigned int c = remap[indices[i + 2]];
+		if (a == b || b == c || a == c)
+			continue;
+
+		lodIndices.push_back(a);
+		lodIndices.push_back(b);
+		lodIndices.push_back(c);
+	}
+
+	return;
+}
+
+void Mesh::BuildDetailLevels(const vector<Vertex>& vertices, const vector<unsigned int>& indices, vector<unsigned int>& allIndices,
+	unsigned int lodOffset[MESH_LOD_LEVELS], unsigned int lodCount[MESH_LOD_LEVELS])
+{
+	//Level 0 is the mesh as loaded
+	allIndices = indices;
+	lodOffset[0] = 0;
+	lodCount[0] = indices.size();
+	for(unsigned int lod = 1; lod < MESH_LOD_LEVELS; ++lod)
+	{
+		lodOffset[lod] = allIndices.size();
+		if (indices.size() >= lodMinTriangles * 3)
+			ClusterIndices(vertices, indices, lodClusterCells[lod - 1], allIndices);
+
+		lodCount[lod] = allIndices.size() - lodOffset[lod];
+		if (lodCount[lod] == 0)
+		{
+			//Everything collapsed or the mesh is too small, the previous level is kept
+			lodOffset[lod] = lodOffset[lod - 1];
+			lodCount[lod] = lodCount[lod - 1];
+		}
+	}
+
+	return;
+}
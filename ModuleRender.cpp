@@ -15,8 +15,9 @@
 #include "ComponentMesh.h"
 #include "GameObject.h"
 #include "ComponentCamera.h"
-#include "MyQuadTree.h"
+#include "LooseOctree.h"
 #include "AABBTree.h"
+#include "SpatialHashGrid.h"
 #include "debugdraw.h"
 #include "Skybox.h"
 #include "SDL/SDL.h"
@@ -26,6 +27,7 @@
 #include "Imgui/imgui_impl_opengl3.h"
 #include "MathGeoLib/Geometry/Frustum.h"
 #include <math.h>
+#include <algorithm>
 #include "MathGeoLib/Math/float4.h"
 //#include "Brofiler/Brofiler.h"
 #include "ImGuizmo/ImGuizmo.h"
@@ -193,6 +195,9 @@ update_status ModuleRender::Update()
 	
 	timeRender->StartTimer();
 
+	//Both viewports draw from the same culling pass
+	CollectVisibleGameObjects();
+
 	ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.f);
 	ImGui::PushStyleColor(ImGuiCol_CheckMark, ImVec4(0, 1, 0, 1));
 	
@@ -289,12 +294,13 @@ void ModuleRender::DrawGuizmo() const
 	ImGui::SetCursorPos({ 20,30 });
 
 	//Chose which guizmo we will use
-	if(App->scene->selectedByHierarchy != nullptr && !App->scene->selectedByHierarchy->isStatic)
+	GameObject* selected = App->scene->GetSelectedObject();
+	if(selected != nullptr && !selected->isStatic)
 	{
 		//Use guizmos only if object is static
 		ImGuizmo::Enable(true);
 		//TODO: Fix a bug where if you modify first rotation and then you use guizmo to scale rotation comeback to default (related with ImGuizmo::MODE = WORLD)
-		float4x4 model = App->scene->selectedByHierarchy->myTransform->globalModelMatrix;
+		float4x4 model = selected->myTransform->GetGlobalMatrix();
 		float4x4 view = App->camera->GetViewMatrix();
 		float4x4 proj = App->camera->GetProjMatrix();
 
@@ -310,7 +316,7 @@ void ModuleRender::DrawGuizmo() const
 		if(ImGuizmo::IsUsing())
 		{
 			model.Transpose();
-			App->scene->selectedByHierarchy->SetGlobalMatrix(model);
+			selected->SetGlobalMatrix(model);
 		}
 
 	}
@@ -318,7 +324,7 @@ void ModuleRender::DrawGuizmo() const
 	return;
 }
 
-void ModuleRender::DrawAllGameObjects() const
+void ModuleRender::DrawAllGameObjects()
 {
 
 	//unsigned int progModel = App->program->defaultProg;
@@ -332,90 +338,175 @@ void ModuleRender::DrawAllGameObjects() const
 	glUniformMatrix4fv(glGetUniformLocation(progModel,
 		"view"), 1, GL_TRUE, &App->camera->editorCamera->view[0][0]);
 
-	std::set<GameObject*> staticGO;
-	std::set<GameObject*> dynamicGO;
-	
-	if(App->scene->quadtreeIsComputed)
+	for(unsigned int i = 0; i < visibleGO.Size(); ++i)
 	{
-		App->scene->quadtree->GetIntersection(staticGO, &App->camera->editorCamera->frustum->MinimalEnclosingAABB());
+		GameObject* gameObject = visibleGO[i];
+		if (!(gameObject->visibleViews & sceneView))
+			continue;
+
+		glUniformMatrix4fv(glGetUniformLocation(progModel,
+			"model"), 1, GL_TRUE, &gameObject->myTransform->GetGlobalMatrix()[0][0]);
+
+		gameObject->Draw(progModel, false, showBoundingBox, sceneDetailLevels[i]);
 	}
-	App->scene->aabbTree->GetIntersection(dynamicGO, &App->camera->editorCamera->frustum->MinimalEnclosingAABB());
 
-	//With C++ 17 we could do staticGO.merge(dynamicGO);
-	std::set<GameObject*> onCameraGO = staticGO;
-	onCameraGO.insert(dynamicGO.begin(), dynamicGO.end());
 
-	for(auto gameObject : onCameraGO)
+	glUseProgram(0);
+}
+
+void ModuleRender::DrawGame()
+{
+	unsigned int progModel = App->program->uberProg;
+	glUseProgram(progModel);
+
+	glUniformMatrix4fv(glGetUniformLocation(progModel,
+		"proj"), 1, GL_TRUE, &gameCamera->proj[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(progModel,
+		"view"), 1, GL_TRUE, &gameCamera->view[0][0]);
+
+	for (unsigned int i = 0; i < visibleGO.Size(); ++i)
 	{
-		if (!gameObject->isEnabled)
+		GameObject* gameObject = visibleGO[i];
+		if (!(gameObject->visibleViews & gameView))
 			continue;
 
 		glUniformMatrix4fv(glGetUniformLocation(progModel,
-			"model"), 1, GL_TRUE, &gameObject->myTransform->globalModelMatrix[0][0]);
+			"model"), 1, GL_TRUE, &gameObject->myTransform->GetGlobalMatrix()[0][0]);
 
-		if(gameObject->globalBoundingBox != nullptr)
-		{
+		gameObject->Draw(progModel, true, false, gameDetailLevels[i]);
+	}
 
-			if(App->camera->editorCamera->AABBWithinFrustum(*gameObject->globalBoundingBox) != 0)
-			{
+	glUseProgram(0);
+}
 
-				gameObject->Draw(progModel, false, showBoundingBox);
-			}
+void ModuleRender::CollectVisibleGameObjects()
+{
+	//Editor and game cameras are culled in the same pass, each draw only takes the objects with its bit
+	views.ClearViews();
+	sceneView = views.AddView(*App->camera->editorCamera->frustum);
+	gameView = (gameCamera != nullptr) ? views.AddView(*gameCamera->frustum) : 0;
 
-		}
-		else
+	//Static and dynamic results go to the same list, no allocations once it has grown
+	visibleGO.Begin();
+
+	//Static objects: results of last frame are reused or patched while the views and the static objects don't change much
+	if (App->scene->octreeIsComputed)
+	{
+		if (!staticVisibilityCache)
+			staticVisibility.Invalidate();
+
+		switch (staticVisibility.Collect(views, *App->scene->octree, App->scene->StaticEpoch(), visibleGO))
 		{
-			gameObject->Draw(progModel, false, showBoundingBox);
+			case VisibilityCache::CACHE_REUSED:
+				++staticFramesReused;
+				break;
+			case VisibilityCache::CACHE_PATCHED:
+				++staticFramesPatched;
+				break;
+			case VisibilityCache::CACHE_REBUILT:
+				++staticFramesRebuilt;
+				break;
 		}
+		staticRetestedCount = staticVisibility.retestedCount;
+	}
+	unsigned int visibleCount = visibleGO.Size();
 
+	//Dynamic objects: the tree or the grid is walked once against all the views so its result is already culled
+	if (App->scene->dynamicGridIsActive)
+		App->scene->dynamicGrid->GetIntersection(visibleGO, views);
+	else
+		App->scene->aabbTree->GetIntersection(visibleGO, views);
 
+	for(unsigned int i = visibleCount; i < visibleGO.Size(); ++i)
+	{
+		if (visibleGO[i]->isEnabled)
+			visibleGO[visibleCount++] = visibleGO[i];
+	}
+	visibleGO.Resize(visibleCount);
 
+	//Meshes of a model are only reached through their parent: views that have it inside see all of them
+	meshesAcceptedByParent = 0;
+	meshesTestedByParent = 0;
+	ViewCullPlanes meshCullPlanes;
+	for(unsigned int i = 0; i < visibleCount; ++i)
+	{
+		visibleGO[i]->CullChildren(views, meshCullPlanes, visibleGO, meshesTestedByParent, meshesAcceptedByParent);
 	}
 
+	//Small objects are dropped before the occlusion test, it is the cheaper one
+	screenSizeCulledCount = 0;
+	for(unsigned int i = 0; i < MESH_LOD_LEVELS; ++i)
+	{
+		detailLevelCount[i] = 0;
+	}
+	App->camera->editorCamera->SelectDetailLevels(visibleGO, sceneView, heightScene, sceneDetailLevels, screenSizeCulledCount, detailLevelCount);
+	if (gameView != 0)
+		gameCamera->SelectDetailLevels(visibleGO, gameView, heightGame, gameDetailLevels, screenSizeCulledCount, detailLevelCount);
+	else
+		gameDetailLevels.assign(visibleGO.Size(), 0);
 
-	glUseProgram(0);
+	occlusionCulledCount = 0;
+	occluderCount = 0;
+	if (occlusionCulling)
+	{
+		CullOccludedGameObjects(*App->camera->editorCamera->frustum, sceneView);
+		if (gameView != 0)
+			CullOccludedGameObjects(*gameCamera->frustum, gameView);
+	}
+
+	return;
 }
 
-void ModuleRender::DrawGame() const
+void ModuleRender::CullOccludedGameObjects(const Frustum &frustum, unsigned int view)
 {
-	unsigned int progModel = App->program->uberProg;
-	glUseProgram(progModel);
+	occlusionCuller.Begin(frustum.ViewProjMatrix());
 
-	glUniformMatrix4fv(glGetUniformLocation(progModel,
-		"proj"), 1, GL_TRUE, &gameCamera->proj[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(progModel,
-		"view"), 1, GL_TRUE, &gameCamera->view[0][0]);
+	//Occluders are the biggest static meshes on screen
+	occluders.clear();
+	for(auto gameObject : visibleGO)
+	{
+		if (!(gameObject->visibleViews & view) || !gameObject->isStatic || gameObject->myMesh == nullptr || gameObject->myMesh->mesh == nullptr || gameObject->globalBoundingBox == nullptr)
+			continue;
 
-	
-	std::set<GameObject*> staticGO;
-	std::set<GameObject*> dynamicGO;
+		float area = occlusionCuller.ScreenArea(*gameObject->globalBoundingBox);
+		if (area >= OCCLUSION_MIN_OCCLUDER_AREA)
+			occluders.push_back(std::make_pair(area, gameObject));
+	}
+
+	std::sort(occluders.begin(), occluders.end(), [](const std::pair<float, GameObject*> &a, const std::pair<float, GameObject*> &b) { return a.first > b.first; });
+	if (occluders.size() > OCCLUSION_MAX_OCCLUDERS)
+		occluders.resize(OCCLUSION_MAX_OCCLUDERS);
 
-	if (App->scene->quadtreeIsComputed)
+	for(auto& occluder : occluders)
 	{
-		App->scene->quadtree->GetIntersection(staticGO, &gameCamera->frustum->MinimalEnclosingAABB());
+		GameObject* gameObject = occluder.second;
+		occlusionCuller.RasterizeTriangles(gameObject->myMesh->mesh->vertices, gameObject->myMesh->mesh->indices, gameObject->myTransform->GetGlobalMatrix());
 	}
+	occlusionCuller.UpdateTiles();
+	occluderCount += occluders.size();
 
-	App->scene->aabbTree->GetIntersection(dynamicGO, &gameCamera->frustum->MinimalEnclosingAABB());
-	std::set<GameObject*> onCameraGO = staticGO;
-	onCameraGO.insert(dynamicGO.begin(), dynamicGO.end());
+	//Occluders stay, they would hide themselves
+	std::sort(occluders.begin(), occluders.end(), [](const std::pair<float, GameObject*> &a, const std::pair<float, GameObject*> &b) { return a.second < b.second; });
+	auto isOccluder = [this](GameObject* gameObject)
+	{
+		auto it = std::lower_bound(occluders.begin(), occluders.end(), gameObject, [](const std::pair<float, GameObject*> &a, GameObject* b) { return a.second < b; });
+		return it != occluders.end() && it->second == gameObject;
+	};
 
-	for (auto gameObject : onCameraGO)
+	//Hidden objects only lose the bit of this view
+	for(auto gameObject : visibleGO)
 	{
-		if (!gameObject->isEnabled)
+		if (!(gameObject->visibleViews & view) || gameObject->globalBoundingBox == nullptr || isOccluder(gameObject))
 			continue;
 
-		if (gameCamera->AABBWithinFrustum(*gameObject->globalBoundingBox) != 0)
+		if (!occlusionCuller.IsVisible(*gameObject->globalBoundingBox))
 		{
-			glUniformMatrix4fv(glGetUniformLocation(progModel,
-				"model"), 1, GL_TRUE, &gameObject->myTransform->globalModelMatrix[0][0]);
-
-			gameObject->Draw(progModel, true);
-			
+			gameObject->visibleViews &= ~view;
+			++occlusionCulledCount;
 		}
-
 	}
 
-	glUseProgram(0);
+	return;
 }
 
 void ModuleRender::CreateFrameBuffer(int myWidth, int myHeight, bool scene)
@@ -609,10 +700,9 @@ void ModuleRender::DrawGuizmoButtons() const
 
 void ModuleRender::DrawDebug() const
 {
-	if(showQuadTree && App->scene->quadtreeIsComputed)
+	if(showOctree && App->scene->octreeIsComputed)
 	{
-		//Iterative
-		App->scene->quadtree->DrawIterative();
+		App->scene->octree->Draw();
 	}
 
 	if(showGrid)
@@ -622,7 +712,10 @@ void ModuleRender::DrawDebug() const
 
 	if(showAABBTree)
 	{
-		App->scene->aabbTree->Draw();
+		if (App->scene->dynamicGridIsActive)
+			App->scene->dynamicGrid->Draw();
+		else
+			App->scene->aabbTree->Draw();
 	}
 
 	return;
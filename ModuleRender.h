@@ -6,6 +6,10 @@
 #include "MathGeoLib/Math/float4x4.h"
 #include "MathGeoLib/Math/float3x3.h"
 #include "ComponentCamera.h"
+#include "MultiViewCuller.h"
+#include "VisibilityCache.h"
+#include "VisibleList.h"
+#include "OcclusionCuller.h"
 #include "GL/glew.h"
 #include "ImGuizmo/ImGuizmo.h"
 #include "Timer.h"
@@ -54,13 +58,33 @@ public:
 	//Frustum Culling
 	bool frustumCullingIsActivated = false;
 
+	//Static visibility kept between frames, frames counted by how their static results were found
+	bool staticVisibilityCache = true;
+	unsigned int staticFramesReused = 0;
+	unsigned int staticFramesPatched = 0;
+	unsigned int staticFramesRebuilt = 0;
+	unsigned int staticRetestedCount = 0;
+
+	//Meshes culled through their parent in the last collected view
+	unsigned int meshesAcceptedByParent = 0;
+	unsigned int meshesTestedByParent = 0;
+
+	//Occlusion Culling, counters are from the last collected view
+	bool occlusionCulling = true;
+	unsigned int occlusionCulledCount = 0;
+	unsigned int occluderCount = 0;
+
+	//Screen size culling and detail levels, the settings are in each camera and the counters add all the views
+	unsigned int screenSizeCulledCount = 0;
+	unsigned int detailLevelCount[MESH_LOD_LEVELS] = { 0 };
+
 
 	//Debug
 	//void OurOpenGLErrorFunction(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
 	//Draw
 	void DrawGuizmo() const;
-	void DrawAllGameObjects() const;
-	void DrawGame() const;
+	void DrawAllGameObjects();
+	void DrawGame();
 	
 	//If scene create buffer for scene else create buffer for game window
 	void CreateFrameBuffer(int width, int height, bool scene = true);
@@ -68,15 +92,15 @@ public:
 	void GenerateTextureGame(int width, int height);
 
 	//Quadtree variables
-	bool showQuadTree = false;
+	bool showOctree = false;
 	bool showAABBTree = false;
 	bool showFrustum = true;
 	bool showGrid = false;
 	bool antialiasing = false;
 
 	//Windows size
-	int heightScene, widthScene;
-	int heightGame, widthGame;
+	int heightScene = 0, widthScene = 0;
+	int heightGame = 0, widthGame = 0;
 
 	bool firstTimeCreatingBuffer = true;
 
@@ -122,7 +146,24 @@ private:
 	unsigned int gameTexture = 0;
 
 
+	//Frustum culling of all the views, buffers are kept between frames
+	MultiViewCuller views;
+	unsigned int sceneView = 0;
+	unsigned int gameView = 0;
+	VisibleList visibleGO;
+	VisibilityCache staticVisibility;
+
+	//Occlusion culling, occluder candidates are kept between frames
+	OcclusionCuller occlusionCuller;
+	std::vector<std::pair<float, GameObject*>> occluders;
+
+	//Detail level of each object of visibleGO in each view
+	std::vector<unsigned char> sceneDetailLevels;
+	std::vector<unsigned char> gameDetailLevels;
+
 	//Methods
+	void CollectVisibleGameObjects();
+	void CullOccludedGameObjects(const Frustum &frustum, unsigned int view);
 	void DrawDebug() const;
 	void DrawSceneBuffer();
 	void DrawGameBuffer();
@@ -8,10 +8,15 @@
 #include "ModuleIMGUI.h"
 #include "ModuleInput.h"
 #include "ComponentTransform.h"
+#include "TransformHierarchy.h"
 #include "ComponentMesh.h"
 #include "ComponentMaterial.h"
-#include "MyQuadTree.h"
+#include "LooseOctree.h"
 #include "AABBTree.h"
+#include "SpatialHashGrid.h"
+#include "OverlapPairs.h"
+#include "JobSystem.h"
+#include "uSTimer.h"
 #include "Imgui/imgui.h"
 #include "Imgui/imgui_impl_sdl.h"
 #include "Imgui/imgui_impl_opengl3.h"
@@ -38,6 +43,7 @@ ModuleScene::ModuleScene()
 	root->UID = 1;
 	root->isRoot = true;
 	root->isStatic = true;
+	gameObjects.Add(root);
 }
 
 
@@ -48,6 +54,8 @@ ModuleScene::~ModuleScene()
 bool ModuleScene::Init()
 {
 	aabbTree = new AABBTree(10);
+	dynamicGrid = new SpatialHashGrid();
+	overlapPairs = new OverlapPairs();
 
 	//Creating the main camera of the game
 	mainCamera = CreateGameObject("Main Camera", root);
@@ -61,53 +69,160 @@ bool ModuleScene::Init()
 		}
 	}
 	
-	allGameObjects.insert(mainCamera);
-	dynamicGO.insert(mainCamera);
-	aabbTree->Insert(mainCamera);
+	gameObjects.Insert(mainCamera, false);
+	InsertDynamic(mainCamera);
 
 	//Creating the sun light
 	directionalLight = CreateGameObject("Directional Light", root);
 	directionalLight->CreateComponent(LIGHT);
-	directionalLight->myTransform->position = float3(0, 5, 0);
+	directionalLight->myTransform->SetPosition(float3(0, 5, 0));
 
-	allGameObjects.insert(directionalLight);
-	dynamicGO.insert(directionalLight);
-	aabbTree->Insert(directionalLight);
+	gameObjects.Insert(directionalLight, false);
+	InsertDynamic(directionalLight);
 
 	return true;
 }
 
 update_status ModuleScene::PreUpdate()
 {
+	UpdateOctree();
+
 	return UPDATE_CONTINUE;
 }
 
 update_status ModuleScene::Update()
 {
-	for(auto gameObject : staticGO)
+	sceneUpdateTimer.StartTimer();
+
+	//Only the transforms that changed and their descendants are recomputed, parents before children
+	JobSystem* transformJobs = parallelTransforms ? App->jobs : nullptr;
+	transformTimer.StartTimer();
+	Transforms->Update(transformJobs);
+	timeTransforms = transformTimer.StopTimer();
+	const std::vector<unsigned int>& changedSlots = Transforms->changedSlots;
+	recomputedTransforms = changedSlots.size();
+
+	//World bounds of the changed dynamic objects, every object only writes its own bounds
+	changedPreviousBoxes.resize(changedSlots.size());
+	auto updateBounds = [this, &changedSlots](unsigned int begin, unsigned int end)
+	{
+		for(unsigned int i = begin; i < end; ++i)
+		{
+			ComponentTransform* transform = Transforms->GetOwner(changedSlots[i]);
+			if (transform == nullptr || !transform->myGameObject->isEnabled || transform->myGameObject->isStatic)
+				continue;
+
+			GameObject* GO = transform->myGameObject;
+			if (GO->globalBoundingBox != nullptr)
+				changedPreviousBoxes[i] = *GO->globalBoundingBox;
+
+			GO->UpdateBoundingBox(Transforms->worldMatrices[changedSlots[i]]);
+		}
+	};
+	if (transformJobs != nullptr)
+		transformJobs->ParallelForRange(changedSlots.size(), TRANSFORM_PARALLEL_MIN_SLOTS / 4, updateBounds);
+	else
+		updateBounds(0, changedSlots.size());
+
+	movedGO.clear();
+	movedPreviousBoxes.clear();
+	changedCullingGroups.clear();
+	for(unsigned int i = 0; i < changedSlots.size(); ++i)
 	{
-		if(gameObject->isEnabled)
-			gameObject->Update();
+		ComponentTransform* transform = Transforms->GetOwner(changedSlots[i]);
+		if (transform == nullptr || !transform->myGameObject->isEnabled)
+			continue;
+
+		GameObject* GO = transform->myGameObject;
+		GO->Update();
+		if (GO->isStatic)
+			continue;
+
+		//Meshes of a model move the tree leaf of their parent
+		if (GO->IsCulledWithParent())
+		{
+			changedCullingGroups.push_back(GO->parent);
+		}
+		else if (GO->globalBoundingBox != nullptr)
+		{
+			movedGO.push_back(GO);
+			movedPreviousBoxes.push_back(changedPreviousBoxes[i]);
+		}
 	}
 
-	for(auto GO : dynamicGO)
+	//Parents that didn't change themselves are moved by their meshes
+	std::sort(changedCullingGroups.begin(), changedCullingGroups.end());
+	changedCullingGroups.erase(std::unique(changedCullingGroups.begin(), changedCullingGroups.end()), changedCullingGroups.end());
+	for(auto GO : changedCullingGroups)
 	{
-		if(GO->isEnabled)
+		if (!Transforms->HasChanged(GO->myTransform->slot) && GO->isEnabled && !GO->isStatic)
 		{
-			GO->UpdateTransform();
-			GO->Update();
+			movedGO.push_back(GO);
+			movedPreviousBoxes.push_back(*GO->globalBoundingBox);
+		}
+	}
 
-			if (GO->globalBoundingBox != nullptr)
-			{
-				aabbTree->UpdateObject(GO);
-			}
+	//Parent bounds are taken once all their meshes are updated
+	for(auto GO : movedGO)
+	{
+		if (GO->isParentOfMeshes)
+			GO->EncloseChildren();
+	}
 
-			if (moveObjectsArround)
-				MoveObjects(GO);
+	unsigned int movingCount = 0;
+	for(unsigned int i = 0; i < movedGO.size(); ++i)
+	{
+		//New objects are checked for overlaps in their first frame
+		if (trackOverlaps && movedGO[i]->overlapProxyIndex == OVERLAP_NULL_PROXY)
+			overlapPairs->Add(movedGO[i]);
+
+		const AABB& box = *movedGO[i]->globalBoundingBox;
+		const AABB& previousBox = movedPreviousBoxes[i];
+		if (box.minPoint.x != previousBox.minPoint.x || box.minPoint.y != previousBox.minPoint.y || box.minPoint.z != previousBox.minPoint.z
+			|| box.maxPoint.x != previousBox.maxPoint.x || box.maxPoint.y != previousBox.maxPoint.y || box.maxPoint.z != previousBox.maxPoint.z)
+		{
+			++movingCount;
+			if (trackOverlaps)
+				overlapPairs->MarkMoved(movedGO[i]);
 		}
+	}
+	ChooseDynamicBroadphase(movingCount);
+
+	//Tree or grid is updated once with all the dynamic objects
+	if (dynamicGridIsActive)
+		dynamicGrid->UpdateObjects(movedGO);
+	else
+		aabbTree->UpdateObjects(movedGO);
+
+	//Overlaps of the objects that moved, from the updated structure
+	if (trackOverlaps)
+	{
+		overlapTimer.StartTimer();
+		overlapPairs->Update([this](VisibleList& candidates, const AABB* box)
+		{
+			if (dynamicGridIsActive)
+				dynamicGrid->GetIntersection(candidates, box);
+			else
+				aabbTree->GetIntersection(candidates, box);
+		});
+		timeOverlapPairs = overlapTimer.StopTimer();
+	}
+	else if (overlapPairs->Size() > 0)
+	{
+		overlapPairs->Clear();
+	}
+	//TODO: How to treat cameras : as a normal object but we only put on octree objects with mesh or parent of mesh
 
+	//Moved objects are dirty and picked up in the next frame
+	if (moveObjectsArround)
+	{
+		for(auto GO : gameObjects.GetDynamic())
+		{
+			if (GO->isEnabled)
+				MoveObjects(GO);
+		}
 	}
-	//TODO: How to treat cameras : as a normal object but we only put on quadtree objects with mesh or parent of mesh
+	timeSceneUpdate = sceneUpdateTimer.StopTimer();
 
 	DrawGUI();
 
@@ -116,24 +231,24 @@ update_status ModuleScene::Update()
 
 bool ModuleScene::CleanUp()
 {
-	if (quadtreeIsComputed)
-	{
-		quadtree->ClearIterative();
-		delete quadtree;
-	}
-
-	quadTreeInitialized = false;
+	WaitOctreeRebuild();
+	delete octree;
+	octree = nullptr;
+	octreeIsComputed = false;
 
-	for(auto GO : allGameObjects)
+	for(auto GO : gameObjects.GetAll())
 	{
 		delete GO;
 	}
-
-	allGameObjects.clear();
-	dynamicGO.clear();
-	staticGO.clear();
+	gameObjects.Clear();
 
 	delete aabbTree;
+	aabbTree = nullptr;
+	delete dynamicGrid;
+	dynamicGrid = nullptr;
+	dynamicGridIsActive = false;
+	delete overlapPairs;
+	overlapPairs = nullptr;
 	delete root;
 
 	return true;
@@ -149,7 +264,9 @@ GameObject * ModuleScene::CreateGameObject()
 
 	++numberOfGameObjects;
 
-	selectedByHierarchy = gameObject;
+	//Registered here so it can be selected, it is listed by the caller
+	gameObjects.Add(gameObject);
+	SelectObjectInHierarchy(gameObject);
 
 	return gameObject;
 }
@@ -163,7 +280,9 @@ GameObject * ModuleScene::CreateGameObject(const char * name, GameObject * paren
 
 	++numberOfGameObjects;
 
-	selectedByHierarchy = gameObject;
+	//Registered here so it can be selected, it is listed by the caller
+	gameObjects.Add(gameObject);
+	SelectObjectInHierarchy(gameObject);
 
 	return gameObject;
 }
@@ -186,6 +305,9 @@ void ModuleScene::LoadModel(const char * path, GameObject* parent)
 	LOG("Creating parent gameObject %s", name.c_str());
 	//parent->SetName(name);
 
+	//Setting parent as a meshParent, its meshes are culled through it
+	parent->isParentOfMeshes = true;
+
 	LOG("For each mesh of the model we create a gameObject.");
 	
 	for (multimap<Mesh*, Texture*>::iterator it = modelLoaded.Meshes.begin(); it != modelLoaded.Meshes.end();)
@@ -209,16 +331,13 @@ void ModuleScene::LoadModel(const char * path, GameObject* parent)
 
 		myMaterialCreated->SetTextures(textures);
 		newMeshObject->ComputeAABB();
-		allGameObjects.insert(newMeshObject);
-		dynamicGO.insert(newMeshObject);
-		aabbTree->Insert(newMeshObject);
+		gameObjects.Insert(newMeshObject, false);
 		++numObject;
 	}
 
 
 	parent->ComputeAABB();
-	//Setting parent as a meshParent
-	parent->isParentOfMeshes = true;
+	parent->EncloseChildren();
 
 	return;
 }
@@ -229,9 +348,8 @@ void ModuleScene::CreateEmpty(GameObject* parent)
 	GameObject* empty = CreateGameObject(defaultName.c_str(), parent);
 	
 
-	allGameObjects.insert(empty);
-	dynamicGO.insert(empty);
-	aabbTree->Insert(empty);
+	gameObjects.Insert(empty, false);
+	InsertDynamic(empty);
 
 	return;
 }
@@ -250,9 +368,8 @@ void ModuleScene::CreateGameObjectBakerHouse(GameObject * parent)
 	LoadModel("BakerHouse", newGameObject);
 	++numberOfBakerHouse;
 
-	allGameObjects.insert(newGameObject);
-	dynamicGO.insert(newGameObject);
-	aabbTree->Insert(newGameObject);
+	gameObjects.Insert(newGameObject, false);
+	InsertDynamic(newGameObject);
 	LOG("%s created with %s as parent.", defaultName.c_str(), parent->GetName().c_str());
 	
 
@@ -273,9 +390,8 @@ void ModuleScene::CreateGameObjectZomBunny(GameObject * parent)
 	LoadModel("Zombunny", newGameObject);
 	++numberOfBakerHouse;
 
-	allGameObjects.insert(newGameObject);
-	dynamicGO.insert(newGameObject);
-	aabbTree->Insert(newGameObject);
+	gameObjects.Insert(newGameObject, false);
+	InsertDynamic(newGameObject);
 	LOG("%s created with %s as parent.", defaultName.c_str(), parent->GetName());
 
 
@@ -295,9 +411,8 @@ void ModuleScene::CreateGameObjectByName(GameObject * parent, const char* name)
 	LoadModel(name, newGameObject);
 	++numberOfBakerHouse;
 
-	allGameObjects.insert(newGameObject);
-	dynamicGO.insert(newGameObject);
-	aabbTree->Insert(newGameObject);
+	gameObjects.Insert(newGameObject, false);
+	InsertDynamic(newGameObject);
 	LOG("%s created with %s as parent.", name, parent->GetName().c_str());
 
 
@@ -386,7 +501,7 @@ void ModuleScene::CreateGameObjectShape(GameObject * parent, ShapeType shape)
 	//newGameObject->ComputeAABB();
 	//newGameObject->isParentOfMeshes = true;
 
-	//allGameObjects.insert(newGameObject);
+	//gameObjects.Insert(newGameObject, false);
 
 
 	//LOG("%s created with %s as parent.", defaultName.c_str(), parent->GetName());
@@ -398,20 +513,15 @@ void ModuleScene::CreateGameObjectShape(GameObject * parent, ShapeType shape)
 
 void ModuleScene::RemoveGameObject(GameObject * go)
 {
-	if (!allGameObjects.empty())
+	if (go->registrySlot != GAMEOBJECT_NULL_SLOT)
 	{
-		allGameObjects.erase(go);
-		
-		if (go->isStatic)
-		{
-			staticGO.erase(go);
-		}
+		//The list it is in tells where it was inserted, the flag can be out of step with it
+		if (gameObjects.IsStatic(go))
+			RemoveFromOctree(go);
 		else
-		{
-			dynamicGO.erase(go);
-			aabbTree->Remove(go);
-		}
-			
+			RemoveDynamic(go);
+
+		gameObjects.Remove(go);
 	}
 
 	return;
@@ -419,7 +529,7 @@ void ModuleScene::RemoveGameObject(GameObject * go)
 
 void ModuleScene::SelectObjectInHierarchy(GameObject * selected)
 {
-	selectedByHierarchy = selected;
+	selectedByHierarchy = gameObjects.GetHandle(selected);
 
 	return;
 }
@@ -440,79 +550,284 @@ void ModuleScene::DrawGUI()
 		);
 
 		ImGui::Begin(ICON_FA_SITEMAP " Hierarchy", &showHierarchy, flags);
-		root->DrawHierarchy(selectedByHierarchy);
+		root->DrawHierarchy(GetSelectedObject());
 		ImGui::End();
 	}
 
 
-	if(selectedByHierarchy != nullptr && showInspector)
+	GameObject* selected = GetSelectedObject();
+	if(selected != nullptr && showInspector)
 	{
-		selectedByHierarchy->DrawInspector(showInspector);
+		selected->DrawInspector(showInspector);
 	}
 
 }
 
-void ModuleScene::AddToQuadtree(GameObject* go) const
+void ModuleScene::BuildOctree()
 {
-	if(go->globalBoundingBox == nullptr)
-	{
-		LOG("Can not add element to quadtree, AABB is nullptr.");
+	//A rebuild in flight would be older than this one
+	WaitOctreeRebuild();
+
+	//Cells are allocated once, later builds only clear them
+	if (octree == nullptr)
+		octree = new LooseOctree();
+
+	octreeTimer.StartTimer();
+
+	std::vector<std::pair<GameObject*, AABB>> objects;
+	GetStaticBounds(objects);
+
+	//Without static objects the limits are taken from the first one added
+	AABB sceneBox = ComputeSceneAABB();
+	if (!sceneBox.IsFinite())
+		sceneBox = AABB(float3::zero, float3::zero);
+
+	octree->Build(sceneBox, objects);
+	octree->BindObjects();
+
+	timeOctree = octreeTimer.StopTimer();
+
+	++octreeVersion;
+	octreeIsComputed = true;
+
+	return;
+}
+
+void ModuleScene::AddToOctree(GameObject * go)
+{
+	if (go->globalBoundingBox == nullptr || go->IsCulledWithParent())
 		return;
-	}
-	quadtree->Insert(go);
+
+	if (octree == nullptr)
+		octree = new LooseOctree();
+
+	octree->Insert(go);
+	++staticVersion;
+	octreeIsComputed = true;
+
 	return;
 }
 
-void ModuleScene::BuildQuadTree()
+void ModuleScene::RemoveFromOctree(GameObject * go)
 {
-	if (staticGO.size() == 0 || (staticGO.size() == 1 && (*staticGO.begin())->globalBoundingBox == nullptr))
+	if (octree == nullptr)
 		return;
 
-	AABB* sceneBox = ComputeSceneAABB();
+	octree->Remove(go);
+	++staticVersion;
 
-	quadtreeIsComputed = false;
+	return;
+}
 
-	//Iterative
-	if (quadTreeInitialized)
+void ModuleScene::UpdateCullingGroup(GameObject * parent)
+{
+	if (parent == nullptr || parent->isRoot)
+		return;
+
+	//Octree items keep their box, static parents are taken out before their box changes and inserted again
+	bool reinsertParent = parent->isParentOfMeshes && parent->octreeItemIndex != OCTREE_NULL_ITEM;
+	if (reinsertParent)
+		RemoveFromOctree(parent);
+
+	std::vector<GameObject*> leaving;
+	std::vector<GameObject*> joining;
+	parent->UpdateCullingGroup(leaving, joining);
+	for(auto child : leaving)
 	{
-		quadtree->ClearIterative();
-		delete quadtree;
+		if (gameObjects.IsStatic(child))
+			RemoveFromOctree(child);
+		else
+			RemoveDynamic(child);
 	}
-	
-	quadtree = new MyQuadTree(sceneBox);
+	for(auto child : joining)
+	{
+		if (gameObjects.IsStatic(child))
+			AddToOctree(child);
+		else
+			InsertDynamic(child);
+	}
+
+	if (reinsertParent)
+		AddToOctree(parent);
+	else if (parent->isParentOfMeshes)
+		UpdateDynamic(parent);
 
-	iterative.StartTimer();
-	for(auto go : staticGO)
+	return;
+}
+
+void ModuleScene::RebuildOctreeAsync()
+{
+	if (octreeRebuilder.IsBuilding())
+		return;
+
+	std::vector<std::pair<GameObject*, AABB>> objects;
+	GetStaticBounds(objects);
+
+	AABB sceneBox = ComputeSceneAABB();
+	if (!sceneBox.IsFinite())
+		sceneBox = AABB(float3::zero, float3::zero);
+
+	octreeRebuilder.Start(*App->jobs, sceneBox, std::move(objects), staticVersion);
+
+	return;
+}
+
+void ModuleScene::WaitOctreeRebuild()
+{
+	octreeRebuilder.Wait(*App->jobs);
+
+	return;
+}
+
+void ModuleScene::UpdateOctree()
+{
+	if (octreeRebuilder.Swap(octree, staticVersion))
 	{
-		if(go->globalBoundingBox != nullptr)
-		{
-			quadtree->InsertIterative(quadtree->nodes, go);
-		}
+		timeOctree = octreeRebuilder.buildTime;
+		++octreeVersion;
 	}
 
-	timeIterative = iterative.StopTimer();
+	if (!octreeRebuilder.IsBuilding() && octree != nullptr && octree->NeedsRebuild())
+		RebuildOctreeAsync();
 
-	quadTreeInitialized = true;
+	return;
+}
 
-	quadtreeIsComputed = true;	
+void ModuleScene::GetStaticBounds(std::vector<std::pair<GameObject*, AABB>>& objects) const
+{
+	objects.reserve(gameObjects.GetStatic().size());
+	for(auto go : gameObjects.GetStatic())
+	{
+		if(go->globalBoundingBox != nullptr && !go->IsCulledWithParent())
+		{
+			objects.push_back(std::make_pair(go, *go->globalBoundingBox));
+		}
+	}
 
 	return;
 }
 
-void ModuleScene::BuildAABBTree()
+void ModuleScene::BuildAABBTree(bool incremental)
 {
+	//Objects in the grid are moved back to the tree
+	if (dynamicGridIsActive)
+	{
+		dynamicGrid->Build(std::vector<GameObject*>());
+		dynamicGridIsActive = false;
+	}
+
+	std::vector<GameObject*> objects;
+	for(auto go : gameObjects.GetDynamic())
+	{
+		if(go->globalBoundingBox != nullptr && !go->IsCulledWithParent())
+		{
+			objects.push_back(go);
+		}
+	}
+
 	aabbTreeTimer.StartTimer();
-	for(auto go : allGameObjects)
+	if(incremental)
 	{
-		if(go->globalBoundingBox != nullptr)
+		//Kept for comparing the quality with the bulk build
+		aabbTree->Build(std::vector<GameObject*>());
+		for(auto go : objects)
 		{
 			aabbTree->Insert(go);
 		}
 	}
+	else
+	{
+		aabbTree->Build(objects, App->jobs);
+	}
+
+	timeAABBTree = aabbTreeTimer.StopTimer();
 
 	aabbTreeIsComputed = true;
+	aabbTreeSAHCost = aabbTree->ComputeSAHCost();
+	aabbTreeDepth = aabbTree->ComputeDepth();
 
-	timeAABBTree = aabbTreeTimer.StopTimer();
+	return;
+}
+
+void ModuleScene::InsertDynamic(GameObject * go)
+{
+	if (dynamicGridIsActive)
+		dynamicGrid->Insert(go);
+	else
+		aabbTree->Insert(go);
+
+	return;
+}
+
+void ModuleScene::RemoveDynamic(GameObject * go)
+{
+	//Each structure ignores the objects it doesn't have
+	aabbTree->Remove(go);
+	dynamicGrid->Remove(go);
+	overlapPairs->Remove(go);
+
+	return;
+}
+
+void ModuleScene::UpdateDynamic(GameObject * go)
+{
+	if (go->aabbTreeNodeIndex != AABB_NULL_NODE)
+		aabbTree->UpdateObject(go);
+	else if (go->gridItemIndex != GRID_NULL_ITEM)
+		dynamicGrid->UpdateObject(go);
+
+	return;
+}
+
+void ModuleScene::SetDynamicGrid(bool useGrid)
+{
+	if (useGrid == dynamicGridIsActive)
+		return;
+
+	if (!useGrid)
+	{
+		BuildAABBTree();
+		LOG("Dynamic objects moved to the AABBTree, %.0f%% of them moving.", movingFraction * 100.0f);
+		return;
+	}
+
+	std::vector<GameObject*> objects;
+	for(auto go : gameObjects.GetDynamic())
+	{
+		if(go->globalBoundingBox != nullptr && !go->IsCulledWithParent())
+		{
+			objects.push_back(go);
+		}
+	}
+
+	aabbTree->Build(std::vector<GameObject*>());
+	dynamicGrid->Build(objects);
+	dynamicGridIsActive = true;
+	LOG("Dynamic objects moved to the grid, %.0f%% of them moving.", movingFraction * 100.0f);
+
+	return;
+}
+
+void ModuleScene::ChooseDynamicBroadphase(unsigned int movingCount)
+{
+	if (broadphaseMode != BROADPHASE_AUTO)
+	{
+		SetDynamicGrid(broadphaseMode == BROADPHASE_GRID);
+		return;
+	}
+
+	//Averaged over about 30 frames so a single teleport doesn't switch
+	unsigned int dynamicCount = dynamicGridIsActive ? dynamicGrid->Size() : aabbTree->objectCount;
+	float frameFraction = (dynamicCount == 0) ? 0.0f : (float)movingCount / dynamicCount;
+	movingFraction += (frameFraction - movingFraction) / 30.0f;
+
+	//Refits are cheap with few objects or few movers, the grid pays off when most of the boxes change every frame
+	if (!dynamicGridIsActive && dynamicCount >= 256 && movingFraction > 0.5f)
+		SetDynamicGrid(true);
+	else if (dynamicGridIsActive && (dynamicCount < 128 || movingFraction < 0.2f))
+		SetDynamicGrid(false);
+
+	return;
 }
 
 void ModuleScene::CreateShapesScript()
@@ -531,7 +846,7 @@ void ModuleScene::CreateShapesScript()
 		CreateGameObjectShape(root, TORUS);
 	}
 
-	for(auto go : allGameObjects)
+	for(auto go : gameObjects.GetAll())
 	{
 		if(go != root && go != mainCamera)
 		{
@@ -553,7 +868,7 @@ void ModuleScene::CreateHousesScript()
 		CreateGameObjectBakerHouse(root);
 	}
 
-	for (auto go : allGameObjects)
+	for (auto go : gameObjects.GetAll())
 	{
 		if (go != root && go != mainCamera && go->isParentOfMeshes)
 		{
@@ -567,30 +882,24 @@ void ModuleScene::CreateHousesScript()
 	return;
 }
 
-AABB * ModuleScene::ComputeSceneAABB() const
+AABB ModuleScene::ComputeSceneAABB() const
 {
-	auto someElementIterator = staticGO.begin();
-	while((*someElementIterator)->globalBoundingBox == nullptr)
-	{
-		++someElementIterator;
-	}
-	float3 minPoint = (*someElementIterator)->globalBoundingBox->minPoint;
-	float3 maxPoint = (*someElementIterator)->globalBoundingBox->maxPoint;
-	
-	for(auto it = ++someElementIterator; it != staticGO.end(); ++it)
+	//Bounds of the static objects, not finite if there is none
+	AABB sceneBox;
+	sceneBox.SetNegativeInfinity();
+
+	for(auto go : gameObjects.GetStatic())
 	{
-		if((*it)->globalBoundingBox != nullptr)
+		if(go->globalBoundingBox != nullptr)
 		{
-			minPoint = Min(minPoint, (*it)->globalBoundingBox->minPoint);
-			maxPoint = Max(maxPoint, (*it)->globalBoundingBox->maxPoint);
+			sceneBox.Enclose(*go->globalBoundingBox);
 		}
-
 	}
 
-	minPoint.y = 0;
-	maxPoint.y = 0;
+	if (!sceneBox.IsFinite())
+		return sceneBox;
 
-	return new AABB(minPoint - float3(5,0,5), maxPoint + float3(5, 0, 5));
+	return AABB(sceneBox.minPoint - float3(5, 5, 5), sceneBox.maxPoint + float3(5, 5, 5));
 }
 
 void ModuleScene::CreateCubesScript()
@@ -600,7 +909,7 @@ void ModuleScene::CreateCubesScript()
 		CreateGameObjectShape(root, CUBE);
 	}
 
-	for (auto go : allGameObjects)
+	for (auto go : gameObjects.GetAll())
 	{
 		if (go != root && go != mainCamera)
 		{
@@ -624,15 +933,15 @@ void ModuleScene::MoveObjects(GameObject* go) const
 	{
 		if(go->shape == CUBE)
 		{
-			go->myTransform->position.x += dist;
+			go->myTransform->SetPosition(go->myTransform->GetPosition() + float3(dist, 0.0f, 0.0f));
 		}
 		if (go->shape == SPHERE)
 		{
-			go->myTransform->position.y += dist;
+			go->myTransform->SetPosition(go->myTransform->GetPosition() + float3(0.0f, dist, 0.0f));
 		}
 		if (go->shape == TORUS)
 		{
-			go->myTransform->position.z += dist;
+			go->myTransform->SetPosition(go->myTransform->GetPosition() + float3(0.0f, 0.0f, dist));
 		}
 
 	}
@@ -645,8 +954,8 @@ void ModuleScene::SaveScene()
 	SceneLoader * loader = new SceneLoader();
 
 	root->OnSave(*loader);
-	for (set<GameObject*>::iterator it = allGameObjects.begin(); it != allGameObjects.end(); ++it)
-		(*it)->OnSave(*loader);
+	for(auto go : gameObjects.GetAll())
+		go->OnSave(*loader);
 
 	loader->SaveJSONToFile("temp_save.json");
 
@@ -671,11 +980,14 @@ void ModuleScene::LoadScene()
 	//Create root
 	root = new GameObject();
 	root->OnLoad(*loader);
+	gameObjects.Add(root);
 
-	selectedByHierarchy = root;
+	SelectObjectInHierarchy(root);
 
 	//Create AABBtree
 	aabbTree = new AABBTree(10);
+	dynamicGrid = new SpatialHashGrid();
+	overlapPairs = new OverlapPairs();
 
 	//Start queue for loading the rest of the scene
 	queue<GameObject*> parents;
@@ -702,23 +1014,17 @@ void ModuleScene::LoadScene()
 		if (currentGameObject->GetName() == "Main Camera")
 			mainCamera = currentGameObject;
 
-		allGameObjects.insert(currentGameObject);
-		//Add to quadtree or aabbtree set (dynamic or static)
-		if (currentGameObject->isStatic)
-			staticGO.insert(currentGameObject);
-		else
-		{
-			dynamicGO.insert(currentGameObject);
-			if(currentGameObject->globalBoundingBox != nullptr)
-				aabbTree->Insert(currentGameObject);
-		}
+		//Add to octree or aabbtree list (dynamic or static)
+		gameObjects.Insert(currentGameObject, currentGameObject->isStatic);
 
 		//Add gameobject to queue
 		parents.push(currentGameObject);
 	}
 
-	//Build QuadTree
-	BuildQuadTree();
+	//Build Octree
+	BuildOctree();
+	//Build the AABBTree in one pass once all the objects are loaded
+	BuildAABBTree();
 
 	delete loader;
 
@@ -727,17 +1033,20 @@ void ModuleScene::LoadScene()
 void ModuleScene::PasteGameObject(GameObject * go)
 {
 	assert(go != nullptr);
-	if(clipboard == nullptr)
+	//The copied object may have been deleted since
+	GameObject* copiedGO = gameObjects.Get(clipboard);
+	if(copiedGO == nullptr)
 	{
 		LOG("You have nothing copied on the clipboard.");
 		return;
 	}
-	GameObject* pastedGO = new GameObject(*clipboard, go);
+	GameObject* pastedGO = new GameObject(*copiedGO, go);
 	go->children.push_back(pastedGO);
-	++clipboard->numberOfCopies;
+	++copiedGO->numberOfCopies;
 
-	allGameObjects.insert(pastedGO);
 	//Add all childs to the scene
+	gameObjects.Insert(pastedGO, false);
+	InsertDynamic(pastedGO);
 
 	InsertChilds(pastedGO);
 
@@ -759,9 +1068,8 @@ void ModuleScene::DuplicateGameObject(GameObject * go)
 	++go->numberOfCopies;
 
 	//Add all childs to the scene
-	allGameObjects.insert(duplicatedGO);
-	dynamicGO.insert(duplicatedGO);
-	aabbTree->Insert(duplicatedGO);
+	gameObjects.Insert(duplicatedGO, false);
+	InsertDynamic(duplicatedGO);
 
 	InsertChilds(duplicatedGO);
 
@@ -775,9 +1083,9 @@ void ModuleScene::InsertChilds(GameObject * go)
 
 	for(auto ch : go->children)
 	{
-		allGameObjects.insert(ch);
-		dynamicGO.insert(ch);
-		aabbTree->Insert(ch);
+		gameObjects.Insert(ch, false);
+		if (!ch->IsCulledWithParent())
+			InsertDynamic(ch);
 		InsertChilds(ch);
 	}
 
@@ -785,7 +1093,7 @@ void ModuleScene::InsertChilds(GameObject * go)
 	return;
 }
 
-LineSegment* ModuleScene::CreateRayCast(const float3 &origin, const float3 &direction, float maxDistance) const
+LineSegment ModuleScene::CreateRayCast(const float3 &origin, const float3 &direction, float maxDistance) const
 {
 	Frustum auxFrustum = Frustum();
 	auxFrustum.pos = origin - float3(0.1f,0.1f,0.1f);
@@ -803,12 +1111,12 @@ LineSegment* ModuleScene::CreateRayCast(const float3 &origin, const float3 &dire
 	float normalized_x = 0.0f;
 	float normalized_y = 0.0f;
 
-	return new LineSegment(auxFrustum.UnProjectLineSegment(normalized_x, normalized_y));
+	return auxFrustum.UnProjectLineSegment(normalized_x, normalized_y);
 }
 
-LineSegment* ModuleScene::CreateRayCast(float normalizedX, float normalizedY) const	
+LineSegment ModuleScene::CreateRayCast(float normalizedX, float normalizedY) const	
 {
-	return new LineSegment(App->camera->editorCamera->frustum->UnProjectLineSegment(normalizedX, normalizedY));
+	return App->camera->editorCamera->frustum->UnProjectLineSegment(normalizedX, normalizedY);
 }
 
 void ModuleScene::PickObject(const ImVec2 &sizeWindow, const ImVec2 &posWindow)
@@ -820,15 +1128,15 @@ void ModuleScene::PickObject(const ImVec2 &sizeWindow, const ImVec2 &posWindow)
 	//Start is position of scene imgui window and stop is scene imgui window + width/heigth of scene imgui window size
 	normalizedX = mapValues(mouse.x, posWindow.x, posWindow.x + sizeWindow.x, -1, 1);
 	normalizedY = mapValues(mouse.y, posWindow.y, posWindow.y + sizeWindow.y, 1, -1);
-	LineSegment ray = *CreateRayCast(normalizedX, normalizedY);
-	GameObject* selectedGO = IntersectRayCast(App->camera->editorCamera->frustum->pos, ray);
+	LineSegment ray = CreateRayCast(normalizedX, normalizedY);
+	GameObject* selectedGO = IntersectRayCast(ray);
 	if (selectedGO != nullptr)
 	{
 		if (!selectedGO->isParentOfMeshes && selectedGO->parent != nullptr)
 		{
 			selectedGO = selectedGO->parent;
 		}
-		selectedByHierarchy = selectedGO;
+		SelectObjectInHierarchy(selectedGO);
 	}
 
 	//dd::arrow(ray.a, ray.b, float3(1, 0, 0),10);
@@ -841,64 +1149,119 @@ GameObject * ModuleScene::GetRoot() const
 	return root;
 }
 
-GameObject* ModuleScene::IntersectRayCast(const float3 &origin, const LineSegment &ray)
+GameObject* ModuleScene::IntersectRayCast(const LineSegment &ray)
 {
-	//First get aabb intersection ordered by distance, then compare with aabb that are closer to the closest triangle hit
-	std::map<float, GameObject*> hits;
+	//Both structures visit their nodes nearest first, the closest hit of the first one prunes the second
+	float hitDistance = std::numeric_limits<float>::infinity();
+
+	GameObject* hitGO = dynamicGridIsActive ? dynamicGrid->RayCast(ray, hitDistance) : aabbTree->RayCast(ray, hitDistance);
 
-	/*
-	//Posible future optimization
-	std::set<GameObject*> possibleDynamicGO;
-	std::set<GameObject*> possibleStaticGO;
-	aabbTree->GetIntersection(possibleDynamicGO, &ray);
-	if (quadtreeIsComputed)
+	if (octreeIsComputed)
 	{
-		quadtree->GetIntersection(possibleStaticGO, &ray);
+		GameObject* staticHitGO = octree->RayCast(ray, hitDistance);
+		if (staticHitGO != nullptr)
+			hitGO = staticHitGO;
 	}
 
-	std::set<GameObject*> possibleGO = possibleDynamicGO;
-	possibleGO.insert(possibleStaticGO.begin(), possibleStaticGO.end());
-	*/
+	return hitGO;
+}
 
-	for(auto go : allGameObjects)
+void ModuleScene::IntersectRays(const std::vector<LineSegment>& rays, std::vector<RayHit>& hits)
+{
+	hits.assign(rays.size(), RayHit());
+	if (rays.empty())
+		return;
+
+	//Mesh BVHs are built the first time they are hit, build the missing ones before the workers share them
+	for(auto go : gameObjects.GetAll())
 	{
-		if(go->globalBoundingBox != nullptr && go->myMesh != nullptr)
-		{
-			bool hit = ray.Intersects(*go->globalBoundingBox);
-			if(hit)
-			{
-				float dist = origin.Distance(*go->globalBoundingBox);
-				hits[dist] = go;
-			}
+		if (go->myMesh != nullptr && go->myMesh->mesh != nullptr && !go->myMesh->mesh->bvh.IsBuilt())
+			go->myMesh->mesh->bvh.Build(go->myMesh->mesh->vertices, go->myMesh->mesh->indices);
+	}
 
+	//Sort by direction octant and then by the Morton code of the origin, so the rays of a packet go through the same nodes
+	AABB originBounds;
+	originBounds.SetNegativeInfinity();
+	for(const auto& ray : rays)
+	{
+		originBounds.Enclose(ray.a);
+	}
+
+	float3 originScale = float3(511.0f).Div(Max(originBounds.Size(), float3(1e-6f)));
+	std::vector<std::pair<unsigned, unsigned>> order(rays.size());
+	for(unsigned i = 0; i < rays.size(); ++i)
+	{
+		float3 direction = rays[i].b - rays[i].a;
+		unsigned octant = (direction.x < 0.0f ? 1 : 0) | (direction.y < 0.0f ? 2 : 0) | (direction.z < 0.0f ? 4 : 0);
+
+		float3 cell = (rays[i].a - originBounds.minPoint).Mul(originScale);
+		unsigned x = (unsigned)cell.x;
+		unsigned y = (unsigned)cell.y;
+		unsigned z = (unsigned)cell.z;
+		unsigned mortonCode = 0;
+		for(int bit = 0; bit < 9; ++bit)
+		{
+			mortonCode |= ((x >> bit) & 1) << (3 * bit);
+			mortonCode |= ((y >> bit) & 1) << (3 * bit + 1);
+			mortonCode |= ((z >> bit) & 1) << (3 * bit + 2);
 		}
-	
+
+		order[i] = std::make_pair((octant << 27) | mortonCode, i);
 	}
-	
-	if (hits.size() == 0)
-		return nullptr;
+	std::sort(order.begin(), order.end());
 
-	float minDistTriangle = std::numeric_limits<float>::infinity();;
-	GameObject* hitGO = nullptr;
-	bool isHit = false;
-	
-	//Until first hit with triangle check all gameObjects by order
-	for(const auto& it : hits)
+	unsigned packetCount = (rays.size() + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE;
+	App->jobs->ParallelFor(packetCount, [&](unsigned packet)
 	{
+		unsigned begin = packet * RAY_PACKET_SIZE;
+		unsigned count = std::min((unsigned)rays.size() - begin, (unsigned)RAY_PACKET_SIZE);
 
-		//If hitDist is -1.0f then ray doesn't intersect any triangle
-		float hitDist = it.second->IsIntersectedByRay(origin, ray);
-		if (hitDist != -1.0f && hitDist < minDistTriangle)
+		LineSegment packetRays[RAY_PACKET_SIZE];
+		RayHit packetHits[RAY_PACKET_SIZE];
+		for(unsigned i = 0; i < count; ++i)
 		{
-			minDistTriangle = hitDist;
-			hitGO = it.second;
+			packetRays[i] = rays[order[begin + i].second];
 		}
-			
-		
-	}
 
-	return hitGO;
+		//Dynamic hits prune the static query as in IntersectRayCast
+		if (dynamicGridIsActive)
+			dynamicGrid->RayCast(packetRays, packetHits, count);
+		else
+			aabbTree->RayCast(packetRays, packetHits, count);
+		if (octreeIsComputed)
+			octree->RayCast(packetRays, packetHits, count);
+
+		for(unsigned i = 0; i < count; ++i)
+		{
+			hits[order[begin + i].second] = packetHits[i];
+		}
+	});
+
+	return;
+}
+
+unsigned int ModuleScene::GetNearestObjects(const float3 & point, unsigned int k, float maxDistance, NearestObject * nearest)
+{
+	//Dynamic results bound the static search, as in IntersectRayCast
+	unsigned int count = dynamicGridIsActive ? dynamicGrid->GetNearest(point, k, maxDistance, nearest) : aabbTree->GetNearest(point, k, maxDistance, nearest);
+
+	if (octreeIsComputed)
+		count = octree->GetNearest(point, k, maxDistance, nearest, count);
+
+	return count;
 }
 
+void ModuleScene::GetObjectsInRadius(const float3 & point, float radius, std::vector<NearestObject>& objects)
+{
+	objects.clear();
+	if (dynamicGridIsActive)
+		dynamicGrid->GetWithinRadius(point, radius, objects);
+	else
+		aabbTree->GetWithinRadius(point, radius, objects);
+
+	if (octreeIsComputed)
+		octree->GetWithinRadius(point, radius, objects);
 
+	return;
+}
 
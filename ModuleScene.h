@@ -4,14 +4,20 @@
 #include "Globals.h"
 #include "Module.h"
 #include "GameObject.h"
+#include "GameObjectRegistry.h"
+#include "SpatialQuery.h"
+#include "OctreeRebuilder.h"
 #include "Timer.h"
+#include "uSTimer.h"
 #include "Point.h"
 #include "imgui/imgui.h"
 #include "MathGeoLib/Math/float2.h"
-#include <set>
+#include <vector>
 
-class MyQuadTree;
+class LooseOctree;
 class AABBTree;
+class SpatialHashGrid;
+class OverlapPairs;
 
 enum ShapeType
 {
@@ -23,6 +29,14 @@ enum ShapeType
 	
 };
 
+//Structure holding the dynamic objects
+enum DynamicBroadphase
+{
+	BROADPHASE_AUTO = 0,
+	BROADPHASE_AABBTREE,
+	BROADPHASE_GRID
+};
+
 class ModuleScene : public Module
 {
 public:
@@ -56,13 +70,10 @@ public:
 	//Drawing Methods
 	void DrawGUI();
 
-	//AllGameObjectsCreated
-	std::set<GameObject*> allGameObjects;
-	std::set<GameObject*> staticGO;
-	std::set<GameObject*> dynamicGO;
+	//Every GameObject of the scene but the root in dense static and dynamic lists, found by handle or UID
+	GameObjectRegistry gameObjects;
 	bool showHierarchy = true;
 	bool showInspector = true;
-	std::set<unsigned int> UIDs;
 
 	//Game's Main Camera Object
 	GameObject* mainCamera = nullptr;
@@ -70,35 +81,75 @@ public:
 	//Directional light
 	GameObject* directionalLight = nullptr;
 
-	//QuadTree
-	MyQuadTree* quadtree = nullptr;
+	//Static objects in the octree, dynamic ones in the AABBTree or in the grid when most of them move every frame
+	LooseOctree* octree = nullptr;
+	//Octree built in the background
+	OctreeRebuilder octreeRebuilder;
 	AABBTree* aabbTree = nullptr;
-
-	void AddToQuadtree(GameObject* go) const;
-
-	bool quadTreeInitialized = false;
-
-	//Static objects
-	void BuildQuadTree();
-	//Dynamic objects
-	void BuildAABBTree();
+	SpatialHashGrid* dynamicGrid = nullptr;
+	//Dynamic objects sent to the AABBTree or the grid each frame, kept between frames
+	std::vector<GameObject*> movedGO;
+
+	//Auto switches to the grid when most dynamic objects move and back to the tree when few of them do
+	DynamicBroadphase broadphaseMode = BROADPHASE_AUTO;
+	bool dynamicGridIsActive = false;
+	//Running average of the fraction of dynamic objects whose box changed in a frame
+	float movingFraction = 0.0f;
+	//Dynamic objects go to the active structure
+	void InsertDynamic(GameObject* go);
+	void RemoveDynamic(GameObject* go);
+	void UpdateDynamic(GameObject* go);
+	//Moves every dynamic object to the grid or to the tree
+	void SetDynamicGrid(bool useGrid);
+
+	//Dynamic objects whose boxes overlap, with the pairs that began and ended this frame. Base for triggers and collisions
+	OverlapPairs* overlapPairs = nullptr;
+	bool trackOverlaps = true;
+	float timeOverlapPairs = 0.0f;
+
+	//Matrices of the changed transforms, computed at the start of Update. Only their objects are updated after it
+	float timeTransforms = 0.0f;
+	unsigned int recomputedTransforms = 0;
+	float timeSceneUpdate = 0.0f;
+	//Transforms and world bounds are split between the job system threads, the results are the same as with one thread
+	bool parallelTransforms = true;
+
+	//Static objects, full build on the main thread
+	void BuildOctree();
+	//Single static objects, a lazy rebuild starts when the octree gets loose
+	void AddToOctree(GameObject* go);
+	void RemoveFromOctree(GameObject* go);
+	//After a parent change, moves the children in or out of the trees and updates the bounds of a parent of meshes
+	void UpdateCullingGroup(GameObject* parent);
+	//Builds a new octree as a job, the scene keeps using the current one until it is swapped in PreUpdate
+	void RebuildOctreeAsync();
+	//Waits for a rebuild in flight and drops its result
+	void WaitOctreeRebuild();
+	//Dynamic objects, bulk SAH build unless incremental
+	void BuildAABBTree(bool incremental = false);
 	void CreateCubesScript();
 	void CreateShapesScript();
 	void CreateHousesScript();
 
-	AABB* ComputeSceneAABB() const;
+	AABB ComputeSceneAABB() const;
 
 	//Move Objects
 	void MoveObjects(GameObject* go) const;
 
 	//Timers
-	Timer iterative = Timer();
+	Timer octreeTimer = Timer();
 	Timer aabbTreeTimer = Timer();
 
-	float timeIterative = 0.0f;
+	float timeOctree = 0.0f;
+	//Incremented every time a new octree is swapped in, a frame always queries a single version
+	unsigned int octreeVersion = 0;
+	//Grows every time the static objects or the octree change, cached static results older than it are stale
+	unsigned int StaticEpoch() const { return staticVersion + octreeVersion; }
 	float timeAABBTree = 0.0f;
+	float aabbTreeSAHCost = 0.0f;
+	int aabbTreeDepth = 0;
 
-	bool quadtreeIsComputed = false;
+	bool octreeIsComputed = false;
 	bool aabbTreeIsComputed = false;
 
 	bool moveObjectsArround = false;
@@ -108,18 +159,29 @@ public:
 	void SaveScene();
 	void LoadScene();
 
-	GameObject* clipboard = nullptr;
+	//Handles so a deleted object is never pasted or selected
+	GameObjectHandle clipboard;
 	void PasteGameObject(GameObject* go);
 	void DuplicateGameObject(GameObject* go);
 	void InsertChilds(GameObject* go);
 
-	GameObject* selectedByHierarchy = nullptr;
+	GameObjectHandle selectedByHierarchy;
+	//nullptr if nothing is selected or the selected object was deleted
+	GameObject* GetSelectedObject() const { return gameObjects.Get(selectedByHierarchy); }
 
 	//Mouse Picking
-	LineSegment* CreateRayCast(const float3 &origin, const float3 &direction, float maxDistance) const;
-	GameObject* IntersectRayCast(const float3 &origin, const LineSegment &ray);
-	LineSegment* CreateRayCast(float normalizedX, float normalizedY) const;
-	LineSegment* currentRay = nullptr;
+	LineSegment CreateRayCast(const float3 &origin, const float3 &direction, float maxDistance) const;
+	GameObject* IntersectRayCast(const LineSegment &ray);
+	LineSegment CreateRayCast(float normalizedX, float normalizedY) const;
+
+	//Batch ray casts, one hit per ray. Rays are sorted into coherent packets that traverse the trees together and
+	//packets are spread over the worker threads
+	void IntersectRays(const std::vector<LineSegment> &rays, std::vector<RayHit> &hits);
+
+	//k nearest objects to the point within maxDistance, static and dynamic, nearest first. Returns how many were written
+	unsigned int GetNearestObjects(const float3 &point, unsigned int k, float maxDistance, NearestObject* nearest);
+	//Objects whose box is within radius of the point, nearest first
+	void GetObjectsInRadius(const float3 &point, float radius, std::vector<NearestObject> &objects);
 
 	void PickObject(const ImVec2 &sizeWindow, const ImVec2 &posWindow);
 
@@ -139,6 +201,24 @@ private:
 
 	float2 offset = float2(-5.0f, -25.0f);
 
+	//Changes to the static objects, a rebuild started at an older version is stale
+	unsigned int staticVersion = 0;
+
+	void GetStaticBounds(std::vector<std::pair<GameObject*, AABB>> &objects) const;
+	//Swaps a finished rebuild in and starts a new one when needed
+	void UpdateOctree();
+	//Applies the broadphase mode, movingCount of the dynamic objects changed their box this frame
+	void ChooseDynamicBroadphase(unsigned int movingCount);
+	//Previous boxes of movedGO, to count the objects that move
+	std::vector<AABB> movedPreviousBoxes;
+	uSTimer overlapTimer;
+	uSTimer transformTimer;
+	uSTimer sceneUpdateTimer;
+	//Parents of the model meshes that changed this frame
+	std::vector<GameObject*> changedCullingGroups;
+	//Boxes of the changed objects before their update, by position in TransformHierarchy::changedSlots
+	std::vector<AABB> changedPreviousBoxes;
+
 	
 	
 
@@ -0,0 +1,125 @@
+#include "MultiViewCuller.h"
+#include "ComponentCamera.h"
+
+void MultiViewCuller::ClearViews()
+{
+	viewCount = 0;
+	bounds.SetNegativeInfinity();
+
+	return;
+}
+
+unsigned int MultiViewCuller::AddView(const Frustum & frustum)
+{
+	if (viewCount == CULL_MAX_VIEWS)
+	{
+		LOG("ERROR: Cannot cull more than %d views at the same time.", CULL_MAX_VIEWS);
+		return 0;
+	}
+
+	views[viewCount].SetPlanes(frustum);
+	viewProjections[viewCount] = frustum.ViewProjMatrix();
+	bounds.Enclose(frustum.MinimalEnclosingAABB());
+
+	return 1 << viewCount++;
+}
+
+ViewCullState MultiViewCuller::RootState() const
+{
+	ViewCullState state;
+	state.viewMask = AllViews();
+	for(unsigned int v = 0; v < CULL_MAX_VIEWS; ++v)
+	{
+		state.planeMask[v] = FrustumCuller::ALL_PLANES;
+	}
+
+	return state;
+}
+
+ViewMasks MultiViewCuller::TestAABB(const AABB & aabb) const
+{
+	ViewMasks masks;
+	for(unsigned int v = 0; v < viewCount; ++v)
+	{
+		int result = views[v].TestAABB(aabb);
+		if (result != AABB_OUT)
+			masks.visible |= 1 << v;
+		if (result == AABB_IN)
+			masks.inside |= 1 << v;
+	}
+
+	return masks;
+}
+
+ViewMasks MultiViewCuller::TestAABB(const AABB & aabb, ViewCullState & state, ViewCullPlanes & cullPlanes) const
+{
+	ViewMasks masks;
+	for(unsigned int v = 0; v < viewCount; ++v)
+	{
+		unsigned int viewBit = 1 << v;
+		if (!(state.viewMask & viewBit))
+			continue;
+
+		//Views that have the parent inside don't test any plane
+		unsigned planeMask = state.planeMask[v];
+		int lastPlane = cullPlanes.lastPlane[v];
+		int result = views[v].TestAABB(aabb, planeMask, lastPlane);
+		state.planeMask[v] = (unsigned char)planeMask;
+		cullPlanes.lastPlane[v] = (unsigned char)lastPlane;
+
+		if (result == AABB_OUT)
+		{
+			state.viewMask &= ~viewBit;
+			continue;
+		}
+
+		masks.visible |= viewBit;
+		if (result == AABB_IN)
+			masks.inside |= viewBit;
+	}
+
+	return masks;
+}
+
+void MultiViewCuller::ClearBoxes()
+{
+	boxes.Clear();
+
+	return;
+}
+
+void MultiViewCuller::AddBox(const AABB & aabb)
+{
+	boxes.AddBox(aabb);
+
+	return;
+}
+
+void MultiViewCuller::Cull(std::vector<ViewMasks>& results)
+{
+	results.assign(boxes.Size(), ViewMasks());
+
+	for(unsigned int v = 0; v < viewCount; ++v)
+	{
+		for(int p = 0; p < 6; ++p)
+		{
+			boxes.planeX[p] = views[v].planeX[p];
+			boxes.planeY[p] = views[v].planeY[p];
+			boxes.planeZ[p] = views[v].planeZ[p];
+			boxes.planeD[p] = views[v].planeD[p];
+		}
+
+		boxes.Cull(viewResults);
+
+		unsigned int viewBit = 1 << v;
+		for(unsigned int i = 0; i < viewResults.size(); ++i)
+		{
+			if (viewResults[i] != AABB_OUT)
+				results[i].visible |= viewBit;
+			if (viewResults[i] == AABB_IN)
+				results[i].inside |= viewBit;
+		}
+	}
+
+	return;
+}
@@ -0,0 +1,80 @@
+#ifndef __MultiViewCuller_H__
+#define __MultiViewCuller_H__
+
+#include "Globals.h"
+#include "FrustumCuller.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include "MathGeoLib/Geometry/Frustum.h"
+#include "MathGeoLib/Math/float4x4.h"
+#include <vector>
+
+//Views culled together, one bit each in the view masks
+#define CULL_MAX_VIEWS 8
+
+//Views that see a box, bit v for view v
+struct ViewMasks
+{
+	unsigned int visible = 0;
+	//Views the box is fully inside, always a subset of visible
+	unsigned int inside = 0;
+};
+
+//Views a node still has to be tested against and, for each of them, the planes it is not fully inside yet
+struct ViewCullState
+{
+	unsigned int viewMask = 0;
+	unsigned char planeMask[CULL_MAX_VIEWS];
+};
+
+//Plane that rejected the last box of each view, tested first for the next box. Boxes walked one after the other are
+//close to each other, and a walk kept from the last frame starts with the planes that rejected it
+struct ViewCullPlanes
+{
+	unsigned char lastPlane[CULL_MAX_VIEWS] = {};
+};
+
+//Culls boxes against several frustums in the same pass
+//The spatial trees are walked once for all the views: a node is only tested against the views that see its parent
+//and a view that has the node fully inside accepts the whole subtree without more tests.
+class MultiViewCuller
+{
+public:
+	MultiViewCuller() = default;
+	~MultiViewCuller() = default;
+
+	//Views
+	void ClearViews();
+	//Returns the bit of the new view, 0 if there are already CULL_MAX_VIEWS views
+	unsigned int AddView(const Frustum &frustum);
+	unsigned int ViewCount() const { return viewCount; }
+	unsigned int AllViews() const { return (1 << viewCount) - 1; }
+	const FrustumCuller& GetView(unsigned int view) const { return views[view]; }
+	const float4x4& GetViewProjection(unsigned int view) const { return viewProjections[view]; }
+	//Encloses the bounding boxes of all the views
+	const AABB& GetBounds() const { return bounds; }
+
+	//State of the root, every view with every plane
+	ViewCullState RootState() const;
+	ViewMasks TestAABB(const AABB &aabb) const;
+	//Only tests the views and planes left in state, views the box is out of and planes it is inside are removed from it.
+	//Each view starts by its plane in cullPlanes and writes back the plane that rejects the box
+	ViewMasks TestAABB(const AABB &aabb, ViewCullState &state, ViewCullPlanes &cullPlanes) const;
+
+	//Boxes, they are stored once and culled against every view
+	void ClearBoxes();
+	void AddBox(const AABB &aabb);
+	void Cull(std::vector<ViewMasks> &results);
+
+private:
+	FrustumCuller views[CULL_MAX_VIEWS];
+	float4x4 viewProjections[CULL_MAX_VIEWS];
+	unsigned int viewCount = 0;
+	AABB bounds;
+
+	//Holds the boxes, it takes the planes of each view in turn
+	FrustumCuller boxes;
+	std::vector<int> viewResults;
+
+};
+
+#endif __MultiViewCuller_H__
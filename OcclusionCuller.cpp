@@ -0,0 +1,270 @@
+#include "OcclusionCuller.h"
+#include "Mesh.h"
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+#ifdef OCCLUSION_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+//Vertices nearer than this to the camera plane are not projected
+#define OCCLUSION_MIN_W 1e-5f
+
+OcclusionCuller::OcclusionCuller()
+{
+	depth.resize(OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT);
+	tileMaxDepth.resize((OCCLUSION_BUFFER_WIDTH / OCCLUSION_TILE_SIZE) * (OCCLUSION_BUFFER_HEIGHT / OCCLUSION_TILE_SIZE));
+}
+
+void OcclusionCuller::Begin(const float4x4 & viewProjection)
+{
+	this->viewProjection = viewProjection;
+
+	std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+	std::fill(tileMaxDepth.begin(), tileMaxDepth.end(), std::numeric_limits<float>::max());
+	rasterizedTriangles = 0;
+
+	return;
+}
+
+void OcclusionCuller::RasterizeTriangles(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const float4x4 & model)
+{
+	float4x4 modelViewProjection = viewProjection * model;
+
+	//Vertices are projected once, w is kept to know the ones behind the camera
+	screenVertices.resize(vertices.size());
+	for(unsigned int i = 0; i < vertices.size(); ++i)
+	{
+		float4 clip = modelViewProjection * float4(vertices[i].Position, 1.0f);
+		if (clip.w <= OCCLUSION_MIN_W)
+		{
+			screenVertices[i] = float4(0.0f, 0.0f, 0.0f, clip.w);
+			continue;
+		}
+
+		float invW = 1.0f / clip.w;
+		screenVertices[i].x = (clip.x * invW * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH;
+		screenVertices[i].y = (clip.y * invW * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT;
+		screenVertices[i].z = clip.z * invW;
+		screenVertices[i].w = clip.w;
+	}
+
+	for(unsigned int i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const float4& v0 = screenVertices[indices[i]];
+		const float4& v1 = screenVertices[indices[i + 1]];
+		const float4& v2 = screenVertices[indices[i + 2]];
+
+		//Triangles crossing the near plane are not clipped, skipping them only hides less
+		if (v0.w <= OCCLUSION_MIN_W || v1.w <= OCCLUSION_MIN_W || v2.w <= OCCLUSION_MIN_W)
+			continue;
+
+		RasterizeTriangle(v0.xyz(), v1.xyz(), v2.xyz());
+	}
+
+	return;
+}
+
+void OcclusionCuller::UpdateTiles()
+{
+	const int tilesPerRow = OCCLUSION_BUFFER_WIDTH / OCCLUSION_TILE_SIZE;
+	for(unsigned int tile = 0; tile < tileMaxDepth.size(); ++tile)
+	{
+		int firstX = (tile % tilesPerRow) * OCCLUSION_TILE_SIZE;
+		int firstY = (tile / tilesPerRow) * OCCLUSION_TILE_SIZE;
+
+		float maxDepth = -std::numeric_limits<float>::max();
+		for(int y = firstY; y < firstY + OCCLUSION_TILE_SIZE; ++y)
+		{
+			for(int x = firstX; x < firstX + OCCLUSION_TILE_SIZE; ++x)
+			{
+				maxDepth = std::max(maxDepth, depth[y * OCCLUSION_BUFFER_WIDTH + x]);
+			}
+		}
+
+		tileMaxDepth[tile] = maxDepth;
+	}
+
+	return;
+}
+
+bool OcclusionCuller::IsVisible(const AABB & aabb) const
+{
+	int minX, minY, maxX, maxY;
+	float minDepth;
+	if (!ProjectAABB(aabb, minX, minY, maxX, maxY, minDepth))
+		return true;
+
+	const int tilesPerRow = OCCLUSION_BUFFER_WIDTH / OCCLUSION_TILE_SIZE;
+	for(int tileY = minY / OCCLUSION_TILE_SIZE; tileY <= maxY / OCCLUSION_TILE_SIZE; ++tileY)
+	{
+		for(int tileX = minX / OCCLUSION_TILE_SIZE; tileX <= maxX / OCCLUSION_TILE_SIZE; ++tileX)
+		{
+			//Every pixel of the tile has an occluder nearer than the box
+			if (minDepth >= tileMaxDepth[tileY * tilesPerRow + tileX])
+				continue;
+
+			int firstX = std::max(minX, tileX * OCCLUSION_TILE_SIZE);
+			int lastX = std::min(maxX, tileX * OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1);
+			int firstY = std::max(minY, tileY * OCCLUSION_TILE_SIZE);
+			int lastY = std::min(maxY, tileY * OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1);
+			for(int y = firstY; y <= lastY; ++y)
+			{
+				for(int x = firstX; x <= lastX; ++x)
+				{
+					if (minDepth < depth[y * OCCLUSION_BUFFER_WIDTH + x])
+						return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+float OcclusionCuller::ScreenArea(const AABB & aabb) const
+{
+	int minX, minY, maxX, maxY;
+	float minDepth;
+	if (!ProjectAABB(aabb, minX, minY, maxX, maxY, minDepth))
+		return 1.0f;
+
+	return (float)((maxX - minX + 1) * (maxY - minY + 1)) / (OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT);
+}
+
+bool OcclusionCuller::ProjectAABB(const AABB & aabb, int & minX, int & minY, int & maxX, int & maxY, float & minDepth) const
+{
+	float minScreenX = std::numeric_limits<float>::max();
+	float minScreenY = std::numeric_limits<float>::max();
+	float maxScreenX = -std::numeric_limits<float>::max();
+	float maxScreenY = -std::numeric_limits<float>::max();
+	minDepth = std::numeric_limits<float>::max();
+
+	for(int corner = 0; corner < 8; ++corner)
+	{
+		float4 clip = viewProjection * float4(aabb.CornerPoint(corner), 1.0f);
+		if (clip.w <= OCCLUSION_MIN_W)
+			return false;
+
+		float invW = 1.0f / clip.w;
+		float screenX = (clip.x * invW * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH;
+		float screenY = (clip.y * invW * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT;
+
+		minScreenX = std::min(minScreenX, screenX);
+		minScreenY = std::min(minScreenY, screenY);
+		maxScreenX = std::max(maxScreenX, screenX);
+		maxScreenY = std::max(maxScreenY, screenY);
+		minDepth = std::min(minDepth, clip.z * invW);
+	}
+
+	//Every pixel the rectangle touches
+	minX = std::max(0, (int)floor(minScreenX));
+	minY = std::max(0, (int)floor(minScreenY));
+	maxX = std::min(OCCLUSION_BUFFER_WIDTH - 1, (int)floor(maxScreenX));
+	maxY = std::min(OCCLUSION_BUFFER_HEIGHT - 1, (int)floor(maxScreenY));
+
+	//Outside the screen, frustum culling decides
+	return minX <= maxX && minY <= maxY;
+}
+
+void OcclusionCuller::RasterizeTriangle(const float3 & v0, const float3 & v1, const float3 & v2)
+{
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (fabs(area) < 1e-8f)
+		return;
+
+	//Both windings are rasterized, vertices are ordered so the inside of every edge is positive
+	const float3& a = v0;
+	const float3& b = (area > 0.0f) ? v1 : v2;
+	const float3& c = (area > 0.0f) ? v2 : v1;
+	area = fabs(area);
+
+	int minX = std::max(0, (int)floor(std::min(a.x, std::min(b.x, c.x))));
+	int minY = std::max(0, (int)floor(std::min(a.y, std::min(b.y, c.y))));
+	int maxX = std::min(OCCLUSION_BUFFER_WIDTH - 1, (int)floor(std::max(a.x, std::max(b.x, c.x))));
+	int maxY = std::min(OCCLUSION_BUFFER_HEIGHT - 1, (int)floor(std::max(a.y, std::max(b.y, c.y))));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	//Edge functions e(x, y) = A * x + B * y + C of the edges ab, bc and ca
+	const float3* edgeStart[3] = { &a, &b, &c };
+	const float3* edgeEnd[3] = { &b, &c, &a };
+	float edge[3][3];
+	for(int e = 0; e < 3; ++e)
+	{
+		edge[e][0] = -(edgeEnd[e]->y - edgeStart[e]->y);
+		edge[e][1] = edgeEnd[e]->x - edgeStart[e]->x;
+		edge[e][2] = -(edge[e][0] * edgeStart[e]->x + edge[e][1] * edgeStart[e]->y);
+	}
+
+	//Depth is linear in screen space: z(x, y) = dzdx * x + dzdy * y + z0
+	float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+	float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+	float depthPlane[3] = { dzdx, dzdy, a.z - dzdx * a.x - dzdy * a.y };
+
+	//Rows start at a multiple of 4 so blocks never go past the end of the row
+	minX &= ~3;
+	for(int y = minY; y <= maxY; ++y)
+	{
+		RasterizeRow(y, minX, maxX, edge, depthPlane);
+	}
+
+	++rasterizedTriangles;
+
+	return;
+}
+
+void OcclusionCuller::RasterizeRow(int y, int minX, int maxX, const float edge[3][3], const float depthPlane[3])
+{
+	float centerY = y + 0.5f;
+	float* row = &depth[y * OCCLUSION_BUFFER_WIDTH];
+
+#ifdef OCCLUSION_CULLER_SSE
+	__m128 zero = _mm_setzero_ps();
+	__m128 edgeA[3], edgeRow[3];
+	for(int e = 0; e < 3; ++e)
+	{
+		edgeA[e] = _mm_set1_ps(edge[e][0]);
+		edgeRow[e] = _mm_set1_ps(edge[e][1] * centerY + edge[e][2]);
+	}
+	__m128 depthA = _mm_set1_ps(depthPlane[0]);
+	__m128 depthRow = _mm_set1_ps(depthPlane[1] * centerY + depthPlane[2]);
+
+	for(int x = minX; x <= maxX; x += 4)
+	{
+		__m128 centerX = _mm_set_ps(x + 3.5f, x + 2.5f, x + 1.5f, x + 0.5f);
+
+		__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], centerX), edgeRow[0]), zero);
+		inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], centerX), edgeRow[1]), zero));
+		inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], centerX), edgeRow[2]), zero));
+		if (_mm_movemask_ps(inside) == 0)
+			continue;
+
+		//Nearest depth wins on the covered pixels
+		__m128 pixelDepth = _mm_add_ps(_mm_mul_ps(depthA, centerX), depthRow);
+		__m128 oldDepth = _mm_loadu_ps(row + x);
+		__m128 newDepth = _mm_min_ps(oldDepth, pixelDepth);
+		_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, newDepth), _mm_andnot_ps(inside, oldDepth)));
+	}
+#else
+	for(int x = minX; x <= maxX; ++x)
+	{
+		float centerX = x + 0.5f;
+		bool inside = true;
+		for(int e = 0; e < 3; ++e)
+		{
+			if (edge[e][0] * centerX + edge[e][1] * centerY + edge[e][2] < 0.0f)
+				inside = false;
+		}
+
+		if (!inside)
+			continue;
+
+		float pixelDepth = depthPlane[0] * centerX + depthPlane[1] * centerY + depthPlane[2];
+		row[x] = std::min(row[x], pixelDepth);
+	}
+#endif
+
+	return;
+}
@@ -0,0 +1,64 @@
+#ifndef __OcclusionCuller_H__
+#define __OcclusionCuller_H__
+
+#include "Globals.h"
+#include "MathGeoLib/Math/float4.h"
+#include "MathGeoLib/Math/float4x4.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include <vector>
+
+//Comment this line to force the scalar path
+#define OCCLUSION_CULLER_SSE
+
+//Depth buffer size, width is a multiple of 4 so rows are filled 4 pixels at a time
+#define OCCLUSION_BUFFER_WIDTH 256
+#define OCCLUSION_BUFFER_HEIGHT 128
+//Tiles keep the farthest depth of their pixels
+#define OCCLUSION_TILE_SIZE 8
+//Occluders are the static meshes covering at least this fraction of the screen, biggest first
+#define OCCLUSION_MIN_OCCLUDER_AREA 0.02f
+#define OCCLUSION_MAX_OCCLUDERS 32
+
+struct Vertex;
+
+//CPU occlusion culler
+//Occluder triangles are rasterized into a small depth buffer that keeps the nearest occluder depth of each pixel.
+//Boxes are then projected to a screen rectangle with their nearest depth and are hidden when every pixel of the
+//rectangle has an occluder in front. Tiles keep the farthest depth of their pixels so most boxes are decided per tile.
+//Depths are clip z / w, any projection whose depth grows with the distance works.
+class OcclusionCuller
+{
+public:
+	OcclusionCuller();
+	~OcclusionCuller() = default;
+
+	//Starts a frame, the buffer is cleared to the far plane
+	void Begin(const float4x4 &viewProjection);
+	void RasterizeTriangles(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const float4x4 &model);
+	//Has to be called after the last occluder and before testing
+	void UpdateTiles();
+
+	bool IsVisible(const AABB &aabb) const;
+	//Fraction of the screen covered by the projected box, 1 if it crosses the near plane
+	float ScreenArea(const AABB &aabb) const;
+
+	//Nearest depth of a pixel
+	float GetDepth(int x, int y) const { return depth[y * OCCLUSION_BUFFER_WIDTH + x]; }
+
+	unsigned int rasterizedTriangles = 0;
+
+private:
+	//Screen rectangle in pixels, false if the box crosses the near plane
+	bool ProjectAABB(const AABB &aabb, int &minX, int &minY, int &maxX, int &maxY, float &minDepth) const;
+	void RasterizeTriangle(const float3 &v0, const float3 &v1, const float3 &v2);
+	void RasterizeRow(int y, int minX, int maxX, const float edge[3][3], const float depthPlane[3]);
+
+	float4x4 viewProjection;
+	std::vector<float> depth;
+	std::vector<float> tileMaxDepth;
+	//Screen x, y and depth of the current occluder vertices, w is the clip w
+	std::vector<float4> screenVertices;
+
+};
+
+#endif __OcclusionCuller_H__
@@ -0,0 +1,66 @@
+#include "OctreeRebuilder.h"
+#include "LooseOctree.h"
+#include "uSTimer.h"
+#include <utility>
+
+OctreeRebuilder::~OctreeRebuilder()
+{
+	assert(!isBuilding);
+	delete rebuiltOctree;
+}
+
+void OctreeRebuilder::Start(JobSystem & jobs, const AABB & limits, std::vector<std::pair<GameObject*, AABB>>&& objects, unsigned staticVersion)
+{
+	if (isBuilding)
+		return;
+
+	//Cells are allocated once, later builds only clear them
+	if (rebuiltOctree == nullptr)
+		rebuiltOctree = new LooseOctree();
+
+	buildVersion = staticVersion;
+	isBuilding = true;
+
+	//In the background queue, a wait of the frame loops would run the whole build on the main thread
+	LooseOctree* target = rebuiltOctree;
+	jobs.RunBackground([this, target, limits, objects = std::move(objects)]()
+	{
+		uSTimer buildTimer;
+		buildTimer.StartTimer();
+		target->Build(limits, objects);
+		buildTime = buildTimer.StopTimer();
+	}, &counter);
+
+	return;
+}
+
+void OctreeRebuilder::Wait(JobSystem & jobs)
+{
+	if (isBuilding)
+	{
+		jobs.Wait(counter);
+		isBuilding = false;
+	}
+
+	return;
+}
+
+bool OctreeRebuilder::Swap(LooseOctree *& octree, unsigned staticVersion)
+{
+	if (!isBuilding || !counter.IsDone())
+		return false;
+
+	isBuilding = false;
+
+	//Static objects changed while building, the current octree has those changes and the result has not
+	if (buildVersion != staticVersion)
+	{
+		++discardedCount;
+		return false;
+	}
+
+	std::swap(octree, rebuiltOctree);
+	octree->BindObjects();
+
+	return true;
+}
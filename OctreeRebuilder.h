@@ -0,0 +1,43 @@
+#ifndef __OctreeRebuilder_H__
+#define __OctreeRebuilder_H__
+
+#include "Globals.h"
+#include "JobSystem.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include <vector>
+
+class GameObject;
+class LooseOctree;
+
+//Builds a LooseOctree in the background queue of a job system while the scene keeps using its current one
+//The static version tells when the static objects changed: a build started at an older version than the one it is
+//swapped at misses those changes and is dropped.
+class OctreeRebuilder
+{
+public:
+	OctreeRebuilder() = default;
+	~OctreeRebuilder();
+
+	//Does nothing if a build is in flight. Bounds are copied so the job never reads the GameObjects
+	void Start(JobSystem &jobs, const AABB &limits, std::vector<std::pair<GameObject*, AABB>> &&objects, unsigned staticVersion);
+	//Waits for a build in flight and drops its result
+	void Wait(JobSystem &jobs);
+	//Swaps a finished build with octree and binds its objects. False while building, without a build or when the
+	//result was stale and dropped
+	bool Swap(LooseOctree* &octree, unsigned staticVersion);
+
+	bool IsBuilding() const { return isBuilding; }
+
+	//Last finished build
+	float buildTime = 0.0f;
+	unsigned discardedCount = 0;
+
+private:
+	LooseOctree* rebuiltOctree = nullptr;
+	JobCounter counter;
+	bool isBuilding = false;
+	unsigned buildVersion = 0;
+
+};
+
+#endif __OctreeRebuilder_H__
@@ -0,0 +1,197 @@
+#include "OverlapPairs.h"
+#include "GameObject.h"
+#include <assert.h>
+#include <algorithm>
+
+void OverlapPairs::Add(GameObject * go)
+{
+	assert(go != nullptr && go->overlapProxyIndex == OVERLAP_NULL_PROXY);
+
+	unsigned proxyIndex = firstFreeProxy;
+	if (proxyIndex != OVERLAP_NULL_PROXY)
+	{
+		firstFreeProxy = proxies[proxyIndex].nextFreeProxy;
+	}
+	else
+	{
+		proxyIndex = proxies.size();
+		proxies.push_back(OverlapProxy());
+	}
+
+	proxies[proxyIndex].go = go;
+	proxies[proxyIndex].nextFreeProxy = OVERLAP_NULL_PROXY;
+	go->overlapProxyIndex = proxyIndex;
+	++proxyCount;
+
+	MarkMoved(go);
+
+	return;
+}
+
+void OverlapPairs::Remove(GameObject * go)
+{
+	unsigned proxyIndex = go->overlapProxyIndex;
+	if (proxyIndex == OVERLAP_NULL_PROXY)
+		return;
+
+	OverlapProxy& proxy = proxies[proxyIndex];
+	while (!proxy.overlaps.empty())
+	{
+		RemovePair(proxyIndex, proxy.overlaps.back());
+	}
+
+	//Still in the moved list, Update skips it
+	proxy.go = nullptr;
+	proxy.isMoved = false;
+	proxy.nextFreeProxy = firstFreeProxy;
+	firstFreeProxy = proxyIndex;
+
+	go->overlapProxyIndex = OVERLAP_NULL_PROXY;
+	--proxyCount;
+
+	return;
+}
+
+void OverlapPairs::MarkMoved(GameObject * go)
+{
+	unsigned proxyIndex = go->overlapProxyIndex;
+	if (proxyIndex == OVERLAP_NULL_PROXY || proxies[proxyIndex].isMoved)
+		return;
+
+	proxies[proxyIndex].isMoved = true;
+	movedProxies.push_back(proxyIndex);
+
+	return;
+}
+
+void OverlapPairs::Clear()
+{
+	for(auto& proxy : proxies)
+	{
+		if (proxy.go != nullptr)
+			proxy.go->overlapProxyIndex = OVERLAP_NULL_PROXY;
+	}
+
+	proxies.clear();
+	firstFreeProxy = OVERLAP_NULL_PROXY;
+	proxyCount = 0;
+	movedProxies.clear();
+	pairKeys.clear();
+	beginPairs.clear();
+	endPairs.clear();
+
+	return;
+}
+
+void OverlapPairs::Update(const std::function<void(VisibleList&, const AABB*)>& query)
+{
+	beginPairs.clear();
+	endPairs.clear();
+	movedCount = 0;
+
+	//Pairs of two moved objects are found by the first one, the second one sees them already in the set
+	for(auto proxyIndex : movedProxies)
+	{
+		if (!proxies[proxyIndex].isMoved)
+			continue;
+
+		proxies[proxyIndex].isMoved = false;
+		++movedCount;
+
+		GameObject* go = proxies[proxyIndex].go;
+		const AABB& box = *go->globalBoundingBox;
+
+		//Backwards, RemovePair swaps the last overlap in
+		std::vector<unsigned>& overlaps = proxies[proxyIndex].overlaps;
+		for(int i = (int)overlaps.size() - 1; i >= 0; --i)
+		{
+			unsigned otherIndex = overlaps[i];
+			if (!box.Intersects(*proxies[otherIndex].go->globalBoundingBox))
+			{
+				endPairs.push_back(MakePair(proxyIndex, otherIndex));
+				RemovePair(proxyIndex, otherIndex);
+			}
+		}
+
+		candidates.Begin();
+		query(candidates, &box);
+		for(auto other : candidates)
+		{
+			unsigned otherIndex = other->overlapProxyIndex;
+			if (otherIndex == OVERLAP_NULL_PROXY || otherIndex == proxyIndex || !box.Intersects(*other->globalBoundingBox))
+				continue;
+
+			if (pairKeys.count(PairKey(proxyIndex, otherIndex)) != 0)
+				continue;
+
+			AddPair(proxyIndex, otherIndex);
+			beginPairs.push_back(MakePair(proxyIndex, otherIndex));
+		}
+	}
+	movedProxies.clear();
+
+	return;
+}
+
+void OverlapPairs::GetPairs(std::vector<OverlapPair>& currentPairs) const
+{
+	currentPairs.clear();
+	currentPairs.reserve(pairKeys.size());
+	for(unsigned proxyIndex = 0; proxyIndex < proxies.size(); ++proxyIndex)
+	{
+		for(auto otherIndex : proxies[proxyIndex].overlaps)
+		{
+			if (proxyIndex < otherIndex)
+				currentPairs.push_back(MakePair(proxyIndex, otherIndex));
+		}
+	}
+
+	return;
+}
+
+unsigned long long OverlapPairs::PairKey(unsigned proxyA, unsigned proxyB) const
+{
+	if (proxyA > proxyB)
+		std::swap(proxyA, proxyB);
+
+	return ((unsigned long long)proxyA << 32) | proxyB;
+}
+
+OverlapPair OverlapPairs::MakePair(unsigned proxyA, unsigned proxyB) const
+{
+	if (proxyA > proxyB)
+		std::swap(proxyA, proxyB);
+
+	OverlapPair pair;
+	pair.a = proxies[proxyA].go;
+	pair.b = proxies[proxyB].go;
+
+	return pair;
+}
+
+void OverlapPairs::AddPair(unsigned proxyA, unsigned proxyB)
+{
+	pairKeys.insert(PairKey(proxyA, proxyB));
+	proxies[proxyA].overlaps.push_back(proxyB);
+	proxies[proxyB].overlaps.push_back(proxyA);
+
+	return;
+}
+
+void OverlapPairs::RemovePair(unsigned proxyA, unsigned proxyB)
+{
+	pairKeys.erase(PairKey(proxyA, proxyB));
+
+	//Objects overlap a few others, a linear search is enough
+	std::vector<unsigned>& overlapsA = proxies[proxyA].overlaps;
+	auto itA = std::find(overlapsA.begin(), overlapsA.end(), proxyB);
+	*itA = overlapsA.back();
+	overlapsA.pop_back();
+
+	std::vector<unsigned>& overlapsB = proxies[proxyB].overlaps;
+	auto itB = std::find(overlapsB.begin(), overlapsB.end(), proxyA);
+	*itB = overlapsB.back();
+	overlapsB.pop_back();
+
+	return;
+}
@@ -0,0 +1,78 @@
+#ifndef __OverlapPairs_H__
+#define __OverlapPairs_H__
+
+#include "Globals.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include "VisibleList.h"
+#include <vector>
+#include <unordered_set>
+#include <functional>
+
+#define OVERLAP_NULL_PROXY 0xffffffff
+
+class GameObject;
+
+//Two objects whose boxes overlap, a is the one added first
+struct OverlapPair
+{
+	GameObject* a = nullptr;
+	GameObject* b = nullptr;
+};
+
+//Persistent set of the dynamic objects whose boxes overlap
+//Each object has a proxy with the proxies it overlaps. Only the objects marked as moved are checked in Update: their
+//pairs that stopped overlapping end and the broadphase is queried with their box for the ones that begin. Objects
+//that didn't move keep their pairs without any work, so the cost follows the movers and not the object count.
+class OverlapPairs
+{
+public:
+	OverlapPairs() = default;
+	~OverlapPairs() = default;
+
+	//The proxy index is kept in GameObject::overlapProxyIndex. New objects get their pairs in the next Update
+	void Add(GameObject* go);
+	//Pairs of the object are dropped without end events, it may be deleted before the next Update
+	void Remove(GameObject* go);
+	void MarkMoved(GameObject* go);
+	void Clear();
+
+	//query(list, box) fills the list with the objects whose box may intersect the box, more is fine but not less.
+	//Fills beginPairs and endPairs with the changes since the last Update
+	void Update(const std::function<void(VisibleList&, const AABB*)> &query);
+
+	unsigned PairCount() const { return pairKeys.size(); }
+	unsigned Size() const { return proxyCount; }
+	//Every current pair, for checks and debug drawing
+	void GetPairs(std::vector<OverlapPair> &currentPairs) const;
+
+	std::vector<OverlapPair> beginPairs;
+	std::vector<OverlapPair> endPairs;
+	//Objects checked in the last Update
+	unsigned movedCount = 0;
+
+private:
+	struct OverlapProxy
+	{
+		GameObject* go = nullptr;
+		//Proxies overlapping this one, the next free proxy while it is unused
+		std::vector<unsigned> overlaps;
+		unsigned nextFreeProxy = OVERLAP_NULL_PROXY;
+		bool isMoved = false;
+	};
+
+	unsigned long long PairKey(unsigned proxyA, unsigned proxyB) const;
+	OverlapPair MakePair(unsigned proxyA, unsigned proxyB) const;
+	void AddPair(unsigned proxyA, unsigned proxyB);
+	void RemovePair(unsigned proxyA, unsigned proxyB);
+
+	std::vector<OverlapProxy> proxies;
+	unsigned firstFreeProxy = OVERLAP_NULL_PROXY;
+	unsigned proxyCount = 0;
+
+	std::vector<unsigned> movedProxies;
+	std::unordered_set<unsigned long long> pairKeys;
+	VisibleList candidates;
+
+};
+
+#endif __OverlapPairs_H__
@@ -0,0 +1,671 @@
+#include "SpatialHashGrid.h"
+#include "GameObject.h"
+#include "ComponentCamera.h"
+#include "debugdraw.h"
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+#include <limits>
+
+static unsigned long long PackCell(long long x, long long y, long long z)
+{
+	return ((unsigned long long)(x + GRID_COORDINATE_BIAS) << 42) | ((unsigned long long)(y + GRID_COORDINATE_BIAS) << 21) | (unsigned long long)(z + GRID_COORDINATE_BIAS);
+}
+
+static void UnpackCell(unsigned long long cellKey, long long &x, long long &y, long long &z)
+{
+	x = (long long)((cellKey >> 42) & 0x1fffff) - GRID_COORDINATE_BIAS;
+	y = (long long)((cellKey >> 21) & 0x1fffff) - GRID_COORDINATE_BIAS;
+	z = (long long)(cellKey & 0x1fffff) - GRID_COORDINATE_BIAS;
+}
+
+static bool IsValidCell(long long x, long long y, long long z)
+{
+	return x >= -GRID_COORDINATE_BIAS && x < GRID_COORDINATE_BIAS && y >= -GRID_COORDINATE_BIAS && y < GRID_COORDINATE_BIAS
+		&& z >= -GRID_COORDINATE_BIAS && z < GRID_COORDINATE_BIAS;
+}
+
+void SpatialHashGrid::Insert(GameObject * go)
+{
+	assert(go != nullptr && go->globalBoundingBox != nullptr);
+	assert(go->gridItemIndex == GRID_NULL_ITEM);
+
+	unsigned itemIndex = firstFreeItem;
+	if (itemIndex != GRID_NULL_ITEM)
+	{
+		firstFreeItem = items[itemIndex].nextItem;
+	}
+	else
+	{
+		itemIndex = items.size();
+		items.push_back(GridItem());
+	}
+
+	GridItem& item = items[itemIndex];
+	item.go = go;
+	if (!ComputeCell(*go->globalBoundingBox, item.level, item.cellKey))
+		item.level = GRID_LEVELS;
+
+	go->gridItemIndex = itemIndex;
+	LinkItem(itemIndex);
+	++itemCount;
+
+	return;
+}
+
+void SpatialHashGrid::Remove(GameObject * go)
+{
+	unsigned itemIndex = go->gridItemIndex;
+	if (itemIndex == GRID_NULL_ITEM)
+		return;
+
+	assert(items[itemIndex].go == go);
+
+	UnlinkItem(itemIndex);
+	items[itemIndex].go = nullptr;
+	items[itemIndex].nextItem = firstFreeItem;
+	firstFreeItem = itemIndex;
+
+	go->gridItemIndex = GRID_NULL_ITEM;
+	--itemCount;
+
+	return;
+}
+
+void SpatialHashGrid::UpdateObject(GameObject * go)
+{
+	unsigned itemIndex = go->gridItemIndex;
+	if (itemIndex == GRID_NULL_ITEM)
+		return;
+
+	int level;
+	unsigned long long cellKey = 0;
+	if (!ComputeCell(*go->globalBoundingBox, level, cellKey))
+		level = GRID_LEVELS;
+
+	//Still in the same cell, queries read the live box
+	GridItem& item = items[itemIndex];
+	if (item.level == level && (level == GRID_LEVELS || item.cellKey == cellKey))
+		return;
+
+	UnlinkItem(itemIndex);
+	item.level = level;
+	item.cellKey = cellKey;
+	LinkItem(itemIndex);
+	++cellChangeCount;
+
+	return;
+}
+
+void SpatialHashGrid::UpdateObjects(const std::vector<GameObject*>& movedObjects)
+{
+	for(auto go : movedObjects)
+	{
+		UpdateObject(go);
+	}
+
+	return;
+}
+
+void SpatialHashGrid::Build(const std::vector<GameObject*>& objects)
+{
+	for(auto& item : items)
+	{
+		if (item.go != nullptr)
+			item.go->gridItemIndex = GRID_NULL_ITEM;
+	}
+
+	for(int level = 0; level < GRID_LEVELS; ++level)
+	{
+		cells[level].clear();
+		levelCounts[level] = 0;
+	}
+	firstOversizedItem = GRID_NULL_ITEM;
+	items.clear();
+	firstFreeItem = GRID_NULL_ITEM;
+	itemCount = 0;
+
+	items.reserve(objects.size());
+	for(auto go : objects)
+	{
+		Insert(go);
+	}
+
+	return;
+}
+
+void SpatialHashGrid::GetIntersection(VisibleList & intersectionGO, const AABB * bbox) const
+{
+	VisitCells(bbox, [&](int, unsigned long long, unsigned firstItem)
+	{
+		for(unsigned itemIndex = firstItem; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			if (bbox->Intersects(*items[itemIndex].go->globalBoundingBox))
+				intersectionGO.Add(items[itemIndex].go);
+		}
+	});
+
+	for(unsigned itemIndex = firstOversizedItem; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+	{
+		if (bbox->Intersects(*items[itemIndex].go->globalBoundingBox))
+			intersectionGO.Add(items[itemIndex].go);
+	}
+
+	return;
+}
+
+void SpatialHashGrid::GetIntersection(VisibleList & intersectionGO, const LineSegment * ray) const
+{
+	for(unsigned itemIndex = firstOversizedItem; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+	{
+		if (items[itemIndex].go->globalBoundingBox->Intersects(*ray))
+			intersectionGO.Add(items[itemIndex].go);
+	}
+
+	for(int level = 0; level < GRID_LEVELS; ++level)
+	{
+		if (levelCounts[level] == 0)
+			continue;
+
+		//Objects never leave the neighbours of their cell, so the cells around the ones crossed are enough
+		WalkRay(*ray, level, [&](long long x, long long y, long long z, float)
+		{
+			for(long long dx = -1; dx <= 1; ++dx)
+			for(long long dy = -1; dy <= 1; ++dy)
+			for(long long dz = -1; dz <= 1; ++dz)
+			{
+				if (!IsValidCell(x + dx, y + dy, z + dz))
+					continue;
+
+				auto cell = cells[level].find(PackCell(x + dx, y + dy, z + dz));
+				if (cell == cells[level].end())
+					continue;
+
+				for(unsigned itemIndex = cell->second; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+				{
+					if (items[itemIndex].go->globalBoundingBox->Intersects(*ray))
+						intersectionGO.Add(items[itemIndex].go);
+				}
+			}
+
+			return true;
+		});
+	}
+
+	return;
+}
+
+void SpatialHashGrid::GetIntersection(VisibleList & intersectionGO, const MultiViewCuller & views) const
+{
+	if (views.ViewCount() == 0)
+		return;
+
+	ViewCullPlanes cullPlanes;
+	VisitCells(&views.GetBounds(), [&](int level, unsigned long long cellKey, unsigned firstItem)
+	{
+		ViewCullState cellState = views.RootState();
+		ViewMasks cellMasks = views.TestAABB(LooseCellAABB(level, cellKey), cellState, cullPlanes);
+		if (cellMasks.visible == 0)
+			return;
+
+		for(unsigned itemIndex = firstItem; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			//Objects are inside the loose cell, views that have the cell inside have them inside too
+			if (cellMasks.inside == cellMasks.visible)
+			{
+				intersectionGO.Add(items[itemIndex].go, cellMasks.visible, cellMasks.inside);
+				continue;
+			}
+
+			ViewCullState itemState = cellState;
+			ViewMasks itemMasks = views.TestAABB(*items[itemIndex].go->globalBoundingBox, itemState, cullPlanes);
+			if (itemMasks.visible != 0)
+				intersectionGO.Add(items[itemIndex].go, itemMasks.visible, itemMasks.inside);
+		}
+	});
+
+	for(unsigned itemIndex = firstOversizedItem; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+	{
+		ViewMasks itemMasks = views.TestAABB(*items[itemIndex].go->globalBoundingBox);
+		if (itemMasks.visible != 0)
+			intersectionGO.Add(items[itemIndex].go, itemMasks.visible, itemMasks.inside);
+	}
+
+	return;
+}
+
+GameObject * SpatialHashGrid::RayCast(const LineSegment & ray, float & hitDistance) const
+{
+	return RayCast(ray, hitDistance, nullptr);
+}
+
+void SpatialHashGrid::RayCast(const LineSegment * rays, RayHit * hits, unsigned count) const
+{
+	//Rays are walked one by one, the grid has no nodes to share between them
+	for(unsigned i = 0; i < count; ++i)
+	{
+		float hitDistance = hits[i].distance;
+		unsigned triangle;
+		GameObject* hitGO = RayCast(rays[i], hitDistance, &triangle);
+		if (hitGO != nullptr)
+		{
+			hits[i].go = hitGO;
+			hits[i].distance = hitDistance;
+			hits[i].triangle = triangle;
+		}
+	}
+
+	return;
+}
+
+GameObject * SpatialHashGrid::RayCast(const LineSegment & ray, float & hitDistance, unsigned * triangle) const
+{
+	GameObject* hitGO = nullptr;
+
+	//An object is reached from every cell around it, its mesh is only tested once
+	std::vector<unsigned> testedItems;
+	auto testItem = [&](unsigned itemIndex)
+	{
+		GameObject* go = items[itemIndex].go;
+		float entry, exit;
+		if (!go->globalBoundingBox->Intersects(ray, entry, exit) || entry >= hitDistance)
+			return;
+
+		if (std::find(testedItems.begin(), testedItems.end(), itemIndex) != testedItems.end())
+			return;
+		testedItems.push_back(itemIndex);
+
+		unsigned hitTriangle;
+		GameObject* hitObject = go;
+		float distance = go->IsIntersectedByRay(ray, &hitTriangle, &hitObject);
+		if (distance >= 0.0f && distance < hitDistance)
+		{
+			hitDistance = distance;
+			hitGO = hitObject;
+			if (triangle != nullptr)
+				*triangle = hitTriangle;
+		}
+	};
+
+	for(unsigned itemIndex = firstOversizedItem; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+	{
+		testItem(itemIndex);
+	}
+
+	for(int level = 0; level < GRID_LEVELS; ++level)
+	{
+		if (levelCounts[level] == 0)
+			continue;
+
+		WalkRay(ray, level, [&](long long x, long long y, long long z, float entry)
+		{
+			//Objects found from later cells are hit inside those cells, so they are farther
+			if (entry >= hitDistance)
+				return false;
+
+			for(long long dx = -1; dx <= 1; ++dx)
+			for(long long dy = -1; dy <= 1; ++dy)
+			for(long long dz = -1; dz <= 1; ++dz)
+			{
+				if (!IsValidCell(x + dx, y + dy, z + dz))
+					continue;
+
+				auto cell = cells[level].find(PackCell(x + dx, y + dy, z + dz));
+				if (cell == cells[level].end())
+					continue;
+
+				for(unsigned itemIndex = cell->second; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+				{
+					testItem(itemIndex);
+				}
+			}
+
+			return true;
+		});
+	}
+
+	return hitGO;
+}
+
+unsigned SpatialHashGrid::GetNearest(const float3 & point, unsigned k, float maxDistance, NearestObject * nearest, unsigned count) const
+{
+	if (itemCount == 0 || k == 0)
+		return count;
+
+	auto isFarther = [&](float distance)
+	{
+		return (count == k) ? distance >= nearest[k - 1].distance : distance > maxDistance;
+	};
+	auto addItems = [&](unsigned firstItem)
+	{
+		for(unsigned itemIndex = firstItem; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			float distance = items[itemIndex].go->globalBoundingBox->Distance(point);
+			if (!isFarther(distance))
+				count = InsertNearest(nearest, count, k, items[itemIndex].go, distance);
+		}
+	};
+
+	addItems(firstOversizedItem);
+
+	//Fullest levels first so the k-th distance bounds the search of the others soon
+	int levels[GRID_LEVELS];
+	for(int level = 0; level < GRID_LEVELS; ++level)
+	{
+		levels[level] = level;
+	}
+	std::sort(levels, levels + GRID_LEVELS, [this](int first, int second) { return levelCounts[first] > levelCounts[second]; });
+
+	for(int level : levels)
+	{
+		if (levelCounts[level] == 0)
+			break;
+
+		float cellSize = GRID_BASE_CELL_SIZE * (1 << level);
+		long long center[3];
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			center[axis] = (long long)std::max(std::min(floor((double)point[axis] / cellSize), (double)GRID_COORDINATE_BIAS), (double)-GRID_COORDINATE_BIAS);
+		}
+
+		//Cells at ring r around the cell of the point, their objects are at least (r - 1.5) cells away
+		for(long long ring = 0; ; ++ring)
+		{
+			if (ring >= 2 && isFarther((ring - 1.5f) * cellSize))
+				break;
+
+			//Rings cost more than going through the occupied cells, the rest of the level is done that way
+			long long side = 2 * ring + 1;
+			if (side * side * side > (long long)cells[level].size())
+			{
+				for(const auto& cell : cells[level])
+				{
+					long long x, y, z;
+					UnpackCell(cell.first, x, y, z);
+					long long cellRing = std::max(std::max(std::abs(x - center[0]), std::abs(y - center[1])), std::abs(z - center[2]));
+					if (cellRing < ring || (cellRing >= 2 && isFarther((cellRing - 1.5f) * cellSize)))
+						continue;
+
+					if (!isFarther(LooseCellAABB(level, cell.first).Distance(point)))
+						addItems(cell.second);
+				}
+				break;
+			}
+
+			for(long long dx = -ring; dx <= ring; ++dx)
+			for(long long dy = -ring; dy <= ring; ++dy)
+			{
+				//Whole columns on the sides, only the two ends inside
+				bool isSide = (std::abs(dx) == ring || std::abs(dy) == ring);
+				for(long long dz = -ring; dz <= ring; dz += (isSide || ring == 0) ? 1 : 2 * ring)
+				{
+					long long x = center[0] + dx;
+					long long y = center[1] + dy;
+					long long z = center[2] + dz;
+					if (!IsValidCell(x, y, z))
+						continue;
+
+					unsigned long long cellKey = PackCell(x, y, z);
+					if (isFarther(LooseCellAABB(level, cellKey).Distance(point)))
+						continue;
+
+					auto cell = cells[level].find(cellKey);
+					if (cell != cells[level].end())
+						addItems(cell->second);
+				}
+			}
+		}
+	}
+
+	return count;
+}
+
+void SpatialHashGrid::GetWithinRadius(const float3 & point, float radius, std::vector<NearestObject>& objects) const
+{
+	auto addItems = [&](unsigned firstItem)
+	{
+		for(unsigned itemIndex = firstItem; itemIndex != GRID_NULL_ITEM; itemIndex = items[itemIndex].nextItem)
+		{
+			NearestObject object;
+			object.go = items[itemIndex].go;
+			object.distance = object.go->globalBoundingBox->Distance(point);
+			if (object.distance <= radius)
+				objects.push_back(object);
+		}
+	};
+
+	AABB region = AABB(point - float3(radius), point + float3(radius));
+	VisitCells(&region, [&](int level, unsigned long long cellKey, unsigned firstItem)
+	{
+		if (LooseCellAABB(level, cellKey).Distance(point) <= radius)
+			addItems(firstItem);
+	});
+	addItems(firstOversizedItem);
+
+	std::sort(objects.begin(), objects.end());
+
+	return;
+}
+
+void SpatialHashGrid::Draw() const
+{
+	for(int level = 0; level < GRID_LEVELS; ++level)
+	{
+		float cellSize = GRID_BASE_CELL_SIZE * (1 << level);
+		for(const auto& cell : cells[level])
+		{
+			long long x, y, z;
+			UnpackCell(cell.first, x, y, z);
+			float3 minPoint = float3((float)x, (float)y, (float)z) * cellSize;
+			dd::aabb(minPoint, minPoint + float3(cellSize), float3(0.5f, 1.0f, 0.5f));
+		}
+	}
+
+	return;
+}
+
+unsigned SpatialHashGrid::UsedCells() const
+{
+	unsigned usedCells = 0;
+	for(int level = 0; level < GRID_LEVELS; ++level)
+	{
+		usedCells += cells[level].size();
+	}
+
+	return usedCells;
+}
+
+bool SpatialHashGrid::ComputeCell(const AABB & aabb, int & level, unsigned long long & cellKey) const
+{
+	if (!aabb.IsFinite())
+		return false;
+
+	float extent = aabb.Size().MaxElement();
+	float cellSize = GRID_BASE_CELL_SIZE;
+	for(level = 0; level < GRID_LEVELS; ++level, cellSize *= 2.0f)
+	{
+		if (extent <= cellSize)
+			break;
+	}
+
+	if (level == GRID_LEVELS)
+		return false;
+
+	float3 center = aabb.CenterPoint();
+	long long x = (long long)floor(center.x / cellSize);
+	long long y = (long long)floor(center.y / cellSize);
+	long long z = (long long)floor(center.z / cellSize);
+	if (!IsValidCell(x, y, z))
+		return false;
+
+	cellKey = PackCell(x, y, z);
+
+	return true;
+}
+
+AABB SpatialHashGrid::LooseCellAABB(int level, unsigned long long cellKey) const
+{
+	float cellSize = GRID_BASE_CELL_SIZE * (1 << level);
+	long long x, y, z;
+	UnpackCell(cellKey, x, y, z);
+
+	float3 minPoint = float3((float)x, (float)y, (float)z) * cellSize;
+	float3 halfCell = float3(cellSize * 0.5f);
+
+	return AABB(minPoint - halfCell, minPoint + float3(cellSize) + halfCell);
+}
+
+template<class Visitor>
+void SpatialHashGrid::VisitCells(const AABB * region, Visitor visit) const
+{
+	for(int level = 0; level < GRID_LEVELS; ++level)
+	{
+		if (levelCounts[level] == 0)
+			continue;
+
+		float cellSize = GRID_BASE_CELL_SIZE * (1 << level);
+		long long minCell[3], maxCell[3];
+		double rangeCount = 1.0;
+		if (region != nullptr)
+		{
+			//Cells whose loose bounds can reach the region
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				//Clamped before the conversion, regions can be infinite
+				minCell[axis] = (long long)std::max(floor((region->minPoint[axis] - 1.5 * cellSize) / cellSize), (double)-GRID_COORDINATE_BIAS);
+				maxCell[axis] = (long long)std::min(floor((region->maxPoint[axis] + 0.5 * cellSize) / cellSize), (double)GRID_COORDINATE_BIAS - 1);
+				rangeCount *= (double)std::max(maxCell[axis] - minCell[axis] + 1, 0LL);
+			}
+		}
+
+		//Big regions go through the occupied cells instead of looking up every cell of the range
+		if (region == nullptr || rangeCount > (double)cells[level].size())
+		{
+			for(const auto& cell : cells[level])
+			{
+				if (region == nullptr || region->Intersects(LooseCellAABB(level, cell.first)))
+					visit(level, cell.first, cell.second);
+			}
+			continue;
+		}
+
+		for(long long x = minCell[0]; x <= maxCell[0]; ++x)
+		for(long long y = minCell[1]; y <= maxCell[1]; ++y)
+		for(long long z = minCell[2]; z <= maxCell[2]; ++z)
+		{
+			auto cell = cells[level].find(PackCell(x, y, z));
+			if (cell != cells[level].end())
+				visit(level, cell->first, cell->second);
+		}
+	}
+
+	return;
+}
+
+template<class Visitor>
+void SpatialHashGrid::WalkRay(const LineSegment & ray, int level, Visitor visit) const
+{
+	//3D DDA over the segment, entry is the position along the segment where the cell starts
+	float cellSize = GRID_BASE_CELL_SIZE * (1 << level);
+	float3 direction = ray.b - ray.a;
+
+	long long cell[3];
+	int step[3];
+	float nextBoundary[3];
+	float boundaryDelta[3];
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		cell[axis] = (long long)floor(ray.a[axis] / cellSize);
+		if (direction[axis] > 0.0f)
+		{
+			step[axis] = 1;
+			nextBoundary[axis] = ((cell[axis] + 1) * cellSize - ray.a[axis]) / direction[axis];
+			boundaryDelta[axis] = cellSize / direction[axis];
+		}
+		else if (direction[axis] < 0.0f)
+		{
+			step[axis] = -1;
+			nextBoundary[axis] = (cell[axis] * cellSize - ray.a[axis]) / direction[axis];
+			boundaryDelta[axis] = -cellSize / direction[axis];
+		}
+		else
+		{
+			step[axis] = 0;
+			nextBoundary[axis] = std::numeric_limits<float>::max();
+			boundaryDelta[axis] = std::numeric_limits<float>::max();
+		}
+	}
+
+	float entry = 0.0f;
+	while (visit(cell[0], cell[1], cell[2], entry))
+	{
+		int axis = (nextBoundary[0] < nextBoundary[1]) ? ((nextBoundary[0] < nextBoundary[2]) ? 0 : 2) : ((nextBoundary[1] < nextBoundary[2]) ? 1 : 2);
+		if (nextBoundary[axis] > 1.0f)
+			break;
+
+		entry = nextBoundary[axis];
+		cell[axis] += step[axis];
+		nextBoundary[axis] += boundaryDelta[axis];
+	}
+
+	return;
+}
+
+void SpatialHashGrid::LinkItem(unsigned itemIndex)
+{
+	GridItem& item = items[itemIndex];
+	item.previousItem = GRID_NULL_ITEM;
+
+	if (item.level == GRID_LEVELS)
+	{
+		item.nextItem = firstOversizedItem;
+		if (firstOversizedItem != GRID_NULL_ITEM)
+			items[firstOversizedItem].previousItem = itemIndex;
+		firstOversizedItem = itemIndex;
+
+		return;
+	}
+
+	unsigned& firstItem = cells[item.level].emplace(item.cellKey, GRID_NULL_ITEM).first->second;
+	item.nextItem = firstItem;
+	if (firstItem != GRID_NULL_ITEM)
+		items[firstItem].previousItem = itemIndex;
+	firstItem = itemIndex;
+	++levelCounts[item.level];
+
+	return;
+}
+
+void SpatialHashGrid::UnlinkItem(unsigned itemIndex)
+{
+	GridItem& item = items[itemIndex];
+
+	if (item.previousItem != GRID_NULL_ITEM)
+	{
+		items[item.previousItem].nextItem = item.nextItem;
+	}
+	else if (item.level == GRID_LEVELS)
+	{
+		firstOversizedItem = item.nextItem;
+	}
+	else
+	{
+		//Empty cells are erased so the occupied ones can be iterated
+		auto cell = cells[item.level].find(item.cellKey);
+		if (item.nextItem == GRID_NULL_ITEM)
+			cells[item.level].erase(cell);
+		else
+			cell->second = item.nextItem;
+	}
+
+	if (item.nextItem != GRID_NULL_ITEM)
+		items[item.nextItem].previousItem = item.previousItem;
+
+	if (item.level < GRID_LEVELS)
+		--levelCounts[item.level];
+
+	item.previousItem = GRID_NULL_ITEM;
+	item.nextItem = GRID_NULL_ITEM;
+
+	return;
+}
@@ -0,0 +1,94 @@
+#ifndef __SpatialHashGrid_H__
+#define __SpatialHashGrid_H__
+
+#include "Globals.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include "MathGeoLib/Geometry/LineSegment.h"
+#include "MultiViewCuller.h"
+#include "VisibleList.h"
+#include "SpatialQuery.h"
+#include <vector>
+#include <unordered_map>
+
+#define GRID_NULL_ITEM 0xffffffff
+//Cell size of the finest level, every level doubles it
+#define GRID_BASE_CELL_SIZE 2.0f
+#define GRID_LEVELS 10
+//Cell coordinates are packed in 21 bits each, objects farther away are kept with the oversized ones
+#define GRID_COORDINATE_BIAS (1 << 20)
+
+class GameObject;
+
+struct GridItem
+{
+	GameObject* go = nullptr;
+	//GRID_LEVELS for the objects that don't fit in any level
+	int level = 0;
+	unsigned long long cellKey = 0;
+	unsigned previousItem = GRID_NULL_ITEM;
+	unsigned nextItem = GRID_NULL_ITEM;
+};
+
+//Multi-level spatial hash grid for objects that move every frame
+//An object is stored once, in the cell of its center at the first level whose cells are as big as the object, so
+//it never leaves the cell grown by half a cell on each side. Only occupied cells exist, in a hash map per level.
+//Moving an object is O(1): nothing is done while its center stays in the same cell, otherwise it is unlinked and
+//linked again. Queries test the live object boxes where the AABBTree tests its fat leaves, so box and ray results are
+//the exact subset of the tree ones.
+class SpatialHashGrid
+{
+public:
+	SpatialHashGrid() = default;
+	~SpatialHashGrid() = default;
+
+	//The item index is kept in GameObject::gridItemIndex so an object can only be in one grid
+	void Insert(GameObject* go);
+	void Remove(GameObject* go);
+	void UpdateObject(GameObject* go);
+	void UpdateObjects(const std::vector<GameObject*> &movedObjects);
+	//Removes everything and inserts the objects
+	void Build(const std::vector<GameObject*> &objects);
+
+	void GetIntersection(VisibleList &intersectionGO, const AABB* bbox) const;
+	void GetIntersection(VisibleList &intersectionGO, const LineSegment* ray) const;
+	void GetIntersection(VisibleList &intersectionGO, const MultiViewCuller &views) const;
+	//Same as AABBTree::RayCast, cells are walked along the ray and hitDistance is along the segment in [0, 1]
+	GameObject* RayCast(const LineSegment &ray, float &hitDistance) const;
+	//Same as the AABBTree packet query, safe to call from several threads
+	void RayCast(const LineSegment* rays, RayHit* hits, unsigned count) const;
+	//Same as the AABBTree nearest queries, rings of cells are visited around the point at each level. Thread safe
+	unsigned GetNearest(const float3 &point, unsigned k, float maxDistance, NearestObject* nearest, unsigned count = 0) const;
+	void GetWithinRadius(const float3 &point, float radius, std::vector<NearestObject> &objects) const;
+
+	void Draw() const;
+
+	unsigned Size() const { return itemCount; }
+	unsigned UsedCells() const;
+
+	//Objects that changed cell in UpdateObject since last reset
+	unsigned cellChangeCount = 0;
+
+private:
+	//Level of the box and key of the cell of its center, false if it is oversized
+	bool ComputeCell(const AABB &aabb, int &level, unsigned long long &cellKey) const;
+	AABB LooseCellAABB(int level, unsigned long long cellKey) const;
+	//Calls visit(level, cellKey, firstItem) for every occupied cell whose loose bounds intersect the region, all of them if it is null
+	template<class Visitor> void VisitCells(const AABB* region, Visitor visit) const;
+	//Walks the cells crossed by the ray in order, visit(cellX, cellY, cellZ, entry) returns false to stop
+	template<class Visitor> void WalkRay(const LineSegment &ray, int level, Visitor visit) const;
+	GameObject* RayCast(const LineSegment &ray, float &hitDistance, unsigned* triangle) const;
+
+	void LinkItem(unsigned itemIndex);
+	void UnlinkItem(unsigned itemIndex);
+
+	std::unordered_map<unsigned long long, unsigned> cells[GRID_LEVELS];
+	unsigned levelCounts[GRID_LEVELS] = {};
+	unsigned firstOversizedItem = GRID_NULL_ITEM;
+
+	std::vector<GridItem> items;
+	unsigned firstFreeItem = GRID_NULL_ITEM;
+	unsigned itemCount = 0;
+
+};
+
+#endif __SpatialHashGrid_H__
@@ -0,0 +1,51 @@
+#ifndef __SpatialQuery_H__
+#define __SpatialQuery_H__
+
+//Results shared by the queries of the spatial structures
+
+class GameObject;
+
+//Rays traced together by the packet queries of the spatial trees, one bit each in a 64 bit mask
+#define RAY_PACKET_SIZE 64
+
+//Nearest object hit by a ray
+struct RayHit
+{
+	GameObject* go = nullptr;
+	//Position along the segment in [0, 1], the end of the segment while nothing is hit
+	float distance = 1.0f;
+	//Triangle of the mesh, index of its first vertex index divided by 3
+	unsigned int triangle = 0xffffffff;
+};
+
+//Result of the nearest object queries, distance from the point to the object box, 0 inside it
+struct NearestObject
+{
+	GameObject* go = nullptr;
+	float distance = 0.0f;
+
+	bool operator<(const NearestObject &other) const { return distance < other.distance; }
+};
+
+//Adds an object to count objects sorted by distance keeping the k nearest, returns the new count
+inline unsigned int InsertNearest(NearestObject* nearest, unsigned int count, unsigned int k, GameObject* go, float distance)
+{
+	if (count == k)
+	{
+		if (distance >= nearest[k - 1].distance)
+			return count;
+		--count;
+	}
+
+	unsigned int i = count;
+	for(; i > 0 && nearest[i - 1].distance > distance; --i)
+	{
+		nearest[i] = nearest[i - 1];
+	}
+	nearest[i].go = go;
+	nearest[i].distance = distance;
+
+	return count + 1;
+}
+
+#endif __SpatialQuery_H__
@@ -0,0 +1,157 @@
+#include "Globals.h"
+#include "GameObject.h"
+#include "ComponentTransform.h"
+#include "ComponentMesh.h"
+#include "ComponentCamera.h"
+#include "TransformHierarchy.h"
+#include "MathGeoLib/Geometry/LineSegment.h"
+#include "MathGeoLib/Geometry/Sphere.h"
+#include <stdarg.h>
+#include <math.h>
+
+//Engine definitions the tested files link against, without the Application, the editor or OpenGL.
+//Parent links, bounds, culling groups and ray hits of GameObject are the engine ones, from GameObjectBounds.cpp.
+//Screen sizes and detail levels of the camera are from ComponentCameraDetail.cpp
+
+#define DEBUG_DRAW_IMPLEMENTATION
+#include "debugdraw.h"
+
+TransformHierarchy* Transforms = nullptr;
+
+void log(const char file[], int line, const char* format, ...)
+{
+	va_list arguments;
+	va_start(arguments, format);
+	vprintf(format, arguments);
+	va_end(arguments);
+	printf("\n");
+}
+
+GameObject::GameObject()
+{
+}
+
+GameObject::~GameObject()
+{
+	//Component has no virtual destructor, the test objects only have these two
+	delete myTransform;
+	delete myMesh;
+	delete boundingBox;
+	delete globalBoundingBox;
+}
+
+ComponentTransform::ComponentTransform(GameObject* gameObject)
+{
+	myGameObject = gameObject;
+	myType = TRANSFORM;
+	slot = Transforms->Add(this);
+	UpdateMatrices();
+}
+
+ComponentTransform::~ComponentTransform()
+{
+	Transforms->Remove(slot);
+}
+
+void ComponentTransform::UpdateMatrices()
+{
+	Transforms->UpdateSlot(slot);
+}
+
+void ComponentTransform::SetParent(const ComponentTransform* parentTransform)
+{
+	Transforms->SetParent(slot, (parentTransform != nullptr) ? parentTransform->slot : TRANSFORM_NULL_SLOT);
+}
+
+void ComponentTransform::OnSave(SceneLoader & loader)
+{
+}
+
+void ComponentTransform::OnLoad(SceneLoader & loader)
+{
+}
+
+void ComponentTransform::DrawInspector()
+{
+}
+
+//Test meshes have no Mesh, it needs OpenGL
+ComponentMesh::ComponentMesh(GameObject* go)
+{
+	myGameObject = go;
+	myType = MESH;
+	mesh = nullptr;
+}
+
+ComponentMesh::~ComponentMesh()
+{
+}
+
+float ComponentMesh::IsIntersectedByRay(const LineSegment & ray, unsigned int* triangle)
+{
+	//The triangles of a test mesh are the sphere inscribed in its local box
+	const AABB* box = myGameObject->boundingBox;
+	Sphere sphere(box->CenterPoint(), box->Size().MinElement() * 0.5f);
+	float distance;
+	if (!sphere.Intersects(ray, nullptr, nullptr, &distance))
+		return -1.0f;
+
+	if (triangle != nullptr)
+		*triangle = 0;
+
+	return (distance < 0.0f) ? 0.0f : distance;
+}
+
+void ComponentMesh::OnSave(SceneLoader & loader)
+{
+}
+
+void ComponentMesh::OnLoad(SceneLoader & loader)
+{
+}
+
+void ComponentMesh::DrawInspector()
+{
+}
+
+ComponentCamera::ComponentCamera(GameObject* go)
+{
+	myGameObject = go;
+	myType = CAMERA;
+
+	frustum = new Frustum();
+	frustum->type = FrustumType::PerspectiveFrustum;
+	frustum->pos = float3::zero;
+	frustum->front = -float3::unitZ;
+	frustum->up = float3::unitY;
+	frustum->nearPlaneDistance = 0.1f;
+	frustum->farPlaneDistance = 50.0f;
+	frustum->verticalFov = (float)M_PI / 4.0f;
+	frustum->horizontalFov = frustum->verticalFov;
+}
+
+ComponentCamera::~ComponentCamera()
+{
+	delete frustum;
+}
+
+void ComponentCamera::Update()
+{
+}
+
+bool ComponentCamera::CleanUp()
+{
+	return true;
+}
+
+void ComponentCamera::OnSave(SceneLoader & loader)
+{
+}
+
+void ComponentCamera::OnLoad(SceneLoader & loader)
+{
+}
+
+void ComponentCamera::DrawInspector()
+{
+}
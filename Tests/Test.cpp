@@ -0,0 +1,52 @@
+#include "Test.h"
+#include <stdio.h>
+#include <string.h>
+
+static unsigned int failedChecks = 0;
+
+TestRegistrar::TestRegistrar(const char* name, TestFunction function, bool isBenchmark)
+{
+	GetTestCases().push_back({ name, function, isBenchmark });
+}
+
+std::vector<TestCase>& GetTestCases()
+{
+	//Built on first use, the registrars of other files run before main in any order
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+bool ReportCheck(bool condition, const char* expression, const char* file, int line)
+{
+	if (!condition)
+	{
+		printf("%s(%d): CHECK(%s) failed\n", file, line, expression);
+		++failedChecks;
+	}
+
+	return condition;
+}
+
+int main(int argc, char** argv)
+{
+	bool runBenchmarks = argc > 1 && strcmp(argv[1], "benchmark") == 0;
+
+	unsigned int testCount = 0;
+	unsigned int failedTests = 0;
+	for(const auto& testCase : GetTestCases())
+	{
+		if (testCase.isBenchmark && !runBenchmarks)
+			continue;
+
+		++testCount;
+		unsigned int failedBefore = failedChecks;
+		testCase.function();
+		bool isPassed = failedChecks == failedBefore;
+		printf("%s %s\n", isPassed ? "[ OK ]" : "[FAIL]", testCase.name);
+		if (!isPassed)
+			++failedTests;
+	}
+
+	printf("%u failed of %u tests\n", failedTests, testCount);
+	return (failedTests == 0) ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+#ifndef __Test_H__
+#define __Test_H__
+
+#include <vector>
+
+//Test runner for the engine parts that work without the Application
+//Every TEST runs on each run, BENCHMARKs only when "benchmark" is passed. A failed CHECK prints the condition and
+//the test goes on, the run exits with 1 if any check failed.
+typedef void(*TestFunction)();
+
+struct TestCase
+{
+	const char* name;
+	TestFunction function;
+	bool isBenchmark;
+};
+
+class TestRegistrar
+{
+public:
+	TestRegistrar(const char* name, TestFunction function, bool isBenchmark);
+};
+
+std::vector<TestCase>& GetTestCases();
+bool ReportCheck(bool condition, const char* expression, const char* file, int line);
+
+#define TEST(name) static void name(); static TestRegistrar name##Registrar(#name, name, false); static void name()
+#define BENCHMARK(name) static void name(); static TestRegistrar name##Registrar(#name, name, true); static void name()
+//Returns the condition so a test can stop when the rest depends on it
+#define CHECK(condition) ReportCheck((condition), #condition, __FILE__, __LINE__)
+
+#endif __Test_H__
@@ -0,0 +1,190 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "AABBTree.h"
+#include "JobSystem.h"
+#include <math.h>
+
+//Random moves mixing refits with full reinsertions, the tree has to stay valid and its depth bounded
+TEST(AABBTreeStaysBalanced)
+{
+	const unsigned int objectCount = 5000;
+	const unsigned int cycles = 500;
+
+	std::mt19937 generator(objectCount);
+	std::uniform_real_distribution<float> movement(-5.0f, 5.0f);
+
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, objectCount, 500.0f, 0.5f, 10.0f, objects);
+
+	AABBTree tree(10);
+	for(auto go : objects)
+	{
+		tree.Insert(go);
+	}
+
+	//Balanced trees stay close to log2(n), a chain would be n
+	int maxDepth = 2 * (int)ceil(log2((float)objectCount)) + 2;
+	bool isValid = true;
+
+	for(unsigned int cycle = 0; cycle < cycles && isValid; ++cycle)
+	{
+		for(unsigned int i = 0; i < objectCount / 10 + 1; ++i)
+		{
+			GameObject* go = objects[generator() % objectCount];
+			go->globalBoundingBox->Translate(float3(movement(generator), movement(generator), movement(generator)));
+
+			if (generator() % 4 == 0)
+			{
+				tree.Remove(go);
+				tree.Insert(go);
+			}
+			else
+			{
+				tree.UpdateObject(go);
+			}
+		}
+
+		isValid = CHECK(tree.ComputeDepth() <= maxDepth) && CHECK(tree.ValidateTree());
+	}
+
+	DeleteObjects(objects);
+}
+
+//Each range writes its own nodes, the halves built as jobs give the same tree as a build on one thread
+TEST(AABBTreeParallelBuildMatchesSerial)
+{
+	const unsigned int objectCount = 20 * AABB_PARALLEL_THRESHOLD;
+
+	std::mt19937 generator(objectCount);
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, objectCount, 500.0f, 0.5f, 10.0f, objects);
+
+	AABBTree serialTree(10);
+	serialTree.Build(objects);
+	std::vector<unsigned int> serialNodes;
+	for(auto go : objects)
+	{
+		serialNodes.push_back(go->aabbTreeNodeIndex);
+	}
+
+	JobSystem jobs(3);
+	AABBTree tree(10);
+	tree.Build(objects, &jobs);
+	CHECK(tree.ValidateTree());
+	CHECK(tree.ComputeDepth() == serialTree.ComputeDepth());
+	CHECK(tree.ComputeSAHCost() == serialTree.ComputeSAHCost());
+	for(unsigned int i = 0; i < objectCount; ++i)
+	{
+		CHECK(objects[i]->aabbTreeNodeIndex == serialNodes[i]);
+	}
+
+	DeleteObjects(objects);
+}
+
+//Empty pools grow before their free list is linked
+TEST(AABBTreeGrowsEmptyPools)
+{
+	std::mt19937 generator(7);
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, 100, 50.0f, 0.5f, 5.0f, objects);
+
+	AABBTree tree(0);
+	for(auto go : objects)
+	{
+		tree.Insert(go);
+	}
+	CHECK(tree.ValidateTree());
+
+	AABBTree emptyBuild(0);
+	emptyBuild.Build(std::vector<GameObject*>());
+	for(auto go : objects)
+	{
+		tree.Remove(go);
+		emptyBuild.Insert(go);
+	}
+	CHECK(emptyBuild.ValidateTree());
+
+	DeleteObjects(objects);
+}
+
+//Moves inside the fat box keep the leaf, moves that stay in the parent refit it and the rest are reinserted
+TEST(AABBTreeUpdateObjectsPaths)
+{
+	std::vector<GameObject*> objects;
+	objects.push_back(CreateBoxObject(AABB(float3(0.0f), float3(1.0f))));
+	objects.push_back(CreateBoxObject(AABB(float3(10.0f), float3(11.0f))));
+	std::vector<GameObject*> moved = { objects[0] };
+
+	AABBTree tree(10);
+	tree.Build(objects);
+
+	//The fat box has a margin of a tenth of the size
+	objects[0]->globalBoundingBox->Translate(float3(0.05f, 0.0f, 0.0f));
+	tree.UpdateObjects(moved);
+	CHECK(tree.refitCount == 0 && tree.reinsertCount == 0);
+	CHECK(tree.ValidateTree());
+
+	//Out of the fat box, the new one stretched along the move is still inside the root
+	objects[0]->globalBoundingBox->Translate(float3(0.45f, 0.0f, 0.0f));
+	tree.UpdateObjects(moved);
+	CHECK(tree.refitCount == 1 && tree.reinsertCount == 0);
+	CHECK(tree.ValidateTree());
+
+	objects[0]->globalBoundingBox->Translate(float3(50.0f, 0.0f, 0.0f));
+	tree.UpdateObjects(moved);
+	CHECK(tree.refitCount == 0 && tree.reinsertCount == 1);
+	CHECK(tree.ValidateTree());
+
+	DeleteObjects(objects);
+}
+
+TEST(AABBTreeUpdateObjectsCounters)
+{
+	const unsigned int objectCount = 2000;
+	std::mt19937 generator(objectCount);
+	std::uniform_real_distribution<float> movement(-3.0f, 3.0f);
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, objectCount, 200.0f, 0.5f, 5.0f, objects);
+
+	AABBTree tree(10);
+	tree.Build(objects);
+	int depth = tree.ComputeDepth();
+
+	//Smaller than any margin
+	for(auto go : objects)
+	{
+		go->globalBoundingBox->Translate(float3(0.01f, 0.0f, -0.01f));
+	}
+	tree.UpdateObjects(objects);
+	CHECK(tree.refitCount == 0 && tree.reinsertCount == 0);
+	CHECK(tree.ComputeDepth() == depth);
+
+	//Far from every parent, all of them are reinserted
+	std::vector<GameObject*> jumped(objects.begin(), objects.begin() + objectCount / 10);
+	for(auto go : jumped)
+	{
+		go->globalBoundingBox->Translate(float3(10000.0f, 0.0f, 0.0f));
+	}
+	tree.UpdateObjects(jumped);
+	CHECK(tree.refitCount == 0 && tree.reinsertCount == jumped.size());
+	CHECK(tree.ValidateTree());
+
+	//Random moves mix the three paths
+	unsigned int refits = 0;
+	unsigned int reinserts = 0;
+	for(unsigned int frame = 0; frame < 20; ++frame)
+	{
+		for(auto go : objects)
+		{
+			go->globalBoundingBox->Translate(float3(movement(generator), movement(generator), movement(generator)));
+		}
+		tree.UpdateObjects(objects);
+		CHECK(tree.refitCount + tree.reinsertCount <= objectCount);
+		CHECK(tree.ValidateTree());
+		refits += tree.refitCount;
+		reinserts += tree.reinsertCount;
+	}
+	CHECK(refits > 0 && reinserts > 0 && refits + reinserts < 20 * objectCount);
+
+	DeleteObjects(objects);
+}
@@ -0,0 +1,98 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "AABBTree.h"
+#include "SpatialHashGrid.h"
+#include "VisibleList.h"
+#include "uSTimer.h"
+#include <math.h>
+#include <algorithm>
+
+//Every cube moves along x as in ModuleScene::MoveObjects, both structures are updated and queried around a moving
+//point every frame, as picking and culling do. Returns false if their results differ
+static bool MoveCubes(unsigned int objectCount, unsigned int frames, float &treeTime, float &gridTime, unsigned int &cellChanges)
+{
+	std::mt19937 generator(objectCount);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::vector<GameObject*> objects;
+	CreateCubes(generator, objectCount, objects);
+
+	AABBTree tree(10);
+	tree.Build(objects);
+	SpatialHashGrid grid;
+	grid.Build(objects);
+
+	VisibleList results;
+	std::vector<GameObject*> treeResults;
+	std::vector<GameObject*> gridResults;
+	uSTimer timer;
+	treeTime = 0.0f;
+	gridTime = 0.0f;
+	bool isValid = true;
+
+	for(unsigned int frame = 0; frame < frames; ++frame)
+	{
+		float dist = 3.0f * sin(frame * 0.05f);
+		for(auto go : objects)
+		{
+			go->globalBoundingBox->Translate(float3(dist, 0.0f, 0.0f));
+		}
+
+		float3 queryCenter = float3(position(generator), 0.0f, position(generator));
+		AABB query = AABB(queryCenter - float3(20.0f), queryCenter + float3(20.0f));
+
+		timer.StartTimer();
+		tree.UpdateObjects(objects);
+		results.Begin();
+		tree.GetIntersection(results, &query);
+		treeTime += timer.StopTimer();
+
+		//Tree leaves are fat, only the objects whose own box is hit are compared
+		treeResults.clear();
+		for(auto go : results)
+		{
+			if (query.Intersects(*go->globalBoundingBox))
+				treeResults.push_back(go);
+		}
+
+		timer.StartTimer();
+		grid.UpdateObjects(objects);
+		results.Begin();
+		grid.GetIntersection(results, &query);
+		gridTime += timer.StopTimer();
+		gridResults.assign(results.begin(), results.end());
+
+		std::sort(treeResults.begin(), treeResults.end());
+		std::sort(gridResults.begin(), gridResults.end());
+		isValid = isValid && treeResults == gridResults;
+	}
+
+	isValid = isValid && tree.ValidateTree();
+	cellChanges = grid.cellChangeCount;
+	DeleteObjects(objects);
+
+	return isValid;
+}
+
+TEST(BroadphasesMatchOnMovingCubes)
+{
+	float treeTime;
+	float gridTime;
+	unsigned int cellChanges;
+	CHECK(MoveCubes(2000, 60, treeTime, gridTime, cellChanges));
+	//The cubes crossed cells
+	CHECK(cellChanges > 0);
+}
+
+BENCHMARK(Broadphases)
+{
+	const unsigned int objectCount = 10000;
+	const unsigned int frames = 300;
+
+	float treeTime;
+	float gridTime;
+	unsigned int cellChanges;
+	CHECK(MoveCubes(objectCount, frames, treeTime, gridTime, cellChanges));
+
+	printf("%u moving cubes, %u frames. AABBTree %.3f ms/frame, grid %.3f ms/frame, %u cell changes\n", objectCount, frames,
+		treeTime / frames, gridTime / frames, cellChanges);
+}
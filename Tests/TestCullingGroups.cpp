@@ -0,0 +1,281 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "AABBTree.h"
+#include "MultiViewCuller.h"
+#include "VisibleList.h"
+#include "ComponentTransform.h"
+#include "MathGeoLib/Geometry/LineSegment.h"
+#include "MathGeoLib/Geometry/OBB.h"
+#include "MathGeoLib/Math/Quat.h"
+#include "MathGeoLib/Math/TransformOps.h"
+#include <algorithm>
+
+static bool SameBox(const AABB &a, const AABB &b)
+{
+	return a.minPoint.Equals(b.minPoint, 1e-4f) && a.maxPoint.Equals(b.maxPoint, 1e-4f);
+}
+
+static bool Contains(const std::vector<GameObject*> &objects, const GameObject* go)
+{
+	return std::find(objects.begin(), objects.end(), go) != objects.end();
+}
+
+//Model root without mesh, as the model loader creates it, with a mesh child on each box
+static GameObject* CreateModel(const std::vector<AABB> &meshBoxes, std::vector<GameObject*> &objects)
+{
+	GameObject* model = CreateBoxObject(AABB(float3(-1.0f), float3(1.0f)));
+	objects.push_back(model);
+	for(const auto& box : meshBoxes)
+	{
+		GameObject* mesh = CreateMeshObject(box);
+		mesh->SetParent(model);
+		objects.push_back(mesh);
+	}
+
+	return model;
+}
+
+//Meshes of a model root leave the trees and the root encloses them, meshes of the scene root or of another mesh don't
+TEST(CullingGroupsEncloseMeshes)
+{
+	TestTransforms transforms;
+	std::vector<GameObject*> objects;
+	AABB boxA(float3(-4.0f, 0.0f, 0.0f), float3(-2.0f, 2.0f, 2.0f));
+	AABB boxB(float3(3.0f, -1.0f, 5.0f), float3(5.0f, 1.0f, 9.0f));
+
+	GameObject* empty = CreateBoxObject(AABB(float3(0.0f), float3(1.0f)));
+	objects.push_back(empty);
+	GameObject* meshA = CreateMeshObject(boxA);
+	GameObject* meshB = CreateMeshObject(boxB);
+	objects.push_back(meshA);
+	objects.push_back(meshB);
+	CHECK(!meshA->IsCulledWithParent());
+
+	//Loaded at the scene root before they are parented, every object is in the tree
+	AABBTree tree(10);
+	tree.Build(objects);
+	GameObject* model = CreateBoxObject(AABB(float3(-1.0f), float3(1.0f)));
+	objects.push_back(model);
+	tree.Insert(model);
+
+	empty->SetParent(model);
+	CHECK(!model->isParentOfMeshes);
+	meshA->SetParent(model);
+	meshB->SetParent(model);
+	CHECK(model->isParentOfMeshes && model->children.size() == 3);
+	CHECK(meshA->IsCulledWithParent() && meshB->IsCulledWithParent());
+	CHECK(!empty->IsCulledWithParent());
+
+	std::vector<GameObject*> leaving;
+	std::vector<GameObject*> joining;
+	model->UpdateCullingGroup(leaving, joining);
+	CHECK(leaving.size() == 2 && Contains(leaving, meshA) && Contains(leaving, meshB));
+	CHECK(joining.empty());
+	AABB enclosed = boxA;
+	enclosed.Enclose(boxB);
+	CHECK(SameBox(*model->globalBoundingBox, enclosed));
+
+	//Taken out of the tree, nothing left to move
+	for(auto go : leaving)
+	{
+		tree.Remove(go);
+		CHECK(!go->IsInSpatialStructures());
+	}
+	CHECK(empty->IsInSpatialStructures() && model->IsInSpatialStructures());
+	leaving.clear();
+	model->UpdateCullingGroup(leaving, joining);
+	CHECK(leaving.empty() && joining.empty());
+
+	//Parents of meshes keep the enclosing box in their own bounds update
+	model->UpdateBoundingBox(float4x4::Translate(float3(100.0f)));
+	CHECK(SameBox(*model->globalBoundingBox, enclosed));
+
+	//A moved mesh updates its own box from its transform, the parent encloses it again
+	meshB->myTransform->SetPosition(boxB.CenterPoint() + float3(0.0f, 10.0f, 0.0f));
+	meshB->myTransform->SetRotation(Quat::RotateY(0.785398f));
+	meshB->myTransform->UpdateMatrices();
+	meshB->UpdateBoundingBox();
+	OBB rotated = meshB->boundingBox->Transform(meshB->myTransform->GetGlobalMatrix());
+	CHECK(SameBox(*meshB->globalBoundingBox, rotated.MinimalEnclosingAABB()));
+	CHECK(meshB->globalBoundingBox->Volume() > boxB.Volume() * 1.2f);
+	model->UpdateCullingGroup(leaving, joining);
+	CHECK(leaving.empty() && joining.empty());
+	CHECK(model->globalBoundingBox->Contains(*meshA->globalBoundingBox) && model->globalBoundingBox->Contains(*meshB->globalBoundingBox));
+	CHECK(model->globalBoundingBox->maxPoint.y == meshB->globalBoundingBox->maxPoint.y);
+
+	//A mesh under another mesh is culled on its own
+	GameObject* nested = CreateMeshObject(AABB(float3(20.0f), float3(21.0f)));
+	objects.push_back(nested);
+	nested->SetParent(meshA);
+	CHECK(meshA->isParentOfMeshes && !nested->IsCulledWithParent());
+	model->UpdateCullingGroup(leaving, joining);
+	meshA->UpdateCullingGroup(leaving, joining);
+	CHECK(leaving.empty() && joining.size() == 1 && joining[0] == nested);
+
+	//The scene root doesn't group its meshes, they join the trees again
+	joining.clear();
+	model->isRoot = true;
+	CHECK(!meshA->IsCulledWithParent() && !meshB->IsCulledWithParent());
+	AABB modelBox = *model->globalBoundingBox;
+	model->UpdateCullingGroup(leaving, joining);
+	CHECK(leaving.empty() && joining.size() == 2 && Contains(joining, meshA) && Contains(joining, meshB));
+	CHECK(SameBox(*model->globalBoundingBox, modelBox));
+	model->isRoot = false;
+
+	//Moved to another parent
+	GameObject* other = CreateBoxObject(AABB(float3(-1.0f), float3(1.0f)));
+	objects.push_back(other);
+	meshA->SetParent(other);
+	CHECK(model->children.size() == 2 && other->children.size() == 1 && meshA->parent == other);
+	CHECK(Transforms->GetParent(meshA->myTransform->slot) == TRANSFORM_NULL_SLOT);
+	joining.clear();
+	model->UpdateCullingGroup(leaving, joining);
+	CHECK(SameBox(*model->globalBoundingBox, *meshB->globalBoundingBox));
+
+	DeleteObjects(objects);
+}
+
+static Frustum CreateView(const float3 &pos, const float3 &front)
+{
+	Frustum frustum;
+	frustum.type = FrustumType::PerspectiveFrustum;
+	frustum.pos = pos;
+	frustum.front = front.Normalized();
+	frustum.up = frustum.front.Perpendicular();
+	frustum.nearPlaneDistance = 0.1f;
+	frustum.farPlaneDistance = 100.0f;
+	frustum.verticalFov = 1.0f;
+	frustum.horizontalFov = 1.0f;
+
+	return frustum;
+}
+
+//Views the parent is inside accept its meshes, views it crosses test them, views that don't see it skip them
+TEST(CullingGroupsFollowParentViews)
+{
+	TestTransforms transforms;
+	std::vector<GameObject*> objects;
+
+	//Meshes inside, crossing the right plane and out of the view looking down z
+	std::vector<AABB> meshBoxes;
+	meshBoxes.push_back(AABB(float3(-1.0f, -1.0f, 40.0f), float3(1.0f, 1.0f, 42.0f)));
+	meshBoxes.push_back(AABB(float3(20.0f, -1.0f, 40.0f), float3(24.0f, 1.0f, 42.0f)));
+	meshBoxes.push_back(AABB(float3(60.0f, -1.0f, 40.0f), float3(62.0f, 1.0f, 42.0f)));
+	meshBoxes.push_back(AABB(float3(-1.0f, -1.0f, 45.0f), float3(1.0f, 1.0f, 46.0f)));
+	GameObject* model = CreateModel(meshBoxes, objects);
+	std::vector<GameObject*> leaving;
+	std::vector<GameObject*> joining;
+	model->UpdateCullingGroup(leaving, joining);
+	GameObject* inside = model->children[0];
+	GameObject* crossing = model->children[1];
+	GameObject* outside = model->children[2];
+	GameObject* disabled = model->children[3];
+	disabled->isEnabled = false;
+
+	//View 0 crosses the model, view 1 from far away has it inside, view 2 looks away
+	MultiViewCuller views;
+	views.AddView(CreateView(float3(0.0f), float3(0.0f, 0.0f, 1.0f)));
+	views.AddView(CreateView(float3(20.0f, 0.0f, -40.0f), float3(0.0f, 0.0f, 1.0f)));
+	views.AddView(CreateView(float3(0.0f), float3(0.0f, 0.0f, -1.0f)));
+	ViewMasks modelMasks = views.TestAABB(*model->globalBoundingBox);
+	CHECK(modelMasks.visible == 3 && modelMasks.inside == 2);
+
+	VisibleList visible;
+	visible.Begin();
+	visible.Add(model, modelMasks.visible, modelMasks.inside);
+	ViewCullPlanes cullPlanes;
+	unsigned int testedCount = 0;
+	unsigned int acceptedCount = 0;
+	model->CullChildren(views, cullPlanes, visible, testedCount, acceptedCount);
+	CHECK(testedCount == 3 && acceptedCount == 3);
+
+	//Views the model crosses are exact, the view it is inside sees every enabled mesh
+	CHECK(visible.Size() == 4 && !visible.Contains(disabled));
+	for(auto mesh : { inside, crossing, outside })
+	{
+		ViewMasks expected = views.TestAABB(*mesh->globalBoundingBox);
+		CHECK(visible.Contains(mesh));
+		CHECK(mesh->visibleViews == (expected.visible | 2) && mesh->insideViews == (expected.inside | 2));
+	}
+	CHECK(inside->visibleViews == 3 && inside->insideViews == 3);
+	CHECK(crossing->visibleViews == 3 && crossing->insideViews == 2);
+	CHECK(outside->visibleViews == 2);
+
+	//Only crossed, the meshes out of the view are dropped
+	visible.Begin();
+	visible.Add(model, 1, 0);
+	testedCount = 0;
+	acceptedCount = 0;
+	model->CullChildren(views, cullPlanes, visible, testedCount, acceptedCount);
+	CHECK(testedCount == 3 && acceptedCount == 0);
+	CHECK(visible.Size() == 3 && visible.Contains(inside) && visible.Contains(crossing) && !visible.Contains(outside));
+	CHECK(inside->insideViews == 1 && crossing->visibleViews == 1 && crossing->insideViews == 0);
+
+	//Only inside, nothing is tested
+	visible.Begin();
+	visible.Add(model, 2, 2);
+	testedCount = 0;
+	model->CullChildren(views, cullPlanes, visible, testedCount, acceptedCount);
+	CHECK(testedCount == 0 && acceptedCount == 3 && visible.Size() == 4);
+
+	//Not seen, nothing is tested or added
+	model->visibleViews = 0;
+	model->insideViews = 0;
+	visible.Begin();
+	testedCount = 0;
+	acceptedCount = 0;
+	model->CullChildren(views, cullPlanes, visible, testedCount, acceptedCount);
+	CHECK(testedCount == 0 && acceptedCount == 0 && visible.Size() == 0);
+
+	DeleteObjects(objects);
+}
+
+//Rays hit the meshes of a model through the model in the tree, the nearest mesh is the hit object
+TEST(CullingGroupsRayHits)
+{
+	TestTransforms transforms;
+	std::vector<GameObject*> objects;
+	std::vector<AABB> meshBoxes;
+	meshBoxes.push_back(AABB(float3(-1.0f, -1.0f, 10.0f), float3(1.0f, 1.0f, 12.0f)));
+	meshBoxes.push_back(AABB(float3(-1.0f, -1.0f, 20.0f), float3(1.0f, 1.0f, 22.0f)));
+	meshBoxes.push_back(AABB(float3(10.0f, -1.0f, 20.0f), float3(12.0f, 1.0f, 22.0f)));
+	GameObject* model = CreateModel(meshBoxes, objects);
+	std::vector<GameObject*> leaving;
+	std::vector<GameObject*> joining;
+	model->UpdateCullingGroup(leaving, joining);
+
+	AABBTree tree(10);
+	std::vector<GameObject*> inTree;
+	inTree.push_back(model);
+	tree.Build(inTree);
+
+	//Through the two meshes on the z axis, the first one is hit
+	LineSegment ray(float3(0.0f, 0.0f, 0.0f), float3(0.0f, 0.0f, 40.0f));
+	float distance = 1.0f;
+	CHECK(tree.RayCast(ray, distance) == model->children[0]);
+	CHECK(fabsf(distance - 10.0f / 40.0f) < 1e-4f);
+
+	unsigned int triangle = 1;
+	GameObject* hitObject = nullptr;
+	CHECK(fabsf(model->IsIntersectedByRay(ray, &triangle, &hitObject) - 10.0f / 40.0f) < 1e-4f);
+	CHECK(hitObject == model->children[0] && triangle == 0);
+
+	//From between them, the one behind is nearer along the segment
+	ray = LineSegment(float3(0.0f, 0.0f, 15.0f), float3(0.0f, 0.0f, 35.0f));
+	distance = 1.0f;
+	CHECK(tree.RayCast(ray, distance) == model->children[1]);
+
+	//Local space of a moved mesh
+	ray = LineSegment(float3(11.0f, 0.0f, 0.0f), float3(11.0f, 0.0f, 40.0f));
+	distance = 1.0f;
+	CHECK(tree.RayCast(ray, distance) == model->children[2]);
+	CHECK(fabsf(distance - 20.0f / 40.0f) < 1e-4f);
+
+	//Inside the model box between its meshes
+	ray = LineSegment(float3(5.0f, 0.0f, 0.0f), float3(5.0f, 0.0f, 40.0f));
+	distance = 1.0f;
+	CHECK(tree.RayCast(ray, distance) == nullptr);
+	CHECK(model->IsIntersectedByRay(ray) < 0.0f);
+
+	DeleteObjects(objects);
+}
@@ -0,0 +1,259 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "ComponentCamera.h"
+#include "VisibleList.h"
+#include "Mesh.h"
+#include <math.h>
+#include <algorithm>
+
+//Camera at the origin looking down z, a vertical fov of 90 degrees puts the top of the screen at y = distance
+static ComponentCamera* CreateCamera()
+{
+	ComponentCamera* camera = new ComponentCamera(nullptr);
+	camera->frustum->front = float3::unitZ;
+	camera->frustum->farPlaneDistance = 2000.0f;
+	camera->frustum->verticalFov = (float)M_PI / 2.0f;
+	camera->frustum->horizontalFov = (float)M_PI / 2.0f;
+
+	return camera;
+}
+
+//Mesh whose bounding sphere, as SelectDetailLevels takes it, has radius 1 and is centered at distance along z
+static GameObject* CreateMeshAt(float distance)
+{
+	float3 center = float3(0.0f, 0.0f, distance);
+	float3 halfSize = float3(1.0f / sqrtf(3.0f));
+	return CreateMeshObject(AABB(center - halfSize, center + halfSize));
+}
+
+TEST(DetailLevelsScreenSize)
+{
+	ComponentCamera* camera = CreateCamera();
+
+	//Projected diameter: the radius over the half height of the view at that distance
+	CHECK(fabsf(camera->ScreenSize(float3(0.0f, 0.0f, 10.0f), 1.0f, 1000) - 100.0f) < 1e-2f);
+	CHECK(fabsf(camera->ScreenSize(float3(0.0f, 0.0f, 20.0f), 1.0f, 1000) - 50.0f) < 1e-2f);
+	CHECK(fabsf(camera->ScreenSize(float3(0.0f, 0.0f, 20.0f), 2.0f, 500) - 50.0f) < 1e-2f);
+	//Only the distance counts, not the direction
+	CHECK(fabsf(camera->ScreenSize(float3(0.0f, 10.0f, 0.0f), 1.0f, 1000) - 100.0f) < 1e-2f);
+
+	//A narrower fov magnifies
+	camera->frustum->verticalFov = 2.0f * atanf(0.5f);
+	CHECK(fabsf(camera->ScreenSize(float3(0.0f, 0.0f, 10.0f), 1.0f, 1000) - 200.0f) < 1e-2f);
+
+	//Inside the sphere it covers the whole screen
+	CHECK(camera->ScreenSize(float3(0.0f, 0.0f, 0.5f), 1.0f, 1000) == 1000.0f);
+
+	//Orthographic sizes don't depend on the distance
+	camera->frustum->type = FrustumType::OrthographicFrustum;
+	camera->frustum->orthographicWidth = 20.0f;
+	camera->frustum->orthographicHeight = 20.0f;
+	CHECK(fabsf(camera->ScreenSize(float3(0.0f, 0.0f, 10.0f), 1.0f, 1000) - 100.0f) < 1e-2f);
+	CHECK(fabsf(camera->ScreenSize(float3(0.0f, 0.0f, 1000.0f), 1.0f, 1000) - 100.0f) < 1e-2f);
+
+	delete camera;
+}
+
+TEST(DetailLevelsThresholds)
+{
+	ComponentCamera* camera = CreateCamera();
+	CHECK(camera->lodScreenSizes[0] == 150.0f && camera->lodScreenSizes[1] == 40.0f);
+
+	CHECK(camera->DetailLevel(1000.0f) == 0);
+	CHECK(camera->DetailLevel(150.0f) == 0);
+	CHECK(camera->DetailLevel(149.0f) == 1);
+	CHECK(camera->DetailLevel(40.0f) == 1);
+	CHECK(camera->DetailLevel(39.0f) == 2);
+	CHECK(camera->DetailLevel(0.0f) == MESH_LOD_LEVELS - 1);
+
+	delete camera;
+}
+
+//Meshes at a few distances from the camera of view 1, the objects are also seen by view 2
+TEST(DetailLevelsSelectedByDistance)
+{
+	TestTransforms transforms;
+	ComponentCamera* camera = CreateCamera();
+	std::vector<GameObject*> objects;
+	//200, 100 and 20 pixels, then 1 pixel, below minScreenSize
+	objects.push_back(CreateMeshAt(5.0f));
+	objects.push_back(CreateMeshAt(10.0f));
+	objects.push_back(CreateMeshAt(50.0f));
+	objects.push_back(CreateMeshAt(1000.0f));
+	//Objects without mesh still have to be drawn
+	objects.push_back(CreateBoxObject(AABB(float3(-0.1f, -0.1f, 1000.0f), float3(0.1f, 0.1f, 1000.2f))));
+	//Not seen by view 1
+	objects.push_back(CreateMeshAt(1000.0f));
+
+	VisibleList visible;
+	visible.Begin();
+	for(unsigned int i = 0; i + 1 < objects.size(); ++i)
+	{
+		visible.Add(objects[i], 3, 0);
+	}
+	visible.Add(objects.back(), 2, 0);
+
+	std::vector<unsigned char> detailLevels;
+	unsigned int culledCount = 0;
+	unsigned int levelCounts[MESH_LOD_LEVELS] = { 0 };
+	camera->SelectDetailLevels(visible, 1, 1000, detailLevels, culledCount, levelCounts);
+	CHECK(detailLevels.size() == objects.size());
+	CHECK(detailLevels[0] == 0 && detailLevels[1] == 1 && detailLevels[2] == 2);
+	CHECK(levelCounts[0] == 1 && levelCounts[1] == 1 && levelCounts[2] == 1);
+
+	//The small mesh is dropped from view 1 only, the others keep their views
+	CHECK(culledCount == 1 && objects[3]->visibleViews == 2);
+	CHECK(objects[0]->visibleViews == 3 && objects[2]->visibleViews == 3);
+	CHECK(detailLevels[4] == 0 && objects[4]->visibleViews == 3);
+	CHECK(detailLevels[5] == 0 && objects[5]->visibleViews == 2);
+
+	//Counts add up over the views, a bigger viewport shows more detail
+	camera->SelectDetailLevels(visible, 2, 4000, detailLevels, culledCount, levelCounts);
+	CHECK(detailLevels[0] == 0 && detailLevels[1] == 0 && detailLevels[2] == 1 && detailLevels[3] == 2);
+	CHECK(detailLevels[5] == 2 && culledCount == 1);
+	CHECK(levelCounts[0] == 3 && levelCounts[1] == 2 && levelCounts[2] == 3);
+
+	//Moved thresholds
+	camera->lodScreenSizes[0] = 90.0f;
+	camera->minScreenSize = 30.0f;
+	camera->SelectDetailLevels(visible, 2, 1000, detailLevels, culledCount, levelCounts);
+	CHECK(detailLevels[0] == 0 && detailLevels[1] == 0);
+	CHECK(culledCount == 4 && objects[2]->visibleViews == 1 && objects[3]->visibleViews == 0 && objects[5]->visibleViews == 0);
+
+	//Without screen size culling every object keeps its views at full detail
+	camera->screenSizeCulling = false;
+	objects[3]->visibleViews = 3;
+	camera->SelectDetailLevels(visible, 1, 1000, detailLevels, culledCount, levelCounts);
+	CHECK(detailLevels.size() == objects.size() && culledCount == 4 && objects[3]->visibleViews == 3);
+	for(auto level : detailLevels)
+	{
+		CHECK(level == 0);
+	}
+
+	//Nor with an empty viewport
+	camera->screenSizeCulling = true;
+	camera->SelectDetailLevels(visible, 1, 0, detailLevels, culledCount, levelCounts);
+	CHECK(culledCount == 4 && objects[3]->visibleViews == 3);
+
+	DeleteObjects(objects);
+	delete camera;
+}
+
+static Vertex CreateVertex(const float3 &position)
+{
+	Vertex vertex;
+	vertex.Position = position;
+	vertex.Normal = float3::unitY;
+	vertex.TexCoords = float2::zero;
+
+	return vertex;
+}
+
+//Levels follow each other in the indices, without triangles with two equal corners
+static void CheckDetailLevels(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<unsigned int> &allIndices,
+	const unsigned int lodOffset[MESH_LOD_LEVELS], const unsigned int lodCount[MESH_LOD_LEVELS])
+{
+	CHECK(lodOffset[0] == 0 && lodCount[0] == indices.size());
+	CHECK(std::equal(indices.begin(), indices.end(), allIndices.begin()));
+	for(unsigned int lod = 0; lod < MESH_LOD_LEVELS; ++lod)
+	{
+		CHECK(lodCount[lod] % 3 == 0 && lodOffset[lod] + lodCount[lod] <= allIndices.size());
+		if (lod == 0)
+			continue;
+
+		CHECK(lodCount[lod] <= lodCount[lod - 1]);
+		for(unsigned int i = lodOffset[lod]; i < lodOffset[lod] + lodCount[lod]; i += 3)
+		{
+			CHECK(allIndices[i] < vertices.size() && allIndices[i + 1] < vertices.size() && allIndices[i + 2] < vertices.size());
+			CHECK(allIndices[i] != allIndices[i + 1] && allIndices[i + 1] != allIndices[i + 2] && allIndices[i] != allIndices[i + 2]);
+		}
+	}
+
+	return;
+}
+
+TEST(MeshDetailLevelsClusterVertices)
+{
+	//Grid of 64x64 vertices on the xz plane
+	const unsigned int side = 64;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	for(unsigned int z = 0; z < side; ++z)
+	{
+		for(unsigned int x = 0; x < side; ++x)
+		{
+			vertices.push_back(CreateVertex(float3((float)x, 0.0f, (float)z)));
+		}
+	}
+	for(unsigned int z = 0; z + 1 < side; ++z)
+	{
+		for(unsigned int x = 0; x + 1 < side; ++x)
+		{
+			unsigned int corner = x + z * side;
+			unsigned int quad[6] = { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	std::vector<unsigned int> allIndices;
+	unsigned int lodOffset[MESH_LOD_LEVELS];
+	unsigned int lodCount[MESH_LOD_LEVELS];
+	Mesh::BuildDetailLevels(vertices, indices, allIndices, lodOffset, lodCount);
+	CheckDetailLevels(vertices, indices, allIndices, lodOffset, lodCount);
+
+	//Each level is a coarser grid, about two triangles per cell of the clustering grid
+	CHECK(lodOffset[1] == indices.size() && lodOffset[2] == lodOffset[1] + lodCount[1]);
+	CHECK(allIndices.size() == lodOffset[2] + lodCount[2]);
+	CHECK(lodCount[1] < lodCount[0] / 2 && lodCount[1] / 3 >= 2 * 30 * 30);
+	CHECK(lodCount[2] < lodCount[1] / 4 && lodCount[2] / 3 >= 2 * 9 * 9);
+
+	//Too small to simplify, every level is the full mesh
+	indices.resize(3 * 63);
+	allIndices.clear();
+	Mesh::BuildDetailLevels(vertices, indices, allIndices, lodOffset, lodCount);
+	CHECK(allIndices == indices);
+	for(unsigned int lod = 0; lod < MESH_LOD_LEVELS; ++lod)
+	{
+		CHECK(lodOffset[lod] == 0 && lodCount[lod] == indices.size());
+	}
+}
+
+//Small triangles whose corners are in different cells of the first clustering grid but in one cell of the second
+TEST(MeshDetailLevelsKeepCollapsedLevel)
+{
+	const unsigned int steps[5] = { 5, 9, 15, 22, 27 };
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	for(auto x : steps)
+	{
+		for(auto y : steps)
+		{
+			for(auto z : steps)
+			{
+				float3 corner = float3(x / 32.0f, y / 32.0f, z / 32.0f);
+				indices.push_back(vertices.size());
+				vertices.push_back(CreateVertex(corner + float3(-0.005f, -0.005f, 0.0f)));
+				indices.push_back(vertices.size());
+				vertices.push_back(CreateVertex(corner + float3(0.005f, -0.005f, 0.0f)));
+				indices.push_back(vertices.size());
+				vertices.push_back(CreateVertex(corner + float3(-0.005f, 0.005f, 0.0f)));
+			}
+		}
+	}
+	//A degenerate triangle sets the bounds to the unit cube, it is dropped from the simplified levels
+	indices.push_back(vertices.size());
+	indices.push_back(vertices.size());
+	vertices.push_back(CreateVertex(float3(0.0f)));
+	indices.push_back(vertices.size());
+	vertices.push_back(CreateVertex(float3(1.0f)));
+
+	std::vector<unsigned int> allIndices;
+	unsigned int lodOffset[MESH_LOD_LEVELS];
+	unsigned int lodCount[MESH_LOD_LEVELS];
+	Mesh::BuildDetailLevels(vertices, indices, allIndices, lodOffset, lodCount);
+	CheckDetailLevels(vertices, indices, allIndices, lodOffset, lodCount);
+
+	CHECK(lodCount[1] == indices.size() - 3);
+	CHECK(lodOffset[2] == lodOffset[1] && lodCount[2] == lodCount[1]);
+	CHECK(allIndices.size() == indices.size() + lodCount[1]);
+}
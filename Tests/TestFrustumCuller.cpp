@@ -0,0 +1,169 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "FrustumCuller.h"
+#include "ComponentCamera.h"
+#include "MathGeoLib/Geometry/Frustum.h"
+#include "MathGeoLib/Math/MathConstants.h"
+
+//Right angle fovs: the side planes are |x| = -z and |y| = -z with normal components of the same size, so boxes can
+//touch them exactly. Near is z = -1 and far z = -100
+static Frustum RightAngleFrustum()
+{
+	Frustum frustum;
+	frustum.type = FrustumType::PerspectiveFrustum;
+	frustum.pos = float3::zero;
+	frustum.front = -float3::unitZ;
+	frustum.up = float3::unitY;
+	frustum.nearPlaneDistance = 1.0f;
+	frustum.farPlaneDistance = 100.0f;
+	frustum.horizontalFov = pi * 0.5f;
+	frustum.verticalFov = pi * 0.5f;
+
+	return frustum;
+}
+
+//Every path of the culler for one box: the batch results are checked apart
+static void CheckBox(const FrustumCuller &culler, const Frustum &frustum, const AABB &box, int expected)
+{
+	CHECK(FrustumCuller::TestAABBCorners(frustum, box) == expected);
+	CHECK(culler.TestAABB(box) == expected);
+
+	for(int lastPlane = 0; lastPlane < 6; ++lastPlane)
+	{
+		unsigned planeMask = FrustumCuller::ALL_PLANES;
+		int plane = lastPlane;
+		CHECK(culler.TestAABB(box, planeMask, plane) == expected);
+	}
+
+	return;
+}
+
+TEST(FrustumCullerMatchesCorners)
+{
+	std::mt19937 generator(1);
+	unsigned int found[3] = { 0, 0, 0 };
+
+	for(unsigned int f = 0; f < 200; ++f)
+	{
+		Frustum frustum = RandomFrustum(generator, f % 4 == 0);
+		FrustumCuller culler;
+		culler.SetPlanes(frustum);
+
+		//Sizes from points to boxes bigger than the frustum, around it
+		std::vector<AABB> boxes;
+		for(unsigned int i = 0; i < 253; ++i)
+		{
+			float halfSize = (i % 3 == 0) ? 0.1f : (i % 3 == 1) ? 5.0f : 40.0f;
+			AABB box = RandomBox(generator, 100.0f, 0.0f, halfSize);
+			box.Translate(frustum.pos);
+			boxes.push_back(box);
+		}
+
+		culler.Clear();
+		for(const auto& box : boxes)
+		{
+			culler.AddBox(box);
+		}
+
+		std::vector<int> batch;
+		std::vector<int> scalar;
+		culler.Cull(batch);
+		culler.CullScalar(scalar);
+		if (!CHECK(batch.size() == boxes.size() && scalar.size() == boxes.size()))
+			return;
+
+		for(unsigned int i = 0; i < boxes.size(); ++i)
+		{
+			int expected = FrustumCuller::TestAABBCorners(frustum, boxes[i]);
+			++found[expected];
+
+			CHECK(batch[i] == expected);
+			CHECK(scalar[i] == expected);
+			CheckBox(culler, frustum, boxes[i], expected);
+		}
+	}
+
+	//The random boxes cover every result
+	CHECK(found[AABB_OUT] > 0);
+	CHECK(found[AABB_IN] > 0);
+	CHECK(found[AABB_INTERSECT] > 0);
+}
+
+TEST(FrustumCullerKnownBoxes)
+{
+	Frustum frustum = RightAngleFrustum();
+	FrustumCuller culler;
+	culler.SetPlanes(frustum);
+
+	std::vector<AABB> boxes;
+	std::vector<int> expected;
+	auto add = [&boxes, &expected](const AABB& box, int result)
+	{
+		boxes.push_back(box);
+		expected.push_back(result);
+	};
+
+	//Inside, outside and across
+	add(AABB(float3(-1.0f, -1.0f, -50.0f), float3(1.0f, 1.0f, -40.0f)), AABB_IN);
+	add(AABB(float3(-9.0f, -4.0f, -99.0f), float3(9.0f, 4.0f, -10.0f)), AABB_IN);
+	add(AABB(float3(60.0f, -1.0f, -50.0f), float3(62.0f, 1.0f, -40.0f)), AABB_OUT);
+	add(AABB(float3(-1.0f, -1.0f, 5.0f), float3(1.0f, 1.0f, 10.0f)), AABB_OUT);
+	add(AABB(float3(-1.0f, -1.0f, -200.0f), float3(1.0f, 1.0f, -150.0f)), AABB_OUT);
+	add(AABB(float3(35.0f, -1.0f, -50.0f), float3(45.0f, 1.0f, -40.0f)), AABB_INTERSECT);
+	add(AABB(float3(-1.0f, -1.0f, -2.0f), float3(1.0f, 1.0f, 0.0f)), AABB_INTERSECT);
+	add(AABB(float3(-500.0f, -500.0f, -500.0f), float3(500.0f, 500.0f, 500.0f)), AABB_INTERSECT);
+
+	//Touching a plane from outside is out, from inside it intersects: a corner on a plane counts as in front of it
+	add(AABB(float3(50.0f, -1.0f, -50.0f), float3(52.0f, 1.0f, -40.0f)), AABB_OUT);
+	add(AABB(float3(30.0f, -1.0f, -50.0f), float3(40.0f, 1.0f, -40.0f)), AABB_INTERSECT);
+	add(AABB(float3(-52.0f, -1.0f, -50.0f), float3(-50.0f, 1.0f, -40.0f)), AABB_OUT);
+	add(AABB(float3(-1.0f, 50.0f, -50.0f), float3(1.0f, 52.0f, -40.0f)), AABB_OUT);
+	add(AABB(float3(-1.0f, 30.0f, -50.0f), float3(1.0f, 40.0f, -40.0f)), AABB_INTERSECT);
+	add(AABB(float3(-1.0f, -1.0f, -1.0f), float3(1.0f, 1.0f, 2.0f)), AABB_OUT);
+	add(AABB(float3(-1.0f, -1.0f, -100.0f), float3(1.0f, 1.0f, -90.0f)), AABB_INTERSECT);
+	add(AABB(float3(-1.0f, -1.0f, -110.0f), float3(1.0f, 1.0f, -100.0f)), AABB_OUT);
+	//Flat boxes on a plane and inside
+	add(AABB(float3(50.0f, -1.0f, -50.0f), float3(50.0f, 1.0f, -40.0f)), AABB_OUT);
+	add(AABB(float3(-1.0f, -1.0f, -50.0f), float3(1.0f, 1.0f, -50.0f)), AABB_IN);
+
+	culler.Clear();
+	for(const auto& box : boxes)
+	{
+		culler.AddBox(box);
+	}
+
+	std::vector<int> batch;
+	std::vector<int> scalar;
+	culler.Cull(batch);
+	culler.CullScalar(scalar);
+	if (!CHECK(batch.size() == boxes.size() && scalar.size() == boxes.size()))
+		return;
+
+	for(unsigned int i = 0; i < boxes.size(); ++i)
+	{
+		CHECK(batch[i] == expected[i]);
+		CHECK(scalar[i] == expected[i]);
+		CheckBox(culler, frustum, boxes[i], expected[i]);
+	}
+}
+
+TEST(FrustumCullerPlaneMask)
+{
+	Frustum frustum = RightAngleFrustum();
+	FrustumCuller culler;
+	culler.SetPlanes(frustum);
+
+	//Fully inside every plane but the right one
+	unsigned planeMask = FrustumCuller::ALL_PLANES;
+	int lastPlane = 0;
+	CHECK(culler.TestAABB(AABB(float3(35.0f, -1.0f, -50.0f), float3(45.0f, 1.0f, -40.0f)), planeMask, lastPlane) == AABB_INTERSECT);
+	CHECK(planeMask == (1u << 3));
+
+	//A child of that box only tests the right plane and remembers it when rejected
+	CHECK(culler.TestAABB(AABB(float3(46.0f, -1.0f, -45.0f), float3(48.0f, 1.0f, -44.0f)), planeMask, lastPlane) == AABB_OUT);
+	CHECK(lastPlane == 3);
+
+	//Planes out of the mask are not tested
+	planeMask = 0;
+	CHECK(culler.TestAABB(AABB(float3(60.0f, -1.0f, -50.0f), float3(62.0f, 1.0f, -40.0f)), planeMask, lastPlane) == AABB_IN);
+}
@@ -0,0 +1,296 @@
+#include "Test.h"
+#include "GameObject.h"
+#include "GameObjectRegistry.h"
+#include "uSTimer.h"
+#include <random>
+#include <algorithm>
+#include <set>
+
+//Plain objects with consecutive UIDs, a quarter of them static
+static std::vector<GameObject*> CreatePlainObjects(unsigned int count)
+{
+	std::vector<GameObject*> objects;
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		GameObject* go = new GameObject();
+		go->UID = i + 2;
+		go->isStatic = (i % 4 == 0);
+		go->visibleStamp = i;
+		objects.push_back(go);
+	}
+
+	return objects;
+}
+
+static void DeletePlainObjects(std::vector<GameObject*> &objects)
+{
+	for(auto go : objects)
+	{
+		delete go;
+	}
+	objects.clear();
+
+	return;
+}
+
+//Distinct random indices for each cycle
+static std::vector<std::vector<unsigned int>> RandomRemovals(std::mt19937 &generator, unsigned int objectCount, unsigned int cycles)
+{
+	std::vector<std::vector<unsigned int>> removedPerCycle(cycles);
+	for(auto& removed : removedPerCycle)
+	{
+		for(unsigned int i = 0; i < objectCount / 10; ++i)
+		{
+			removed.push_back(generator() % objectCount);
+		}
+		std::sort(removed.begin(), removed.end());
+		removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+	}
+
+	return removedPerCycle;
+}
+
+TEST(GameObjectRegistryHandlesGoStale)
+{
+	std::vector<GameObject*> objects = CreatePlainObjects(3);
+	GameObjectRegistry registry;
+	for(auto go : objects)
+	{
+		registry.Insert(go, go->isStatic);
+	}
+
+	GameObjectHandle handle = registry.GetHandle(objects[1]);
+	CHECK(registry.Get(handle) == objects[1]);
+	CHECK(registry.Find(objects[1]->UID) == objects[1]);
+
+	//The removed object is not found through its handle or its UID
+	registry.Remove(objects[1]);
+	CHECK(objects[1]->registrySlot == GAMEOBJECT_NULL_SLOT);
+	CHECK(registry.Get(handle) == nullptr);
+	CHECK(registry.Find(objects[1]->UID) == nullptr);
+	CHECK(registry.GetHandle(objects[1]).slot == GAMEOBJECT_NULL_SLOT);
+	CHECK(registry.Size() == 2);
+
+	//The next object takes the free slot with a new generation, the old handle stays stale
+	GameObject* other = new GameObject();
+	other->UID = 100;
+	registry.Insert(other, false);
+	GameObjectHandle otherHandle = registry.GetHandle(other);
+	CHECK(otherHandle.slot == handle.slot);
+	CHECK(otherHandle != handle);
+	CHECK(registry.Get(handle) == nullptr);
+	CHECK(registry.Get(otherHandle) == other);
+
+	//Removing twice does nothing
+	registry.Remove(objects[1]);
+	CHECK(registry.Size() == 3);
+
+	//Clear makes every handle stale
+	registry.Clear();
+	CHECK(registry.Get(otherHandle) == nullptr);
+	CHECK(registry.Size() == 0 && registry.GetAll().empty());
+	CHECK(registry.Find(other->UID) == nullptr);
+
+	delete other;
+	DeletePlainObjects(objects);
+}
+
+TEST(GameObjectRegistryLists)
+{
+	std::vector<GameObject*> objects = CreatePlainObjects(8);
+	GameObjectRegistry registry;
+
+	//Added without a list, as the root
+	registry.Add(objects[0]);
+	CHECK(registry.Find(objects[0]->UID) == objects[0]);
+	CHECK(registry.GetAll().empty());
+	CHECK(!registry.IsStatic(objects[0]));
+
+	for(auto go : objects)
+	{
+		registry.Insert(go, go->isStatic);
+	}
+	CHECK(registry.GetAll().size() == 8);
+	CHECK(registry.GetStatic().size() == 2 && registry.GetDynamic().size() == 6);
+	CHECK(registry.IsStatic(objects[4]) && !registry.IsStatic(objects[5]));
+
+	//Inserting a listed object moves it to the other list, once
+	registry.Insert(objects[4], false);
+	registry.Insert(objects[4], false);
+	CHECK(!registry.IsStatic(objects[4]));
+	CHECK(registry.GetStatic().size() == 1 && registry.GetDynamic().size() == 7);
+	CHECK(registry.GetAll().size() == 8);
+	registry.Insert(objects[5], true);
+	CHECK(registry.IsStatic(objects[5]));
+	CHECK(std::count(registry.GetStatic().begin(), registry.GetStatic().end(), objects[5]) == 1);
+	CHECK(std::count(registry.GetDynamic().begin(), registry.GetDynamic().end(), objects[5]) == 0);
+
+	//Unregistered objects are not static
+	GameObject unregistered;
+	CHECK(!registry.IsStatic(&unregistered));
+
+	DeletePlainObjects(objects);
+}
+
+TEST(GameObjectRegistryReservesUIDs)
+{
+	GameObjectRegistry registry;
+	CHECK(registry.ReserveUID(50));
+	CHECK(!registry.ReserveUID(50));
+
+	//The object that reserved it takes it, it is free again when the object is removed
+	GameObject go;
+	go.UID = 50;
+	registry.Insert(&go, false);
+	CHECK(!registry.ReserveUID(50));
+	CHECK(registry.Find(50) == &go);
+
+	registry.Remove(&go);
+	CHECK(registry.Find(50) == nullptr);
+	CHECK(registry.ReserveUID(50));
+}
+
+//Objects removed and added back every cycle, the lists have to match std::sets of the same objects
+TEST(GameObjectRegistryMatchesSets)
+{
+	const unsigned int objectCount = 5000;
+	std::mt19937 generator(objectCount);
+	std::vector<GameObject*> objects = CreatePlainObjects(objectCount);
+	std::vector<std::vector<unsigned int>> removedPerCycle = RandomRemovals(generator, objectCount, 50);
+
+	GameObjectRegistry registry;
+	std::set<GameObject*> staticSet;
+	std::set<GameObject*> dynamicSet;
+	for(auto go : objects)
+	{
+		registry.Insert(go, go->isStatic);
+		(go->isStatic ? staticSet : dynamicSet).insert(go);
+	}
+
+	std::vector<GameObjectHandle> removedHandles;
+	for(const auto& removed : removedPerCycle)
+	{
+		removedHandles.clear();
+		for(auto i : removed)
+		{
+			removedHandles.push_back(registry.GetHandle(objects[i]));
+			registry.Remove(objects[i]);
+			(objects[i]->isStatic ? staticSet : dynamicSet).erase(objects[i]);
+		}
+		CHECK(registry.Size() == objectCount - removed.size());
+
+		//Some come back on the other list
+		for(auto i : removed)
+		{
+			if (generator() % 8 == 0)
+				objects[i]->isStatic = !objects[i]->isStatic;
+			registry.Insert(objects[i], objects[i]->isStatic);
+			(objects[i]->isStatic ? staticSet : dynamicSet).insert(objects[i]);
+		}
+
+		//Slots are reused with a new generation, the old handles don't find the objects again
+		for(unsigned int i = 0; i < removed.size(); ++i)
+		{
+			GameObject* go = objects[removed[i]];
+			CHECK(registry.Get(removedHandles[i]) == nullptr);
+			CHECK(registry.Get(registry.GetHandle(go)) == go);
+			CHECK(registry.Find(go->UID) == go);
+		}
+
+		CHECK(std::set<GameObject*>(registry.GetStatic().begin(), registry.GetStatic().end()) == staticSet);
+		CHECK(std::set<GameObject*>(registry.GetDynamic().begin(), registry.GetDynamic().end()) == dynamicSet);
+		CHECK(registry.GetAll().size() == objectCount);
+	}
+
+	for(auto go : objects)
+	{
+		CHECK(registry.IsStatic(go) == go->isStatic);
+		registry.Remove(go);
+	}
+	CHECK(registry.Size() == 0 && registry.GetAll().empty());
+
+	DeletePlainObjects(objects);
+}
+
+//Removing, adding back and walking the dynamic objects with std::sets as before and with a GameObjectRegistry
+BENCHMARK(Registry)
+{
+	const unsigned int objectCount = 100000;
+	const unsigned int cycles = 100;
+
+	std::mt19937 generator(objectCount);
+	std::vector<GameObject*> objects = CreatePlainObjects(objectCount);
+	std::vector<std::vector<unsigned int>> removedPerCycle = RandomRemovals(generator, objectCount, cycles);
+
+	uSTimer timer;
+	unsigned long long sumSet = 0;
+	float setTime = 0.0f;
+	{
+		std::set<GameObject*> allSet;
+		std::set<GameObject*> staticSet;
+		std::set<GameObject*> dynamicSet;
+		std::set<unsigned int> uidSet;
+		for(auto go : objects)
+		{
+			allSet.insert(go);
+			(go->isStatic ? staticSet : dynamicSet).insert(go);
+			uidSet.insert(go->UID);
+		}
+
+		timer.StartTimer();
+		for(const auto& removed : removedPerCycle)
+		{
+			for(auto i : removed)
+			{
+				allSet.erase(objects[i]);
+				(objects[i]->isStatic ? staticSet : dynamicSet).erase(objects[i]);
+				uidSet.erase(objects[i]->UID);
+			}
+			for(auto i : removed)
+			{
+				allSet.insert(objects[i]);
+				(objects[i]->isStatic ? staticSet : dynamicSet).insert(objects[i]);
+				uidSet.insert(objects[i]->UID);
+			}
+			for(auto go : dynamicSet)
+			{
+				sumSet += go->visibleStamp;
+			}
+		}
+		setTime = timer.StopTimer();
+	}
+
+	unsigned long long sumSlotMap = 0;
+	float slotMapTime = 0.0f;
+	{
+		GameObjectRegistry registry;
+		for(auto go : objects)
+		{
+			registry.Insert(go, go->isStatic);
+		}
+
+		timer.StartTimer();
+		for(const auto& removed : removedPerCycle)
+		{
+			for(auto i : removed)
+			{
+				registry.Remove(objects[i]);
+			}
+			for(auto i : removed)
+			{
+				registry.Insert(objects[i], objects[i]->isStatic);
+			}
+			for(auto go : registry.GetDynamic())
+			{
+				sumSlotMap += go->visibleStamp;
+			}
+		}
+		slotMapTime = timer.StopTimer();
+	}
+	CHECK(sumSet == sumSlotMap);
+
+	printf("%u objects, %u cycles removing and adding back 10%% and walking the dynamic ones. std::set %.3f ms, slot map %.3f ms\n",
+		objectCount, cycles, setTime, slotMapTime);
+
+	DeletePlainObjects(objects);
+}
@@ -0,0 +1,183 @@
+#include "Test.h"
+#include "JobSystem.h"
+#include "uSTimer.h"
+#include <algorithm>
+
+//Nested jobs, counters and loops from every thread at once, checked against the expected sums
+static bool RunNestedJobs(JobSystem &jobs, unsigned int jobCount)
+{
+	//Every job starts children with a counter of its own and waits for them while others steal them
+	std::atomic<unsigned long long> sum{ 0 };
+	JobCounter parents;
+	for(unsigned int i = 0; i < jobCount; ++i)
+	{
+		jobs.Run([&jobs, &sum, i]()
+		{
+			JobCounter children;
+			for(unsigned int j = 0; j < 8; ++j)
+			{
+				jobs.Run([&sum, i, j]() { sum += i * 8 + j; }, &children);
+			}
+			jobs.Wait(children);
+		}, &parents);
+	}
+	jobs.Wait(parents);
+	unsigned long long count = (unsigned long long)jobCount * 8;
+	bool isValid = sum == count * (count - 1) / 2;
+
+	//Loops inside loops, the second one reads what the first one wrote
+	std::vector<unsigned int> values(jobCount);
+	jobs.ParallelFor(jobCount, [&jobs, &values](unsigned int i)
+	{
+		std::atomic<unsigned int> innerSum{ 0 };
+		jobs.ParallelForRange(64, 4, [&innerSum](unsigned int begin, unsigned int end)
+		{
+			for(unsigned int j = begin; j < end; ++j)
+			{
+				innerSum += j;
+			}
+		});
+		values[i] = innerSum + i;
+	});
+	std::atomic<unsigned long long> valuesSum{ 0 };
+	jobs.ParallelForRange(jobCount, 16, [&values, &valuesSum](unsigned int begin, unsigned int end)
+	{
+		unsigned long long rangeSum = 0;
+		for(unsigned int i = begin; i < end; ++i)
+		{
+			rangeSum += values[i];
+		}
+		valuesSum += rangeSum;
+	});
+
+	return isValid && valuesSum == (unsigned long long)jobCount * 2016 + (unsigned long long)jobCount * (jobCount - 1) / 2;
+}
+
+TEST(JobSystemNestedJobs)
+{
+	//Workers of their own, the hardware may have a single thread
+	JobSystem jobs(3);
+	CHECK(jobs.ThreadCount() == 4);
+	for(unsigned int round = 0; round < 5; ++round)
+	{
+		CHECK(RunNestedJobs(jobs, 2000));
+	}
+	CHECK(jobs.GetJobCount() > 0);
+
+	//A single worker and the calling thread
+	JobSystem single(1);
+	CHECK(RunNestedJobs(single, 500));
+}
+
+//Every index once, in ranges of at least minRange unless a single range takes them all
+TEST(JobSystemRangesCoverEveryIndex)
+{
+	JobSystem jobs(3);
+	unsigned int counts[] = { 0, 1, 63, 64, 1000, 100000 };
+	for(auto count : counts)
+	{
+		std::vector<std::atomic<unsigned int>> visits(count);
+		std::atomic<unsigned int> shortRanges{ 0 };
+		jobs.ParallelForRange(count, 64, [&visits, &shortRanges, count](unsigned int begin, unsigned int end)
+		{
+			if (end - begin < 64 && (begin != 0 || end != count))
+				++shortRanges;
+			for(unsigned int i = begin; i < end; ++i)
+			{
+				++visits[i];
+			}
+		});
+
+		CHECK(shortRanges == 0);
+		CHECK(std::all_of(visits.begin(), visits.end(), [](const std::atomic<unsigned int> &visit) { return visit == 1; }));
+	}
+
+	//Waiting on a counter nothing was started with returns at once
+	JobCounter counter;
+	CHECK(counter.IsDone());
+	jobs.Wait(counter);
+}
+
+//A background job holds its worker while this thread waits on loops, the waits never take it
+TEST(JobSystemWaitsSkipBackgroundJobs)
+{
+	JobSystem jobs(1);
+	std::atomic<bool> isReleased{ false };
+	std::atomic<bool> isStarted{ false };
+	std::thread::id backgroundThread;
+	JobCounter background;
+	jobs.RunBackground([&isReleased, &isStarted, &backgroundThread]()
+	{
+		backgroundThread = std::this_thread::get_id();
+		isStarted = true;
+		//Gives up in the end so a wait that took it fails instead of hanging
+		uSTimer timer;
+		timer.StartTimer();
+		while (!isReleased && timer.ReadTimer() < 5000.0f)
+		{
+			std::this_thread::yield();
+		}
+	}, &background);
+
+	for(unsigned int round = 0; round < 200 || !isStarted; ++round)
+	{
+		std::atomic<unsigned int> sum{ 0 };
+		jobs.ParallelForRange(1000, 10, [&sum](unsigned int begin, unsigned int end)
+		{
+			for(unsigned int i = begin; i < end; ++i)
+			{
+				sum += i;
+			}
+		});
+		CHECK(sum == 499500);
+	}
+	CHECK(!background.IsDone());
+
+	isReleased = true;
+	jobs.Wait(background);
+	CHECK(backgroundThread != std::this_thread::get_id());
+}
+
+//Cost of scheduling empty jobs and small loops
+BENCHMARK(Jobs)
+{
+	const unsigned int jobCount = 100000;
+
+	JobSystem jobs;
+	uSTimer timer;
+
+	//Empty jobs started from this thread and taken by every thread
+	JobCounter counter;
+	timer.StartTimer();
+	for(unsigned int i = 0; i < jobCount; ++i)
+	{
+		jobs.Run([]() {}, &counter);
+	}
+	jobs.Wait(counter);
+	float runTime = timer.StopTimer() * 1000000.0f / jobCount;
+
+	//Small loops, mostly the cost of splitting and waiting
+	std::vector<float> values(1024, 1.0f);
+	unsigned int loopCount = jobCount / 100;
+	timer.StartTimer();
+	for(unsigned int i = 0; i < loopCount; ++i)
+	{
+		jobs.ParallelForRange(values.size(), 64, [&values](unsigned int begin, unsigned int end)
+		{
+			for(unsigned int j = begin; j < end; ++j)
+			{
+				values[j] *= 1.0001f;
+			}
+		});
+	}
+	float parallelForTime = timer.StopTimer() * 1000.0f / loopCount;
+
+	//Stress run on the hardware threads
+	uSTimer stressTimer;
+	stressTimer.StartTimer();
+	CHECK(RunNestedJobs(jobs, 10000));
+	float stressTime = stressTimer.StopTimer();
+
+	printf("%u threads: %.0f ns per empty job, %.2f us per loop of 1024 floats, %.3f ms for 10000 nested jobs, %u jobs run, %u stolen\n",
+		jobs.ThreadCount(), runTime, parallelForTime, stressTime, jobs.GetJobCount(), jobs.GetStolenCount());
+}
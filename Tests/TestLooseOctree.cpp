@@ -0,0 +1,214 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "LooseOctree.h"
+#include "OctreeRebuilder.h"
+#include "JobSystem.h"
+#include "VisibleList.h"
+#include <algorithm>
+#include <thread>
+
+//Objects of the octree hit by random boxes, the same as a linear scan over the objects in it
+static bool QueriesMatchLinearScan(LooseOctree &octree, const std::vector<GameObject*> &objects, std::mt19937 &generator)
+{
+	VisibleList results;
+	std::vector<GameObject*> found;
+	std::vector<GameObject*> expected;
+	for(unsigned int query = 0; query < 100; ++query)
+	{
+		AABB box = RandomBox(generator, 200.0f, 5.0f, 40.0f);
+		results.Begin();
+		octree.GetIntersection(results, &box);
+		found.assign(results.begin(), results.end());
+
+		expected.clear();
+		for(auto go : objects)
+		{
+			if (go->octreeItemIndex != OCTREE_NULL_ITEM && box.Intersects(*go->globalBoundingBox))
+				expected.push_back(go);
+		}
+
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		if (found != expected)
+			return false;
+	}
+
+	return true;
+}
+
+TEST(LooseOctreeInsertRemove)
+{
+	std::mt19937 generator(7);
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, 2000, 100.0f, 0.1f, 10.0f, objects);
+
+	LooseOctree octree;
+	octree.Clear(AABB(float3(-120.0f), float3(120.0f)));
+	for(auto go : objects)
+	{
+		octree.Insert(go);
+		CHECK(go->octreeItemIndex != OCTREE_NULL_ITEM);
+	}
+	//Inserting twice does nothing
+	octree.Insert(objects[0]);
+	CHECK(octree.Size() == objects.size());
+	CHECK(octree.growCount == 0 && !octree.NeedsRebuild());
+	CHECK(QueriesMatchLinearScan(octree, objects, generator));
+
+	//Removed items are reused by the next inserts
+	for(unsigned int i = 0; i < objects.size(); i += 2)
+	{
+		octree.Remove(objects[i]);
+		CHECK(objects[i]->octreeItemIndex == OCTREE_NULL_ITEM);
+	}
+	octree.Remove(objects[0]);
+	CHECK(octree.Size() == objects.size() / 2);
+	CHECK(octree.removeCount == objects.size() / 2 && !octree.NeedsRebuild());
+	CHECK(QueriesMatchLinearScan(octree, objects, generator));
+
+	for(unsigned int i = 0; i < objects.size(); i += 4)
+	{
+		octree.Insert(objects[i]);
+	}
+	CHECK(QueriesMatchLinearScan(octree, objects, generator));
+
+	//More removed than left
+	for(unsigned int i = 1; i < objects.size(); i += 2)
+	{
+		octree.Remove(objects[i]);
+	}
+	CHECK(octree.Size() == objects.size() / 4);
+	CHECK(octree.NeedsRebuild());
+	CHECK(QueriesMatchLinearScan(octree, objects, generator));
+
+	octree.Clear(octree.limits);
+	CHECK(octree.Size() == 0 && octree.UsedCells() == 0 && !octree.NeedsRebuild());
+
+	DeleteObjects(objects);
+}
+
+TEST(LooseOctreeGrows)
+{
+	std::mt19937 generator(8);
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, 500, 10.0f, 0.1f, 1.0f, objects);
+
+	//The first object sets the limits of an octree that was never cleared
+	LooseOctree octree;
+	for(auto go : objects)
+	{
+		octree.Insert(go);
+	}
+	CHECK(octree.limits.Contains(*objects[0]->globalBoundingBox));
+	CHECK(octree.Size() == objects.size());
+
+	//Limits are doubled towards the new object and the old items keep their place in the queries
+	unsigned int growCount = octree.growCount;
+	objects.push_back(CreateBoxObject(AABB(float3(150.0f), float3(155.0f))));
+	octree.Insert(objects.back());
+	CHECK(octree.growCount > growCount && octree.NeedsRebuild());
+	CHECK(octree.limits.Contains(*objects.back()->globalBoundingBox));
+	for(auto go : objects)
+	{
+		CHECK(octree.limits.Contains(*go->globalBoundingBox));
+	}
+	CHECK(QueriesMatchLinearScan(octree, objects, generator));
+
+	//Too far to grow to, kept in the root
+	objects.push_back(CreateBoxObject(AABB(float3(-1.0e7f), float3(-1.0e7f + 1.0f))));
+	octree.Insert(objects.back());
+	CHECK(!octree.limits.Contains(*objects.back()->globalBoundingBox));
+	VisibleList results;
+	results.Begin();
+	octree.GetIntersection(results, objects.back()->globalBoundingBox);
+	CHECK(results.Size() == 1 && results[0] == objects.back());
+	CHECK(QueriesMatchLinearScan(octree, objects, generator));
+
+	//A build fits the limits again
+	std::vector<std::pair<GameObject*, AABB>> bounds;
+	for(unsigned int i = 0; i < objects.size() - 1; ++i)
+	{
+		bounds.push_back(std::make_pair(objects[i], *objects[i]->globalBoundingBox));
+	}
+	octree.Build(AABB(float3(-11.0f), float3(155.0f)), bounds);
+	octree.BindObjects();
+	objects.back()->octreeItemIndex = OCTREE_NULL_ITEM;
+	CHECK(octree.growCount == 0 && !octree.NeedsRebuild());
+	CHECK(QueriesMatchLinearScan(octree, objects, generator));
+
+	DeleteObjects(objects);
+}
+
+//Polls the swap as ModuleScene::UpdateOctree does every frame until the build is over
+static bool SwapWhenDone(OctreeRebuilder &rebuilder, LooseOctree* &octree, unsigned int staticVersion)
+{
+	while (rebuilder.IsBuilding())
+	{
+		if (rebuilder.Swap(octree, staticVersion))
+			return true;
+		std::this_thread::yield();
+	}
+
+	return false;
+}
+
+TEST(OctreeRebuilderSwapsOrDiscards)
+{
+	std::mt19937 generator(9);
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, 3000, 100.0f, 0.1f, 10.0f, objects);
+	std::vector<std::pair<GameObject*, AABB>> bounds;
+	for(auto go : objects)
+	{
+		bounds.push_back(std::make_pair(go, *go->globalBoundingBox));
+	}
+	AABB limits(float3(-110.0f), float3(110.0f));
+
+	JobSystem jobs(2);
+	LooseOctree* octree = new LooseOctree();
+	octree->Clear(limits);
+	for(unsigned int i = 0; i < objects.size(); i += 2)
+	{
+		octree->Insert(objects[i]);
+	}
+	LooseOctree* current = octree;
+
+	//Nothing to swap without a build
+	OctreeRebuilder rebuilder;
+	CHECK(!rebuilder.Swap(octree, 0));
+
+	//Static objects changed while building, the result is dropped and the current octree kept
+	rebuilder.Start(jobs, limits, std::vector<std::pair<GameObject*, AABB>>(bounds), 1);
+	CHECK(rebuilder.IsBuilding());
+	CHECK(!SwapWhenDone(rebuilder, octree, 2));
+	CHECK(octree == current && rebuilder.discardedCount == 1);
+	CHECK(octree->Size() == objects.size() / 2);
+	CHECK(QueriesMatchLinearScan(*octree, objects, generator));
+
+	//Same version, swapped in and bound to the objects
+	rebuilder.Start(jobs, limits, std::vector<std::pair<GameObject*, AABB>>(bounds), 2);
+	//A second start while building does nothing
+	rebuilder.Start(jobs, limits, std::vector<std::pair<GameObject*, AABB>>(), 2);
+	CHECK(SwapWhenDone(rebuilder, octree, 2));
+	CHECK(octree != current && rebuilder.discardedCount == 1);
+	CHECK(octree->Size() == objects.size());
+	for(auto go : objects)
+	{
+		CHECK(go->octreeItemIndex != OCTREE_NULL_ITEM);
+	}
+	CHECK(QueriesMatchLinearScan(*octree, objects, generator));
+
+	//Single changes go to the swapped octree
+	octree->Remove(objects[1]);
+	CHECK(objects[1]->octreeItemIndex == OCTREE_NULL_ITEM);
+	CHECK(QueriesMatchLinearScan(*octree, objects, generator));
+
+	//A wait drops the result, the old octree is reused by the next build
+	rebuilder.Start(jobs, limits, std::vector<std::pair<GameObject*, AABB>>(bounds), 3);
+	rebuilder.Wait(jobs);
+	CHECK(!rebuilder.IsBuilding() && !rebuilder.Swap(octree, 3));
+	CHECK(rebuilder.discardedCount == 1);
+
+	delete octree;
+	DeleteObjects(objects);
+}
@@ -0,0 +1,209 @@
+#include "Test.h"
+#include "MeshBVH.h"
+#include "Mesh.h"
+#include "MathGeoLib/Geometry/Triangle.h"
+#include <random>
+#include <limits>
+
+//Loose triangles with centers in [-extent, extent] and sides up to maxSide
+static void CreateTriangleSoup(std::mt19937 &generator, unsigned int count, float extent, float maxSide, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+	std::uniform_real_distribution<float> position(-extent, extent);
+	std::uniform_real_distribution<float> offset(-maxSide * 0.5f, maxSide * 0.5f);
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		float3 center = float3(position(generator), position(generator), position(generator));
+		for(unsigned int corner = 0; corner < 3; ++corner)
+		{
+			Vertex vertex;
+			vertex.Position = center + float3(offset(generator), offset(generator), offset(generator));
+			indices.push_back(vertices.size());
+			vertices.push_back(vertex);
+		}
+	}
+
+	return;
+}
+
+static Triangle GetTriangle(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, unsigned int triangle)
+{
+	return Triangle(vertices[indices[3 * triangle]].Position, vertices[indices[3 * triangle + 1]].Position, vertices[indices[3 * triangle + 2]].Position);
+}
+
+//Nearest hit of a loop over every triangle, MESH_BVH_NULL_TRIANGLE if none
+static unsigned int BruteForceRayCast(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const LineSegment &ray, float &hitDistance)
+{
+	unsigned int hitTriangle = MESH_BVH_NULL_TRIANGLE;
+	hitDistance = std::numeric_limits<float>::max();
+	for(unsigned int i = 0; i < indices.size() / 3; ++i)
+	{
+		float distance;
+		if (GetTriangle(vertices, indices, i).Intersects(ray, &distance, nullptr) && distance < hitDistance)
+		{
+			hitDistance = distance;
+			hitTriangle = i;
+		}
+	}
+
+	return hitTriangle;
+}
+
+//MathGeoLib takes hits a bit outside of the edges, the results can only differ for rays that graze an edge
+static bool GrazesEdge(const Triangle &triangle, const LineSegment &ray)
+{
+	float distance;
+	if (!triangle.Intersects(ray, &distance, nullptr))
+		return false;
+
+	float3 point = ray.GetPoint(distance);
+	for(int edge = 0; edge < 3; ++edge)
+	{
+		if (triangle.Edge(edge).Distance(point) < 1e-3f)
+			return true;
+	}
+
+	return false;
+}
+
+//Both kernels against the brute force loop. Returns the rays whose results differ, each of them grazing an edge
+static unsigned int CheckRays(const MeshBVH &bvh, const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+	const std::vector<LineSegment> &rays, unsigned int &hitCount)
+{
+	unsigned int grazingCount = 0;
+	hitCount = 0;
+	for(const auto& ray : rays)
+	{
+		float expectedDistance;
+		unsigned int expectedTriangle = BruteForceRayCast(vertices, indices, ray, expectedDistance);
+		if (expectedTriangle != MESH_BVH_NULL_TRIANGLE)
+			++hitCount;
+
+		for(int kernel = 0; kernel < 2; ++kernel)
+		{
+			float distance = std::numeric_limits<float>::max();
+			unsigned int triangle = MESH_BVH_NULL_TRIANGLE;
+			bool isHit = (kernel == 0) ? bvh.RayCast(ray, distance, &triangle) : bvh.RayCastScalar(ray, distance, &triangle);
+
+			if (isHit && expectedTriangle != MESH_BVH_NULL_TRIANGLE)
+			{
+				//Another triangle only through the same point
+				CHECK(fabs(distance - expectedDistance) < 1e-4f);
+				if (triangle != expectedTriangle)
+					CHECK(GetTriangle(vertices, indices, triangle).Distance(ray.GetPoint(expectedDistance)) < 1e-3f);
+			}
+			else if (isHit != (expectedTriangle != MESH_BVH_NULL_TRIANGLE))
+			{
+				++grazingCount;
+				CHECK(GrazesEdge(GetTriangle(vertices, indices, isHit ? triangle : expectedTriangle), ray));
+			}
+			else
+			{
+				//A miss leaves the distance as it was
+				CHECK(distance == std::numeric_limits<float>::max());
+			}
+		}
+	}
+
+	return grazingCount;
+}
+
+TEST(MeshBVHMatchesBruteForce)
+{
+	std::mt19937 generator(11);
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	CreateTriangleSoup(generator, 3000, 50.0f, 6.0f, vertices, indices);
+
+	MeshBVH bvh;
+	bvh.Build(vertices, indices);
+	CHECK(bvh.IsBuilt() && bvh.TriangleCount() == 3000);
+	CHECK(bvh.NodeCount() >= 2 * 3000 / MESH_BVH_LEAF_TRIANGLES - 1);
+
+	std::uniform_real_distribution<float> outside(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> inside(-45.0f, 45.0f);
+	std::uniform_real_distribution<float> length(0.5f, 20.0f);
+	std::vector<LineSegment> rays;
+	for(unsigned int i = 0; i < 500; ++i)
+	{
+		//Across the mesh from outside its bounds
+		float3 a = float3(outside(generator), outside(generator), outside(generator));
+		float3 b = float3(inside(generator), inside(generator), inside(generator));
+		rays.push_back(LineSegment(a, a + (b - a) * 2.0f));
+
+		//Starting inside the bounds, short ones end before any triangle
+		a = float3(inside(generator), inside(generator), inside(generator));
+		b = float3(outside(generator), outside(generator), outside(generator));
+		rays.push_back(LineSegment(a, a + (b - a).Normalized() * length(generator)));
+		rays.push_back(LineSegment(a, b));
+
+		//Along an axis, the slab test divides by zero on the other two
+		float3 axis = float3::zero;
+		axis[i % 3] = (i % 2 == 0) ? 120.0f : -120.0f;
+		rays.push_back(LineSegment(a, a + axis));
+
+		//Away from the bounds
+		a = float3(60.0f + inside(generator) * 0.1f, inside(generator), inside(generator));
+		rays.push_back(LineSegment(a, a + float3(100.0f, outside(generator), outside(generator))));
+	}
+
+	unsigned int hitCount;
+	unsigned int grazingCount = CheckRays(bvh, vertices, indices, rays, hitCount);
+	CHECK(hitCount > rays.size() / 4 && hitCount < rays.size() * 3 / 4);
+	CHECK(grazingCount < rays.size() / 100);
+
+	//Only hits nearer than the distance on entry are taken
+	for(const auto& ray : rays)
+	{
+		float expectedDistance;
+		if (BruteForceRayCast(vertices, indices, ray, expectedDistance) == MESH_BVH_NULL_TRIANGLE || expectedDistance < 1e-3f)
+			continue;
+
+		float distance = expectedDistance * 0.5f;
+		CHECK(!bvh.RayCast(ray, distance) && distance == expectedDistance * 0.5f);
+		CHECK(!bvh.RayCastScalar(ray, distance) && distance == expectedDistance * 0.5f);
+	}
+
+	//An empty mesh is built and never hit
+	bvh.Build(std::vector<Vertex>(), std::vector<unsigned int>());
+	float distance = 1.0f;
+	CHECK(bvh.IsBuilt() && bvh.TriangleCount() == 0);
+	CHECK(!bvh.RayCast(rays[0], distance) && !bvh.RayCastScalar(rays[0], distance));
+}
+
+//Triangles with the same centroid can't be split by SAH, the build falls back to the median
+TEST(MeshBVHStackedTriangles)
+{
+	std::mt19937 generator(12);
+	std::uniform_real_distribution<float> side(0.5f, 10.0f);
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	for(unsigned int i = 0; i < 2000; ++i)
+	{
+		//Triangles in the z = 0 plane around the origin, of every size
+		float size = side(generator);
+		float3 corners[3] = { float3(-size, -size, 0.0f), float3(2.0f * size, -size, 0.0f), float3(-size, 2.0f * size, 0.0f) };
+		for(const auto& corner : corners)
+		{
+			Vertex vertex;
+			vertex.Position = corner;
+			indices.push_back(vertices.size());
+			vertices.push_back(vertex);
+		}
+	}
+
+	MeshBVH bvh;
+	bvh.Build(vertices, indices);
+	CHECK(bvh.TriangleCount() == 2000);
+
+	std::uniform_real_distribution<float> position(-30.0f, 30.0f);
+	std::vector<LineSegment> rays;
+	for(unsigned int i = 0; i < 300; ++i)
+	{
+		float3 a = float3(position(generator), position(generator), 10.0f);
+		rays.push_back(LineSegment(a, float3(position(generator), position(generator), -10.0f)));
+	}
+
+	unsigned int hitCount;
+	unsigned int grazingCount = CheckRays(bvh, vertices, indices, rays, hitCount);
+	CHECK(hitCount > 0 && grazingCount < rays.size() / 50);
+}
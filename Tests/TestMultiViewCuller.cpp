@@ -0,0 +1,104 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "MultiViewCuller.h"
+#include "FrustumCuller.h"
+#include "AABBTree.h"
+#include "SpatialHashGrid.h"
+#include "VisibleList.h"
+#include "ComponentCamera.h"
+
+//Every object of the list has the views of the corner test and every object out of it is seen by none
+static void CheckViewMasks(const VisibleList &visible, const std::vector<GameObject*> &objects, const std::vector<Frustum> &frustums)
+{
+	for(auto go : objects)
+	{
+		unsigned int expectedVisible = 0;
+		unsigned int expectedInside = 0;
+		for(unsigned int v = 0; v < frustums.size(); ++v)
+		{
+			int result = FrustumCuller::TestAABBCorners(frustums[v], *go->globalBoundingBox);
+			if (result != AABB_OUT)
+				expectedVisible |= 1 << v;
+			if (result == AABB_IN)
+				expectedInside |= 1 << v;
+		}
+
+		if (!visible.Contains(go))
+		{
+			CHECK(expectedVisible == 0);
+			continue;
+		}
+
+		CHECK(go->visibleViews == expectedVisible);
+		CHECK(go->insideViews == expectedInside);
+	}
+
+	return;
+}
+
+//The walks keep the rejecting plane of each view between boxes and frames, the results can't depend on it
+TEST(MultiViewWalksMatchCorners)
+{
+	std::mt19937 generator(3);
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, 3000, 150.0f, 0.5f, 10.0f, objects);
+
+	AABBTree tree(10);
+	tree.Build(objects);
+	SpatialHashGrid grid;
+	grid.Build(objects);
+
+	MultiViewCuller views;
+	VisibleList visible;
+	for(unsigned int frame = 0; frame < 20; ++frame)
+	{
+		std::vector<Frustum> frustums;
+		views.ClearViews();
+		for(unsigned int v = 0; v < 1 + frame % 3; ++v)
+		{
+			//Perspective only: MathGeoLib takes the side planes of orthographic frustums from the fovs, so they don't
+			//match the corners the grid uses for the view bounds
+			frustums.push_back(RandomFrustum(generator, false));
+			views.AddView(frustums.back());
+		}
+
+		visible.Begin();
+		tree.GetIntersection(visible, views);
+		CheckViewMasks(visible, objects, frustums);
+
+		visible.Begin();
+		grid.GetIntersection(visible, views);
+		CheckViewMasks(visible, objects, frustums);
+	}
+
+	DeleteObjects(objects);
+}
+
+TEST(MultiViewCullerTracksRejectingPlane)
+{
+	std::mt19937 generator(4);
+	Frustum frustum = RandomFrustum(generator, false);
+	Frustum backwards = frustum;
+	backwards.front = -frustum.front;
+
+	MultiViewCuller views;
+	views.ClearViews();
+	views.AddView(frustum);
+	views.AddView(backwards);
+
+	//Far to the right of the first view, only its right plane rejects it. The second view has it behind and its
+	//near plane, tested first, rejects it
+	AABB box = AABB::FromCenterAndSize(frustum.pos + frustum.front * 10.0f + frustum.WorldRight() * 1000.0f, float3(1.0f));
+	ViewCullPlanes cullPlanes;
+	ViewCullState state = views.RootState();
+	CHECK(views.TestAABB(box, state, cullPlanes).visible == 0);
+	CHECK(state.viewMask == 0);
+	CHECK(cullPlanes.lastPlane[0] == 3);
+	CHECK(cullPlanes.lastPlane[1] == 0);
+
+	//A box in view keeps the planes
+	state = views.RootState();
+	CHECK(views.TestAABB(AABB::FromCenterAndSize(frustum.pos + frustum.front * 10.0f, float3(1.0f)), state, cullPlanes).visible == 1);
+	CHECK(cullPlanes.lastPlane[0] == 3);
+	CHECK(cullPlanes.lastPlane[1] == 0);
+}
@@ -0,0 +1,136 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "AABBTree.h"
+#include "LooseOctree.h"
+#include "SpatialHashGrid.h"
+#include "uSTimer.h"
+#include <limits>
+#include <algorithm>
+
+enum { LINEAR = 0, TREE, OCTREE, GRID, STRUCTURES };
+
+//Distances of the k nearest and of the objects within radius of every point, the objects of equal distances may come
+//in any order. A linear scan and the three structures over the same random boxes. Returns false if they differ
+static bool NearestQueries(unsigned int objectCount, unsigned int queryCount, unsigned int k, float maxDistance, float radius,
+	float times[STRUCTURES])
+{
+	std::mt19937 generator(objectCount);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, objectCount, 500.0f, 0.5f, 10.0f, objects);
+
+	std::vector<std::pair<GameObject*, AABB>> bounds;
+	for(auto go : objects)
+	{
+		bounds.push_back(std::make_pair(go, *go->globalBoundingBox));
+	}
+
+	AABBTree tree(10);
+	tree.Build(objects);
+	LooseOctree staticOctree;
+	staticOctree.Build(AABB(float3(-510.0f), float3(510.0f)), bounds);
+	staticOctree.BindObjects();
+	SpatialHashGrid grid;
+	grid.Build(objects);
+
+	std::vector<float3> points(queryCount);
+	for(auto& point : points)
+	{
+		point = float3(position(generator), position(generator), position(generator));
+	}
+
+	std::vector<float> distances[STRUCTURES];
+	uSTimer timer;
+	std::vector<NearestObject> nearest(k);
+	std::vector<NearestObject> inRadius;
+	for(int structure = LINEAR; structure < STRUCTURES; ++structure)
+	{
+		timer.StartTimer();
+		for(const auto& point : points)
+		{
+			unsigned int count = 0;
+			inRadius.clear();
+			switch (structure)
+			{
+				case LINEAR:
+					for(auto go : objects)
+					{
+						float distance = go->globalBoundingBox->Distance(point);
+						if (distance <= maxDistance)
+							count = InsertNearest(nearest.data(), count, k, go, distance);
+						if (distance <= radius)
+							inRadius.push_back({ go, distance });
+					}
+					std::sort(inRadius.begin(), inRadius.end());
+					break;
+				case TREE:
+					count = tree.GetNearest(point, k, maxDistance, nearest.data());
+					tree.GetWithinRadius(point, radius, inRadius);
+					break;
+				case OCTREE:
+					count = staticOctree.GetNearest(point, k, maxDistance, nearest.data());
+					staticOctree.GetWithinRadius(point, radius, inRadius);
+					break;
+				case GRID:
+					count = grid.GetNearest(point, k, maxDistance, nearest.data());
+					grid.GetWithinRadius(point, radius, inRadius);
+					break;
+			}
+
+			for(unsigned int i = 0; i < count; ++i)
+			{
+				distances[structure].push_back(nearest[i].distance);
+			}
+			for(const auto& object : inRadius)
+			{
+				distances[structure].push_back(object.distance);
+			}
+			distances[structure].push_back(-1.0f);
+		}
+		times[structure] = timer.StopTimer();
+	}
+
+	DeleteObjects(objects);
+
+	return distances[TREE] == distances[LINEAR] && distances[OCTREE] == distances[LINEAR] && distances[GRID] == distances[LINEAR];
+}
+
+TEST(NearestQueriesMatchLinearScan)
+{
+	float times[STRUCTURES];
+	CHECK(NearestQueries(3000, 300, 8, std::numeric_limits<float>::max(), 25.0f, times));
+	//Fewer than k objects within the maximum distance
+	CHECK(NearestQueries(3000, 300, 16, 30.0f, 40.0f, times));
+	CHECK(NearestQueries(3000, 300, 1, std::numeric_limits<float>::max(), 0.0f, times));
+}
+
+//Points inside a box are at distance 0 of it
+TEST(NearestQueriesInsideBox)
+{
+	std::vector<GameObject*> objects;
+	objects.push_back(CreateBoxObject(AABB(float3(-1.0f), float3(1.0f))));
+	objects.push_back(CreateBoxObject(AABB(float3(4.0f, -1.0f, -1.0f), float3(6.0f, 1.0f, 1.0f))));
+
+	AABBTree tree(10);
+	tree.Build(objects);
+
+	NearestObject nearest[2];
+	CHECK(tree.GetNearest(float3::zero, 2, 100.0f, nearest) == 2);
+	CHECK(nearest[0].go == objects[0] && nearest[0].distance == 0.0f);
+	CHECK(nearest[1].go == objects[1] && nearest[1].distance == 4.0f);
+	CHECK(tree.GetNearest(float3::zero, 2, 2.0f, nearest) == 1);
+
+	DeleteObjects(objects);
+}
+
+BENCHMARK(NearestQueriesOnRandomBoxes)
+{
+	const unsigned int objectCount = 20000;
+	const unsigned int queryCount = 2000;
+
+	float times[STRUCTURES];
+	CHECK(NearestQueries(objectCount, queryCount, 8, std::numeric_limits<float>::max(), 25.0f, times));
+
+	printf("%u objects, %u points, 8 nearest and radius 25. Linear %.3f ms, AABBTree %.3f ms, octree %.3f ms, grid %.3f ms\n",
+		objectCount, queryCount, times[LINEAR], times[TREE], times[OCTREE], times[GRID]);
+}
@@ -0,0 +1,109 @@
+#include "TestObjects.h"
+#include "ComponentTransform.h"
+#include "ComponentMesh.h"
+
+GameObject* CreateBoxObject(const AABB& box)
+{
+	GameObject* go = new GameObject();
+	go->boundingBox = new AABB(box);
+	go->globalBoundingBox = new AABB(box);
+
+	return go;
+}
+
+GameObject* CreateMeshObject(const AABB& box)
+{
+	GameObject* go = new GameObject();
+	go->myTransform = new ComponentTransform(go);
+	go->myTransform->SetPosition(box.CenterPoint());
+	go->myTransform->UpdateMatrices();
+	go->myMesh = new ComponentMesh(go);
+	go->components.push_back(go->myTransform);
+	go->components.push_back(go->myMesh);
+
+	go->boundingBox = new AABB(-box.HalfSize(), box.HalfSize());
+	go->globalBoundingBox = new AABB();
+	go->UpdateBoundingBox();
+
+	return go;
+}
+
+void CreateRandomBoxes(std::mt19937& generator, unsigned int count, float extent, float minHalfSize, float maxHalfSize, std::vector<GameObject*>& objects)
+{
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		objects.push_back(CreateBoxObject(RandomBox(generator, extent, minHalfSize, maxHalfSize)));
+	}
+
+	return;
+}
+
+void CreateCubes(std::mt19937& generator, unsigned int count, std::vector<GameObject*>& objects)
+{
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		float3 center = float3(position(generator), 0.0f, position(generator));
+		objects.push_back(CreateBoxObject(AABB(center - float3(0.5f), center + float3(0.5f))));
+	}
+
+	return;
+}
+
+AABB RandomBox(std::mt19937& generator, float extent, float minHalfSize, float maxHalfSize)
+{
+	std::uniform_real_distribution<float> position(-extent, extent);
+	std::uniform_real_distribution<float> size(minHalfSize, maxHalfSize);
+
+	float3 center = float3(position(generator), position(generator), position(generator));
+	float3 halfSize = float3(size(generator), size(generator), size(generator));
+
+	return AABB(center - halfSize, center + halfSize);
+}
+
+Frustum RandomFrustum(std::mt19937& generator, bool isOrthographic)
+{
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> fov(0.3f, 2.0f);
+	std::uniform_real_distribution<float> size(5.0f, 60.0f);
+
+	Frustum frustum;
+	frustum.pos = float3(position(generator), position(generator), position(generator));
+
+	float3 front;
+	do
+	{
+		front = float3(direction(generator), direction(generator), direction(generator));
+	} while (front.LengthSq() < 0.01f);
+	frustum.front = front.Normalized();
+	frustum.up = frustum.front.Perpendicular();
+
+	frustum.nearPlaneDistance = 0.1f;
+	frustum.farPlaneDistance = size(generator) * 3.0f;
+	if (isOrthographic)
+	{
+		frustum.type = FrustumType::OrthographicFrustum;
+		frustum.orthographicWidth = size(generator);
+		frustum.orthographicHeight = size(generator);
+	}
+	else
+	{
+		frustum.type = FrustumType::PerspectiveFrustum;
+		frustum.verticalFov = fov(generator);
+		frustum.horizontalFov = fov(generator);
+	}
+
+	return frustum;
+}
+
+void DeleteObjects(std::vector<GameObject*>& objects)
+{
+	for(auto go : objects)
+	{
+		delete go;
+	}
+	objects.clear();
+
+	return;
+}
@@ -0,0 +1,37 @@
+#ifndef __TestObjects_H__
+#define __TestObjects_H__
+
+#include "GameObject.h"
+#include "TransformHierarchy.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include "MathGeoLib/Geometry/Frustum.h"
+#include <vector>
+#include <random>
+
+//Objects with only their bounds, as the spatial structures see them. The tests own them
+GameObject* CreateBoxObject(const AABB &box);
+//Objects with a transform at the center of the box and a mesh, the sphere inscribed in the box. Need TestTransforms
+GameObject* CreateMeshObject(const AABB &box);
+//Boxes with centers in [-extent, extent] and half sizes in [minHalfSize, maxHalfSize]
+void CreateRandomBoxes(std::mt19937 &generator, unsigned int count, float extent, float minHalfSize, float maxHalfSize, std::vector<GameObject*> &objects);
+//Unit cubes on the xz plane with centers in [-100, 100], as ModuleScene::CreateCubesScript places them
+void CreateCubes(std::mt19937 &generator, unsigned int count, std::vector<GameObject*> &objects);
+AABB RandomBox(std::mt19937 &generator, float extent, float minHalfSize, float maxHalfSize);
+//Frustum around a point in [-50, 50] looking in any direction
+Frustum RandomFrustum(std::mt19937 &generator, bool isOrthographic);
+void DeleteObjects(std::vector<GameObject*> &objects);
+
+//Hierarchy of the transforms created while it lives, the objects that use it are deleted before it
+class TestTransforms
+{
+public:
+	TestTransforms() { previous = Transforms; Transforms = &hierarchy; }
+	~TestTransforms() { Transforms = previous; }
+
+	TransformHierarchy hierarchy;
+
+private:
+	TransformHierarchy* previous = nullptr;
+};
+
+#endif __TestObjects_H__
@@ -0,0 +1,88 @@
+#include "Test.h"
+#include "OcclusionCuller.h"
+#include "Mesh.h"
+#include "MathGeoLib/Geometry/Frustum.h"
+#include "MathGeoLib/Math/TransformOps.h"
+
+//Camera at the origin looking down -z
+static float4x4 ViewProjection()
+{
+	Frustum frustum;
+	frustum.type = FrustumType::PerspectiveFrustum;
+	frustum.pos = float3::zero;
+	frustum.front = -float3::unitZ;
+	frustum.up = float3::unitY;
+	frustum.nearPlaneDistance = 0.1f;
+	frustum.farPlaneDistance = 1000.0f;
+	frustum.verticalFov = 1.0f;
+	frustum.horizontalFov = 1.5f;
+
+	return frustum.ViewProjMatrix();
+}
+
+//Wall facing the camera, x and y in [-5, 5] at z = -10
+static void RasterizeWall(OcclusionCuller &culler, const float4x4 &model)
+{
+	std::vector<Vertex> vertices(4);
+	vertices[0].Position = float3(-5.0f, -5.0f, -10.0f);
+	vertices[1].Position = float3(5.0f, -5.0f, -10.0f);
+	vertices[2].Position = float3(5.0f, 5.0f, -10.0f);
+	vertices[3].Position = float3(-5.0f, 5.0f, -10.0f);
+	std::vector<unsigned int> indices = { 0, 1, 2, 0, 2, 3 };
+
+	culler.RasterizeTriangles(vertices, indices, model);
+
+	return;
+}
+
+TEST(OcclusionCullerHidesBoxesBehindOccluders)
+{
+	OcclusionCuller culler;
+	culler.Begin(ViewProjection());
+	RasterizeWall(culler, float4x4::identity);
+	culler.UpdateTiles();
+	CHECK(culler.rasterizedTriangles == 2);
+
+	//Behind the wall, also far to the side where it covers them in perspective
+	CHECK(!culler.IsVisible(AABB(float3(-1.0f, -1.0f, -30.0f), float3(1.0f, 1.0f, -28.0f))));
+	CHECK(!culler.IsVisible(AABB(float3(3.0f, -1.0f, -30.0f), float3(9.0f, 1.0f, -28.0f))));
+	CHECK(!culler.IsVisible(AABB(float3(-4.0f, -4.0f, -500.0f), float3(4.0f, 4.0f, -11.0f))));
+
+	//In front of the wall, beside it, partly behind it and crossing the near plane
+	CHECK(culler.IsVisible(AABB(float3(-1.0f, -1.0f, -8.0f), float3(1.0f, 1.0f, -6.0f))));
+	CHECK(culler.IsVisible(AABB(float3(20.0f, -1.0f, -30.0f), float3(22.0f, 1.0f, -28.0f))));
+	CHECK(culler.IsVisible(AABB(float3(10.0f, -1.0f, -30.0f), float3(20.0f, 1.0f, -28.0f))));
+	CHECK(culler.IsVisible(AABB(float3(-1.0f, -1.0f, -30.0f), float3(1.0f, 1.0f, 1.0f))));
+	//Across the wall
+	CHECK(culler.IsVisible(AABB(float3(-1.0f, -1.0f, -12.0f), float3(1.0f, 1.0f, -9.0f))));
+
+	//The wall covers the center of the screen and nothing else
+	CHECK(culler.GetDepth(OCCLUSION_BUFFER_WIDTH / 2, OCCLUSION_BUFFER_HEIGHT / 2) < 1.0f);
+	CHECK(culler.GetDepth(0, 0) >= 1.0f);
+	CHECK(culler.ScreenArea(AABB(float3(-5.0f, -5.0f, -10.1f), float3(5.0f, 5.0f, -10.0f))) > OCCLUSION_MIN_OCCLUDER_AREA);
+	CHECK(culler.ScreenArea(AABB(float3(-1.0f, -1.0f, -1.0f), float3(1.0f, 1.0f, 1.0f))) == 1.0f);
+}
+
+TEST(OcclusionCullerMovedOccluder)
+{
+	OcclusionCuller culler;
+	AABB behind = AABB(float3(-1.0f, -1.0f, -30.0f), float3(1.0f, 1.0f, -28.0f));
+
+	//Nothing rasterized hides nothing
+	culler.Begin(ViewProjection());
+	culler.UpdateTiles();
+	CHECK(culler.IsVisible(behind));
+
+	//The model matrix moves the wall away from the box and over another one
+	culler.Begin(ViewProjection());
+	RasterizeWall(culler, float4x4::Translate(float3(8.0f, 0.0f, 0.0f)));
+	culler.UpdateTiles();
+	CHECK(culler.IsVisible(behind));
+	CHECK(!culler.IsVisible(AABB(float3(23.0f, -1.0f, -30.0f), float3(25.0f, 1.0f, -28.0f))));
+
+	//Begin clears the previous frame
+	culler.Begin(ViewProjection());
+	culler.UpdateTiles();
+	CHECK(culler.rasterizedTriangles == 0);
+	CHECK(culler.IsVisible(AABB(float3(23.0f, -1.0f, -30.0f), float3(25.0f, 1.0f, -28.0f))));
+}
@@ -0,0 +1,201 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "OverlapPairs.h"
+#include "AABBTree.h"
+#include "uSTimer.h"
+#include <set>
+#include <algorithm>
+
+typedef std::set<std::pair<GameObject*, GameObject*>> PairSet;
+
+//Every pair of boxes once
+static PairSet BruteForcePairs(const std::vector<GameObject*> &objects)
+{
+	PairSet expectedPairs;
+	for(unsigned int i = 0; i < objects.size(); ++i)
+	{
+		for(unsigned int j = i + 1; j < objects.size(); ++j)
+		{
+			if (objects[i]->globalBoundingBox->Intersects(*objects[j]->globalBoundingBox))
+				expectedPairs.insert(std::minmax(objects[i], objects[j]));
+		}
+	}
+
+	return expectedPairs;
+}
+
+static PairSet KeptPairs(const OverlapPairs &pairs)
+{
+	std::vector<OverlapPair> currentPairs;
+	pairs.GetPairs(currentPairs);
+
+	PairSet keptPairs;
+	for(const auto& pair : currentPairs)
+	{
+		keptPairs.insert(std::minmax(pair.a, pair.b));
+	}
+
+	return keptPairs;
+}
+
+//Pairs rebuilt from the begin and end events
+static void ApplyEvents(const OverlapPairs &pairs, PairSet &eventPairs)
+{
+	for(const auto& pair : pairs.endPairs)
+	{
+		eventPairs.erase(std::minmax(pair.a, pair.b));
+	}
+	for(const auto& pair : pairs.beginPairs)
+	{
+		eventPairs.insert(std::minmax(pair.a, pair.b));
+	}
+
+	return;
+}
+
+//Some cubes take a random step every frame, the kept pairs and the events have to match every pair of boxes each frame
+TEST(OverlapPairsMatchBruteForce)
+{
+	std::mt19937 generator(5);
+	std::uniform_real_distribution<float> movement(-0.5f, 0.5f);
+	std::vector<GameObject*> objects;
+	CreateCubes(generator, 1500, objects);
+
+	AABBTree tree(10);
+	tree.Build(objects);
+	OverlapPairs pairs;
+	for(auto go : objects)
+	{
+		pairs.Add(go);
+	}
+
+	auto query = [&tree](VisibleList& candidates, const AABB* box)
+	{
+		tree.GetIntersection(candidates, box);
+	};
+
+	PairSet eventPairs;
+	pairs.Update(query);
+	ApplyEvents(pairs, eventPairs);
+	CHECK(KeptPairs(pairs) == BruteForcePairs(objects));
+	CHECK(eventPairs == BruteForcePairs(objects));
+
+	unsigned int beginCount = 0;
+	unsigned int endCount = 0;
+	for(unsigned int frame = 0; frame < 40; ++frame)
+	{
+		//From every cube moving to a few of them
+		std::vector<GameObject*> moved;
+		for(auto go : objects)
+		{
+			if (frame % 2 == 0 || generator() % 10 == 0)
+			{
+				go->globalBoundingBox->Translate(float3(movement(generator), 0.0f, movement(generator)));
+				pairs.MarkMoved(go);
+				moved.push_back(go);
+			}
+		}
+
+		tree.UpdateObjects(moved);
+		pairs.Update(query);
+		beginCount += pairs.beginPairs.size();
+		endCount += pairs.endPairs.size();
+		ApplyEvents(pairs, eventPairs);
+
+		PairSet expectedPairs = BruteForcePairs(objects);
+		CHECK(pairs.PairCount() == expectedPairs.size());
+		CHECK(KeptPairs(pairs) == expectedPairs);
+		CHECK(eventPairs == expectedPairs);
+	}
+
+	//The cubes met and parted
+	CHECK(beginCount > 0 && endCount > 0);
+
+	DeleteObjects(objects);
+}
+
+//A removed object loses its pairs without end events
+TEST(OverlapPairsRemove)
+{
+	std::vector<GameObject*> objects;
+	objects.push_back(CreateBoxObject(AABB(float3(0.0f), float3(1.0f))));
+	objects.push_back(CreateBoxObject(AABB(float3(0.5f), float3(1.5f))));
+	objects.push_back(CreateBoxObject(AABB(float3(0.9f), float3(2.0f))));
+
+	AABBTree tree(10);
+	tree.Build(objects);
+	OverlapPairs pairs;
+	for(auto go : objects)
+	{
+		pairs.Add(go);
+	}
+
+	auto query = [&tree](VisibleList& candidates, const AABB* box)
+	{
+		tree.GetIntersection(candidates, box);
+	};
+
+	pairs.Update(query);
+	CHECK(pairs.PairCount() == 3);
+	CHECK(pairs.beginPairs.size() == 3);
+
+	pairs.Remove(objects[1]);
+	tree.Remove(objects[1]);
+	pairs.Update(query);
+	CHECK(pairs.PairCount() == 1);
+	CHECK(pairs.endPairs.empty());
+	CHECK(pairs.Size() == 2);
+
+	//Nothing moved, nothing is checked
+	pairs.Update(query);
+	CHECK(pairs.movedCount == 0);
+	CHECK(pairs.beginPairs.empty() && pairs.endPairs.empty());
+
+	DeleteObjects(objects);
+}
+
+BENCHMARK(OverlapPairsOnMovingCubes)
+{
+	const unsigned int objectCount = 10000;
+	const unsigned int frames = 100;
+
+	std::mt19937 generator(objectCount);
+	std::uniform_real_distribution<float> movement(-0.25f, 0.25f);
+	std::vector<GameObject*> objects;
+	CreateCubes(generator, objectCount, objects);
+
+	AABBTree tree(10);
+	tree.Build(objects);
+	OverlapPairs pairs;
+	for(auto go : objects)
+	{
+		pairs.Add(go);
+	}
+
+	auto query = [&tree](VisibleList& candidates, const AABB* box)
+	{
+		tree.GetIntersection(candidates, box);
+	};
+	pairs.Update(query);
+
+	uSTimer timer;
+	float updateTime = 0.0f;
+	for(unsigned int frame = 0; frame < frames; ++frame)
+	{
+		for(auto go : objects)
+		{
+			go->globalBoundingBox->Translate(float3(movement(generator), 0.0f, movement(generator)));
+			pairs.MarkMoved(go);
+		}
+
+		timer.StartTimer();
+		tree.UpdateObjects(objects);
+		pairs.Update(query);
+		updateTime += timer.StopTimer();
+	}
+
+	CHECK(KeptPairs(pairs) == BruteForcePairs(objects));
+	printf("%u moving cubes, %u frames, %.3f ms/frame, %u pairs\n", objectCount, frames, updateTime / frames, pairs.PairCount());
+
+	DeleteObjects(objects);
+}
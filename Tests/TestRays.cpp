@@ -0,0 +1,187 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "AABBTree.h"
+#include "LooseOctree.h"
+#include "SpatialHashGrid.h"
+#include "JobSystem.h"
+#include "uSTimer.h"
+#include "MathGeoLib/Geometry/LineSegment.h"
+#include <math.h>
+
+static std::vector<LineSegment> RandomRays(std::mt19937 &generator, unsigned int count, float extent)
+{
+	std::uniform_real_distribution<float> position(-extent, extent);
+
+	std::vector<LineSegment> rays(count);
+	for(auto& ray : rays)
+	{
+		ray.a = float3(position(generator), position(generator), position(generator));
+		ray.b = float3(position(generator), position(generator), position(generator));
+	}
+
+	return rays;
+}
+
+//Random boxes with a mesh, the rays hit the sphere inscribed in each box
+static void CreateRandomMeshes(std::mt19937 &generator, unsigned int count, float extent, float minHalfSize, float maxHalfSize, std::vector<GameObject*> &objects)
+{
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		objects.push_back(CreateMeshObject(RandomBox(generator, extent, minHalfSize, maxHalfSize)));
+	}
+
+	return;
+}
+
+//Nearest object hit testing every object
+static RayHit RayCastAll(const std::vector<GameObject*> &objects, const LineSegment &ray)
+{
+	RayHit hit;
+	for(auto go : objects)
+	{
+		float distance = go->IsIntersectedByRay(ray, nullptr, nullptr);
+		if (distance >= 0.0f && distance < hit.distance)
+		{
+			hit.go = go;
+			hit.distance = distance;
+		}
+	}
+
+	return hit;
+}
+
+static bool SameHit(const RayHit &hit, GameObject* go, float distance)
+{
+	if (hit.go == nullptr || go == nullptr)
+		return hit.go == go;
+
+	//Two spheres hit at the same distance can come in any order
+	return fabsf(hit.distance - distance) < 1e-4f;
+}
+
+//Packets, single rays and every object give the same nearest hit in the three structures
+TEST(RayPacketsMatchSingleRays)
+{
+	TestTransforms transforms;
+	std::mt19937 generator(2);
+	std::vector<GameObject*> objects;
+	CreateRandomMeshes(generator, 2000, 500.0f, 0.5f, 20.0f, objects);
+	std::vector<LineSegment> rays = RandomRays(generator, 2000, 600.0f);
+
+	AABBTree tree(10);
+	tree.Build(objects);
+
+	LooseOctree octree;
+	AABB limits;
+	limits.SetNegativeInfinity();
+	for(auto go : objects)
+	{
+		limits.Enclose(*go->globalBoundingBox);
+	}
+	octree.Clear(limits);
+	for(auto go : objects)
+	{
+		octree.Insert(go);
+	}
+
+	SpatialHashGrid grid;
+	grid.Build(objects);
+
+	std::vector<RayHit> treeHits(rays.size());
+	std::vector<RayHit> octreeHits(rays.size());
+	std::vector<RayHit> gridHits(rays.size());
+	for(unsigned int begin = 0; begin < rays.size(); begin += RAY_PACKET_SIZE)
+	{
+		unsigned int count = std::min((unsigned int)rays.size() - begin, (unsigned int)RAY_PACKET_SIZE);
+		tree.RayCast(&rays[begin], &treeHits[begin], count);
+		octree.RayCast(&rays[begin], &octreeHits[begin], count);
+		grid.RayCast(&rays[begin], &gridHits[begin], count);
+	}
+
+	unsigned int hitCount = 0;
+	for(unsigned int i = 0; i < rays.size(); ++i)
+	{
+		RayHit expected = RayCastAll(objects, rays[i]);
+		if (expected.go != nullptr)
+			++hitCount;
+
+		float distance = 1.0f;
+		GameObject* go = tree.RayCast(rays[i], distance);
+		CHECK(SameHit(expected, go, distance));
+		CHECK(SameHit(expected, treeHits[i].go, treeHits[i].distance));
+
+		distance = 1.0f;
+		go = octree.RayCast(rays[i], distance);
+		CHECK(SameHit(expected, go, distance));
+		CHECK(SameHit(expected, octreeHits[i].go, octreeHits[i].distance));
+
+		distance = 1.0f;
+		go = grid.RayCast(rays[i], distance);
+		CHECK(SameHit(expected, go, distance));
+		CHECK(SameHit(expected, gridHits[i].go, gridHits[i].distance));
+	}
+
+	//Some rays hit and some miss
+	CHECK(hitCount > 0 && hitCount < rays.size());
+
+	DeleteObjects(objects);
+}
+
+//Rays from one point through the whole scene, as the picking of a camera, in packets on the job system and one by one
+BENCHMARK(RayPackets)
+{
+	const unsigned int rayCount = 20000;
+
+	TestTransforms transforms;
+	std::mt19937 generator(rayCount);
+	std::uniform_real_distribution<float> target(-500.0f, 500.0f);
+	std::vector<GameObject*> objects;
+	CreateRandomMeshes(generator, 20000, 500.0f, 0.5f, 10.0f, objects);
+
+	AABBTree tree(10);
+	tree.Build(objects);
+
+	std::vector<LineSegment> rays(rayCount);
+	for(auto& ray : rays)
+	{
+		ray.a = float3(0.0f, 0.0f, -1000.0f);
+		ray.b = float3(target(generator), target(generator), 1000.0f);
+	}
+
+	JobSystem jobs;
+	std::vector<RayHit> hits(rayCount);
+	unsigned int packetCount = (rayCount + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE;
+
+	uSTimer timer;
+	timer.StartTimer();
+	jobs.ParallelFor(packetCount, [&](unsigned int packet)
+	{
+		unsigned int begin = packet * RAY_PACKET_SIZE;
+		unsigned int count = std::min(rayCount - begin, (unsigned int)RAY_PACKET_SIZE);
+		tree.RayCast(&rays[begin], &hits[begin], count);
+	});
+	float packetTime = std::max(timer.StopTimer(), 0.001f);
+
+	timer.StartTimer();
+	unsigned int singleHits = 0;
+	for(const auto& ray : rays)
+	{
+		float distance = 1.0f;
+		if (tree.RayCast(ray, distance) != nullptr)
+			++singleHits;
+	}
+	float singleTime = std::max(timer.StopTimer(), 0.001f);
+
+	unsigned int packetHits = 0;
+	for(const auto& hit : hits)
+	{
+		if (hit.go != nullptr)
+			++packetHits;
+	}
+	CHECK(packetHits == singleHits);
+
+	printf("%u rays, %u hits. Packets on %u threads: %.0f rays/s. One by one: %.0f rays/s\n", rayCount, packetHits, jobs.ThreadCount(),
+		rayCount * 1000.0f / packetTime, rayCount * 1000.0f / singleTime);
+
+	DeleteObjects(objects);
+}
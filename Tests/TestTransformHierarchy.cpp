@@ -0,0 +1,429 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "TransformHierarchy.h"
+#include "JobSystem.h"
+#include "uSTimer.h"
+#include "MathGeoLib/Math/MathConstants.h"
+#include <random>
+#include <algorithm>
+#include <string.h>
+
+//Random forest: the first tenth are roots and the others hang from any transform made before them
+static std::vector<unsigned int> RandomParents(std::mt19937 &generator, unsigned int count)
+{
+	std::vector<unsigned int> parents(count, TRANSFORM_NULL_SLOT);
+	for(unsigned int i = count / 10; i < count; ++i)
+	{
+		parents[i] = std::uniform_int_distribution<unsigned int>(0, i - 1)(generator);
+	}
+
+	return parents;
+}
+
+static void RandomTRS(std::mt19937 &generator, float3 &position, Quat &rotation, float3 &scale)
+{
+	std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> angle(-pi, pi);
+	std::uniform_real_distribution<float> factor(0.9f, 1.1f);
+
+	position = float3(offset(generator), offset(generator), offset(generator));
+	rotation = Quat::FromEulerXYZ(angle(generator), angle(generator), angle(generator));
+	scale = float3(factor(generator), factor(generator), factor(generator));
+
+	return;
+}
+
+//Slots are added in a random order so the hierarchy has to be sorted before the first pass. Returns the slot of
+//each transform
+static std::vector<unsigned int> BuildShuffled(std::mt19937 &generator, const std::vector<unsigned int> &parents, TransformHierarchy &hierarchy)
+{
+	std::vector<unsigned int> order(parents.size());
+	for(unsigned int i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+	std::shuffle(order.begin(), order.end(), generator);
+
+	std::vector<unsigned int> slots(parents.size());
+	for(auto i : order)
+	{
+		slots[i] = hierarchy.Add(nullptr);
+		RandomTRS(generator, hierarchy.positions[slots[i]], hierarchy.rotations[slots[i]], hierarchy.scales[slots[i]]);
+	}
+	for(unsigned int i = 0; i < parents.size(); ++i)
+	{
+		if (parents[i] != TRANSFORM_NULL_SLOT)
+			hierarchy.SetParent(slots[i], slots[parents[i]]);
+	}
+
+	return slots;
+}
+
+//Every world matrix has to be the world of its parent times its local matrix
+static bool IsConsistent(const TransformHierarchy &hierarchy)
+{
+	if (!hierarchy.IsSorted())
+		return false;
+
+	for(unsigned int i = 0; i < hierarchy.Size(); ++i)
+	{
+		unsigned int parent = hierarchy.GetParent(i);
+		float4x4 local = float4x4::FromTRS(hierarchy.positions[i], hierarchy.rotations[i], hierarchy.scales[i]);
+		float4x4 world = (parent == TRANSFORM_NULL_SLOT) ? local : hierarchy.worldMatrices[parent] * local;
+		if ((parent != TRANSFORM_NULL_SLOT && parent > i) || !hierarchy.worldMatrices[i].Equals(world))
+			return false;
+	}
+
+	return true;
+}
+
+TEST(TransformHierarchyMatchesParents)
+{
+	const unsigned int transformCount = 5000;
+	std::mt19937 generator(1);
+	std::vector<unsigned int> parents = RandomParents(generator, transformCount);
+
+	TransformHierarchy hierarchy;
+	BuildShuffled(generator, parents, hierarchy);
+	CHECK(!hierarchy.IsSorted());
+
+	//A single pass after the sort gives every world matrix from the final world of its parent
+	hierarchy.Update();
+	CHECK(hierarchy.Size() == transformCount);
+	CHECK(hierarchy.changedSlots.size() == transformCount);
+	CHECK(IsConsistent(hierarchy));
+
+	//The sort moves the slots, not the links between them
+	unsigned int rootCount = 0;
+	for(unsigned int i = 0; i < transformCount; ++i)
+	{
+		if (hierarchy.GetParent(i) == TRANSFORM_NULL_SLOT)
+			++rootCount;
+	}
+	CHECK(rootCount == transformCount / 10);
+
+	//Moving a transform under a later slot sorts again
+	std::uniform_int_distribution<unsigned int> randomSlot(0, transformCount - 1);
+	for(unsigned int frame = 0; frame < 10; ++frame)
+	{
+		for(unsigned int i = 0; i < transformCount / 10; ++i)
+		{
+			unsigned int slot = randomSlot(generator);
+			hierarchy.positions[slot] += float3(0.1f, 0.0f, 0.0f);
+			hierarchy.MarkDirty(slot);
+		}
+		hierarchy.Update();
+		CHECK(IsConsistent(hierarchy));
+	}
+
+	//A root added after the deepest level and the first root moved under it, the slots are sorted again once
+	unsigned int sortCount = hierarchy.sortCount;
+	unsigned int newRoot = hierarchy.Add(nullptr);
+	hierarchy.SetParent(0, newRoot);
+	hierarchy.Update();
+	CHECK(hierarchy.sortCount == sortCount + 1);
+	CHECK(hierarchy.Size() == transformCount + 1);
+	CHECK(IsConsistent(hierarchy));
+
+	//Nothing dirty, nothing is walked
+	hierarchy.Update();
+	CHECK(hierarchy.changedSlots.empty());
+}
+
+//One linear pass over the whole hierarchy and a pass with one transform in a hundred moving, against the per object
+//update it replaced
+BENCHMARK(TransformPasses)
+{
+	const unsigned int transformCount = 100000;
+	const unsigned int frames = 100;
+
+	std::mt19937 generator(transformCount);
+	std::vector<unsigned int> parents = RandomParents(generator, transformCount);
+
+	//Per object update as it was done before: objects on the heap walked in pointer order, as the std::set of dynamic objects was
+	struct Node
+	{
+		Node* parent = nullptr;
+		float3 position;
+		Quat rotation;
+		float3 scale;
+		float4x4 localModelMatrix = float4x4::identity;
+		float4x4 globalModelMatrix = float4x4::identity;
+	};
+	std::vector<Node*> nodes(transformCount);
+	for(unsigned int i = 0; i < transformCount; ++i)
+	{
+		nodes[i] = new Node();
+		RandomTRS(generator, nodes[i]->position, nodes[i]->rotation, nodes[i]->scale);
+		if (parents[i] != TRANSFORM_NULL_SLOT)
+			nodes[i]->parent = nodes[parents[i]];
+	}
+
+	TransformHierarchy hierarchy;
+	BuildShuffled(generator, parents, hierarchy);
+
+	uSTimer timer;
+	timer.StartTimer();
+	hierarchy.Update();
+	float firstUpdateTime = timer.StopTimer();
+
+	//Every transform changes, the same work as the per object update
+	timer.StartTimer();
+	for(unsigned int frame = 0; frame < frames; ++frame)
+	{
+		for(unsigned int i = 0; i < transformCount; ++i)
+		{
+			hierarchy.MarkDirty(i);
+		}
+		hierarchy.Update();
+	}
+	float linearTime = timer.StopTimer() / frames;
+
+	std::uniform_int_distribution<unsigned int> randomSlot(0, transformCount - 1);
+	unsigned int recomputed = 0;
+	float fewDirtyTime = 0.0f;
+	for(unsigned int frame = 0; frame < frames; ++frame)
+	{
+		for(unsigned int i = 0; i < transformCount / 100; ++i)
+		{
+			unsigned int slot = randomSlot(generator);
+			hierarchy.positions[slot] += float3(0.1f, 0.0f, 0.0f);
+			hierarchy.MarkDirty(slot);
+		}
+
+		timer.StartTimer();
+		hierarchy.Update();
+		fewDirtyTime += timer.StopTimer();
+		recomputed += hierarchy.changedSlots.size();
+	}
+	CHECK(IsConsistent(hierarchy));
+
+	std::vector<Node*> pointerOrder = nodes;
+	std::sort(pointerOrder.begin(), pointerOrder.end());
+	timer.StartTimer();
+	for(unsigned int frame = 0; frame < frames; ++frame)
+	{
+		for(auto node : pointerOrder)
+		{
+			if (node->parent != nullptr)
+				node->globalModelMatrix = node->parent->globalModelMatrix * node->localModelMatrix;
+
+			node->globalModelMatrix = node->globalModelMatrix * node->localModelMatrix.Inverted();
+			node->localModelMatrix = float4x4::FromTRS(node->position, node->rotation, node->scale);
+			node->globalModelMatrix = node->globalModelMatrix * node->localModelMatrix;
+		}
+	}
+	float perObjectTime = timer.StopTimer() / frames;
+
+	printf("%u transforms, %u frames. Linear pass %.3f ms/frame (first with sort %.3f ms), per object %.3f ms/frame. "
+		"1%% dirty %.3f ms/frame, %u recomputed per frame\n", transformCount, frames, linearTime, firstUpdateTime, perObjectTime,
+		fewDirtyTime / frames, recomputed / frames);
+
+	for(auto node : nodes)
+	{
+		delete node;
+	}
+}
+
+//Only the dirty slots and their descendants are recomputed, the other world matrices are not touched
+TEST(TransformHierarchyRecomputesDirtySubtrees)
+{
+	const unsigned int transformCount = 5000;
+	std::mt19937 generator(2);
+	std::vector<unsigned int> parents = RandomParents(generator, transformCount);
+
+	TransformHierarchy hierarchy;
+	BuildShuffled(generator, parents, hierarchy);
+	hierarchy.Update();
+
+	std::uniform_int_distribution<unsigned int> randomSlot(0, transformCount - 1);
+	for(unsigned int frame = 0; frame < 10; ++frame)
+	{
+		std::vector<float4x4> previousMatrices = hierarchy.worldMatrices;
+		std::vector<bool> expected(transformCount, false);
+		for(unsigned int i = 0; i < 1 + frame * 5; ++i)
+		{
+			unsigned int slot = randomSlot(generator);
+			hierarchy.positions[slot] += float3(0.1f, 0.0f, 0.0f);
+			hierarchy.MarkDirty(slot);
+			expected[slot] = true;
+		}
+
+		//Parents come before their children, one forward pass marks every descendant
+		for(unsigned int i = 0; i < transformCount; ++i)
+		{
+			unsigned int parent = hierarchy.GetParent(i);
+			if (parent != TRANSFORM_NULL_SLOT && expected[parent])
+				expected[i] = true;
+		}
+
+		hierarchy.Update();
+		CHECK(IsConsistent(hierarchy));
+
+		unsigned int expectedCount = 0;
+		for(unsigned int i = 0; i < transformCount; ++i)
+		{
+			CHECK(hierarchy.HasChanged(i) == expected[i]);
+			if (expected[i])
+				++expectedCount;
+			else
+				CHECK(memcmp(&hierarchy.worldMatrices[i], &previousMatrices[i], sizeof(float4x4)) == 0);
+		}
+
+		//In hierarchy order, each changed slot once
+		CHECK(hierarchy.changedSlots.size() == expectedCount);
+		CHECK(std::is_sorted(hierarchy.changedSlots.begin(), hierarchy.changedSlots.end()));
+		for(auto slot : hierarchy.changedSlots)
+		{
+			CHECK(expected[slot]);
+		}
+	}
+}
+
+TEST(TransformHierarchyDirtyLeafAndRoot)
+{
+	//A root and root -> child -> leaf, added by depth so the slots are not moved
+	TransformHierarchy hierarchy;
+	unsigned int other = hierarchy.Add(nullptr);
+	unsigned int root = hierarchy.Add(nullptr);
+	unsigned int child = hierarchy.Add(nullptr, root);
+	unsigned int leaf = hierarchy.Add(nullptr, child);
+	CHECK(hierarchy.IsSorted());
+	hierarchy.positions[root] = float3(1.0f, 0.0f, 0.0f);
+	hierarchy.positions[child] = float3(0.0f, 2.0f, 0.0f);
+	hierarchy.positions[leaf] = float3(0.0f, 0.0f, 3.0f);
+	hierarchy.Update();
+	CHECK(hierarchy.changedSlots.size() == 4);
+	CHECK(hierarchy.worldMatrices[leaf].TranslatePart().Equals(float3(1.0f, 2.0f, 3.0f)));
+
+	hierarchy.positions[leaf] = float3(0.0f, 0.0f, 4.0f);
+	hierarchy.MarkDirty(leaf);
+	hierarchy.Update();
+	CHECK(hierarchy.changedSlots == std::vector<unsigned int>({ leaf }));
+	CHECK(hierarchy.worldMatrices[leaf].TranslatePart().Equals(float3(1.0f, 2.0f, 4.0f)));
+
+	hierarchy.positions[root] = float3(5.0f, 0.0f, 0.0f);
+	hierarchy.MarkDirty(root);
+	hierarchy.Update();
+	CHECK(hierarchy.changedSlots.size() == 3 && !hierarchy.HasChanged(other));
+	CHECK(hierarchy.worldMatrices[leaf].TranslatePart().Equals(float3(5.0f, 2.0f, 4.0f)));
+}
+
+//Random forest added by depth, every object moves every frame and its transform and world bounds are updated as
+//ModuleScene does, on threadCount threads. Returns the world matrices and the boxes of the last frame
+static float MoveObjects(unsigned int objectCount, unsigned int frames, unsigned int threadCount, std::vector<float4x4> &matrices, std::vector<AABB> &boxes)
+{
+	std::mt19937 generator(objectCount);
+	std::vector<unsigned int> parents = RandomParents(generator, objectCount);
+	std::vector<unsigned int> depths(objectCount, 0);
+	for(unsigned int i = 0; i < objectCount; ++i)
+	{
+		if (parents[i] != TRANSFORM_NULL_SLOT)
+			depths[i] = depths[parents[i]] + 1;
+	}
+
+	std::vector<unsigned int> order(objectCount);
+	for(unsigned int i = 0; i < objectCount; ++i)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&depths](unsigned int a, unsigned int b) { return depths[a] < depths[b]; });
+	std::vector<unsigned int> slots(objectCount);
+	for(unsigned int i = 0; i < objectCount; ++i)
+	{
+		slots[order[i]] = i;
+	}
+
+	TransformHierarchy hierarchy;
+	std::vector<GameObject*> objects;
+	for(auto i : order)
+	{
+		unsigned int slot = hierarchy.Add(nullptr, (parents[i] == TRANSFORM_NULL_SLOT) ? TRANSFORM_NULL_SLOT : slots[parents[i]]);
+		RandomTRS(generator, hierarchy.positions[slot], hierarchy.rotations[slot], hierarchy.scales[slot]);
+
+		objects.push_back(CreateBoxObject(AABB(float3(-0.5f), float3(0.5f))));
+	}
+
+	JobSystem* pool = (threadCount > 1) ? new JobSystem(threadCount - 1) : nullptr;
+	auto updateBounds = [&hierarchy, &objects](unsigned int begin, unsigned int end)
+	{
+		for(unsigned int i = begin; i < end; ++i)
+		{
+			unsigned int slot = hierarchy.changedSlots[i];
+			objects[slot]->UpdateBoundingBox(hierarchy.worldMatrices[slot]);
+		}
+	};
+
+	uSTimer timer;
+	float time = 0.0f;
+	for(unsigned int frame = 0; frame < frames; ++frame)
+	{
+		for(unsigned int slot = 0; slot < objectCount; ++slot)
+		{
+			hierarchy.positions[slot] += float3(0.01f, 0.0f, 0.0f);
+			hierarchy.MarkDirty(slot);
+		}
+
+		timer.StartTimer();
+		hierarchy.Update(pool);
+		if (pool != nullptr)
+			pool->ParallelForRange(hierarchy.changedSlots.size(), TRANSFORM_PARALLEL_MIN_SLOTS / 4, updateBounds);
+		else
+			updateBounds(0, hierarchy.changedSlots.size());
+		time += timer.StopTimer();
+	}
+
+	matrices = hierarchy.worldMatrices;
+	boxes.clear();
+	for(auto go : objects)
+	{
+		boxes.push_back(*go->globalBoundingBox);
+	}
+
+	delete pool;
+	DeleteObjects(objects);
+
+	return time / frames;
+}
+
+//Every slot is computed the same way by any thread, the results are the serial ones bit for bit
+TEST(ParallelTransformsMatchSerial)
+{
+	//Big enough for the levels to be split between the threads
+	const unsigned int objectCount = 8 * TRANSFORM_PARALLEL_MIN_SLOTS;
+
+	std::vector<float4x4> serialMatrices;
+	std::vector<AABB> serialBoxes;
+	MoveObjects(objectCount, 5, 1, serialMatrices, serialBoxes);
+
+	std::vector<float4x4> matrices;
+	std::vector<AABB> boxes;
+	for(unsigned int threadCount = 2; threadCount <= 8; threadCount *= 2)
+	{
+		MoveObjects(objectCount, 5, threadCount, matrices, boxes);
+		CHECK(matrices.size() == objectCount && boxes.size() == objectCount);
+		CHECK(memcmp(&serialMatrices[0], &matrices[0], objectCount * sizeof(float4x4)) == 0);
+		CHECK(memcmp(&serialBoxes[0], &boxes[0], objectCount * sizeof(AABB)) == 0);
+	}
+}
+
+BENCHMARK(ParallelTransforms)
+{
+	const unsigned int objectCount = 100000;
+	const unsigned int frames = 50;
+
+	std::vector<float4x4> serialMatrices;
+	std::vector<AABB> serialBoxes;
+	float serialTime = MoveObjects(objectCount, frames, 1, serialMatrices, serialBoxes);
+	printf("%u moving objects, %u frames. Transforms and bounds ms/frame: 1 thread %.3f", objectCount, frames, serialTime);
+
+	std::vector<float4x4> matrices;
+	std::vector<AABB> boxes;
+	for(unsigned int threadCount = 2; threadCount <= 8; threadCount *= 2)
+	{
+		float time = MoveObjects(objectCount, frames, threadCount, matrices, boxes);
+		CHECK(memcmp(&serialMatrices[0], &matrices[0], objectCount * sizeof(float4x4)) == 0);
+		printf(", %u threads %.3f", threadCount, time);
+	}
+	printf("\n");
+}
@@ -0,0 +1,192 @@
+#include "Test.h"
+#include "TestObjects.h"
+#include "VisibilityCache.h"
+#include "MultiViewCuller.h"
+#include "FrustumCuller.h"
+#include "LooseOctree.h"
+#include "VisibleList.h"
+#include "ComponentCamera.h"
+#include "MathGeoLib/Math/float3x3.h"
+
+static Frustum CreateView(const float3 &pos, const float3 &front)
+{
+	Frustum frustum;
+	frustum.type = FrustumType::PerspectiveFrustum;
+	frustum.pos = pos;
+	frustum.front = front.Normalized();
+	frustum.up = frustum.front.Perpendicular();
+	frustum.nearPlaneDistance = 0.1f;
+	frustum.farPlaneDistance = 120.0f;
+	frustum.verticalFov = 1.0f;
+	frustum.horizontalFov = 1.2f;
+
+	return frustum;
+}
+
+//Objects of the octree against a fresh test of every view. Visible views are always exact, a patched inside view
+//can be reported as crossing. Returns the inside views reported as crossing
+static unsigned int CheckCollectedMasks(const VisibleList &visible, const std::vector<GameObject*> &objects, const MultiViewCuller &views, bool isExact)
+{
+	unsigned int downgradedCount = 0;
+	for(auto go : objects)
+	{
+		unsigned int expectedVisible = 0;
+		unsigned int expectedInside = 0;
+		for(unsigned int v = 0; v < views.ViewCount(); ++v)
+		{
+			int result = views.GetView(v).TestAABB(*go->globalBoundingBox);
+			if (result != AABB_OUT)
+				expectedVisible |= 1 << v;
+			if (result == AABB_IN)
+				expectedInside |= 1 << v;
+		}
+
+		if (go->octreeItemIndex == OCTREE_NULL_ITEM || !visible.Contains(go))
+		{
+			CHECK(go->octreeItemIndex == OCTREE_NULL_ITEM || expectedVisible == 0);
+			continue;
+		}
+
+		CHECK(go->visibleViews == expectedVisible);
+		CHECK((go->insideViews & ~expectedInside) == 0);
+		CHECK(!isExact || go->insideViews == expectedInside);
+		if (go->insideViews != expectedInside)
+			++downgradedCount;
+	}
+
+	return downgradedCount;
+}
+
+static VisibilityCache::CacheResult Collect(VisibilityCache &cache, const std::vector<Frustum> &frustums, LooseOctree &octree,
+	unsigned int staticEpoch, MultiViewCuller &views, VisibleList &visible)
+{
+	views.ClearViews();
+	for(const auto& frustum : frustums)
+	{
+		views.AddView(frustum);
+	}
+
+	visible.Begin();
+	return cache.Collect(views, octree, staticEpoch, visible);
+}
+
+//A camera that stays, moves slowly, turns, jumps away and sees the static objects change
+TEST(VisibilityCacheMatchesFreshTests)
+{
+	std::mt19937 generator(16);
+	std::vector<GameObject*> objects;
+	CreateRandomBoxes(generator, 4000, 150.0f, 0.5f, 6.0f, objects);
+
+	LooseOctree octree;
+	octree.Clear(AABB(float3(-160.0f), float3(160.0f)));
+	for(auto go : objects)
+	{
+		octree.Insert(go);
+	}
+
+	std::vector<Frustum> frustums;
+	frustums.push_back(CreateView(float3(0.0f), float3(0.0f, 0.0f, 1.0f)));
+	frustums.push_back(CreateView(float3(20.0f, 5.0f, -10.0f), float3(1.0f, 0.2f, 1.0f)));
+
+	VisibilityCache cache;
+	MultiViewCuller views;
+	VisibleList visible;
+	unsigned int staticEpoch = 1;
+
+	CHECK(Collect(cache, frustums, octree, staticEpoch, views, visible) == VisibilityCache::CACHE_REBUILT);
+	CHECK(cache.candidateCount > 0 && visible.Size() > 0);
+	CheckCollectedMasks(visible, objects, views, true);
+
+	//Same matrices, nothing is tested
+	CHECK(Collect(cache, frustums, octree, staticEpoch, views, visible) == VisibilityCache::CACHE_REUSED);
+	CHECK(cache.retestedCount == 0);
+	CheckCollectedMasks(visible, objects, views, true);
+
+	//Small steps, the drift grows from the views of the rebuild so more boxes near the planes are tested each frame
+	//and inside views of the boxes that may have reached a plane are reported as crossing
+	unsigned int retestedCount = 0;
+	unsigned int downgradedCount = 0;
+	for(unsigned int frame = 0; frame < 20; ++frame)
+	{
+		for(auto& frustum : frustums)
+		{
+			frustum.pos += float3(0.02f, 0.0f, 0.01f);
+		}
+
+		CHECK(Collect(cache, frustums, octree, staticEpoch, views, visible) == VisibilityCache::CACHE_PATCHED);
+		CHECK(cache.retestedCount <= cache.candidateCount * VISIBILITY_CACHE_MAX_RETEST);
+		retestedCount += cache.retestedCount;
+		downgradedCount += CheckCollectedMasks(visible, objects, views, false);
+	}
+	CHECK(retestedCount > 0 && downgradedCount > 0);
+
+	//Turned enough to bring a plane across many boxes while staying in the candidate box
+	unsigned int candidateCount = cache.candidateCount;
+	frustums[0].front = float3x3::RotateY(0.15f) * frustums[0].front;
+	frustums[0].up = frustums[0].front.Perpendicular();
+	CHECK(Collect(cache, frustums, octree, staticEpoch, views, visible) == VisibilityCache::CACHE_REBUILT);
+	CHECK(cache.retestedCount > candidateCount * VISIBILITY_CACHE_MAX_RETEST);
+	CheckCollectedMasks(visible, objects, views, true);
+
+	//Out of the candidate box
+	frustums[1].pos += float3(-200.0f, 0.0f, 0.0f);
+	CHECK(Collect(cache, frustums, octree, staticEpoch, views, visible) == VisibilityCache::CACHE_REBUILT);
+	CHECK(cache.retestedCount == 0);
+	CheckCollectedMasks(visible, objects, views, true);
+
+	//Static objects changed, the removed ones are not seen anymore
+	for(unsigned int i = 0; i < objects.size(); i += 3)
+	{
+		octree.Remove(objects[i]);
+	}
+	CHECK(Collect(cache, frustums, octree, staticEpoch, views, visible) == VisibilityCache::CACHE_REUSED);
+	++staticEpoch;
+	CHECK(Collect(cache, frustums, octree, staticEpoch, views, visible) == VisibilityCache::CACHE_REBUILT);
+	for(unsigned int i = 0; i < objects.size(); i += 3)
+	{
+		CHECK(!visible.Contains(objects[i]));
+	}
+	CheckCollectedMasks(visible, objects, views, true);
+
+	//A view less
+	frustums.pop_back();
+	CHECK(Collect(cache, frustums, octree, staticEpoch, views, visible) == VisibilityCache::CACHE_REBUILT);
+	CheckCollectedMasks(visible, objects, views, true);
+
+	//Invalidated
+	cache.Invalidate();
+	CHECK(Collect(cache, frustums, octree, staticEpoch, views, visible) == VisibilityCache::CACHE_REBUILT);
+	CheckCollectedMasks(visible, objects, views, true);
+
+	DeleteObjects(objects);
+}
+
+//Disabled objects keep their place in the cache but are not collected
+TEST(VisibilityCacheSkipsDisabledObjects)
+{
+	std::vector<GameObject*> objects;
+	objects.push_back(CreateBoxObject(AABB(float3(-1.0f, -1.0f, 10.0f), float3(1.0f, 1.0f, 12.0f))));
+	objects.push_back(CreateBoxObject(AABB(float3(-1.0f, -1.0f, 20.0f), float3(1.0f, 1.0f, 22.0f))));
+
+	LooseOctree octree;
+	for(auto go : objects)
+	{
+		octree.Insert(go);
+	}
+
+	std::vector<Frustum> frustums;
+	frustums.push_back(CreateView(float3(0.0f), float3(0.0f, 0.0f, 1.0f)));
+	VisibilityCache cache;
+	MultiViewCuller views;
+	VisibleList visible;
+
+	CHECK(Collect(cache, frustums, octree, 0, views, visible) == VisibilityCache::CACHE_REBUILT);
+	CHECK(visible.Size() == 2);
+	CHECK(objects[0]->visibleViews == 1 && objects[0]->insideViews == 1);
+
+	objects[1]->isEnabled = false;
+	CHECK(Collect(cache, frustums, octree, 0, views, visible) == VisibilityCache::CACHE_REUSED);
+	CHECK(visible.Size() == 1 && visible[0] == objects[0]);
+
+	DeleteObjects(objects);
+}
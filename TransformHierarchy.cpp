@@ -0,0 +1,284 @@
+#include "TransformHierarchy.h"
+#include "ComponentTransform.h"
+#include "JobSystem.h"
+#include <assert.h>
+#include <algorithm>
+
+unsigned int TransformHierarchy::Add(ComponentTransform* owner, unsigned int parent)
+{
+	unsigned int slot = parents.size();
+	positions.push_back(float3::zero);
+	rotations.push_back(Quat::identity);
+	scales.push_back(float3::one);
+	localMatrices.push_back(float4x4::identity);
+	worldMatrices.push_back(float4x4::identity);
+	parents.push_back(TRANSFORM_NULL_SLOT);
+	owners.push_back(owner);
+	removed.push_back(false);
+	dirty.push_back(0);
+	changed.push_back(0);
+
+	parents[slot] = parent;
+	unsigned int depth = (parent == TRANSFORM_NULL_SLOT) ? 0 : depths[parent] + 1;
+	depths.push_back(depth);
+	MarkDirty(slot);
+
+	//New slots go at the end, the levels are kept when it is as deep as the last level or one more
+	if (isSorted)
+	{
+		if (depth == levelStarts.size())
+			levelStarts.push_back(slot);
+		else if (depth + 1 != levelStarts.size())
+			isSorted = false;
+	}
+
+	return slot;
+}
+
+void TransformHierarchy::Remove(unsigned int slot)
+{
+	assert(!removed[slot]);
+
+	//Removed slots are dropped the next time the arrays are sorted
+	if (dirty[slot])
+	{
+		dirty[slot] = 0;
+		--dirtyCount;
+	}
+	removed[slot] = true;
+	owners[slot] = nullptr;
+	parents[slot] = TRANSFORM_NULL_SLOT;
+	++removedCount;
+	isSorted = false;
+
+	return;
+}
+
+void TransformHierarchy::SetParent(unsigned int slot, unsigned int parent)
+{
+	assert(parent != slot);
+
+	parents[slot] = parent;
+	MarkDirty(slot);
+
+	//Descendants of the slot come after it, only this link can break the order. The slot has to stay in its level
+	if (isSorted)
+	{
+		unsigned int depth = (parent == TRANSFORM_NULL_SLOT) ? 0 : depths[parent] + 1;
+		if ((parent != TRANSFORM_NULL_SLOT && parent > slot) || depth != depths[slot])
+			isSorted = false;
+	}
+
+	return;
+}
+
+void TransformHierarchy::MarkDirty(unsigned int slot)
+{
+	if (dirty[slot])
+		return;
+
+	dirty[slot] = 1;
+	++dirtyCount;
+	firstDirty = std::min(firstDirty, slot);
+
+	return;
+}
+
+void TransformHierarchy::Update(JobSystem* jobs)
+{
+	for(auto slot : changedSlots)
+	{
+		changed[slot] = 0;
+	}
+	changedSlots.clear();
+
+	if (!isSorted)
+		SortByDepth();
+
+	if (dirtyCount == 0)
+		return;
+
+	//Levels from the one of the first dirty slot, the slots of a level only read the levels before it
+	unsigned int level = std::upper_bound(levelStarts.begin(), levelStarts.end(), firstDirty) - levelStarts.begin() - 1;
+	for(; level < levelStarts.size(); ++level)
+	{
+		unsigned int begin = std::max(levelStarts[level], firstDirty);
+		unsigned int end = (level + 1 < levelStarts.size()) ? levelStarts[level + 1] : parents.size();
+		if (jobs == nullptr || end - begin < TRANSFORM_PARALLEL_MIN_SLOTS)
+		{
+			UpdateRange(begin, end);
+			continue;
+		}
+
+		jobs->ParallelForRange(end - begin, TRANSFORM_PARALLEL_MIN_SLOTS / 4, [this, begin](unsigned rangeBegin, unsigned rangeEnd)
+		{
+			UpdateRange(begin + rangeBegin, begin + rangeEnd);
+		});
+	}
+
+	//Same list in the same order with any number of threads
+	for(unsigned int i = firstDirty; i < parents.size(); ++i)
+	{
+		if (changed[i])
+			changedSlots.push_back(i);
+	}
+	dirtyCount = 0;
+	firstDirty = TRANSFORM_NULL_SLOT;
+
+	return;
+}
+
+void TransformHierarchy::UpdateRange(unsigned int begin, unsigned int end)
+{
+	//Parents are in earlier levels, their world matrix is already computed and flagged when it changed
+	for(unsigned int i = begin; i < end; ++i)
+	{
+		unsigned int parent = parents[i];
+		if (!dirty[i] && (parent == TRANSFORM_NULL_SLOT || !changed[parent]))
+			continue;
+
+		if (dirty[i])
+			localMatrices[i] = float4x4::FromTRS(positions[i], rotations[i], scales[i]);
+
+		if (parent == TRANSFORM_NULL_SLOT)
+			worldMatrices[i] = localMatrices[i];
+		else
+			worldMatrices[i] = worldMatrices[parent] * localMatrices[i];
+
+		dirty[i] = 0;
+		changed[i] = 1;
+	}
+
+	return;
+}
+
+void TransformHierarchy::UpdateSlot(unsigned int slot)
+{
+	localMatrices[slot] = float4x4::FromTRS(positions[slot], rotations[slot], scales[slot]);
+	if (parents[slot] == TRANSFORM_NULL_SLOT)
+		worldMatrices[slot] = localMatrices[slot];
+	else
+		worldMatrices[slot] = worldMatrices[parents[slot]] * localMatrices[slot];
+
+	return;
+}
+
+void TransformHierarchy::SortByDepth()
+{
+	unsigned int count = parents.size();
+
+	//Depth of every slot, parents can come after their children until the slots are sorted
+	const unsigned int unknownDepth = 0xffffffff;
+	depths.assign(count, unknownDepth);
+	std::vector<unsigned int> path;
+	unsigned int maxDepth = 0;
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		if (removed[i])
+			continue;
+
+		if (parents[i] != TRANSFORM_NULL_SLOT && removed[parents[i]])
+		{
+			parents[i] = TRANSFORM_NULL_SLOT;
+			if (!dirty[i])
+			{
+				dirty[i] = 1;
+				++dirtyCount;
+			}
+		}
+	}
+
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		if (removed[i])
+			continue;
+
+		path.clear();
+		unsigned int slot = i;
+		while (slot != TRANSFORM_NULL_SLOT && depths[slot] == unknownDepth)
+		{
+			path.push_back(slot);
+			slot = parents[slot];
+		}
+
+		unsigned int depth = (slot == TRANSFORM_NULL_SLOT) ? 0 : depths[slot] + 1;
+		for(unsigned int j = path.size(); j > 0; --j)
+		{
+			depths[path[j - 1]] = depth++;
+		}
+		maxDepth = std::max(maxDepth, depths[i]);
+	}
+
+	//Counting sort by depth, slots of the same depth keep their order
+	std::vector<unsigned int> firstOfDepth(maxDepth + 1, 0);
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		if (!removed[i])
+			++firstOfDepth[depths[i]];
+	}
+
+	unsigned int offset = 0;
+	for(auto& first : firstOfDepth)
+	{
+		unsigned int depthCount = first;
+		first = offset;
+		offset += depthCount;
+	}
+	levelStarts = firstOfDepth;
+
+	std::vector<unsigned int> newSlots(count, TRANSFORM_NULL_SLOT);
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		if (!removed[i])
+			newSlots[i] = firstOfDepth[depths[i]]++;
+	}
+
+	unsigned int newCount = count - removedCount;
+	std::vector<float3> newPositions(newCount);
+	std::vector<Quat> newRotations(newCount);
+	std::vector<float3> newScales(newCount);
+	std::vector<float4x4> newLocalMatrices(newCount);
+	std::vector<float4x4> newWorldMatrices(newCount);
+	std::vector<unsigned int> newParents(newCount);
+	std::vector<ComponentTransform*> newOwners(newCount);
+	std::vector<unsigned char> newDirty(newCount);
+	std::vector<unsigned int> newDepths(newCount);
+	firstDirty = TRANSFORM_NULL_SLOT;
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		if (removed[i])
+			continue;
+
+		unsigned int slot = newSlots[i];
+		newPositions[slot] = positions[i];
+		newRotations[slot] = rotations[i];
+		newScales[slot] = scales[i];
+		newLocalMatrices[slot] = localMatrices[i];
+		newWorldMatrices[slot] = worldMatrices[i];
+		newParents[slot] = (parents[i] == TRANSFORM_NULL_SLOT) ? TRANSFORM_NULL_SLOT : newSlots[parents[i]];
+		newOwners[slot] = owners[i];
+		newDirty[slot] = dirty[i];
+		newDepths[slot] = depths[i];
+		if (dirty[i])
+			firstDirty = std::min(firstDirty, slot);
+		if (owners[i] != nullptr)
+			owners[i]->slot = slot;
+	}
+
+	positions.swap(newPositions);
+	rotations.swap(newRotations);
+	scales.swap(newScales);
+	localMatrices.swap(newLocalMatrices);
+	worldMatrices.swap(newWorldMatrices);
+	parents.swap(newParents);
+	owners.swap(newOwners);
+	dirty.swap(newDirty);
+	depths.swap(newDepths);
+	changed.assign(newCount, 0);
+	removed.assign(newCount, false);
+	removedCount = 0;
+	isSorted = true;
+	++sortCount;
+
+	return;
+}
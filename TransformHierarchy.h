@@ -0,0 +1,89 @@
+#ifndef __TransformHierarchy_H__
+#define __TransformHierarchy_H__
+
+#include "Globals.h"
+#include "MathGeoLib/Math/float3.h"
+#include "MathGeoLib/Math/Quat.h"
+#include "MathGeoLib/Math/float4x4.h"
+#include <vector>
+
+#define TRANSFORM_NULL_SLOT 0xffffffff
+//Levels with fewer slots to update are done on the calling thread
+#define TRANSFORM_PARALLEL_MIN_SLOTS 4096
+
+class ComponentTransform;
+class JobSystem;
+
+//Local and world transforms of the whole scene in contiguous arrays
+//Slots are sorted by hierarchy depth so every parent comes before its children and the world matrices are computed
+//in one forward pass, world = parent world * local, without inverses.
+//Adding a transform or giving it a parent that comes before it keeps the order, removing or moving it under a later
+//slot sorts again in the next update. Components keep their slot, it is updated when the arrays are sorted.
+//Only dirty slots and their descendants are recomputed: a slot is taken when it is dirty or its parent changed in
+//the same pass, and nothing is walked when no slot is dirty.
+//Each depth level is a range of slots whose parents are in the levels before it, big levels are split between the
+//worker threads. Every slot is computed the same way by any thread so the results don't depend on the thread count.
+class TransformHierarchy
+{
+public:
+	TransformHierarchy() = default;
+	~TransformHierarchy() = default;
+
+	//Owner can be nullptr for transforms that only live in the hierarchy
+	unsigned int Add(ComponentTransform* owner, unsigned int parent = TRANSFORM_NULL_SLOT);
+	//Children of a removed slot become roots
+	void Remove(unsigned int slot);
+	//The slot gets its new parent world in the next update
+	void SetParent(unsigned int slot, unsigned int parent);
+	//Local TRS changed, the slot and its descendants are recomputed in the next update
+	void MarkDirty(unsigned int slot);
+
+	//Sorts the slots if needed and computes the matrices of the dirty slots and their descendants, level by level
+	void Update(JobSystem* jobs = nullptr);
+	//Local and world matrices of one slot from the current world of its parent. It stays dirty for its descendants
+	void UpdateSlot(unsigned int slot);
+
+	//World matrix changed in the last update
+	bool HasChanged(unsigned int slot) const { return changed[slot] != 0; }
+	ComponentTransform* GetOwner(unsigned int slot) const { return owners[slot]; }
+
+	unsigned int Size() const { return parents.size(); }
+	unsigned int GetParent(unsigned int slot) const { return parents[slot]; }
+	bool IsSorted() const { return isSorted; }
+
+	//Local TRS, local and world matrices, indexed by slot
+	std::vector<float3> positions;
+	std::vector<Quat> rotations;
+	std::vector<float3> scales;
+	std::vector<float4x4> localMatrices;
+	std::vector<float4x4> worldMatrices;
+
+	//Slots whose world matrix changed in the last update, in hierarchy order
+	std::vector<unsigned int> changedSlots;
+
+	//Times the slots were sorted again
+	unsigned int sortCount = 0;
+
+private:
+	void SortByDepth();
+	void UpdateRange(unsigned int begin, unsigned int end);
+
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> depths;
+	//First slot of each depth, valid while the slots are sorted
+	std::vector<unsigned int> levelStarts;
+	std::vector<ComponentTransform*> owners;
+	std::vector<bool> removed;
+	unsigned int removedCount = 0;
+	//Bytes instead of bits, they are read in the update pass
+	std::vector<unsigned char> dirty;
+	std::vector<unsigned char> changed;
+	unsigned int dirtyCount = 0;
+	unsigned int firstDirty = TRANSFORM_NULL_SLOT;
+	bool isSorted = true;
+
+};
+
+extern TransformHierarchy* Transforms;
+
+#endif __TransformHierarchy_H__
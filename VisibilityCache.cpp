@@ -0,0 +1,193 @@
+#include "VisibilityCache.h"
+#include "GameObject.h"
+#include "LooseOctree.h"
+#include "ComponentCamera.h"
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <string.h>
+
+VisibilityCache::CacheResult VisibilityCache::Collect(const MultiViewCuller & views, LooseOctree & octree, unsigned int staticEpoch, VisibleList & visible)
+{
+	retestedCount = 0;
+
+	CacheResult result = CACHE_REUSED;
+	if (!isValid || epoch != staticEpoch || viewCount != views.ViewCount() || !queryBounds.Contains(views.GetBounds()))
+	{
+		Rebuild(views, octree, staticEpoch);
+		result = CACHE_REBUILT;
+	}
+	else
+	{
+		bool sameViews = true;
+		for(unsigned int v = 0; v < viewCount; ++v)
+		{
+			//Exact comparison, any change goes through the plane drift
+			if (memcmp(&viewProjections[v], &views.GetViewProjection(v), sizeof(float4x4)) != 0)
+				sameViews = false;
+		}
+
+		if (!sameViews)
+		{
+			result = CACHE_PATCHED;
+			if (!Patch(views))
+			{
+				Rebuild(views, octree, staticEpoch);
+				result = CACHE_REBUILT;
+			}
+		}
+	}
+
+	for(unsigned int v = 0; v < viewCount; ++v)
+	{
+		viewProjections[v] = views.GetViewProjection(v);
+	}
+
+	for(unsigned int i = 0; i < candidates.size(); ++i)
+	{
+		if (masks[i].visible != 0 && candidates[i]->isEnabled)
+			visible.Add(candidates[i], masks[i].visible, masks[i].inside);
+	}
+
+	return result;
+}
+
+void VisibilityCache::Rebuild(const MultiViewCuller & views, LooseOctree & octree, unsigned int staticEpoch)
+{
+	//Candidates cover more than the views so small movements keep them valid
+	AABB viewBounds = views.GetBounds();
+	float3 margin = viewBounds.Size() * VISIBILITY_CACHE_MARGIN;
+	queryBounds = AABB(viewBounds.minPoint - margin, viewBounds.maxPoint + margin);
+
+	queryResult.Begin();
+	octree.GetIntersection(queryResult, &queryBounds);
+
+	candidates.assign(queryResult.begin(), queryResult.end());
+	candidateCount = candidates.size();
+	viewCount = views.ViewCount();
+
+	candidateBounds.SetNegativeInfinity();
+	nVertexDistances.resize(candidates.size() * viewCount);
+	pVertexDistances.resize(candidates.size() * viewCount);
+	masks.assign(candidates.size(), ViewMasks());
+
+	for(unsigned int v = 0; v < viewCount; ++v)
+	{
+		referenceViews[v] = views.GetView(v);
+	}
+
+	for(unsigned int i = 0; i < candidates.size(); ++i)
+	{
+		const AABB& aabb = *candidates[i]->globalBoundingBox;
+		candidateBounds.Enclose(aabb);
+
+		for(unsigned int v = 0; v < viewCount; ++v)
+		{
+			const FrustumCuller& view = referenceViews[v];
+			float nDistance = -std::numeric_limits<float>::max();
+			float pDistance = -std::numeric_limits<float>::max();
+			for(int p = 0; p < 6; ++p)
+			{
+				float nX = (view.planeX[p] > 0.0f) ? aabb.minPoint.x : aabb.maxPoint.x;
+				float nY = (view.planeY[p] > 0.0f) ? aabb.minPoint.y : aabb.maxPoint.y;
+				float nZ = (view.planeZ[p] > 0.0f) ? aabb.minPoint.z : aabb.maxPoint.z;
+				float pX = (view.planeX[p] > 0.0f) ? aabb.maxPoint.x : aabb.minPoint.x;
+				float pY = (view.planeY[p] > 0.0f) ? aabb.maxPoint.y : aabb.minPoint.y;
+				float pZ = (view.planeZ[p] > 0.0f) ? aabb.maxPoint.z : aabb.minPoint.z;
+
+				nDistance = std::max(nDistance, view.planeX[p] * nX + view.planeY[p] * nY + view.planeZ[p] * nZ - view.planeD[p]);
+				pDistance = std::max(pDistance, view.planeX[p] * pX + view.planeY[p] * pY + view.planeZ[p] * pZ - view.planeD[p]);
+			}
+
+			nVertexDistances[i * viewCount + v] = nDistance;
+			pVertexDistances[i * viewCount + v] = pDistance;
+
+			//Same codes as FrustumCuller::TestAABB
+			if (nDistance >= 0.0f)
+				continue;
+
+			masks[i].visible |= 1 << v;
+			if (pDistance < 0.0f)
+				masks[i].inside |= 1 << v;
+		}
+	}
+
+	epoch = staticEpoch;
+	isValid = true;
+
+	return;
+}
+
+bool VisibilityCache::Patch(const MultiViewCuller & views)
+{
+	float drift[CULL_MAX_VIEWS];
+	for(unsigned int v = 0; v < viewCount; ++v)
+	{
+		drift[v] = PlaneDrift(referenceViews[v], views.GetView(v));
+	}
+
+	unsigned int maxRetested = (unsigned int)(candidates.size() * VISIBILITY_CACHE_MAX_RETEST);
+	for(unsigned int i = 0; i < candidates.size(); ++i)
+	{
+		ViewMasks candidateMasks;
+		bool retested = false;
+		for(unsigned int v = 0; v < viewCount; ++v)
+		{
+			unsigned int viewBit = 1 << v;
+			float nDistance = nVertexDistances[i * viewCount + v];
+			float pDistance = pVertexDistances[i * viewCount + v];
+
+			//Planes have not moved enough to bring the box in
+			if (nDistance >= 0.0f && drift[v] < nDistance)
+				continue;
+
+			//Nor to take it out. It can stop being fully inside, then it is reported as crossing
+			if (nDistance < 0.0f && drift[v] < -nDistance)
+			{
+				candidateMasks.visible |= viewBit;
+				if (pDistance < 0.0f && drift[v] < -pDistance)
+					candidateMasks.inside |= viewBit;
+				continue;
+			}
+
+			retested = true;
+			int result = views.GetView(v).TestAABB(*candidates[i]->globalBoundingBox);
+			if (result != AABB_OUT)
+				candidateMasks.visible |= viewBit;
+			if (result == AABB_IN)
+				candidateMasks.inside |= viewBit;
+		}
+
+		if (retested && ++retestedCount > maxRetested)
+			return false;
+
+		masks[i] = candidateMasks;
+	}
+
+	return true;
+}
+
+float VisibilityCache::PlaneDrift(const FrustumCuller & reference, const FrustumCuller & current) const
+{
+	//The distance change is linear in the point, its extremes over a box are two of its corners
+	float drift = 0.0f;
+	for(int p = 0; p < 6; ++p)
+	{
+		float3 normalChange = float3(current.planeX[p] - reference.planeX[p], current.planeY[p] - reference.planeY[p], current.planeZ[p] - reference.planeZ[p]);
+		float dChange = current.planeD[p] - reference.planeD[p];
+
+		float minChange = -dChange;
+		float maxChange = -dChange;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			float low = normalChange[axis] * candidateBounds.minPoint[axis];
+			float high = normalChange[axis] * candidateBounds.maxPoint[axis];
+			minChange += std::min(low, high);
+			maxChange += std::max(low, high);
+		}
+
+		drift = std::max(drift, std::max(fabs(minChange), fabs(maxChange)));
+	}
+
+	return drift;
+}
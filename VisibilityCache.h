@@ -0,0 +1,71 @@
+#ifndef __VisibilityCache_H__
+#define __VisibilityCache_H__
+
+#include "Globals.h"
+#include "MultiViewCuller.h"
+#include "VisibleList.h"
+#include "MathGeoLib/Geometry/AABB.h"
+#include "MathGeoLib/Math/float4x4.h"
+#include <vector>
+
+class GameObject;
+class LooseOctree;
+
+//Candidates are taken from the box of the views grown by this fraction of its size on each side
+#define VISIBILITY_CACHE_MARGIN 0.1f
+//When more than this fraction of the candidates has to be tested again the cache is rebuilt
+#define VISIBILITY_CACHE_MAX_RETEST 0.25f
+
+//Visibility of the static objects kept between frames
+//A rebuild stores, for every candidate and view, the largest distance of its n-vertex and p-vertex to the planes.
+//Next frames are keyed on the view-projection of each view and on the static epoch of the scene:
+//- Same matrices: last results are used again without any test.
+//- Moved views: the largest distance change of the planes over the candidates is computed, only the boxes that are
+//  closer to a plane than that change are tested again.
+//- Static changes, views leaving the candidate box or too many boxes to test: full rebuild.
+class VisibilityCache
+{
+public:
+	enum CacheResult { CACHE_REUSED, CACHE_PATCHED, CACHE_REBUILT };
+
+	VisibilityCache() = default;
+	~VisibilityCache() = default;
+
+	//Adds the visible static objects to the list with their view masks. The candidates are found with a query of their
+	//own, so it has to be called before the list gets any other object
+	CacheResult Collect(const MultiViewCuller &views, LooseOctree &octree, unsigned int staticEpoch, VisibleList &visible);
+	//Next collect rebuilds
+	void Invalidate() { isValid = false; }
+
+	//Last collect
+	unsigned int candidateCount = 0;
+	unsigned int retestedCount = 0;
+
+private:
+	void Rebuild(const MultiViewCuller &views, LooseOctree &octree, unsigned int staticEpoch);
+	//Returns false if too many boxes are close to the planes
+	bool Patch(const MultiViewCuller &views);
+	//Largest change of the distance to a plane of any point of the candidates
+	float PlaneDrift(const FrustumCuller &reference, const FrustumCuller &current) const;
+
+	bool isValid = false;
+	unsigned int epoch = 0;
+	unsigned int viewCount = 0;
+	//Views of the last collect
+	float4x4 viewProjections[CULL_MAX_VIEWS];
+	//Views the distances were computed with
+	FrustumCuller referenceViews[CULL_MAX_VIEWS];
+
+	AABB queryBounds;
+	AABB candidateBounds;
+	VisibleList queryResult;
+	std::vector<GameObject*> candidates;
+	//viewCount distances per candidate, positive n-vertex distance means out and positive p-vertex one crossing
+	std::vector<float> nVertexDistances;
+	std::vector<float> pVertexDistances;
+	//Results of the last collect
+	std::vector<ViewMasks> masks;
+
+};
+
+#endif __VisibilityCache_H__
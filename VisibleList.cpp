@@ -0,0 +1,53 @@
+#include "VisibleList.h"
+#include "GameObject.h"
+
+unsigned VisibleList::lastStamp = 0;
+
+void VisibleList::Begin()
+{
+	//Keep the memory for the next query
+	gameObjects.clear();
+	stamp = ++lastStamp;
+
+	return;
+}
+
+bool VisibleList::Add(GameObject * go)
+{
+	if (go->visibleStamp == stamp)
+		return false;
+
+	go->visibleStamp = stamp;
+	gameObjects.push_back(go);
+
+	return true;
+}
+
+bool VisibleList::Add(GameObject * go, unsigned int visibleViews, unsigned int insideViews)
+{
+	if (go->visibleStamp == stamp)
+	{
+		go->visibleViews |= visibleViews;
+		go->insideViews |= insideViews;
+		return false;
+	}
+
+	go->visibleStamp = stamp;
+	go->visibleViews = visibleViews;
+	go->insideViews = insideViews;
+	gameObjects.push_back(go);
+
+	return true;
+}
+
+bool VisibleList::Contains(const GameObject * go) const
+{
+	return go->visibleStamp == stamp;
+}
+
+void VisibleList::Resize(unsigned size)
+{
+	gameObjects.resize(size);
+
+	return;
+}
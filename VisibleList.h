@@ -0,0 +1,44 @@
+#ifndef __VisibleList_H__
+#define __VisibleList_H__
+
+#include "Globals.h"
+#include <vector>
+
+class GameObject;
+
+//Result of the spatial queries
+//Objects are written in a contiguous array that keeps its memory between frames. Duplicates are discarded
+//comparing the stamp of the object with the stamp of the query, so only one list can be filled at a time.
+class VisibleList
+{
+public:
+	VisibleList() = default;
+	~VisibleList() = default;
+
+	//Starts a new query, previous results are discarded
+	void Begin();
+	//Returns false if the object was already added in this query
+	bool Add(GameObject* go);
+	//Multi view queries, the view masks of an object added twice are merged
+	bool Add(GameObject* go, unsigned int visibleViews, unsigned int insideViews);
+	bool Contains(const GameObject* go) const;
+
+	//Keeps only the first size objects, removed ones still count as added
+	void Resize(unsigned size);
+	unsigned Size() const { return gameObjects.size(); }
+
+	GameObject* operator[](unsigned index) const { return gameObjects[index]; }
+	GameObject*& operator[](unsigned index) { return gameObjects[index]; }
+	std::vector<GameObject*>::const_iterator begin() const { return gameObjects.begin(); }
+	std::vector<GameObject*>::const_iterator end() const { return gameObjects.end(); }
+
+private:
+	std::vector<GameObject*> gameObjects;
+	unsigned stamp = 0;
+
+	//Shared by all the lists so two queries never have the same stamp
+	static unsigned lastStamp;
+
+};
+
+#endif __VisibleList_H__